@@ -0,0 +1,62 @@
+#pragma once
+
+#include "Journal.h"
+#include "MatchingEngine.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace engine {
+
+struct BacktestConfig {
+    size_t threads = 0;            // workers, 0 = one per hardware thread
+    BookConfig book;               // every symbol's book (see EngineShape::bookConfig for a journal's)
+    size_t poolSize = 1 << 16;     // each worker's first pool size — it grows, and is kept across tasks
+    bool keepTrades = true;        // false: only count and digest the trades
+};
+
+// One trade of the merged result
+struct BacktestTrade {
+    uint64_t timeNs;       // arrival time of the message that traded (0 in files without timing)
+    uint64_t sequence;     // that message's position in its file, from 1 (a journal's own sequence)
+    uint32_t day;          // which input file
+    Trade trade;           // with the symbol as recorded
+};
+
+struct BacktestResult {
+    uint64_t messages = 0;
+    uint64_t rejected = 0;          // messages the engine refused (cancels of orders already gone, ...)
+    TradeDigest digest;             // every trade, in merged order
+    std::vector<BacktestTrade> trades;   // merged: by day, then arrival time, then sequence
+    size_t threads = 0;
+    size_t tasks = 0;               // symbol-days replayed
+    uint64_t steals = 0;            // tasks a worker took from another worker's queue
+    double splitSeconds = 0;        // mapping the files and splitting them by symbol
+    double replaySeconds = 0;
+    double mergeSeconds = 0;
+
+    double messagesPerSecond() const { return replaySeconds > 0 ? static_cast<double>(messages) / replaySeconds : 0; }
+};
+
+// Replay recorded flow, one file per day — journals or saved workloads, mixed freely
+//
+// Each file is mapped read-only and split by symbol in one pass into lists
+// of message positions, in parallel across days. A symbol-day is one task:
+// symbols trade independently and every day starts from an empty book, so
+// tasks share nothing. Tasks are dealt out largest first to per-worker
+// queues; a worker runs its own largest remaining task and, once its queue
+// is empty, steals the smallest from another's. Each worker builds one
+// single-book engine on its own thread and resets it between tasks, so the
+// pool, ID index and ladders are allocated once per worker — not per task,
+// and not per day. The per-task trades are then merged by day, arrival time
+// and sequence, which for a journal reproduces its recorded trade digest.
+//
+// Splitting needs cancels and modifies to carry their order's symbol, as
+// the protocol and the workload generator do.
+//
+// Throws std::system_error if a file can't be read, std::runtime_error if
+// one is neither format.
+BacktestResult runBacktest(const std::vector<std::string>& days, const BacktestConfig& config = {});
+
+} // namespace engine
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "Types.h"
+
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace engine {
+
+// Where timestamps come from
+enum class ClockSource : uint8_t {
+    Steady,   // std::chrono::steady_clock::now() — a vDSO call per read
+    Tsc       // CPU timestamp counter, converted with a startup calibration
+};
+
+// Raw timestamp counter reads
+// rdtsc can be reordered with nearby instructions, which is fine for stamping
+// events; rdtscp waits for earlier instructions, which is what interval
+// timing wants. Non-x86 builds use the ARM virtual counter or steady_clock.
+inline uint64_t readTsc() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t ticks;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#else
+    return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+inline uint64_t readTscSerialized() {
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned aux;
+    return __rdtscp(&aux);
+#else
+    return readTsc();
+#endif
+}
+
+// Maps counter ticks onto steady_clock time
+// Calibrated once (the first time it's used) by spinning ~10ms and comparing
+// both clocks. Assumes an invariant TSC (constant_tsc / nonstop_tsc), which
+// every server CPU of the last decade has.
+class TscCalibration {
+public:
+    static const TscCalibration& get();
+
+    Timestamp toTimestamp(uint64_t ticks) const {
+        auto ns = static_cast<int64_t>(static_cast<double>(static_cast<int64_t>(ticks - baseTicks_)) * nsPerTick_);
+        return baseTime_ + std::chrono::nanoseconds(ns);
+    }
+
+    double nsPerTick() const { return nsPerTick_; }
+    double ticksPerNs() const { return 1.0 / nsPerTick_; }
+
+private:
+    TscCalibration();
+
+    uint64_t baseTicks_;
+    Timestamp baseTime_;
+    double nsPerTick_;
+};
+
+// The engine's clock
+// With stampPerMessage, beginMessage() reads the clock once and every stamp()
+// until the next message — the order and all the trades it produces — reuses
+// that time. Otherwise stamp() reads the clock each time.
+class Clock {
+public:
+    explicit Clock(ClockSource source = ClockSource::Steady, bool stampPerMessage = true)
+        : source_(source)
+        , perMessage_(stampPerMessage)
+        , tsc_(source == ClockSource::Tsc ? &TscCalibration::get() : nullptr)
+    {}
+
+    // Read the clock
+    Timestamp now() const {
+        if (tsc_) return tsc_->toTimestamp(readTsc());
+        return engine::now();
+    }
+
+    // Call once at the start of each inbound message (or batch)
+    void beginMessage() {
+        if (perMessage_) current_ = now();
+    }
+
+    // Timestamp for an order or trade in the current message
+    Timestamp stamp() const {
+        return perMessage_ ? current_ : now();
+    }
+
+    ClockSource source() const { return source_; }
+    bool stampsPerMessage() const { return perMessage_; }
+
+private:
+    ClockSource source_;
+    bool perMessage_;
+    const TscCalibration* tsc_;
+    Timestamp current_{};
+};
+
+} // namespace engine
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "PriceLadder.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace engine {
+
+// Vectorised scans over runs of price levels, for depth and sweep-cost queries
+//
+// A ladder side is one array of 32-byte PriceLevels, and levels without
+// orders always hold totalQuantity 0, so "how much rests within N ticks" or
+// "how far does X go" is a scan of totalQuantity along the array — no
+// bitmap, no orders touched. The AVX2 and AVX-512 kernels read whole levels
+// (one or two per register) and keep running and prefix sums per lane, which
+// gives Σ quantity and Σ quantity × distance without gathers or multiplies.
+// The kernel is picked once from what the CPU supports; the scalar loop is
+// the fallback and the reference.
+enum class SimdLevel : uint8_t {
+    Scalar,
+    Avx2,
+    Avx512
+};
+
+// Best kernel this CPU runs — what sweepLevels uses
+SimdLevel supportedSimd();
+const char* simdName(SimdLevel level);
+
+inline constexpr size_t kNotReached = static_cast<size_t>(-1);
+
+struct SweepResult {
+    uint64_t quantity = 0;        // taken, at most the target
+    uint64_t weighted = 0;        // Σ quantity taken × its distance (in levels) from the first level
+    size_t reachedAt = kNotReached;   // distance of the level that brought quantity up to the target
+};
+
+// Take totalQuantity from `count` consecutive levels, starting at `first` and
+// moving to higher addresses (lower when `down`), until `target` is reached
+// Pass UINT64_MAX as the target to sum the whole run.
+SweepResult sweepLevels(const PriceLevel* first, size_t count, bool down, uint64_t target);
+
+// The same with a given kernel (one the CPU doesn't support falls back to the best it does)
+SweepResult sweepLevels(SimdLevel level, const PriceLevel* first, size_t count, bool down, uint64_t target);
+
+} // namespace engine
@@ -0,0 +1,217 @@
+#pragma once
+
+#include "Clock.h"
+#include "Order.h"
+#include "Trade.h"
+#include "Messages.h"
+#include "SpscRing.h"
+#include "WaitStrategy.h"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/uio.h>
+
+namespace engine {
+
+// === Execution reports ===
+// What a drop copy carries, one fixed-width binary record per event
+enum class ExecType : uint8_t {
+    Trade,       // orderId = aggressor, otherId = resting order; flags say whose fill it completed
+    Rested,      // order accepted and resting, or a stop parked (quantity: displayed)
+    Cancelled,   // cancel ack, or the unfilled rest of a market / IOC order (quantity: what was left)
+    Modified,    // amended — price and quantity are the new ones
+    Triggered,   // parked stop reached (price: its limit, 0 for a stop)
+    Clock        // time anchor: price holds the absolute time in ns, the next delta counts from it
+};
+
+// Trade flags: a trade without its side's flag is a partial fill of that order
+inline constexpr uint8_t kAggressorFilled = 1;
+inline constexpr uint8_t kRestingFilled = 2;
+
+// One execution report — 40 bytes, no padding. Timestamps are nanoseconds
+// since the previous report in the stream; a Clock report sets the absolute
+// time whenever the gap doesn't fit in 32 bits (and at the start). Sequence
+// numbers aren't stored per report: each frame carries the first one and the
+// reports in it follow on by one.
+struct ExecReport {
+    ExecType type;
+    Side side;            // trades: the aggressor's; otherwise the order's
+    uint8_t flags;        // trades: kAggressorFilled / kRestingFilled
+    uint8_t reserved;
+    uint32_t timeDelta;   // ns since the previous report
+    SymbolId symbol;
+    Quantity quantity;    // trade size, or the order's quantity (see ExecType)
+    OrderId orderId;
+    OrderId otherId;      // trades only
+    Price price;
+};
+
+static_assert(sizeof(ExecReport) == 40, "ExecReport is written as a fixed 40-byte record");
+
+// === Stream format ===
+// A DropCopyHeader, then frames: a DropCopyFrame and `count` ExecReports.
+// Records go out as they are in memory, like the journal, so both ends must
+// share the architecture.
+struct DropCopyHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t recordSize;
+};
+
+struct DropCopyFrame {
+    uint64_t firstSequence;   // of the frame's first report; the stream starts at 1
+    uint32_t count;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(DropCopyHeader) == 16 && sizeof(DropCopyFrame) == 16, "Drop copy headers have no padding");
+
+// A report read back, with its sequence and absolute time restored
+struct DecodedReport {
+    uint64_t sequence;
+    int64_t timeNs;
+    ExecReport report;
+};
+
+// Read a whole drop copy file — throws std::runtime_error if it isn't one
+// (a torn last frame is ignored)
+std::vector<DecodedReport> readDropCopy(const std::string& path);
+
+struct DropCopyConfig {
+    std::string path;                           // file to create (or truncate) ...
+    int fd = -1;                                // ... or one already open, or a connected socket (blocking; left open)
+    size_t ringCapacity = 1 << 16;              // reports buffered between matching and the writer
+    size_t maxBatch = 1 << 14;                  // most reports per frame, and so per write
+    WaitStrategy wait = WaitStrategy::Backoff;  // writer thread when idle, the matching thread when the ring is full
+};
+
+// Execution reports for a drop copy, written from a background thread
+//
+// A listener: pass it to the engine (or set RunnerConfig::dropCopy) and each
+// callback encodes one ExecReport straight into a slot of a preallocated
+// ring — no Trade or event is built, no text formatted. commit() after each
+// message (or batch) publishes its reports; until then a fill can still
+// mark the trade that completed it. The writer thread frames whatever is
+// published and hands it to writev() from the ring itself, so the reports
+// are never copied in user space, and batches under load grow to maxBatch.
+// The matching thread only waits if the ring fills.
+//
+// The callbacks and commit() must be called from one thread, and a report
+// stamped from `clock` (everything but a trade) takes its time from it.
+class DropCopyWriter {
+public:
+    // Opens the file (or takes the descriptor) and writes the stream header
+    // — throws std::system_error
+    DropCopyWriter(const DropCopyConfig& config, const Clock& clock);
+    ~DropCopyWriter();
+
+    DropCopyWriter(const DropCopyWriter&) = delete;
+    DropCopyWriter& operator=(const DropCopyWriter&) = delete;
+
+    void onTrade(const Trade& trade) {
+        ExecReport* report = next(trade.timestamp);
+        bool buy = trade.aggressor == Side::Buy;
+        *report = {ExecType::Trade, trade.aggressor, 0, 0, report->timeDelta, trade.symbol, trade.quantity,
+                   buy ? trade.buyOrderId : trade.sellOrderId, buy ? trade.sellOrderId : trade.buyOrderId, trade.price};
+        lastTrade_ = report;
+        lastTradeIndex_ = encoded_ - 1;
+    }
+    void onOrderFilled(const Order& order) {
+        // Always the order of this message's latest trade, still unpublished
+        if (!lastTrade_) return;
+        if (lastTrade_->orderId == order.id) {
+            lastTrade_->flags |= kAggressorFilled;
+        } else if (lastTrade_->otherId == order.id) {
+            lastTrade_->flags |= kRestingFilled;
+        }
+    }
+    void onOrderRested(const Order& order) { orderReport(ExecType::Rested, order); }
+    void onOrderCancelled(const Order& order) { orderReport(ExecType::Cancelled, order); }
+    void onOrderModified(const Order& order) { orderReport(ExecType::Modified, order); }
+    void onOrderTriggered(const Order& order) { orderReport(ExecType::Triggered, order); }
+    void onRejected(const OrderMsg&) {}
+
+    // Publish the reports encoded since the last commit — throws std::system_error if the writer has failed
+    void commit() {
+        ring_.publish();
+        published_ = encoded_;
+        lastTrade_ = nullptr;
+        checkError();
+    }
+
+    // Block until everything committed is written
+    void flush();
+
+    uint64_t committed() const { return published_; }
+    uint64_t written() const { return written_.load(std::memory_order_acquire); }
+    uint64_t bytesWritten() const { return bytes_.load(std::memory_order_relaxed); }
+    uint64_t writes() const { return writes_.load(std::memory_order_relaxed); }
+
+private:
+    DropCopyConfig config_;
+    const Clock& clock_;
+    int fd_ = -1;
+    bool ownsFd_ = false;
+    bool socket_ = false;   // sent with MSG_NOSIGNAL, so a dropped peer is an error rather than SIGPIPE
+    SpscRing<ExecReport> ring_;
+
+    // Matching thread
+    int64_t lastNs_ = 0;
+    bool anchored_ = false;
+    uint64_t encoded_ = 0;          // reports claimed in the ring
+    uint64_t published_ = 0;        // of those, handed to the writer
+    ExecReport* lastTrade_ = nullptr;
+    uint64_t lastTradeIndex_ = 0;   // its place among the encoded reports
+
+    // Writer thread
+    std::thread thread_;
+    std::atomic<bool> stopping_{false};
+    alignas(kCacheLineSize) std::atomic<uint64_t> written_{0};
+    std::atomic<uint64_t> bytes_{0};
+    std::atomic<uint64_t> writes_{0};
+    std::atomic<int> error_{0};
+
+    void orderReport(ExecType type, const Order& order) {
+        ExecReport* report = next(clock_.stamp());
+        *report = {type, order.side, 0, 0, report->timeDelta, order.symbol, order.remaining, order.id, 0, order.price};
+    }
+
+    // A slot for the next report with its timeDelta set, after a Clock
+    // report if the gap since the last one doesn't fit
+    ExecReport* next(Timestamp time) {
+        int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+        int64_t delta = ns - lastNs_;
+        if (!anchored_ || delta < 0 || delta > static_cast<int64_t>(UINT32_MAX)) [[unlikely]] {
+            *claim() = {ExecType::Clock, Side::Buy, 0, 0, 0, 0, 0, 0, 0, ns};
+            anchored_ = true;
+            delta = 0;
+        }
+        lastNs_ = ns;
+        ExecReport* report = claim();
+        report->timeDelta = static_cast<uint32_t>(delta);
+        return report;
+    }
+
+    ExecReport* claim() {
+        ExecReport* slot = ring_.claim();
+        if (!slot) [[unlikely]] slot = claimSlow();
+        encoded_++;
+        return slot;
+    }
+    ExecReport* claimSlow();
+
+    void checkError() const {
+        if (error_.load(std::memory_order_relaxed)) [[unlikely]] throwError();
+    }
+    [[noreturn]] void throwError() const;
+
+    void run();
+    void writeFrame(uint64_t firstSequence, std::span<const ExecReport> reports);
+    void writeAll(iovec* parts, int count);
+};
+
+} // namespace engine
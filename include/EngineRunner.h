@@ -0,0 +1,108 @@
+#pragma once
+
+#include "MatchingEngine.h"
+#include "Messages.h"
+#include "SpscRing.h"
+#include "WaitStrategy.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+namespace engine {
+
+class DropCopyWriter;
+class JournalWriter;
+class ReplicationPrimary;
+
+struct RunnerConfig {
+    size_t inboundCapacity = 1 << 16;      // messages waiting to be matched
+    size_t outboundCapacity = 1 << 18;     // events waiting to be read
+    size_t batchSize = 64;                 // most messages drained per ring read
+    int cpu = -1;                          // core to pin the matching thread to (-1 = don't pin)
+    WaitStrategy wait = WaitStrategy::Backoff;
+    // If set, every accepted message is journaled (one runner per journal);
+    // a journal write failure ends the matching thread with std::terminate
+    JournalWriter* journal = nullptr;
+
+    // If set, every accepted message is also streamed to hot standbys
+    // (start it at the journal's appended() so both number records alike)
+    ReplicationPrimary* replication = nullptr;
+
+    // If set, every event also goes to a binary drop copy, committed once per
+    // batch; a drop copy write failure ends the matching thread like the journal's
+    DropCopyWriter* dropCopy = nullptr;
+
+    // If set, fork a snapshot to this path every snapshotEvery messages (one at a time)
+    std::string snapshotPath;
+    uint64_t snapshotEvery = 0;
+};
+
+// Pin the calling thread to one core — returns false if not supported or it failed
+bool pinCurrentThread(int cpu);
+
+// Runs a MatchingEngine on its own thread
+//
+// A gateway thread hands orders in through submit() (an SPSC ring, so exactly
+// one producer thread), the matching thread drains them in batches into the
+// engine, and trade/ack events come back through a second SPSC ring read with
+// poll() by exactly one consumer thread. Nothing is locked or allocated per message.
+// With CancelMode::Lazy, the matching thread compacts one mostly-dead level
+// per empty poll of the inbound ring (MatchingEngine::compact) — so handles
+// in events aren't reproducible from a journal replay (see CancelMode).
+//
+// The engine must not be touched by other threads while the runner is started.
+// If the outbound ring fills the matching thread waits for the consumer, so
+// keep polling.
+class EngineRunner {
+public:
+    explicit EngineRunner(MatchingEngine& engine, const RunnerConfig& config = {});
+    ~EngineRunner();
+
+    EngineRunner(const EngineRunner&) = delete;
+    EngineRunner& operator=(const EngineRunner&) = delete;
+
+    void start();
+
+    // Finish everything already submitted, then join the matching thread
+    // Events that no longer fit in the outbound ring at that point are dropped.
+    // With a journal, also waits until everything processed is durable, and
+    // with a drop copy until it is all written.
+    void stop();
+
+    // Producer side — false if the inbound ring is full
+    bool submit(const OrderMsg& msg) { return inbound_.tryPush(msg); }
+
+    // Consumer side
+    bool poll(EngineEvent& event) { return outbound_.tryPop(event); }
+    size_t poll(EngineEvent* events, size_t maxEvents) { return outbound_.popBatch(events, maxEvents); }
+
+    uint64_t processed() const { return processed_.load(std::memory_order_acquire); }
+    uint64_t droppedEvents() const { return dropped_.load(std::memory_order_relaxed); }
+    uint64_t snapshotsWritten() const { return snapshotsWritten_.load(std::memory_order_relaxed); }
+    uint64_t snapshotsFailed() const { return snapshotsFailed_.load(std::memory_order_relaxed); }
+    bool running() const { return running_.load(std::memory_order_acquire); }
+
+private:
+    struct RingListener;
+
+    MatchingEngine& engine_;
+    RunnerConfig config_;
+    SpscRing<OrderMsg> inbound_;
+    SpscRing<EngineEvent> outbound_;
+    std::thread thread_;
+
+    std::atomic<bool> running_{false};
+    alignas(kCacheLineSize) std::atomic<uint64_t> processed_{0};
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<uint64_t> snapshotsWritten_{0};
+    std::atomic<uint64_t> snapshotsFailed_{0};
+
+    void run();
+    void process(const OrderMsg& msg, RingListener& listener);
+    void maybeSnapshot(const RingListener& listener, uint64_t processed, uint64_t& lastSnapshotAt, int& child);
+    void reapSnapshot(int& child, bool wait);
+    void publish(const EngineEvent& event, Waiter& waiter);
+};
+
+} // namespace engine
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "Clock.h"
+#include "Order.h"
+#include "Trade.h"
+#include "Messages.h"
+
+#include <vector>
+
+namespace engine {
+
+// Callbacks the engine makes while it processes an order
+// Derive from this and hide the ones you care about. The engine takes the
+// listener as a template parameter, so calls are resolved at compile time —
+// no virtual dispatch, and the empty defaults compile away to nothing.
+//
+// Orders passed to callbacks are only valid for the duration of the call.
+struct EventListener {
+    void onTrade(const Trade&) {}
+    void onOrderFilled(const Order&) {}      // resting or incoming order fully filled
+    void onOrderRested(const Order&) {}      // incoming order added to the book, or a stop parked
+    void onOrderCancelled(const Order&) {}   // cancelled, or unfilled rest of a market order
+    void onOrderModified(const Order&) {}    // resting order amended (new price/quantity already applied)
+    void onOrderTriggered(const Order&) {}   // parked stop reached, about to trade as a market or limit order
+    void onRejected(const OrderMsg&) {}      // batch message refused (bad price/symbol, unknown order, pool full)
+};
+
+// Collects trades into a vector — backs the std::vector<Trade> API
+struct TradeCollector : EventListener {
+    std::vector<Trade>& trades;
+
+    explicit TradeCollector(std::vector<Trade>& out) : trades(out) {}
+
+    void onTrade(const Trade& trade) { trades.push_back(trade); }
+};
+
+// Writes every callback into one flat vector of EngineEvents — the sink for
+// submitBatch. Reserve the vector up front and clear() it between batches, so
+// collecting events never allocates. Same conventions as the runner's
+// outbound events: a trade's orderId is the aggressor, otherId the resting order.
+struct EventBuffer : EventListener {
+    const Clock& clock;
+    std::vector<EngineEvent>& events;
+
+    EventBuffer(const Clock& c, std::vector<EngineEvent>& out) : clock(c), events(out) {}
+
+    void onTrade(const Trade& trade) {
+        bool buy = trade.aggressor == Side::Buy;
+        events.push_back({EventType::Trade, trade.aggressor, trade.symbol,
+                          buy ? trade.buyOrderId : trade.sellOrderId,
+                          buy ? trade.sellOrderId : trade.buyOrderId,
+                          trade.price, trade.quantity, trade.timestamp, {}});
+    }
+    void onOrderRested(const Order& order) {
+        events.push_back({EventType::Rested, order.side, order.symbol, order.id, 0, order.price, order.remaining, clock.stamp(), order.handle()});
+    }
+    void onOrderFilled(const Order& order) {
+        events.push_back({EventType::Filled, order.side, order.symbol, order.id, 0, order.price, 0, clock.stamp(), order.handle()});
+    }
+    void onOrderCancelled(const Order& order) {
+        events.push_back({EventType::Cancelled, order.side, order.symbol, order.id, 0, order.price, order.remaining, clock.stamp(), order.handle()});
+    }
+    void onOrderModified(const Order& order) {
+        events.push_back({EventType::Modified, order.side, order.symbol, order.id, 0, order.price, order.remaining, clock.stamp(), order.handle()});
+    }
+    void onOrderTriggered(const Order& order) {
+        events.push_back({EventType::Triggered, order.side, order.symbol, order.id, 0, order.price, order.remaining, clock.stamp(), order.handle()});
+    }
+    void onRejected(const OrderMsg& msg) {
+        events.push_back({EventType::Rejected, msg.side, msg.symbol, msg.id, 0, msg.price, msg.quantity, clock.stamp(), {}});
+    }
+};
+
+} // namespace engine
@@ -0,0 +1,126 @@
+#pragma once
+
+#include "EngineRunner.h"
+#include "Protocol.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct io_uring_sqe;
+
+namespace engine {
+
+class IoUring;
+class BufferRing;
+
+struct GatewayConfig {
+    std::string address = "0.0.0.0";
+    uint16_t port = 0;                   // 0 = any free port (see Gateway::port())
+    size_t maxConnections = 1024;
+    unsigned ringEntries = 4096;         // io_uring submission queue
+    unsigned receiveBuffers = 4096;      // registered receive buffers, a power of two
+    size_t receiveBufferSize = 4096;
+    size_t eventBatch = 256;             // most events read from the runner at once
+    size_t maxQueuedBytes = 4 << 20;     // reports waiting for one client before it's dropped as too slow
+    int cpu = -1;                        // core to pin the gateway thread to (-1 = don't pin)
+    WaitStrategy wait = WaitStrategy::Backoff;
+};
+
+struct GatewayStats {
+    uint64_t accepted = 0;        // connections accepted
+    uint64_t refused = 0;         // connections closed on arrival because the table was full
+    uint64_t open = 0;            // connections open now
+    uint64_t frames = 0;          // order frames passed to the runner
+    uint64_t badFrames = 0;       // frames rejected by the gateway itself
+    uint64_t reports = 0;         // report frames queued for clients
+    uint64_t receives = 0;        // receive completions
+    uint64_t syscalls = 0;        // io_uring_enter calls
+    uint64_t slowClients = 0;     // connections dropped for not reading their reports
+};
+
+// Binary order entry over TCP, on io_uring (see Protocol.h for the frames)
+//
+// One thread runs the whole network side. A multishot accept takes
+// connections and each one gets a multishot receive into the registered
+// buffer ring, so the kernel writes socket data straight into buffers the
+// gateway owns and reports it with no further syscalls. Frames are decoded
+// where they landed into OrderMsgs for the runner's inbound ring, and the
+// buffer goes straight back to the kernel. The same thread drains the
+// runner's events, writes each as a report frame into its connection's out
+// buffer, and sends every connection's batch with one send each — all the
+// receive re-arms and sends of a loop go to the kernel in one io_uring_enter.
+//
+// Client order ids are per connection: the engine sees
+// (client id << 24) | session, and events are routed back by the low bits
+// (so use the engine's default hashed ID index, not IndexMode::Direct).
+// A connection's resting orders stay in the book after it disconnects.
+//
+// The gateway is the runner's only producer and only consumer, so nothing
+// else may submit() to or poll() the runner while it runs.
+class Gateway {
+public:
+    // Binds and listens — throws std::system_error (also if io_uring isn't available)
+    Gateway(EngineRunner& runner, const GatewayConfig& config = {});
+    ~Gateway();
+
+    Gateway(const Gateway&) = delete;
+    Gateway& operator=(const Gateway&) = delete;
+
+    void start();
+
+    // Close every connection and join the gateway thread (the runner keeps running)
+    void stop();
+
+    uint16_t port() const { return port_; }
+    GatewayStats stats() const;
+
+private:
+    struct Connection;
+
+    EngineRunner& runner_;
+    GatewayConfig config_;
+    int listenFd_ = -1;
+    uint16_t port_ = 0;
+    std::unique_ptr<IoUring> ring_;
+    std::unique_ptr<BufferRing> buffers_;
+
+    std::vector<Connection> connections_;
+    std::vector<uint32_t> dirty_;       // connections with reports to send
+    std::vector<uint32_t> rearm_;       // connections whose receive needs re-arming
+    std::vector<EngineEvent> events_;
+    uint32_t nextSession_ = 1;
+    bool acceptArmed_ = false;
+    bool stopping_ = false;
+    GatewayStats counts_;               // the gateway thread's, published each loop
+
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+    std::atomic<uint64_t> published_[9];   // one per GatewayStats field
+
+    void run();
+    void shutdown();
+    void publishStats();
+    void onCompletion(uint64_t data, int result, uint32_t flags);
+    void onAccept(int result, uint32_t flags);
+    void onReceive(Connection& c, int result, uint32_t flags);
+    void onSend(Connection& c, int result);
+    void consume(Connection& c, const char* data, size_t length);
+    void handleFrame(Connection& c, const char* frame);
+    size_t drainEvents();
+    void route(const EngineEvent& event);
+    void queueReport(Connection& c, const Report& report);
+    void flush();
+    void startSend(Connection& c);
+    void armAccept();
+    void armReceive(Connection& c);
+    void close(Connection& c);
+    void release(Connection& c);
+    Connection* bySession(uint32_t session);
+    io_uring_sqe* nextSqe();
+};
+
+} // namespace engine
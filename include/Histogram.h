@@ -0,0 +1,106 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+namespace engine {
+
+// Latency histogram with the HdrHistogram layout
+// Values below 2^precisionBits are counted exactly. Above that, each power of
+// two is split into 2^precisionBits linear sub-buckets, so any value is kept
+// to within 1 / 2^precisionBits of itself (11 bits ≈ 3 significant digits).
+// Memory is fixed at construction and record() is a few shifts and an add —
+// no samples are stored, so it can sit in the measured loop.
+class Histogram {
+public:
+    explicit Histogram(int precisionBits = 11, uint64_t maxValue = 3'600'000'000'000ull)   // 1 hour in ns
+        : subBits_(precisionBits)
+        , subCount_(uint64_t{1} << precisionBits)
+        , maxValue_(maxValue)
+    {
+        if (precisionBits < 1 || precisionBits > 20 || maxValue < subCount_) {
+            throw std::invalid_argument("Histogram precision or range out of bounds");
+        }
+        counts_.assign(indexOf(maxValue) + 1, 0);
+    }
+
+    // Values above maxValue are counted as maxValue
+    void record(uint64_t value) {
+        value = std::min(value, maxValue_);
+        counts_[indexOf(value)]++;
+        total_++;
+        sum_ += value;
+        min_ = std::min(min_, value);
+        max_ = std::max(max_, value);
+    }
+
+    void merge(const Histogram& other) {
+        if (other.subBits_ != subBits_ || other.counts_.size() != counts_.size()) {
+            throw std::invalid_argument("Can only merge histograms of the same layout");
+        }
+        for (size_t i = 0; i < counts_.size(); ++i) counts_[i] += other.counts_[i];
+        total_ += other.total_;
+        sum_ += other.sum_;
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+    }
+
+    void reset() {
+        std::fill(counts_.begin(), counts_.end(), 0);
+        total_ = 0;
+        sum_ = 0;
+        min_ = std::numeric_limits<uint64_t>::max();
+        max_ = 0;
+    }
+
+    uint64_t count() const { return total_; }
+    uint64_t min() const { return total_ ? min_ : 0; }
+    uint64_t max() const { return max_; }
+    double mean() const { return total_ ? static_cast<double>(sum_) / static_cast<double>(total_) : 0.0; }
+
+    // Smallest value that at least `p` percent of recordings are at or below
+    // (reported as the top of its sub-bucket, never above the largest value recorded)
+    uint64_t percentile(double p) const {
+        if (total_ == 0) return 0;
+        auto target = static_cast<uint64_t>(std::ceil(std::clamp(p, 0.0, 100.0) / 100.0 * static_cast<double>(total_)));
+        target = std::max<uint64_t>(target, 1);
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts_.size(); ++i) {
+            seen += counts_[i];
+            if (seen >= target) return std::min(highestEquivalent(i), max_);
+        }
+        return max_;
+    }
+
+private:
+    int subBits_;
+    uint64_t subCount_;
+    uint64_t maxValue_;
+    std::vector<uint64_t> counts_;
+    uint64_t total_ = 0;
+    uint64_t sum_ = 0;
+    uint64_t min_ = std::numeric_limits<uint64_t>::max();
+    uint64_t max_ = 0;
+
+    // [0, subCount) exact; then bucket b >= 1 covers [subCount << (b-1), subCount << b)
+    size_t indexOf(uint64_t value) const {
+        if (value < subCount_) return static_cast<size_t>(value);
+        int shift = (63 - std::countl_zero(value)) - subBits_;
+        uint64_t sub = (value >> shift) - subCount_;
+        return static_cast<size_t>((static_cast<uint64_t>(shift) + 1) * subCount_ + sub);
+    }
+
+    uint64_t highestEquivalent(size_t index) const {
+        if (index < subCount_) return index;
+        uint64_t shift = index / subCount_ - 1;
+        uint64_t sub = index % subCount_;
+        return ((subCount_ + sub) << shift) + ((uint64_t{1} << shift) - 1);
+    }
+};
+
+} // namespace engine
@@ -0,0 +1,177 @@
+#pragma once
+
+#include "Clock.h"
+#include "Order.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <type_traits>
+
+// Hot-path counters and phase timers, compiled in with -DENGINE_INSTRUMENT=1
+// (cmake -DENGINE_INSTRUMENT=ON). When it's 0 every hook below is an empty
+// inline function or an empty object, so the engine compiles to the same code
+// as without them.
+#ifndef ENGINE_INSTRUMENT
+#define ENGINE_INSTRUMENT 0
+#endif
+
+namespace engine {
+
+inline constexpr bool kInstrumented = ENGINE_INSTRUMENT != 0;
+
+enum class Counter : uint8_t {
+    LevelsCreated,     // price levels that went from empty to non-empty
+    LevelsErased,
+    LadderRecenters,   // ladder windows moved (or grown) to fit a price
+    Lookups,           // ID index finds
+    LookupProbes,      // slots examined by those finds
+    LookupMaxProbe,    // longest single find (a maximum, not a sum)
+    Sweeps,            // match loop runs
+    SweepFills,        // fills produced by those runs
+    SweepLevels,       // levels they traded against
+    SweepMaxLevels,    // deepest single sweep (maximum)
+    PoolHighWater,     // most orders live in the pool at once (maximum)
+    StopsTriggered,    // parked stops released into the book by a trade
+    SelfTradesPrevented, // resting orders cancelled rather than traded with their own account
+    Count
+};
+
+// Time spent inside submitLimit / submitMarket / cancel / modify
+enum class Phase : uint8_t {
+    Lookup,    // finding the order a cancel or modify targets
+    Match,     // the match loop
+    Rest,      // adding the order to its level and the index
+    Release,   // taking orders out of the book and returning their slots
+    Count
+};
+
+inline constexpr size_t kCounterCount = static_cast<size_t>(Counter::Count);
+inline constexpr size_t kPhaseCount = static_cast<size_t>(Phase::Count);
+
+const char* counterName(Counter counter);
+const char* phaseName(Phase phase);
+
+inline constexpr bool isMaxCounter(Counter counter) {
+    return counter == Counter::LookupMaxProbe || counter == Counter::SweepMaxLevels
+        || counter == Counter::PoolHighWater;
+}
+
+// One thread's counters, on cache lines of their own
+// Only the owning thread writes, with plain relaxed load + store (no locked
+// instruction); other threads read with relaxed loads, so a reader may see
+// a value a few increments old but never a torn one.
+struct alignas(kCacheLineSize) ThreadCounters {
+    std::atomic<uint64_t> values[kCounterCount] = {};
+    std::atomic<uint64_t> phaseTicks[kPhaseCount] = {};
+    std::atomic<uint64_t> phaseCalls[kPhaseCount] = {};
+
+    void add(Counter counter, uint64_t n) {
+        auto& value = values[static_cast<size_t>(counter)];
+        value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+    void raise(Counter counter, uint64_t n) {
+        auto& value = values[static_cast<size_t>(counter)];
+        if (n > value.load(std::memory_order_relaxed)) value.store(n, std::memory_order_relaxed);
+    }
+    void addPhase(Phase phase, uint64_t ticks) {
+        auto i = static_cast<size_t>(phase);
+        phaseTicks[i].store(phaseTicks[i].load(std::memory_order_relaxed) + ticks, std::memory_order_relaxed);
+        phaseCalls[i].store(phaseCalls[i].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+};
+
+static_assert(sizeof(ThreadCounters) % kCacheLineSize == 0, "Blocks of different threads must not share a line");
+
+// Blocks come from a fixed table, claimed by each thread on first use and
+// never freed, so a reader can walk them without locking. Threads beyond the
+// table share its last block (their counts may then lose updates).
+inline constexpr size_t kMaxCounterThreads = 64;
+
+ThreadCounters& registerCounterThread();
+
+inline ThreadCounters& threadCounters() {
+    static thread_local ThreadCounters* local = nullptr;
+    if (!local) local = &registerCounterThread();
+    return *local;
+}
+
+// === Hooks ===
+inline void count(Counter counter, uint64_t n = 1) {
+    if constexpr (kInstrumented) threadCounters().add(counter, n);
+}
+
+inline void countMax(Counter counter, uint64_t n) {
+    if constexpr (kInstrumented) threadCounters().raise(counter, n);
+}
+
+// Adds the TSC ticks between construction and destruction to a phase
+template <bool Enabled>
+class BasicPhaseTimer {
+public:
+    explicit BasicPhaseTimer(Phase) {}
+};
+
+template <>
+class BasicPhaseTimer<true> {
+public:
+    explicit BasicPhaseTimer(Phase phase) : phase_(phase), start_(readTsc()) {}
+    ~BasicPhaseTimer() { threadCounters().addPhase(phase_, readTsc() - start_); }
+
+    BasicPhaseTimer(const BasicPhaseTimer&) = delete;
+    BasicPhaseTimer& operator=(const BasicPhaseTimer&) = delete;
+
+private:
+    Phase phase_;
+    uint64_t start_;
+};
+
+using PhaseTimer = BasicPhaseTimer<kInstrumented>;
+
+static_assert(kInstrumented || std::is_empty_v<PhaseTimer>, "Compiled-out timers must hold nothing");
+
+// === Reading ===
+// Counters summed over threads (maxima take the largest), or of one thread
+struct CounterSnapshot {
+    uint64_t values[kCounterCount] = {};
+    uint64_t phaseTicks[kPhaseCount] = {};
+    uint64_t phaseCalls[kPhaseCount] = {};
+    size_t threads = 0;
+
+    uint64_t operator[](Counter counter) const { return values[static_cast<size_t>(counter)]; }
+    double phaseNs(Phase phase) const;   // total time in the phase
+};
+
+// Lock-free, from any thread
+size_t counterThreads();
+CounterSnapshot readCounters();
+CounterSnapshot readCounters(size_t thread);
+
+// Zero every thread's counters — only while no thread is recording
+void resetCounters();
+
+// Background thread that hands a snapshot to `sink` every `interval`
+// The sink runs on the exporter thread; the matching threads are never
+// stopped or locked. A final snapshot is delivered when the exporter stops.
+class CounterExporter {
+public:
+    CounterExporter(std::chrono::milliseconds interval, std::function<void(const CounterSnapshot&)> sink);
+    ~CounterExporter();
+
+    CounterExporter(const CounterExporter&) = delete;
+    CounterExporter& operator=(const CounterExporter&) = delete;
+
+    void stop();
+
+private:
+    std::chrono::milliseconds interval_;
+    std::function<void(const CounterSnapshot&)> sink_;
+    std::atomic<bool> stopping_{false};
+    std::thread thread_;
+
+    void run();
+};
+
+} // namespace engine
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <linux/io_uring.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace engine {
+
+// A minimal io_uring over the raw syscalls (no liburing)
+//
+// One thread owns the ring. It fills entries from getSqe(), hands them all
+// to the kernel with one submit() — one syscall however many there are —
+// and reads completions straight out of the shared completion queue with
+// forEachCompletion(), which makes no syscall at all.
+class IoUring {
+public:
+    // `entries` submission slots (rounded up to a power of two by the kernel);
+    // throws std::system_error if io_uring isn't available
+    explicit IoUring(unsigned entries);
+    ~IoUring();
+
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    // Next submission entry, zeroed — nullptr if the queue is full (submit() and retry)
+    io_uring_sqe* getSqe();
+
+    // Hand the queued entries to the kernel, waiting for `waitFor` completions
+    // Returns how many were taken; throws std::system_error on failure.
+    unsigned submit(unsigned waitFor = 0);
+
+    // Entries queued since the last submit()
+    unsigned queued() const { return sqeTail_ - sqeSubmitted_; }
+
+    // Call f(const io_uring_cqe&) for every completion ready now — returns how many
+    template <typename F>
+    size_t forEachCompletion(F&& f) {
+        unsigned head = *cqHead_;   // only this thread writes it
+        unsigned tail = std::atomic_ref<unsigned>(*cqTail_).load(std::memory_order_acquire);
+        size_t seen = 0;
+        for (; head != tail; ++head, ++seen) {
+            f(cqes_[head & cqMask_]);
+        }
+        std::atomic_ref<unsigned>(*cqHead_).store(head, std::memory_order_release);
+        return seen;
+    }
+
+    int fd() const { return fd_; }
+
+    // io_uring_register(2) — returns its result (negative errno on failure)
+    int registerOp(unsigned opcode, void* arg, unsigned count);
+
+private:
+    int fd_ = -1;
+
+    void* sqRing_ = nullptr;
+    void* cqRing_ = nullptr;
+    size_t sqRingBytes_ = 0;
+    size_t cqRingBytes_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    size_t sqesBytes_ = 0;
+
+    unsigned* sqTail_ = nullptr;
+    unsigned* sqHead_ = nullptr;
+    unsigned* sqArray_ = nullptr;
+    unsigned sqMask_ = 0;
+    unsigned sqEntries_ = 0;
+    unsigned sqeTail_ = 0;        // next entry getSqe() hands out
+    unsigned sqeSubmitted_ = 0;   // entries the kernel has been given
+
+    unsigned* cqHead_ = nullptr;
+    unsigned* cqTail_ = nullptr;
+    io_uring_cqe* cqes_ = nullptr;
+    unsigned cqMask_ = 0;
+
+    void unmap();
+};
+
+// Receive buffers registered with a ring (IORING_REGISTER_PBUF_RING)
+//
+// `count` buffers of `size` bytes in one allocation. A receive with
+// IOSQE_BUFFER_SELECT in this group lets the kernel pick a free buffer and
+// report its id in the completion, so the data lands where it will be
+// parsed. Give a buffer back with recycle() once everything in it has been
+// used; recycled buffers become visible to the kernel at publish().
+class BufferRing {
+public:
+    // count must be a power of two, at most 32768; throws std::system_error
+    BufferRing(IoUring& ring, uint16_t group, unsigned count, size_t size);
+    ~BufferRing();
+
+    BufferRing(const BufferRing&) = delete;
+    BufferRing& operator=(const BufferRing&) = delete;
+
+    uint16_t group() const { return group_; }
+    size_t bufferSize() const { return size_; }
+    unsigned count() const { return count_; }
+
+    char* data(uint16_t id) { return buffers_ + static_cast<size_t>(id) * size_; }
+
+    void recycle(uint16_t id);
+    void publish();
+
+private:
+    IoUring& ring_;
+    // The entries as a plain array: in C++ the header's io_uring_buf_ring puts
+    // its flexible `bufs` member 8 bytes in, not at offset 0 where the kernel reads
+    io_uring_buf* entries_ = nullptr;
+    size_t entriesBytes_ = 0;
+    char* buffers_ = nullptr;
+    size_t size_;
+    unsigned count_;
+    uint16_t group_;
+    uint16_t tail_ = 0;
+};
+
+} // namespace engine
@@ -0,0 +1,204 @@
+#pragma once
+
+#include "MatchingEngine.h"
+#include "Messages.h"
+#include "SpscRing.h"
+#include "WaitStrategy.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace engine {
+
+// Running digest of the trade sequence, used to check a replay against the original run
+// Timestamps are left out — they differ between runs.
+struct TradeDigest {
+    uint64_t count = 0;
+    uint64_t hash = 14695981039346656037ull;   // FNV-1a offset basis
+
+    void add(const Trade& trade) {
+        mix(trade.buyOrderId);
+        mix(trade.sellOrderId);
+        mix(static_cast<uint64_t>(trade.price));
+        mix((static_cast<uint64_t>(trade.symbol) << 32) | trade.quantity);
+        count++;
+    }
+
+    bool operator==(const TradeDigest&) const = default;
+
+private:
+    void mix(uint64_t value) {
+        hash = (hash ^ value) * 1099511628211ull;   // FNV-1a prime, a word at a time
+    }
+};
+
+// Forwards every callback to `inner` and folds trades into `digest`
+template <typename Inner>
+struct DigestListener {
+    Inner& inner;
+    TradeDigest& digest;
+
+    void onTrade(const Trade& trade) { digest.add(trade); inner.onTrade(trade); }
+    void onOrderFilled(const Order& order) { inner.onOrderFilled(order); }
+    void onOrderRested(const Order& order) { inner.onOrderRested(order); }
+    void onOrderCancelled(const Order& order) { inner.onOrderCancelled(order); }
+    void onOrderModified(const Order& order) { inner.onOrderModified(order); }
+    void onOrderTriggered(const Order& order) { inner.onOrderTriggered(order); }
+    void onRejected(const OrderMsg& msg) { inner.onRejected(msg); }
+};
+
+// === File format ===
+// A JournalHeader, then fixed-size JournalRecords in sequence order. Each
+// record holds one accepted message and the trade digest after applying it,
+// so a replay can find the first message where it diverges. A partial record
+// at the end (torn by a crash mid-write) is ignored.
+struct JournalHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t recordSize;
+    EngineShape shape;     // the engine the journal was written from
+
+    static JournalHeader describe(const MatchingEngine& engine);
+    bool valid() const;
+};
+
+struct JournalRecord {
+    uint64_t sequence;      // 1, 2, 3, ...
+    OrderMsg msg;
+    TradeDigest digest;     // trades up to and including this message
+};
+
+struct JournalConfig {
+    std::string path;
+    size_t ringCapacity = 1 << 16;               // records buffered between matching and the writer
+    size_t syncBatch = 1024;                     // fsync once this many records are written...
+    std::chrono::microseconds syncInterval{1000};// ...or once the oldest unsynced record is this old
+    bool sync = true;                            // false: write() only, leave flushing to the OS
+    WaitStrategy wait = WaitStrategy::Backoff;   // writer thread when idle, append() when the ring is full
+    bool append = false;                         // continue an existing journal instead of truncating it
+};
+
+// Appends records to a journal file from a background thread
+//
+// append() only copies the record into a preallocated ring, so the matching
+// thread never blocks on the disk unless the ring fills up. The writer thread
+// drains the ring, writes records in large batches and group-commits with
+// fdatasync per syncBatch records or syncInterval, whichever comes first.
+// An event can therefore be published before its message is durable;
+// durable() tells how far the file is synced.
+//
+// append() and flush() must be called from one thread (the matching thread).
+// The file is created (or truncated) by the constructor, unless config.append
+// is set and it exists — then new records follow the existing ones, which is
+// how an engine restored with recover() keeps journaling.
+class JournalWriter {
+public:
+    JournalWriter(const JournalConfig& config, const MatchingEngine& engine);
+    ~JournalWriter();
+
+    JournalWriter(const JournalWriter&) = delete;
+    JournalWriter& operator=(const JournalWriter&) = delete;
+
+    // Record an accepted message — throws std::system_error if the writer has failed
+    void append(const OrderMsg& msg, const TradeDigest& digest);
+
+    // Block until everything appended so far is written (and synced, if enabled)
+    void flush();
+
+    // Sequence of the last record appended (including ones already in a reopened file)
+    uint64_t appended() const { return nextSequence_ - 1; }
+    uint64_t durable() const { return durable_.load(std::memory_order_acquire); }
+    size_t syncCount() const { return syncs_.load(std::memory_order_relaxed); }
+
+    // Trade digest of the last record already in a reopened journal (empty for a new one)
+    const TradeDigest& lastDigest() const { return lastDigest_; }
+
+private:
+    JournalConfig config_;
+    int fd_ = -1;
+    SpscRing<JournalRecord> ring_;
+    std::thread thread_;
+    uint64_t nextSequence_ = 1;
+    TradeDigest lastDigest_;
+
+    std::atomic<bool> stopping_{false};
+    std::atomic<int> error_{0};
+    alignas(kCacheLineSize) std::atomic<uint64_t> durable_{0};
+    std::atomic<size_t> syncs_{0};
+
+    void run();
+    void reopen(const JournalHeader& expected);
+    void writeAll(const void* data, size_t bytes);
+    void checkError() const;
+};
+
+// Reads a journal file record by record
+class JournalReader {
+public:
+    // Throws std::system_error if the file can't be opened, std::runtime_error if it isn't a journal
+    explicit JournalReader(const std::string& path);
+    ~JournalReader();
+
+    JournalReader(const JournalReader&) = delete;
+    JournalReader& operator=(const JournalReader&) = delete;
+
+    const JournalHeader& header() const { return header_; }
+
+    // Next record, or false at the end of the file
+    // Throws std::runtime_error on a sequence gap (a corrupt file).
+    bool next(JournalRecord& record);
+
+private:
+    int fd_ = -1;
+    JournalHeader header_{};
+    std::vector<JournalRecord> buffer_;
+    size_t bufferPos_ = 0;
+    size_t bufferEnd_ = 0;
+    uint64_t lastSequence_ = 0;
+
+    bool refill();
+};
+
+struct ReplayResult {
+    uint64_t messages = 0;
+    TradeDigest digest;               // of the replayed trades
+    bool matched = true;              // every record's digest was reproduced
+    uint64_t mismatchSequence = 0;    // first record that diverged
+};
+
+// Apply every record in the journal to `engine` (same shape as the original, and empty)
+// Stops at the first message whose trades differ from the original run.
+// To replay only the tail after a snapshot, pass the snapshot's journal
+// sequence and trade digest: earlier records are skipped. If the original
+// enforced risk, attach a table with its limits to `engine` first.
+template <typename Listener>
+ReplayResult replayJournal(JournalReader& reader, MatchingEngine& engine, Listener& listener,
+                           uint64_t afterSequence = 0, const TradeDigest& startDigest = {}) {
+    ReplayResult result;
+    result.digest = startDigest;
+    DigestListener<Listener> digesting{listener, result.digest};
+    JournalRecord record;
+    while (reader.next(record)) {
+        if (record.sequence <= afterSequence) continue;
+        bool applied;
+        try {
+            applied = engine.submit(record.msg, digesting);
+        } catch (const std::exception&) {
+            applied = false;
+        }
+        result.messages++;
+        // Only accepted messages were journaled, so a rejection is a divergence too
+        if (!applied || !(result.digest == record.digest)) {
+            result.matched = false;
+            result.mismatchSequence = record.sequence;
+            break;
+        }
+    }
+    return result;
+}
+
+} // namespace engine
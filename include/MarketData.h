@@ -0,0 +1,50 @@
+#pragma once
+
+#include "MatchingEngine.h"
+
+#include <span>
+#include <vector>
+
+namespace engine {
+
+// A level's state after a message (or batch)
+// totalQuantity == 0 and orderCount == 0 means the level is gone.
+struct LevelUpdate {
+    SymbolId symbol;
+    Side side;
+    Price price;
+    Quantity totalQuantity;
+    uint32_t orderCount;
+};
+
+// Incremental L2 feed for an engine
+//
+// While attached, every book logs the levels that adds, cancels and matches
+// touch. publish() — called after each message or batch — turns that log into
+// one update per changed level, read from the level's current totalQuantity and
+// orderCount, so a level hit many times in a batch is published once.
+// Updates are grouped by symbol and side, in price order.
+//
+// Both buffers are reserved up front; neither grows unless a single publish
+// covers more than `capacity` level touches. Use from the matching thread.
+class L2Publisher {
+public:
+    explicit L2Publisher(MatchingEngine& engine, size_t capacity = 4096);
+    ~L2Publisher();
+
+    L2Publisher(const L2Publisher&) = delete;
+    L2Publisher& operator=(const L2Publisher&) = delete;
+
+    // Updates since the last publish — valid until the next call
+    std::span<const LevelUpdate> publish();
+
+    // Level touches logged since the last publish (before de-duplication)
+    size_t pending() const { return changes_.size(); }
+
+private:
+    MatchingEngine& engine_;
+    std::vector<LevelChange> changes_;
+    std::vector<LevelUpdate> updates_;
+};
+
+} // namespace engine
@@ -4,43 +4,914 @@
 #include "Order.h"
 #include "Trade.h"
 #include "ObjectPool.h"
+#include "EventListener.h"
+#include "Clock.h"
+#include "Messages.h"
+#include "Instrumentation.h"
+#include "Risk.h"
 
+#include <memory>
+#include <span>
 #include <vector>
+#include <stdexcept>
 
 namespace engine {
 
+class MatchingEngine;
+
+// Everything needed to construct an identical engine, in a form that can be
+// written to a file (journal and snapshot headers)
+struct EngineShape {
+    uint64_t poolSize;
+    uint64_t symbolCount;
+    uint64_t ladderLevels;
+    uint64_t maxOrders;
+    int64_t tickSize;
+    int64_t basePrice;
+    uint8_t hasBasePrice;
+    IndexMode indexMode;
+    CancelMode cancelMode;   // 0 (Eager) in files written before it existed
+    uint8_t maxLadderLog2;   // log2 of maxLadderLevels — 0 (the default) in files written before it existed
+    uint8_t reserved[4];
+
+    static EngineShape of(const MatchingEngine& engine);
+
+    // The book configuration the described engine was built with
+    BookConfig bookConfig() const;
+
+    // An engine built like the described one
+    // The pool is growable so rebuilding can't fail where the original didn't.
+    std::unique_ptr<MatchingEngine> makeEngine(const Clock& clock = Clock()) const;
+
+    bool operator==(const EngineShape& other) const;
+};
+
+static_assert(sizeof(EngineShape) == 56, "EngineShape is written to files and compared bytewise — no padding");
+
 class MatchingEngine {
 public:
     // Pre-allocate pool at construction — default 2 million order slots
-    explicit MatchingEngine(size_t poolSize = 2'000'000)
-        : orderPool_(poolSize)
-    {}
+    // bookConfig sets the price ladder window (tick size, levels, base price)
+    // and the ID index mode; the index is sized from the pool so it never rehashes
+    // poolOptions choose the pool's backing (huge pages, prefault, mlock, NUMA node)
+    // and whether it grows instead of throwing — construct on the matching thread
+    // when binding to its NUMA node
+    // clock stamps orders and trades (steady_clock or TSC, once per message or per trade)
+    // symbolCount books (symbols 0..symbolCount-1) share the pool and the ID index;
+    // each gets bookConfig's ladder, so keep ladderLevels small with many symbols
+    explicit MatchingEngine(size_t poolSize = 2'000'000, const BookConfig& bookConfig = {},
+                            const PoolOptions& poolOptions = {}, const Clock& clock = Clock(),
+                            size_t symbolCount = 1)
+        : bookConfig_(sizedFor(poolSize, bookConfig))
+        , orderLookup_(orderPool_, bookConfig_.maxOrders * 2, bookConfig_.indexMode)
+        , orderPool_(poolSize, poolOptions)
+        , clock_(clock)
+    {
+        if (symbolCount == 0) {
+            throw std::invalid_argument("Engine needs at least one symbol");
+        }
+        books_.reserve(symbolCount);
+        for (size_t s = 0; s < symbolCount; ++s) {
+            books_.emplace_back(orderPool_, bookConfig, orderLookup_);
+        }
+        filledScratch_.reserve(1024);
+        triggeredScratch_.reserve(1024);
+    }
 
     // Submit a new limit order — returns any trades that occurred
-    std::vector<Trade> submitLimit(OrderId id, Side side, Price price, Quantity qty);
+    // Throws std::invalid_argument if the price is not on the tick grid or
+    // too far from the book's levels to rest (BookConfig::maxLadderLevels),
+    // or the ID is already live (or, with IndexMode::Direct, its index slot
+    // is taken); std::out_of_range if the symbol has no book
+    std::vector<Trade> submitLimit(SymbolId symbol, OrderId id, Side side, Price price, Quantity qty);
+    std::vector<Trade> submitLimit(OrderId id, Side side, Price price, Quantity qty) {
+        return submitLimit(0, id, side, price, qty);
+    }
 
     // Submit a market order — returns any trades that occurred
-    std::vector<Trade> submitMarket(OrderId id, Side side, Quantity qty);
+    std::vector<Trade> submitMarket(SymbolId symbol, OrderId id, Side side, Quantity qty);
+    std::vector<Trade> submitMarket(OrderId id, Side side, Quantity qty) {
+        return submitMarket(0, id, side, qty);
+    }
 
-    // Cancel an existing order
+    // Cancel an existing order in any book (its pool slot is released)
     bool cancel(OrderId id);
 
-    // Access the book (for printing, market data, etc.)
-    const OrderBook& book() const { return book_; }
-    OrderBook& book() { return book_; }
+    // Cancel by the handle the order's events carried (Order::handle()) —
+    // no ID lookup. Returns false, touching nothing, if the order has since
+    // filled or been cancelled, even when its slot now holds another order.
+    bool cancel(OrderHandle handle);
+
+    // Is the order behind a handle still resting? (a lazily cancelled order
+    // holds its slot until it's unlinked, but has nothing left)
+    bool isLive(OrderHandle handle) const {
+        return handle.slot != kNoSlot && orderPool_.current(handle.slot, handle.generation)
+            && orderPool_.at(handle.slot)->remaining > 0;
+    }
+
+    // Idle-time work for CancelMode::Lazy: unlink the dead orders of up to
+    // maxLevels mostly-dead levels and release their slots. Returns how many
+    // levels were compacted (0: nothing pending). EngineRunner calls this when
+    // its inbound ring is empty.
+    size_t compact(size_t maxLevels = 1);
+
+    // Empty every book and release every order, keeping the pool, the ID
+    // index and the ladders allocated — for reusing one engine across
+    // independent runs, like the days of a backtest. The trade and order
+    // counts go back to zero; handles from before the reset stay stale.
+    void reset();
+
+    // Change a resting order's price and/or open quantity — returns any trades
+    // Reducing the quantity at the same price amends the order in place and it
+    // keeps its place in the queue. Anything else (a new price, or more
+    // quantity) is a cancel-replace in the same pool slot: the order joins the
+    // back of the queue at its new price, and trades first if it now crosses.
+    // newQty is the new open quantity (an iceberg's displayed plus reserve);
+    // 0 cancels the order. Returns false (nothing changed) if no order with
+    // this ID is resting, or a post-only order's new price would trade;
+    // throws std::invalid_argument for a price off the tick grid.
+    bool modify(OrderId id, Price newPrice, Quantity newQty);
+
+    // === Listener API ===
+    // Same operations, but events are delivered to `listener` while the order is
+    // processed instead of being collected into a vector, so nothing is allocated
+    // per order. Listener is any type with the EventListener callbacks —
+    // usually a struct deriving from EventListener.
+    // The overloads without a symbol trade symbol 0.
+    template <typename Listener>
+    void submitLimit(SymbolId symbol, OrderId id, Side side, Price price, Quantity qty, Listener& listener) {
+        clock_.beginMessage();
+        addLimit(symbol, 0, id, side, price, qty, listener);
+    }
+    template <typename Listener>
+    void submitLimit(OrderId id, Side side, Price price, Quantity qty, Listener& listener) {
+        submitLimit(0, id, side, price, qty, listener);
+    }
+
+    template <typename Listener>
+    void submitMarket(SymbolId symbol, OrderId id, Side side, Quantity qty, Listener& listener) {
+        clock_.beginMessage();
+        addMarket(symbol, 0, id, side, qty, listener);
+    }
+    template <typename Listener>
+    void submitMarket(OrderId id, Side side, Quantity qty, Listener& listener) {
+        submitMarket(0, id, side, qty, listener);
+    }
+
+    // === Extended order types ===
+    // IOC trades what it can at its limit price and cancels the rest. FOK
+    // fills completely at once or is rejected; post-only rests or is rejected
+    // if it would trade. An iceberg rests showing `peak` at a time, refilled
+    // from its reserve (in the same pool slot, at the back of the level) as
+    // each slice trades. A rejected order (return false) touched nothing and
+    // raised no events.
+    template <typename Listener>
+    bool submitIoc(SymbolId symbol, OrderId id, Side side, Price price, Quantity qty, Listener& listener) {
+        clock_.beginMessage();
+        return addTyped(symbol, 0, id, side, OrderType::ImmediateOrCancel, price, qty, 0, listener);
+    }
+    template <typename Listener>
+    bool submitFok(SymbolId symbol, OrderId id, Side side, Price price, Quantity qty, Listener& listener) {
+        clock_.beginMessage();
+        return addTyped(symbol, 0, id, side, OrderType::FillOrKill, price, qty, 0, listener);
+    }
+    template <typename Listener>
+    bool submitPostOnly(SymbolId symbol, OrderId id, Side side, Price price, Quantity qty, Listener& listener) {
+        clock_.beginMessage();
+        return addTyped(symbol, 0, id, side, OrderType::PostOnly, price, qty, 0, listener);
+    }
+    template <typename Listener>
+    void submitIceberg(SymbolId symbol, OrderId id, Side side, Price price, Quantity qty, Quantity peak, Listener& listener) {
+        clock_.beginMessage();
+        addTyped(symbol, 0, id, side, OrderType::Iceberg, price, qty, peak, listener);
+    }
+
+    // === Stop orders ===
+    // A stop parks out of the book, keyed by its stop price, until a trade
+    // reaches it: a buy stop at or above the stop price, a sell stop at or
+    // below. It then trades as a market order; a stop-limit as a limit order
+    // at `price`. Stops one match triggers run nearest stop price first (FIFO
+    // at a price) and the trades they make can trigger more — the whole
+    // cascade runs within the message that started it. A stop the last trade
+    // has already reached triggers on arrival. Parked stops can be cancelled
+    // (by ID or handle) but not modified. Throws std::invalid_argument for a
+    // stop or limit price off the tick grid. With risk checks on, a stop over
+    // its account's order size is refused as it arrives — submit() returns
+    // false and no event is emitted — and the rest of the checks run when it
+    // triggers, where a refusal cancels it.
+    template <typename Listener>
+    void submitStop(SymbolId symbol, OrderId id, Side side, Price stopPrice, Quantity qty, Listener& listener) {
+        clock_.beginMessage();
+        addStop(symbol, 0, id, side, OrderType::Stop, stopPrice, 0, qty, listener);
+    }
+    template <typename Listener>
+    void submitStopLimit(SymbolId symbol, OrderId id, Side side, Price stopPrice, Price price, Quantity qty,
+                         Listener& listener) {
+        clock_.beginMessage();
+        addStop(symbol, 0, id, side, OrderType::StopLimit, stopPrice, price, qty, listener);
+    }
+
+    // === Auctions ===
+    // startAuction puts a book in its call phase: limit, iceberg and
+    // post-only orders rest even where they cross (a post-only that crosses
+    // is still refused), stops park whatever the last trade, and market, IOC
+    // and FOK orders throw std::invalid_argument. uncross() trades the whole
+    // cross at the single price that executes the most (see
+    // OrderBook::auctionPrice), writing every fill straight to the listener,
+    // returns the book to continuous matching and then runs any stops the
+    // uncross price reached. indicativeUncross says what it would do now.
+    void startAuction(SymbolId symbol = 0) { bookFor(symbol).startAuction(); }
+    bool inAuction(SymbolId symbol = 0) const { return bookFor(symbol).inAuction(); }
+    AuctionResult indicativeUncross(SymbolId symbol = 0) const { return bookFor(symbol).auctionPrice(); }
+
+    template <typename Listener>
+    AuctionResult uncross(SymbolId symbol, Listener& listener) {
+        clock_.beginMessage();
+        return runUncross(symbol, listener);
+    }
+
+    template <typename Listener>
+    bool cancel(OrderId id, Listener& listener);
+    template <typename Listener>
+    bool cancel(OrderHandle handle, Listener& listener);
+
+    template <typename Listener>
+    bool modify(OrderId id, Price newPrice, Quantity newQty, Listener& listener) {
+        clock_.beginMessage();
+        return amend(id, newPrice, newQty, listener);
+    }
+
+    // Apply one inbound message — what the runner and journal replay use
+    // New orders are entered for msg.account (the calls above enter them for
+    // account 0). Returns false for a cancel of an unknown order, a rejected
+    // FOK / post-only or an order the risk stage refused; throws like the
+    // calls above.
+    template <typename Listener>
+    bool submit(const OrderMsg& msg, Listener& listener) {
+        switch (msg.type) {
+        case MsgType::NewLimit:
+            clock_.beginMessage();
+            return addTyped(msg.symbol, msg.account, msg.id, msg.side, msg.orderType, msg.price, msg.quantity,
+                            msg.displayQty, listener);
+        case MsgType::NewMarket:
+            clock_.beginMessage();
+            return addMarket(msg.symbol, msg.account, msg.id, msg.side, msg.quantity, listener);
+        case MsgType::Cancel:
+            return cancel(msg.id, listener);
+        case MsgType::Modify:
+            return modify(msg.id, msg.price, msg.quantity, listener);
+        case MsgType::NewStop:
+            clock_.beginMessage();
+            return addStop(msg.symbol, msg.account, msg.id, msg.side, msg.orderType, msg.price, msg.limitPrice(),
+                           msg.quantity, listener);
+        case MsgType::StartAuction:
+            startAuction(msg.symbol);
+            return true;
+        case MsgType::Uncross:
+            uncross(msg.symbol, listener);
+            return true;
+        }
+        return false;
+    }
+
+    // Process a burst of messages in order — the same result as submitting
+    // them one at a time, but the clock is read once for the whole batch and,
+    // while one message matches, the ID index buckets, price levels and the
+    // next pool slot for the messages just behind it are prefetched.
+    // A message that would throw (or cancels an unknown order) goes to
+    // sink.onRejected instead, and the batch carries on. Returns how many
+    // messages were accepted.
+    template <typename Sink>
+    size_t submitBatch(std::span<const OrderMsg> msgs, Sink& sink);
+
+    // Access a book (for printing, market data, etc.)
+    const OrderBook& book(SymbolId symbol = 0) const { return bookFor(symbol); }
+    OrderBook& book(SymbolId symbol = 0) { return bookFor(symbol); }
+    size_t symbolCount() const { return books_.size(); }
+
+    // Log level changes of every book into `log` (nullptr to stop) — see L2Publisher
+    void trackLevelChanges(std::vector<LevelChange>* log) {
+        for (OrderBook& book : books_) book.trackChanges(log);
+    }
+
+    // Publish each book's best bid/offer into table[symbol] after every message
+    // that changes it, for lock-free readers on other threads (nullptr to stop).
+    // The current BBOs are published straight away.
+    void publishTopOfBook(BboTable* table);
+
+    // Run every new order through `table`'s pre-trade checks before it takes a
+    // pool slot (nullptr to stop): its account's order size, price band
+    // against the best opposite price, and open quantity and notional if it
+    // rested. A refused order touches nothing and raises no events — the
+    // calls return false and the runner reports a reject. The books keep the
+    // table's exposure current as orders rest, fill and leave, and cancel a
+    // resting order instead of trading it with its own account where the
+    // account asks for that (see OrderBook::trackRisk). Attaching rebuilds
+    // the exposure from the orders resting now; throws std::out_of_range if
+    // any of them, or a parked stop, has an account the table lacks. A
+    // replay or standby must attach a table with the same limits to come out
+    // the same. The table must outlive the engine or be detached first.
+    void enforceRisk(RiskTable* table);
+    const RiskTable* riskTable() const { return risk_; }
+
+    // What the engine was built with (maxOrders filled in) — enough to build an identical one
+    const BookConfig& bookConfig() const { return bookConfig_; }
+    size_t poolSize() const { return poolSize_; }
+
+    const Clock& clock() const { return clock_; }
 
     // Stats
     size_t totalTrades() const { return tradeCount_; }
+    size_t poolInUse() const { return orderPool_.size(); }   // includes lazily cancelled orders not yet unlinked
+
+    // Cold data (original quantity, arrival time) for a live order
+    const OrderMeta& orderMeta(const Order& order) const { return orderPool_.cold(&order); }
+    PageBacking poolBacking() const { return orderPool_.backing(); }
     size_t totalOrders() const { return orderCount_; }
 
 private:
-    OrderBook book_;
+    // Snapshot writer/loader (Snapshot.cpp) works on the books, pool and index directly
+    friend struct SnapshotAccess;
+
+    static BookConfig sizedFor(size_t poolSize, BookConfig config) {
+        if (config.maxOrders == 0) config.maxOrders = poolSize;
+        return config;
+    }
+
+    BookConfig bookConfig_;
+
+    // Resting orders of every book, by ID — declared before books_, which point at it
+    OrderIndex orderLookup_;
+
+    // One book per symbol, indexed by SymbolId
+    std::vector<OrderBook> books_;
 
     // Pre-allocated memory pool — no heap allocation during trading
-    ObjectPool<Order> orderPool_;
+    // Order holds the hot fields; OrderMeta is the cold per-slot side array
+    // (declared after the index and books, which only keep a reference to it)
+    OrderPool orderPool_;
+
+    // Stamps each inbound message once (or every trade, if configured)
+    Clock clock_;
+
+    // Resting orders filled by the current match — reused so it only grows, never reallocates per order
+    std::vector<OrderSlot> filledScratch_;
+
+    // Stops triggered by the current message, run front to back (see runStops)
+    std::vector<OrderSlot> triggeredScratch_;
+
+    OrderBook& bookFor(SymbolId symbol) {
+        if (symbol >= books_.size()) {
+            throw std::out_of_range("Unknown symbol");
+        }
+        return books_[symbol];
+    }
+    const OrderBook& bookFor(SymbolId symbol) const { return const_cast<MatchingEngine*>(this)->bookFor(symbol); }
+
+    // Entry points dispatch on side (and type) once; everything below runs
+    // with both known at compile time
+    template <typename Listener>
+    bool addLimit(SymbolId symbol, AccountId account, OrderId id, Side side, Price price, Quantity qty, Listener& listener) {
+        return addSided<OrderType::Limit>(symbol, account, id, side, price, qty, 0, listener);
+    }
+    template <typename Listener>
+    bool addMarket(SymbolId symbol, AccountId account, OrderId id, Side side, Quantity qty, Listener& listener) {
+        return addSided<OrderType::Market>(symbol, account, id, side, 0, qty, 0, listener);
+    }
+    template <typename Listener>
+    bool addTyped(SymbolId symbol, AccountId account, OrderId id, Side side, OrderType type, Price price, Quantity qty,
+                  Quantity peak, Listener& listener) {
+        switch (type) {
+        case OrderType::Limit:
+            return addSided<OrderType::Limit>(symbol, account, id, side, price, qty, 0, listener);
+        case OrderType::ImmediateOrCancel:
+            return addSided<OrderType::ImmediateOrCancel>(symbol, account, id, side, price, qty, 0, listener);
+        case OrderType::FillOrKill:
+            return addSided<OrderType::FillOrKill>(symbol, account, id, side, price, qty, 0, listener);
+        case OrderType::PostOnly:
+            return addSided<OrderType::PostOnly>(symbol, account, id, side, price, qty, 0, listener);
+        case OrderType::Iceberg:
+            return addSided<OrderType::Iceberg>(symbol, account, id, side, price, qty, peak, listener);
+        case OrderType::Market:
+        case OrderType::Stop:
+        case OrderType::StopLimit:
+            break;
+        }
+        throw std::invalid_argument("Not a limit order type");
+    }
+    template <OrderType T, typename Listener>
+    bool addSided(SymbolId symbol, AccountId account, OrderId id, Side side, Price price, Quantity qty, Quantity peak,
+                  Listener& listener) {
+        if (side == Side::Buy) {
+            return addOrder<Side::Buy, T>(symbol, account, id, price, qty, peak, listener);
+        } else {
+            return addOrder<Side::Sell, T>(symbol, account, id, price, qty, peak, listener);
+        }
+    }
+    template <Side S, OrderType T, typename Listener>
+    bool addOrder(SymbolId symbol, AccountId account, OrderId id, Price price, Quantity qty, Quantity peak,
+                  Listener& listener);
+    template <Side S, OrderType T, typename Listener>
+    void execute(OrderBook& book, Order* order, Listener& listener);
+    template <Side S, OrderType T, typename Listener>
+    void rest(OrderBook& book, Order* order, Listener& listener);
+    template <Side S, typename Listener>
+    void reenter(OrderBook& book, Order* order, Listener& listener);
+    template <typename Listener>
+    bool amend(OrderId id, Price newPrice, Quantity newQty, Listener& listener);
+    template <typename Listener>
+    void removeAndRelease(Order* order, Listener& listener);
+    template <typename Listener>
+    bool addStop(SymbolId symbol, AccountId account, OrderId id, Side side, OrderType type, Price stopPrice, Price price,
+                 Quantity qty, Listener& listener);
+    template <Side S, typename Listener>
+    void trigger(OrderBook& book, Order* order, Listener& listener);
+    template <typename Listener>
+    void runStops(OrderBook& book, Listener& listener);
+    template <typename Listener>
+    AuctionResult runUncross(SymbolId symbol, Listener& listener);
+
+    static bool targetsResting(const OrderMsg& msg) {
+        return msg.type == MsgType::Cancel || msg.type == MsgType::Modify;
+    }
+
+    // Warm the cache lines a message will touch
+    void prefetchFor(const OrderMsg& msg) const {
+        orderLookup_.prefetch(msg.id);
+        if (msg.type == MsgType::NewLimit && msg.symbol < books_.size()) {
+            books_[msg.symbol].prefetchLevel(msg.side, msg.price);
+        }
+    }
+
+    // End of a message on `symbol`: refresh its published BBO, if any
+    void updateTop(SymbolId symbol) {
+        if (bbo_) (*bbo_)[symbol].publish(books_[symbol].top());
+    }
+
+    void releaseFilled() {
+        PhaseTimer timer(Phase::Release);
+        // After a long sweep or an uncross the first orders filled are out of
+        // cache again, so keep a few lines ahead in flight
+        constexpr size_t kPrefetchAhead = 8;
+        size_t n = filledScratch_.size();
+        for (size_t i = 0; i < n; ++i) {
+            if (i + kPrefetchAhead < n) __builtin_prefetch(orderPool_.at(filledScratch_[i + kPrefetchAhead]), 1);
+            orderPool_.release(orderPool_.at(filledScratch_[i]));
+        }
+        filledScratch_.clear();
+    }
+
+    void releaseOrder(Order* order) {
+        PhaseTimer timer(Phase::Release);
+        orderPool_.release(order);
+    }
+
+    bool passesReplace(OrderBook& book, const Order& order, Price newPrice, Quantity newQty) {
+        RiskCheck verdict = order.side == Side::Buy
+            ? risk_->check<Side::Buy, OrderType::Limit>(order.account, newPrice, newQty, book.bestOpposite<Side::Buy>(),
+                                                        order.openQuantity(), order.price)
+            : risk_->check<Side::Sell, OrderType::Limit>(order.account, newPrice, newQty, book.bestOpposite<Side::Sell>(),
+                                                         order.openQuantity(), order.price);
+        return verdict == RiskCheck::Passed;
+    }
+
+    Order* lookup(OrderId id) const {
+        PhaseTimer timer(Phase::Lookup);
+        return orderLookup_.find(id);
+    }
+
+    BboTable* bbo_ = nullptr;
+    RiskTable* risk_ = nullptr;
 
     size_t tradeCount_ = 0;
     size_t orderCount_ = 0;
+    size_t poolSize_ = orderPool_.capacity();
+    size_t compactCursor_ = 0;   // book compact() looks at first, round robin
 };
 
+template <Side S, OrderType T, typename Listener>
+bool MatchingEngine::addOrder(SymbolId symbol, AccountId account, OrderId id, Price price, Quantity qty, Quantity peak,
+                              Listener& listener) {
+    OrderBook& book = bookFor(symbol);
+
+    // Reject up front so a bad price can't trade and then fail to rest
+    if constexpr (T != OrderType::Market) {
+        if (!book.isValidPrice(price)) {
+            throw std::invalid_argument("Limit price is not a multiple of the tick size");
+        }
+    }
+    if constexpr (T == OrderType::Limit || T == OrderType::PostOnly || T == OrderType::Iceberg) {
+        if (!book.canRest(S, price)) {
+            throw std::invalid_argument("Limit price is too far from the book for its ladder window");
+        }
+        // Only orders that can rest enter the ID index
+        if (!orderLookup_.canInsert(id)) {
+            throw std::invalid_argument("Order ID is live already, or shares its direct index slot with a live one");
+        }
+    }
+    if constexpr (T == OrderType::Iceberg) {
+        if (peak == 0) {
+            throw std::invalid_argument("Iceberg peak must be positive");
+        }
+    }
+
+    // Rejections decided before a pool slot is taken or any resting order is touched
+    if constexpr (T == OrderType::Market || T == OrderType::ImmediateOrCancel || T == OrderType::FillOrKill) {
+        if (book.inAuction()) {
+            throw std::invalid_argument("Order type not accepted during an auction");
+        }
+    }
+    if constexpr (T == OrderType::PostOnly) {
+        if (book.crosses<S>(price)) return false;   // one look at the cached best level
+    }
+    if constexpr (T == OrderType::FillOrKill) {
+        // Resting orders of its own account don't count where they'd be cancelled rather than traded
+        bool selfTradesCancelled = risk_ && account < risk_->accountCount() && risk_->preventsSelfTrade(account);
+        if (selfTradesCancelled ? !book.canFillExcluding<S>(price, qty, account) : !book.canFill<S>(price, qty)) {
+            return false;
+        }
+    }
+    if (risk_) {
+        if (risk_->check<S, T>(account, price, qty, book.bestOpposite<S>()) != RiskCheck::Passed) return false;
+    }
+
+    // Acquire from the pool — no heap allocation, just grab a pre-allocated slot
+    Order* order = acquireOrder(orderPool_, id, S, T, price, qty, symbol);
+    order->account = account;
+    orderPool_.cold(order) = OrderMeta{qty, clock_.stamp()};
+    if constexpr (T == OrderType::Iceberg) {
+        order->peak = peak;
+    }
+    countMax(Counter::PoolHighWater, orderPool_.size());
+
+    orderCount_++;
+
+    execute<S, T>(book, order, listener);
+    if (book.stopCount() > 0) [[unlikely]] runStops(book, listener);
+    updateTop(symbol);
+    return true;
+}
+
+// Match an incoming order, then rest what's left of it or free its slot
+template <Side S, OrderType T, typename Listener>
+void MatchingEngine::execute(OrderBook& book, Order* order, Listener& listener) {
+    constexpr bool rests = T == OrderType::Limit || T == OrderType::PostOnly || T == OrderType::Iceberg;
+
+    if constexpr (rests) {
+        // Add-only: nothing on the other side it can trade with, so skip the
+        // match loop (always the case for post-only, checked on entry), or
+        // the book is in an auction and rests everything
+        if (T == OrderType::PostOnly || !book.crosses<S>(order->price) || book.inAuction()) {
+            rest<S, T>(book, order, listener);
+            return;
+        }
+    }
+
+    {
+        PhaseTimer timer(Phase::Match);
+        tradeCount_ += book.match<S, T>(*order, listener, filledScratch_, clock_);
+    }
+
+    // Release filled resting orders back to the pool
+    releaseFilled();
+
+    if (order->isFilled()) {
+        // Fully filled — return the slot to the pool immediately
+        listener.onOrderFilled(*order);
+        releaseOrder(order);
+    } else if constexpr (rests) {
+        // Still has remaining quantity — rest it in the book
+        rest<S, T>(book, order, listener);
+    } else {
+        // Market and IOC orders never rest — anything left over is cancelled
+        listener.onOrderCancelled(*order);
+        releaseOrder(order);
+    }
+}
+
+template <Side S, OrderType T, typename Listener>
+void MatchingEngine::rest(OrderBook& book, Order* order, Listener& listener) {
+    if constexpr (T == OrderType::Iceberg) {
+        // Show one slice; the rest waits in reserve
+        Quantity open = order->openQuantity();
+        order->remaining = std::min(order->peak, open);
+        order->hidden = open - order->remaining;
+    }
+    {
+        PhaseTimer timer(Phase::Rest);
+        book.addOrder<S>(order);
+    }
+    listener.onOrderRested(*order);
+}
+
+// A cancel-replaced order going through matching again as its own type
+template <Side S, typename Listener>
+void MatchingEngine::reenter(OrderBook& book, Order* order, Listener& listener) {
+    switch (order->type) {
+    case OrderType::Iceberg:
+        execute<S, OrderType::Iceberg>(book, order, listener);
+        break;
+    case OrderType::PostOnly:
+        execute<S, OrderType::PostOnly>(book, order, listener);
+        break;
+    default:
+        execute<S, OrderType::Limit>(book, order, listener);
+        break;
+    }
+}
+
+template <typename Listener>
+bool MatchingEngine::cancel(OrderId id, Listener& listener) {
+    // The shared index finds the order whichever book it rests in
+    Order* order = lookup(id);
+    if (!order) {
+        return false;
+    }
+    removeAndRelease(order, listener);
+    return true;
+}
+
+template <typename Listener>
+bool MatchingEngine::cancel(OrderHandle handle, Listener& listener) {
+    // One generation compare tells a stale handle from a live one
+    if (!isLive(handle)) {
+        return false;
+    }
+    removeAndRelease(orderPool_.at(handle.slot), listener);
+    return true;
+}
+
+template <typename Listener>
+void MatchingEngine::removeAndRelease(Order* order, Listener& listener) {
+    SymbolId symbol = order->symbol;
+    if (order->isStop()) [[unlikely]] {
+        // Parked, not in the book — always taken out straight away
+        books_[symbol].removeStop(order);
+        listener.onOrderCancelled(*order);
+        releaseOrder(order);
+        return;
+    }
+    if (bookConfig_.cancelMode == CancelMode::Lazy) {
+        // Report it while it still has its quantity; the slot is only freed
+        // now if the level had nothing live left
+        listener.onOrderCancelled(*order);
+        {
+            PhaseTimer timer(Phase::Release);
+            books_[symbol].markCancelled(order, filledScratch_);
+        }
+        releaseFilled();
+        updateTop(symbol);
+        return;
+    }
+    {
+        PhaseTimer timer(Phase::Release);
+        books_[symbol].removeOrder(order);
+    }
+    listener.onOrderCancelled(*order);
+
+    // The order is out of the book — give its slot back
+    releaseOrder(order);
+    updateTop(symbol);
+}
+
+template <typename Listener>
+bool MatchingEngine::amend(OrderId id, Price newPrice, Quantity newQty, Listener& listener) {
+    Order* order = lookup(id);
+    if (!order) {
+        return false;
+    }
+    if (newQty == 0) {
+        return cancel(id, listener);
+    }
+    if (order->isStop()) {
+        return false;   // cancel and resubmit to move a parked stop
+    }
+    SymbolId symbol = order->symbol;
+    OrderBook& book = books_[symbol];
+
+    if (newPrice == order->price && newQty <= order->openQuantity()) {
+        // Amend down: same level, same queue position, nothing else to touch
+        book.reduceOrder(order, newQty);
+        listener.onOrderModified(*order);
+    } else {
+        // Check before anything changes, so a bad price leaves the order as it was
+        if (!book.isValidPrice(newPrice)) {
+            throw std::invalid_argument("Limit price is not a multiple of the tick size");
+        }
+        if (!book.canRest(order->side, newPrice)) {
+            throw std::invalid_argument("Limit price is too far from the book for its ladder window");
+        }
+        // A post-only order may not be moved to a price where it would trade
+        if (order->type == OrderType::PostOnly && book.crosses(order->side, newPrice)) {
+            return false;
+        }
+        // Checked as a new order, less the open quantity it replaces
+        if (risk_ && !passesReplace(book, *order, newPrice, newQty)) {
+            return false;
+        }
+        // Cancel-replace, reusing the slot: no pool release/acquire, and the
+        // order's ID index entry is simply re-inserted when it rests again
+        book.removeOrder(order);
+        order->price = newPrice;
+        order->remaining = newQty;
+        order->hidden = 0;
+        orderPool_.cold(order) = OrderMeta{newQty, clock_.stamp()};
+        listener.onOrderModified(*order);
+        if (order->side == Side::Buy) {
+            reenter<Side::Buy>(book, order, listener);
+        } else {
+            reenter<Side::Sell>(book, order, listener);
+        }
+        if (book.stopCount() > 0) [[unlikely]] runStops(book, listener);
+    }
+    updateTop(symbol);
+    return true;
+}
+
+template <typename Listener>
+bool MatchingEngine::addStop(SymbolId symbol, AccountId account, OrderId id, Side side, OrderType type, Price stopPrice,
+                             Price price, Quantity qty, Listener& listener) {
+    OrderBook& book = bookFor(symbol);
+    if (type != OrderType::Stop && type != OrderType::StopLimit) {
+        throw std::invalid_argument("Not a stop order type");
+    }
+    if (!book.isValidPrice(stopPrice) || (type == OrderType::StopLimit && !book.isValidPrice(price))) {
+        throw std::invalid_argument("Stop or limit price is not a multiple of the tick size");
+    }
+    if (!book.canPark(side, stopPrice) || (type == OrderType::StopLimit && !book.canRest(side, price))) {
+        throw std::invalid_argument("Stop or limit price is too far from the book for its ladder window");
+    }
+    if (!orderLookup_.canInsert(id)) {
+        throw std::invalid_argument("Order ID is live already, or shares its direct index slot with a live one");
+    }
+    // Only the size can be checked now — the band and open limits depend on
+    // the book when it triggers, and trigger() checks them then. A refused
+    // stop never parks: false, and no events.
+    if (risk_) {
+        RiskCheck verdict = side == Side::Buy
+            ? risk_->check<Side::Buy, OrderType::Stop>(account, 0, qty, std::nullopt)
+            : risk_->check<Side::Sell, OrderType::Stop>(account, 0, qty, std::nullopt);
+        if (verdict != RiskCheck::Passed) return false;
+    }
+
+    Order* order = acquireOrder(orderPool_, id, side, type, type == OrderType::StopLimit ? price : 0, qty, symbol);
+    order->account = account;
+    order->stopPrice = stopPrice;
+    orderPool_.cold(order) = OrderMeta{qty, clock_.stamp()};
+    countMax(Counter::PoolHighWater, orderPool_.size());
+    orderCount_++;
+
+    if (book.inAuction() || !book.stopTriggered(side, stopPrice)) {
+        {
+            PhaseTimer timer(Phase::Rest);
+            book.addStop(order);
+        }
+        listener.onOrderRested(*order);
+        return true;
+    }
+
+    // Already reached: it trades now, and may set off others
+    if (side == Side::Buy) {
+        trigger<Side::Buy>(book, order, listener);
+    } else {
+        trigger<Side::Sell>(book, order, listener);
+    }
+    if (book.stopCount() > 0) runStops(book, listener);
+    updateTop(symbol);
+    return true;
+}
+
+template <typename Listener>
+AuctionResult MatchingEngine::runUncross(SymbolId symbol, Listener& listener) {
+    OrderBook& book = bookFor(symbol);
+    AuctionResult result = book.auctionPrice();
+    {
+        PhaseTimer timer(Phase::Match);
+        tradeCount_ += book.uncross(result, listener, filledScratch_, clock_);
+    }
+    releaseFilled();
+    if (book.stopCount() > 0) runStops(book, listener);
+    updateTop(symbol);
+    return result;
+}
+
+// A stop whose price was reached becomes the order it trades as
+template <Side S, typename Listener>
+void MatchingEngine::trigger(OrderBook& book, Order* order, Listener& listener) {
+    bool stopLimit = order->type == OrderType::StopLimit;
+    order->type = stopLimit ? OrderType::Limit : OrderType::Market;
+    listener.onOrderTriggered(*order);
+
+    // Checked as the order it has become, against the book as it is now:
+    // its account's limits, and for a stop-limit whether its limit can still
+    // get a level. Refused, it is cancelled.
+    bool refused = stopLimit && !book.canRest(S, order->price);
+    if (!refused && risk_) {
+        RiskCheck verdict = stopLimit
+            ? risk_->check<S, OrderType::Limit>(order->account, order->price, order->remaining, book.bestOpposite<S>())
+            : risk_->check<S, OrderType::Market>(order->account, 0, order->remaining, book.bestOpposite<S>());
+        refused = verdict != RiskCheck::Passed;
+    }
+    if (refused) [[unlikely]] {
+        listener.onOrderCancelled(*order);
+        releaseOrder(order);
+        return;
+    }
+
+    if (stopLimit) {
+        execute<S, OrderType::Limit>(book, order, listener);
+    } else {
+        execute<S, OrderType::Market>(book, order, listener);
+    }
+}
+
+// Run the stops the last match triggered through the book, in the order
+// they triggered, then any their own trades trigger: a cascade is a walk
+// along one queue that grows at the back, never a recursive call.
+// In an auction nothing runs: stops stay parked until runUncross.
+template <typename Listener>
+void MatchingEngine::runStops(OrderBook& book, Listener& listener) {
+    if (book.inAuction()) return;
+    book.takeTriggered(triggeredScratch_);
+    for (size_t i = 0; i < triggeredScratch_.size(); ++i) {
+        Order* order = orderPool_.at(triggeredScratch_[i]);
+        if (order->side == Side::Buy) {
+            trigger<Side::Buy>(book, order, listener);
+        } else {
+            trigger<Side::Sell>(book, order, listener);
+        }
+        book.takeTriggered(triggeredScratch_);
+    }
+    triggeredScratch_.clear();
+}
+
+template <typename Sink>
+size_t MatchingEngine::submitBatch(std::span<const OrderMsg> msgs, Sink& sink) {
+    // Far enough ahead for the index bucket to arrive before the message is
+    // processed; cancels and modifies get a second step once the bucket is
+    // warm, to fetch the order itself
+    constexpr size_t kPrefetchDistance = 8;
+    constexpr size_t kOrderPrefetchDistance = 2;
+
+    clock_.beginMessage();   // one timestamp for every order and trade in the batch
+
+    for (size_t i = 0; i < std::min(kPrefetchDistance, msgs.size()); ++i) {
+        prefetchFor(msgs[i]);
+    }
+
+    size_t accepted = 0;
+    for (size_t i = 0; i < msgs.size(); ++i) {
+        if (i + kPrefetchDistance < msgs.size()) {
+            prefetchFor(msgs[i + kPrefetchDistance]);
+        }
+        if (i + kOrderPrefetchDistance < msgs.size() && targetsResting(msgs[i + kOrderPrefetchDistance])) {
+            if (const Order* order = orderLookup_.find(msgs[i + kOrderPrefetchDistance].id)) {
+                __builtin_prefetch(order, 1);
+            }
+        }
+        orderPool_.prefetchNext();
+
+        const OrderMsg& msg = msgs[i];
+        bool ok = false;
+        try {
+            switch (msg.type) {
+            case MsgType::NewLimit:
+                ok = addTyped(msg.symbol, msg.account, msg.id, msg.side, msg.orderType, msg.price, msg.quantity,
+                              msg.displayQty, sink);
+                break;
+            case MsgType::NewMarket:
+                ok = addMarket(msg.symbol, msg.account, msg.id, msg.side, msg.quantity, sink);
+                break;
+            case MsgType::Cancel:
+                ok = cancel(msg.id, sink);
+                break;
+            case MsgType::Modify:
+                ok = amend(msg.id, msg.price, msg.quantity, sink);
+                break;
+            case MsgType::NewStop:
+                ok = addStop(msg.symbol, msg.account, msg.id, msg.side, msg.orderType, msg.price, msg.limitPrice(),
+                             msg.quantity, sink);
+                break;
+            case MsgType::StartAuction:
+                startAuction(msg.symbol);
+                ok = true;
+                break;
+            case MsgType::Uncross:
+                runUncross(msg.symbol, sink);
+                ok = true;
+                break;
+            }
+        } catch (const std::exception&) {
+            // Bad price, unknown symbol, pool exhausted — nothing was changed
+        }
+
+        if (ok) {
+            accepted++;
+        } else {
+            sink.onRejected(msg);
+        }
+    }
+    return accepted;
+}
+
 } // namespace engine
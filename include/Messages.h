@@ -0,0 +1,114 @@
+#pragma once
+
+#include "Types.h"
+
+#include <cstdint>
+#include <stdexcept>
+
+namespace engine {
+
+// === Inbound ===
+enum class MsgType : uint8_t {
+    NewLimit,
+    NewMarket,
+    Cancel,
+    Modify,      // price and quantity are the new price and open quantity
+    NewStop,     // price is the stop price; a stop-limit's limit rides in displayQty (see limitPrice())
+    StartAuction,// symbol only: the book stops matching until the uncross
+    Uncross      // symbol only: trade the auction's cross at one price
+};
+
+// One order-entry message, fixed size so it can sit in a ring buffer
+struct OrderMsg {
+    MsgType type;
+    Side side;
+    OrderType orderType;  // NewLimit: Limit, ImmediateOrCancel, FillOrKill, PostOnly or Iceberg; NewStop: Stop or StopLimit
+    SymbolId symbol;      // cancels only need it to be routed to the right shard
+    OrderId id;
+    Price price;          // ignored for market orders and cancels
+    Quantity quantity;    // ignored for cancels
+    Quantity displayQty;  // icebergs: the peak; stop-limits: limit price - stop price, as an int32
+    AccountId account = 0;  // new orders: who enters it (see RiskTable); modifies keep the order's own
+    uint32_t reserved = 0;
+
+    static OrderMsg limit(OrderId id, Side side, Price price, Quantity qty, SymbolId symbol = 0) {
+        return {MsgType::NewLimit, side, OrderType::Limit, symbol, id, price, qty, 0};
+    }
+    static OrderMsg ioc(OrderId id, Side side, Price price, Quantity qty, SymbolId symbol = 0) {
+        return {MsgType::NewLimit, side, OrderType::ImmediateOrCancel, symbol, id, price, qty, 0};
+    }
+    static OrderMsg fok(OrderId id, Side side, Price price, Quantity qty, SymbolId symbol = 0) {
+        return {MsgType::NewLimit, side, OrderType::FillOrKill, symbol, id, price, qty, 0};
+    }
+    static OrderMsg postOnly(OrderId id, Side side, Price price, Quantity qty, SymbolId symbol = 0) {
+        return {MsgType::NewLimit, side, OrderType::PostOnly, symbol, id, price, qty, 0};
+    }
+    static OrderMsg iceberg(OrderId id, Side side, Price price, Quantity qty, Quantity peak, SymbolId symbol = 0) {
+        return {MsgType::NewLimit, side, OrderType::Iceberg, symbol, id, price, qty, peak};
+    }
+    static OrderMsg market(OrderId id, Side side, Quantity qty, SymbolId symbol = 0) {
+        return {MsgType::NewMarket, side, OrderType::Market, symbol, id, 0, qty, 0};
+    }
+    static OrderMsg stop(OrderId id, Side side, Price stopPrice, Quantity qty, SymbolId symbol = 0) {
+        return {MsgType::NewStop, side, OrderType::Stop, symbol, id, stopPrice, qty, 0};
+    }
+    // Throws std::invalid_argument if the limit is more than 2^31 ticks from the stop
+    static OrderMsg stopLimit(OrderId id, Side side, Price stopPrice, Price price, Quantity qty, SymbolId symbol = 0) {
+        Price offset = price - stopPrice;
+        if (offset < INT32_MIN || offset > INT32_MAX) {
+            throw std::invalid_argument("Stop-limit price too far from its stop price");
+        }
+        return {MsgType::NewStop, side, OrderType::StopLimit, symbol, id, stopPrice,
+                qty, static_cast<Quantity>(static_cast<int32_t>(offset))};
+    }
+    static OrderMsg startAuction(SymbolId symbol = 0) {
+        return {MsgType::StartAuction, Side::Buy, OrderType::Limit, symbol, 0, 0, 0, 0};
+    }
+    static OrderMsg uncross(SymbolId symbol = 0) {
+        return {MsgType::Uncross, Side::Buy, OrderType::Limit, symbol, 0, 0, 0, 0};
+    }
+    static OrderMsg cancel(OrderId id, SymbolId symbol = 0) {
+        return {MsgType::Cancel, Side::Buy, OrderType::Limit, symbol, id, 0, 0, 0};
+    }
+    static OrderMsg modify(OrderId id, Price price, Quantity qty, SymbolId symbol = 0) {
+        return {MsgType::Modify, Side::Buy, OrderType::Limit, symbol, id, price, qty, 0};
+    }
+
+    // The same message entered for `account`
+    OrderMsg from(AccountId owner) const {
+        OrderMsg msg = *this;
+        msg.account = owner;
+        return msg;
+    }
+
+    // NewStop: the price a stop-limit trades at once triggered
+    Price limitPrice() const { return price + static_cast<int32_t>(displayQty); }
+};
+
+static_assert(sizeof(OrderMsg) == 40, "OrderMsg is journaled and ringed as a fixed 40-byte record");
+
+// === Outbound ===
+enum class EventType : uint8_t {
+    Trade,       // orderId = incoming (aggressor), otherId = resting order
+    Rested,      // order accepted and resting in the book, or a stop parked (the ack)
+    Filled,      // order fully filled
+    Cancelled,   // cancelled, or unfilled rest of a market order
+    Rejected,    // invalid message, unknown order on cancel/modify, FOK that can't fill,
+                 // post-only that would cross, or engine error
+    Modified,    // order amended — price/quantity are the new ones (trades and a Rested may follow)
+    Triggered    // parked stop reached — price is its limit (0 for a stop); trades and a Rested may follow
+};
+
+struct EngineEvent {
+    EventType type;
+    Side side;            // side of orderId
+    SymbolId symbol;
+    OrderId orderId;
+    OrderId otherId;      // trades only
+    Price price;
+    Quantity quantity;    // trade size, or remaining quantity for rest/cancel
+    Timestamp timestamp;
+    OrderHandle handle;   // rest/fill/cancel/modify/trigger: the order's handle, for cancel(OrderHandle)
+};
+
+} // namespace engine
@@ -2,38 +2,68 @@
 
 #include <vector>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <stdexcept>
+#include <type_traits>
 #include <new>       // for placement new
 
+#include "PageAllocator.h"
+
 namespace engine {
 
 // A simple object pool that pre-allocates a block of memory
 // and hands out slots without calling new/delete during trading
-template <typename T>
+//
+// Free slots are kept in an intrusive free list: a released slot stores the
+// pointer to the next free slot in its own (now unused) bytes, so the pool
+// needs no side storage. Slots that have never been used are handed out by
+// bumping an index, so construction doesn't have to touch every slot.
+//
+// In growable mode, running out adds another chunk of `capacity` slots
+// instead of throwing. Existing objects never move, so pointers stay valid.
+//
+// PoolOptions choose how chunks are backed: huge pages to cut TLB misses on
+// a deep book, prefaulting and mlock so no page fault lands mid-session, and
+// binding to the matching thread's NUMA node (construct the pool on that thread).
+//
+// Cold is optional per-slot side data kept in a parallel array, so rarely
+// used fields don't dilute the cache lines of the hot T array. It must be a
+// trivially copyable type; it is not constructed — the owner writes it after acquire.
+//
+// Slots are numbered across chunks in allocation order, and the number fits
+// in 32 bits, so owners can link objects by slot instead of by pointer. at()
+// and slotOf() convert either way, with a fast path for the first chunk.
+// Versioned pools also keep a generation per slot, bumped by every release, so
+// a (slot, generation) pair kept by an owner can be checked for staleness.
+struct NoColdData {};
+
+template <typename T, typename Cold = NoColdData, bool Versioned = false>
 class ObjectPool {
+    static_assert(std::is_trivially_copyable_v<Cold>, "Cold data must be trivially copyable");
+
 public:
-    explicit ObjectPool(size_t capacity)
-        : capacity_(capacity)
-        , size_(0)
+    explicit ObjectPool(size_t capacity, const PoolOptions& options = {})
+        : chunkCapacity_(capacity)
+        , options_(options)
     {
-        // Allocate raw memory for all objects at once — one big block
-        // This is the ONLY heap allocation. Everything else is just pointer math.
-        storage_ = static_cast<T*>(std::malloc(capacity * sizeof(T)));
-        if (!storage_) {
-            throw std::bad_alloc();
-        }
-
-        // Build the free list — every slot is available
-        freeSlots_.reserve(capacity);
-        for (size_t i = capacity; i > 0; --i) {
-            freeSlots_.push_back(i - 1);  // push in reverse so slot 0 is used first
+        if (capacity == 0) {
+            throw std::invalid_argument("Object pool capacity must be positive");
         }
+        // Allocate raw memory for all objects at once — one big block
+        // This is the ONLY heap allocation (unless the pool grows).
+        // Everything else is just pointer math.
+        addChunk();
     }
 
     ~ObjectPool() {
         // We don't call destructors here because we manage that in release()
-        // Just free the raw memory block
-        std::free(storage_);
+        // Just free the raw memory blocks
+        for (const Chunk& chunk : chunks_) {
+            freeBlock(chunk.hot);
+            freeBlock(chunk.cold);
+            freeBlock(chunk.generations);
+        }
     }
 
     // No copying — there's only one pool
@@ -44,47 +74,214 @@ public:
     // Args are forwarded to T's constructor
     template <typename... Args>
     T* acquire(Args&&... args) {
-        if (freeSlots_.empty()) {
-            throw std::runtime_error("Object pool exhausted");
+        Slot* slot = freeHead_;
+        if (slot) {
+            // Reuse a released slot — pop it off the free list
+            freeHead_ = slot->next;
+        } else {
+            // Take the next never-used slot in the newest chunk
+            if (bumpNext_ == bumpEnd_) {
+                if (!options_.growable) {
+                    throw std::runtime_error("Object pool exhausted");
+                }
+                addChunk();
+            }
+            slot = bumpNext_++;
         }
-
-        // Pop a free slot index
-        size_t index = freeSlots_.back();
-        freeSlots_.pop_back();
         size_++;
 
         // Construct the object in the pre-allocated memory
         // This is "placement new" — it doesn't allocate, just constructs
-        T* slot = &storage_[index];
-        new (slot) T(std::forward<Args>(args)...);
-
-        return slot;
+        return new (slot->storage) T(std::forward<Args>(args)...);
     }
 
     // Release an object — call its destructor and return the slot
     void release(T* ptr) {
         if (!ptr) return;
 
-        // Calculate which slot index this pointer corresponds to
-        size_t index = static_cast<size_t>(ptr - storage_);
+        if constexpr (Versioned) {
+            generationAt(slotOf(ptr))++;
+        }
 
         // Call the destructor (cleanup the object)
         ptr->~T();
 
-        // Return the slot to the free list
-        freeSlots_.push_back(index);
+        // Thread the slot onto the free list
+        Slot* slot = reinterpret_cast<Slot*>(ptr);
+        slot->next = freeHead_;
+        freeHead_ = slot;
         size_--;
     }
 
+    // Start loading the slot the next acquire() will hand out
+    void prefetchNext() const {
+        __builtin_prefetch(freeHead_ ? static_cast<const void*>(freeHead_) : bumpNext_, 1);
+    }
+
     size_t size() const { return size_; }
-    size_t capacity() const { return capacity_; }
-    size_t available() const { return freeSlots_.size(); }
+    size_t capacity() const { return chunks_.size() * chunkCapacity_; }
+    size_t available() const { return capacity() - size_; }
+    bool growable() const { return options_.growable; }
+
+    // Backing actually in use (HugeTlb falls back to TransparentHuge when none are reserved)
+    PageBacking backing() const { return chunks_.front().hot.backing; }
+
+    // Slot number of a live object, counting across chunks in allocation order
+    size_t indexOf(const T* ptr) const {
+        const Slot* slot = reinterpret_cast<const Slot*>(ptr);
+        size_t offset = (reinterpret_cast<uintptr_t>(slot) - reinterpret_cast<uintptr_t>(first_)) / sizeof(Slot);
+        if (offset < chunkCapacity_) {
+            return offset;
+        }
+        for (size_t c = 1; c < chunks_.size(); ++c) {
+            const Slot* begin = chunks_[c].slots;
+            if (slot >= begin && slot < begin + chunkCapacity_) {
+                return c * chunkCapacity_ + static_cast<size_t>(slot - begin);
+            }
+        }
+        throw std::out_of_range("Pointer does not belong to this pool");
+    }
+
+    uint32_t slotOf(const T* ptr) const { return static_cast<uint32_t>(indexOf(ptr)); }
+
+    // Object in slot `index` (which must be live)
+    T* at(uint32_t index) {
+        if (index < chunkCapacity_) [[likely]] {
+            return reinterpret_cast<T*>(first_[index].storage);
+        }
+        return slotAt(index);
+    }
+    const T* at(uint32_t index) const { return const_cast<ObjectPool*>(this)->at(index); }
+
+    // Generation of a slot: starts at 0, +1 on every release
+    uint32_t generation(uint32_t index) const {
+        static_assert(Versioned, "Pool keeps no generations");
+        return const_cast<ObjectPool*>(this)->generationAt(index);
+    }
+
+    // Is slot `index` still holding the object it held at `generation`?
+    bool current(uint32_t index, uint32_t generation) const {
+        return index < highWater() && this->generation(index) == generation;
+    }
+
+    // Cold side data for a live object
+    Cold& cold(const T* ptr) {
+        static_assert(!std::is_empty_v<Cold>, "Pool has no cold data");
+        const Slot* slot = reinterpret_cast<const Slot*>(ptr);
+        for (const Chunk& chunk : chunks_) {
+            if (slot >= chunk.slots && slot < chunk.slots + chunkCapacity_) {
+                return chunk.coldData[slot - chunk.slots];
+            }
+        }
+        throw std::out_of_range("Pointer does not belong to this pool");
+    }
+    const Cold& cold(const T* ptr) const { return const_cast<ObjectPool*>(this)->cold(ptr); }
+
+    // === Snapshot support ===
+    // Slots handed out at least once — every slot below this is live or on the free list
+    size_t highWater() const {
+        return (chunks_.size() - 1) * chunkCapacity_ + static_cast<size_t>(bumpNext_ - chunks_.back().slots);
+    }
+
+    // Storage of slot `index` (as numbered by indexOf), live or not
+    T* slotAt(size_t index) {
+        return reinterpret_cast<T*>(chunks_[index / chunkCapacity_].slots[index % chunkCapacity_].storage);
+    }
+
+    // Visit the free list as f(slotIndex), head first
+    template <typename F>
+    void forEachFree(F&& f) const {
+        for (const Slot* slot = freeHead_; slot; slot = slot->next) {
+            f(indexOf(reinterpret_cast<const T*>(slot)));
+        }
+    }
+
+    // Recreate the allocation state of a snapshot in an unused pool: slots
+    // [0, highWater) are in use except `freeSlots` (free list order, head
+    // first). The caller then constructs the live objects with slotAt().
+    void restore(size_t highWater, const uint32_t* freeSlots, size_t freeCount) {
+        if (size_ != 0 || freeHead_ || bumpNext_ != chunks_.front().slots) {
+            throw std::logic_error("Can only restore an unused pool");
+        }
+        while (capacity() < highWater) {
+            if (!options_.growable) {
+                throw std::runtime_error("Object pool too small for snapshot");
+            }
+            addChunk();
+        }
+        const Chunk& last = chunks_.back();
+        bumpNext_ = last.slots + (highWater - (chunks_.size() - 1) * chunkCapacity_);
+
+        for (size_t i = freeCount; i-- > 0;) {
+            Slot* slot = reinterpret_cast<Slot*>(slotAt(freeSlots[i]));
+            slot->next = freeHead_;
+            freeHead_ = slot;
+        }
+        size_ = highWater - freeCount;
+    }
 
 private:
-    T* storage_;                    // one contiguous block of memory
-    std::vector<size_t> freeSlots_; // indices of available slots
-    size_t capacity_;
-    size_t size_;
+    // A slot holds either a live T or, while free, the next free slot
+    union Slot {
+        Slot* next;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    // A contiguous block of chunkCapacity_ slots, plus its parallel cold and generation arrays
+    struct Chunk {
+        MemoryBlock hot;
+        MemoryBlock cold;
+        MemoryBlock generations;
+        Slot* slots;
+        Cold* coldData;
+        uint32_t* generationData;
+    };
+
+    std::vector<Chunk> chunks_;
+    Slot* first_ = nullptr;         // slots of the first chunk — what at() and indexOf() try first
+    Slot* freeHead_ = nullptr;      // released slots, most recent first
+    Slot* bumpNext_ = nullptr;      // next never-used slot in the newest chunk
+    Slot* bumpEnd_ = nullptr;
+    size_t chunkCapacity_;
+    size_t size_ = 0;
+    PoolOptions options_;
+
+    uint32_t& generationAt(uint32_t index) {
+        if (index < chunkCapacity_) [[likely]] {
+            return chunks_.front().generationData[index];
+        }
+        return chunks_[index / chunkCapacity_].generationData[index % chunkCapacity_];
+    }
+
+    void addChunk() {
+        // Slot numbers are 32-bit, with the top value left free as a "no slot" marker
+        if ((chunks_.size() + 1) * chunkCapacity_ >= UINT32_MAX) {
+            throw std::length_error("Object pool can't number more than 2^32 - 1 slots");
+        }
+        chunks_.reserve(chunks_.size() + 1);
+        Chunk chunk{};
+        chunk.hot = allocateBlock(chunkCapacity_ * sizeof(Slot), alignof(Slot), options_);
+        chunk.slots = static_cast<Slot*>(chunk.hot.data);
+        try {
+            if constexpr (!std::is_empty_v<Cold>) {
+                chunk.cold = allocateBlock(chunkCapacity_ * sizeof(Cold), alignof(Cold), options_);
+                chunk.coldData = static_cast<Cold*>(chunk.cold.data);
+            }
+            if constexpr (Versioned) {
+                chunk.generations = allocateBlock(chunkCapacity_ * sizeof(uint32_t), alignof(uint32_t), options_);
+                chunk.generationData = static_cast<uint32_t*>(chunk.generations.data);
+                std::memset(chunk.generationData, 0, chunkCapacity_ * sizeof(uint32_t));
+            }
+        } catch (...) {
+            freeBlock(chunk.hot);
+            freeBlock(chunk.cold);
+            throw;
+        }
+        chunks_.push_back(chunk);
+        if (!first_) first_ = chunk.slots;
+        bumpNext_ = chunk.slots;
+        bumpEnd_ = chunk.slots + chunkCapacity_;
+    }
 };
 
 } // namespace engine
@@ -1,37 +1,67 @@
 #pragma once
 
 #include "Types.h"
+#include "ObjectPool.h"
+#include <algorithm>
+#include <cstddef>
 #include <string>
-#include <list>
 
 namespace engine {
 
-struct Order {
+// Cache line size we lay the hot structures out for
+inline constexpr size_t kCacheLineSize = 64;
+
+// Only the fields the match loop, rest and cancel paths touch live here, so an
+// order is exactly one cache line and never straddles two. Everything else
+// lives in OrderMeta, in a parallel array indexed by pool slot.
+struct alignas(kCacheLineSize) Order {
     OrderId id;
-    Side side;
-    OrderType type;
     Price price;          // in ticks (ignored for market orders)
-    Quantity quantity;     // original quantity
     Quantity remaining;    // how much is left to fill
-    Timestamp timestamp;
+    SymbolId symbol;       // which book the order belongs to
+    Side side;
+    OrderType type;
 
-    // added a bookPosition to track the order's position in the order book for efficient cancellations
-    std::list<Order*>::iterator bookPosition;
+    // Icebergs only: remaining is the displayed slice, hidden the reserve behind it
+    Quantity hidden = 0;
+    Quantity peak = 0;     // size of each displayed slice
+
+    // Links for the price level's FIFO queue — the list lives inside the orders
+    // themselves, so resting an order never allocates a list node
+    OrderSlot prev = kNoSlot;
+    OrderSlot next = kNoSlot;
+
+    // This order's own pool slot and its generation (set by acquireOrder)
+    OrderSlot slot = kNoSlot;
+    uint32_t generation = 0;
+
+    // Who entered it — risk limits and self-trade prevention are per account
+    AccountId account = 0;
+
+    // Stops only: the trade price that triggers it (price is a stop-limit's limit)
+    Price stopPrice = 0;
 
     // Constructor for a new order
-    Order(OrderId id, Side side, OrderType type, Price price, Quantity quantity)
+    Order(OrderId id, Side side, OrderType type, Price price, Quantity quantity, SymbolId symbol = 0)
         : id(id)
-        , side(side)
-        , type(type)
         , price(price)
-        , quantity(quantity)
         , remaining(quantity)
-        , timestamp(now())
+        , symbol(symbol)
+        , side(side)
+        , type(type)
     {}
 
-    // Is this order fully filled?
+    // Is this order fully filled? (an iceberg's displayed slice can be, with reserve left)
     bool isFilled() const { return remaining == 0; }
 
+    // Displayed plus hidden quantity
+    Quantity openQuantity() const { return remaining + hidden; }
+
+    OrderHandle handle() const { return {slot, generation}; }
+
+    // Still parked waiting for its trigger? (a triggered stop takes the type it trades as)
+    bool isStop() const { return type == OrderType::Stop || type == OrderType::StopLimit; }
+
     // Fill some quantity, returns how much was actually filled
     Quantity fill(Quantity qty) {
         Quantity filled = std::min(qty, remaining);
@@ -40,4 +70,26 @@ struct Order {
     }
 };
 
+static_assert(sizeof(Order) == kCacheLineSize, "Order must be exactly one cache line");
+static_assert(alignof(Order) == kCacheLineSize, "Order must start on a cache line boundary");
+static_assert(offsetof(Order, stopPrice) + sizeof(Price) <= kCacheLineSize, "Hot fields must fit in one line");
+
+// Cold per-order data — written once when the order arrives, never read by matching
+struct OrderMeta {
+    Quantity quantity;     // original quantity
+    Timestamp timestamp;   // arrival time
+};
+
+// Orders, their cold data and a generation per slot
+using OrderPool = ObjectPool<Order, OrderMeta, true>;
+
+// Take a slot for a new order and record the slot and its generation in it
+template <typename... Args>
+Order* acquireOrder(OrderPool& pool, Args&&... args) {
+    Order* order = pool.acquire(std::forward<Args>(args)...);
+    order->slot = pool.slotOf(order);
+    order->generation = pool.generation(order->slot);
+    return order;
+}
+
 } // namespace engine
@@ -3,93 +3,694 @@
 #include "Types.h"
 #include "Order.h"
 #include "Trade.h"
+#include "PriceLadder.h"
+#include "OrderIndex.h"
+#include "EventListener.h"
+#include "Clock.h"
+#include "TopOfBook.h"
+#include "DepthKernels.h"
+#include "Risk.h"
 
-#include <map>
-#include <list>
-#include <unordered_map>
+#include <memory>
 #include <vector>
 #include <optional>
 
 namespace engine {
 
-// Result of a match operation — includes trades AND pointers to filled resting orders
-// so the engine can release them back to the pool
+// Result of a match operation — includes trades AND the slots of filled resting
+// orders so the engine can release them back to the pool
 struct MatchResult {
     std::vector<Trade> trades;
-    std::vector<Order*> filledOrders;  // resting orders that were fully filled
+    std::vector<OrderSlot> filledOrders;  // resting orders that were fully filled
 };
 
-// A single price level — holds all orders at one price
-// Uses std::list because we need fast removal from the middle (when orders cancel)
-struct PriceLevel {
-    Price price;
-    std::list<Order*> orders;    // FIFO queue of orders at this price
-    Quantity totalQuantity = 0;  // total remaining qty at this level
+// What a cancel does to the order's place in its level
+//
+// With Lazy, when a dead order's slot goes back to the pool depends on when
+// compact() runs — EngineRunner runs it whenever its inbound ring is empty,
+// so on timing. Slot reuse then follows timing too: trades and books replay
+// the same from a journal, but which pool slot an order gets (the
+// OrderHandle in its events) and a snapshot's slot layout may not.
+enum class CancelMode : uint8_t {
+    Eager,   // unlink it and free its slot straight away
+    Lazy     // mark it dead in place; the match loop or compact() unlinks it later
+};
 
-    explicit PriceLevel(Price p) : price(p) {}
+// Ladder layout for both sides of the book, plus sizing for the order ID index
+// Prices are in ticks; tickSize lets a book only accept every Nth price.
+// If basePrice is not set the window is centered on the first order seen.
+struct BookConfig {
+    Price tickSize = 1;
+    size_t ladderLevels = 4096;          // initial window size per side (grows if needed)
+    std::optional<Price> basePrice;      // price of level 0
 
-    void addOrder(Order* order) {
-        orders.push_back(order);
-        order->bookPosition = std::prev(orders.end()); // store iterator for O(1) removal
-        totalQuantity += order->remaining;
-    }
+    // Most levels a side's window may grow to (rounded up to a power of two).
+    // An order priced too far from the levels already resting to share a
+    // window with them is refused before it trades (see MatchingEngine).
+    size_t maxLadderLevels = size_t{1} << 20;
 
-    void removeOrder(Order* order) {
-        totalQuantity -= order->remaining;
-        orders.erase(order->bookPosition);
-    }
+    // Most orders that can rest at once — the ID index gets twice this many slots
+    // so it never rehashes (MatchingEngine fills this in from its pool size)
+    size_t maxOrders = 0;
+    IndexMode indexMode = IndexMode::Hashed;
+
+    // Lazy: a level is queued for compact() once more than this share of the
+    // orders linked in it are dead
+    CancelMode cancelMode = CancelMode::Eager;
+    double compactRatio = 0.5;
+};
+
+// A level whose quantity or order count may have changed (see OrderBook::trackChanges)
+struct LevelChange {
+    SymbolId symbol;
+    Side side;
+    Price price;
+};
+
+// One row of a depth snapshot
+struct DepthLevel {
+    Price price;
+    Quantity totalQuantity;
+    uint32_t orderCount;
+};
+
+// What an order would trade against the book, worked out from level totals
+struct FillEstimate {
+    uint64_t quantity = 0;     // what it would fill, up to the size asked
+    double averagePrice = 0;   // volume-weighted price of that fill (0 if nothing fills)
+    Price worstPrice = 0;      // furthest level it reaches
+    bool complete = false;     // the whole size fills
+};
 
-    bool empty() const { return orders.empty(); }
+// An auction's uncrossing: one price, and what trades there
+struct AuctionResult {
+    Price price = 0;        // equilibrium price (0 if the book isn't crossed)
+    uint64_t volume = 0;    // quantity that trades at it
+    int64_t surplus = 0;    // bid minus ask quantity on offer at it (> 0: buy pressure)
 };
 
+// Orders in the book must come from `pool` (see acquireOrder): levels and
+// the ID index link them by pool slot. The pool must outlive the book.
 class OrderBook {
 public:
-    OrderBook() = default;
+    explicit OrderBook(OrderPool& pool, const BookConfig& config = {})
+        : tickSize_(config.tickSize)
+        , bids_(config.tickSize, config.ladderLevels, config.basePrice, config.maxLadderLevels)
+        , asks_(config.tickSize, config.ladderLevels, config.basePrice, config.maxLadderLevels)
+        , buyStops_(config.tickSize, kStopLadderLevels, std::nullopt, config.maxLadderLevels)
+        , sellStops_(config.tickSize, kStopLadderLevels, std::nullopt, config.maxLadderLevels)
+        , ownedLookup_(std::make_unique<OrderIndex>(pool, config.maxOrders * 2, config.indexMode))
+        , orderLookup_(ownedLookup_.get())
+        , pool_(&pool)
+        , compactRatio_(config.compactRatio)
+    {}
+
+    // A book that registers its resting orders in an index shared with other
+    // books (one per engine, so a cancel by ID doesn't need to know the symbol)
+    // config.maxOrders and indexMode are ignored; the index must outlive the book.
+    OrderBook(OrderPool& pool, const BookConfig& config, OrderIndex& sharedLookup)
+        : tickSize_(config.tickSize)
+        , bids_(config.tickSize, config.ladderLevels, config.basePrice, config.maxLadderLevels)
+        , asks_(config.tickSize, config.ladderLevels, config.basePrice, config.maxLadderLevels)
+        , buyStops_(config.tickSize, kStopLadderLevels, std::nullopt, config.maxLadderLevels)
+        , sellStops_(config.tickSize, kStopLadderLevels, std::nullopt, config.maxLadderLevels)
+        , orderLookup_(&sharedLookup)
+        , pool_(&pool)
+        , compactRatio_(config.compactRatio)
+    {}
 
     // === Core operations ===
     // Add a limit order to the book (after matching is attempted)
+    void addOrder(Order* order) {
+        if (order->side == Side::Buy) {
+            addOrder<Side::Buy>(order);
+        } else {
+            addOrder<Side::Sell>(order);
+        }
+    }
+    template <Side S>
     void addOrder(Order* order);
 
-    // Cancel an order by ID
-    bool cancelOrder(OrderId id);
+    // Cancel an order by ID — returns the removed order, or nullptr if not found
+    Order* cancelOrder(OrderId id);
+
+    // Take a resting order (already looked up) out of the book
+    void removeOrder(Order* order);
+
+    // Lazy cancel: take a resting order's quantity and ID out of the book but
+    // leave it linked in its level, marked dead (remaining 0). Its slot stays
+    // in use until the order is unlinked — by the match loop when it reaches
+    // the front, right here if no live order is left in the level, or by
+    // compact() once the level is mostly dead. Slots of the orders unlinked
+    // here are appended to `freed` for the caller to release.
+    void markCancelled(Order* order, std::vector<OrderSlot>& freed);
+
+    // Unlink the dead orders of up to maxLevels levels queued by markCancelled
+    // (each level is walked once, end to end). Freed slots are appended to
+    // `freed`; returns how many levels were compacted.
+    size_t compact(size_t maxLevels, std::vector<OrderSlot>& freed);
+    size_t pendingCompactions() const { return pendingCompaction_.size(); }
+
+    // Empty the book: every order (resting, lazily cancelled or a parked
+    // stop) leaves the index and its slot is appended to `freed`, and the
+    // last trade price and auction phase are forgotten. The ladders keep
+    // their size and window, so filling the book again allocates nothing.
+    void clear(std::vector<OrderSlot>& freed);
+
+    // Lower a resting order's open quantity in place (0 < newOpen <= openQuantity())
+    // The order keeps its position in the level's queue. An iceberg's reserve
+    // is trimmed before its displayed slice.
+    void reduceOrder(Order* order, Quantity newOpen);
 
     // === Matching ===
     // Try to match an incoming order against resting orders
     // Returns trades and pointers to filled resting orders
     MatchResult match(Order& incomingOrder);
 
+    // Same, without building a MatchResult: each trade goes to listener.onTrade
+    // (and each fully filled resting order to listener.onOrderFilled) as it happens.
+    // Slots of filled resting orders are appended to `filled` so the caller can release them.
+    // Trades are stamped with clock.stamp(). Returns the number of trades.
+    template <typename Listener>
+    size_t match(Order& incomingOrder, Listener& listener, std::vector<OrderSlot>& filled, const Clock& clock) {
+        bool market = incomingOrder.type == OrderType::Market;
+        if (incomingOrder.side == Side::Buy) {
+            return market ? match<Side::Buy, OrderType::Market>(incomingOrder, listener, filled, clock)
+                          : match<Side::Buy, OrderType::Limit>(incomingOrder, listener, filled, clock);
+        } else {
+            return market ? match<Side::Sell, OrderType::Market>(incomingOrder, listener, filled, clock)
+                          : match<Side::Sell, OrderType::Limit>(incomingOrder, listener, filled, clock);
+        }
+    }
+
+    // The same, with side and type known at compile time — what the engine
+    // calls after dispatching once per message. Market orders skip the price
+    // check; every other type stops at the first level it doesn't cross.
+    // A resting iceberg whose displayed slice fills is refilled from its
+    // reserve in the same slot and moved to the back of its level.
+    template <Side S, OrderType T, typename Listener>
+    size_t match(Order& incomingOrder, Listener& listener, std::vector<OrderSlot>& filled, const Clock& clock);
+
+    // Best price an order of side S would trade against (nullopt: that side is empty)
+    template <Side S>
+    std::optional<Price> bestOpposite() const {
+        const PriceLevel* best = opposite<S>().best();
+        return best ? std::optional<Price>(best->price) : std::nullopt;
+    }
+
+    // Would a limit order at this price trade against the other side?
+    // When it wouldn't, the engine rests it without entering the match loop.
+    template <Side S>
+    bool crosses(Price price) const {
+        const PriceLevel* best = opposite<S>().best();
+        return best && Crosses<S>::at(price, best->price);
+    }
+    bool crosses(Side side, Price price) const {
+        return side == Side::Buy ? crosses<Side::Buy>(price) : crosses<Side::Sell>(price);
+    }
+
+    // Is there at least `qty` displayed on the other side at prices a limit
+    // order at `price` can trade? Walks level totals from the best price, so
+    // no resting order is touched. Hidden iceberg reserve isn't counted.
+    template <Side S>
+    bool canFill(Price price, Quantity qty) const {
+        const auto& book = opposite<S>();
+        uint64_t available = 0;
+        for (const PriceLevel* level = book.best(); level && Crosses<S>::at(price, level->price); level = book.next(*level)) {
+            available += level->totalQuantity;
+            if (available >= qty) return true;
+        }
+        return false;
+    }
+
+    // The same, leaving out `account`'s own resting orders — what a FOK of an
+    // account that prevents self trades can count on, since the match loop
+    // cancels those instead of trading them. Walks the orders of the levels
+    // it would reach rather than their totals.
+    template <Side S>
+    bool canFillExcluding(Price price, Quantity qty, AccountId account) const {
+        const auto& book = opposite<S>();
+        uint64_t available = 0;
+        for (const PriceLevel* level = book.best(); level && Crosses<S>::at(price, level->price); level = book.next(*level)) {
+            for (OrderSlot slot = level->head; slot != kNoSlot;) {
+                const Order* order = pool_->at(slot);
+                if (order->account != account) {
+                    available += order->remaining;   // 0 for a lazily cancelled order
+                    if (available >= qty) return true;
+                }
+                slot = order->next;
+            }
+        }
+        return false;
+    }
+
+    // === Stop orders ===
+    // Parked stops sit in their own ladders keyed by stop price, out of
+    // bids_/asks_, so nothing that reads the book sees them. A buy stop
+    // triggers once a trade prints at or above its stop price, a sell stop at
+    // or below, so each side's triggered stops are a run from its best level.
+
+    // Park a stop (order->stopPrice set) and index it under its ID
+    void addStop(Order* order);
+
+    // Take a parked stop out (cancel)
+    void removeStop(Order* order);
+
+    // Would a stop at this price trigger on the last trade already?
+    bool stopTriggered(Side side, Price stopPrice) const {
+        if (!lastTradePrice_) return false;
+        return side == Side::Buy ? Crosses<Side::Buy>::at(*lastTradePrice_, stopPrice)
+                                 : Crosses<Side::Sell>::at(*lastTradePrice_, stopPrice);
+    }
+
+    // Unpark every stop the last trade has reached and append their slots to
+    // `triggered`: nearest stop price first, FIFO at a price. Only the
+    // triggered levels are touched. The orders leave the index; they keep
+    // their stop type for the caller to convert.
+    void takeTriggered(std::vector<OrderSlot>& triggered);
+
+    size_t stopCount() const { return stopCount_; }
+
+    // Price of the book's most recent trade (nullopt before the first)
+    std::optional<Price> lastTradePrice() const { return lastTradePrice_; }
+
+    // === Auctions ===
+    // During an auction the book takes orders without matching them: a
+    // limit order rests even where it crosses, until uncross() trades the
+    // whole cross at one price and the book goes back to continuous matching.
+    void startAuction() { auction_ = true; }
+    bool inAuction() const { return auction_; }
+
+    // The price that trades the most if the book uncrossed now. One walk
+    // down the crossed range (best ask to best bid) over both sides' level
+    // totals: bid quantity at or above the price accumulates, ask quantity at
+    // or below it falls away, and every level is visited once. Ties go to
+    // the smaller surplus, then to the price nearest the last trade, then to
+    // the lower price. Only displayed quantity counts; volume 0 if the book
+    // isn't crossed.
+    AuctionResult auctionPrice() const;
+
+    // Trade `at.volume` at `at.price` — highest bids against lowest asks,
+    // FIFO within a level — and leave the auction. Trades go straight to
+    // listener.onTrade (aggressor Buy: an auction trade has none) and filled
+    // orders to listener.onOrderFilled, their slots appended to `filled`.
+    // `at` must come from auctionPrice() on this book as it is. Returns the
+    // number of trades.
+    template <typename Listener>
+    size_t uncross(const AuctionResult& at, Listener& listener, std::vector<OrderSlot>& filled, const Clock& clock);
+
+    // === Depth queries ===
+    // Scans of level totals along the price ladder with the SIMD kernels in
+    // DepthKernels.h — no order is touched. Hidden iceberg reserve isn't
+    // counted, and neither is anything outside the ladder window.
+
+    // Displayed quantity resting on one side within `ticks` ticks of its best
+    // price (0 = the best level alone)
+    uint64_t depthWithin(Side side, size_t ticks) const;
+
+    // What an order of `side` for `qty` would trade against the other side,
+    // stopping at `limit` if given: how much fills, at what average price,
+    // and how far it sweeps
+    FillEstimate estimateFill(Side side, uint64_t qty, std::optional<Price> limit = std::nullopt) const;
+
     // === Market data ===
     std::optional<Price> bestBid() const;
     std::optional<Price> bestAsk() const;
     std::optional<Price> spread() const;
 
+    // Start loading the level an order at this price would rest on
+    void prefetchLevel(Side side, Price price) const {
+        if (side == Side::Buy) {
+            bids_.prefetch(price);
+        } else {
+            asks_.prefetch(price);
+        }
+    }
+
+    // Best level of each side, with sizes (no sequence number)
+    TopOfBook top() const;
+
+    // Level at a price, or nullptr if nothing rests there
+    const PriceLevel* level(Side side, Price price) const {
+        return side == Side::Buy ? bids_.find(price) : asks_.find(price);
+    }
+
+    // Copy up to maxLevels levels of one side into `out`, best first
+    // Returns how many were written. Doesn't allocate.
+    size_t depth(Side side, DepthLevel* out, size_t maxLevels) const;
+
+    // Append a LevelChange to `log` for every level an add, cancel or match
+    // touches (a level can appear more than once). nullptr stops tracking.
+    void trackChanges(std::vector<LevelChange>* log) { changes_ = log; }
+
+    // Keep `table`'s open quantity and notional current as orders rest here,
+    // fill and leave, and cancel a resting order instead of trading it with
+    // an incoming order of the same account when that account prevents self
+    // trades (nullptr stops both). Parked stops don't count, and the auction
+    // uncross doesn't prevent self trades. clear() leaves the table alone.
+    void trackRisk(RiskTable* table) { risk_ = table; }
+
+    // Can an order rest at this price? (must be a multiple of the tick size)
+    bool isValidPrice(Price price) const { return price % tickSize_ == 0; }
+
+    // Is there room for a level at this price on the order's side — is it
+    // near enough the levels already there to share the ladder window?
+    bool canRest(Side side, Price price) const { return side == Side::Buy ? bids_.fits(price) : asks_.fits(price); }
+
+    // The same for a stop parked at this stop price
+    bool canPark(Side side, Price stopPrice) const {
+        return side == Side::Buy ? buyStops_.fits(stopPrice) : sellStops_.fits(stopPrice);
+    }
+
     // How many orders are in the book
-    size_t orderCount() const { return orderLookup_.size(); }
+    size_t orderCount() const { return restingCount_; }
 
     // How many price levels on each side
-    size_t bidLevelCount() const { return bids_.size(); }
-    size_t askLevelCount() const { return asks_.size(); }
+    size_t bidLevelCount() const { return bids_.levelCount(); }
+    size_t askLevelCount() const { return asks_.levelCount(); }
 
     // Print the book for debugging
     void printBook(int depth = 5) const;
 
+    // === Snapshot support ===
+    const PriceLadder<Side::Buy>& bids() const { return bids_; }
+    const PriceLadder<Side::Sell>& asks() const { return asks_; }
+    const PriceLadder<Side::Sell>& buyStops() const { return buyStops_; }
+    const PriceLadder<Side::Buy>& sellStops() const { return sellStops_; }
+
+    // Set one side's ladder window while the book is empty
+    void restoreWindow(Side side, Price basePrice, size_t capacity) {
+        if (side == Side::Buy) {
+            bids_.restoreWindow(basePrice, capacity);
+        } else {
+            asks_.restoreWindow(basePrice, capacity);
+        }
+    }
+
+    // Put back a whole level whose orders are already linked head → tail
+    // The orders' IDs must be restored into the index separately.
+    void restoreLevel(Side side, Price price, OrderSlot head, OrderSlot tail, uint32_t orderCount, Quantity totalQuantity) {
+        PriceLevel& level = side == Side::Buy ? bids_.getOrCreate(price) : asks_.getOrCreate(price);
+        level.head = head;
+        level.tail = tail;
+        level.orderCount = orderCount;
+        level.totalQuantity = totalQuantity;
+        level.deadCount = 0;
+        restingCount_ += orderCount;
+    }
+
+    // The same for a level of parked stops (price is the stop price)
+    void restoreStopLevel(Side side, Price price, OrderSlot head, OrderSlot tail, uint32_t orderCount, Quantity totalQuantity) {
+        PriceLevel& level = side == Side::Buy ? buyStops_.getOrCreate(price) : sellStops_.getOrCreate(price);
+        level.head = head;
+        level.tail = tail;
+        level.orderCount = orderCount;
+        level.totalQuantity = totalQuantity;
+        level.deadCount = 0;
+        stopCount_ += orderCount;
+    }
+
+    void restoreLastTrade(std::optional<Price> price) { lastTradePrice_ = price; }
+
 private:
-    // Bids: sorted high to low (best bid = highest price = first)
-    // std::map with std::greater gives us descending order
-    std::map<Price, PriceLevel, std::greater<Price>> bids_;
-
-    // Asks: sorted low to high (best ask = lowest price = first)
-    // std::map default is ascending, which is what we want
-    std::map<Price, PriceLevel> asks_;
-
-    // Fast lookup: order ID → which side and price level it's in
-    std::unordered_map<OrderId, Order*> orderLookup_;
-
-    // Internal helpers
-    MatchResult matchBuy(Order& order);
-    MatchResult matchSell(Order& order);
-    void addToAsks(Order* order);
-    void addToBids(Order* order);
+    Price tickSize_;
+
+    // Bids: best bid = highest non-empty level
+    PriceLadder<Side::Buy> bids_;
+
+    // Asks: best ask = lowest non-empty level
+    PriceLadder<Side::Sell> asks_;
+
+    // Parked stops by stop price, best = next to trigger: buy stops lowest
+    // first, sell stops highest first. They start small — stops are few
+    // next to resting orders — and grow like any ladder.
+    static constexpr size_t kStopLadderLevels = 64;
+    PriceLadder<Side::Sell> buyStops_;
+    PriceLadder<Side::Buy> sellStops_;
+    size_t stopCount_ = 0;
+    std::optional<Price> lastTradePrice_;
+    bool auction_ = false;
+
+    // Fast lookup: order ID → resting order (flat, pre-sized, no allocation)
+    // Either this book's own index or one shared by every book in the engine
+    std::unique_ptr<OrderIndex> ownedLookup_;
+    OrderIndex* orderLookup_;
+    OrderPool* pool_;
+    size_t restingCount_ = 0;
+    std::vector<LevelChange>* changes_ = nullptr;
+    RiskTable* risk_ = nullptr;
+
+    // Levels markCancelled found mostly dead, waiting for compact()
+    struct PendingLevel {
+        Side side;
+        Price price;
+    };
+    std::vector<PendingLevel> pendingCompaction_;
+    double compactRatio_;
+
+    // Unlink every dead order in a level, appending their slots to `freed`
+    void reclaimDead(PriceLevel& level, std::vector<OrderSlot>& freed);
+
+    // Self-trade prevention: cancel the front order of a level instead of trading it
+    template <typename Listener>
+    void cancelSelfTrade(PriceLevel& level, Order* order, Listener& listener, std::vector<OrderSlot>& filled);
+
+    // Uncross: the front order of a level on side S just filled
+    template <Side S, typename Listener>
+    void retireFront(PriceLevel& level, Order* order, Listener& listener, std::vector<OrderSlot>& filled);
+
+    void noteChange(SymbolId symbol, Side side, Price price) {
+        if (changes_) changes_->push_back({symbol, side, price});
+    }
+
+    // Ladder an order of side S rests on, and the one it matches against
+    template <Side S>
+    PriceLadder<S>& own() {
+        if constexpr (S == Side::Buy) return bids_;
+        else return asks_;
+    }
+    template <Side S>
+    auto& opposite() {
+        if constexpr (S == Side::Buy) return asks_;
+        else return bids_;
+    }
+    template <Side S>
+    const auto& opposite() const { return const_cast<OrderBook*>(this)->opposite<S>(); }
+
+    // Does an order of side S at `price` trade with a resting level at `levelPrice`?
+    template <Side S>
+    struct Crosses {
+        static bool at(Price price, Price levelPrice) {
+            if constexpr (S == Side::Buy) return price >= levelPrice;   // buy lifts asks at or below its price
+            else return price <= levelPrice;                            // sell hits bids at or above its price
+        }
+    };
+
+    static constexpr Side oppositeSide(Side side) { return side == Side::Buy ? Side::Sell : Side::Buy; }
 };
 
+template <Side S>
+void OrderBook::addOrder(Order* order) {
+    // Creates the price level if it doesn't exist yet
+    own<S>().getOrCreate(order->price).addOrder(order, *pool_);
+    orderLookup_->insert(order->id, order);
+    restingCount_++;
+    if (risk_) risk_->addOpen(order->account, order->price, order->openQuantity());
+    noteChange(order->symbol, S, order->price);
+}
+
+// Incoming order of side S against the other side of the book
+// A buy walks the asks from the lowest price up, a sell walks the bids from
+// the highest down. Trades happen at the resting order's price.
+template <Side S, OrderType T, typename Listener>
+size_t OrderBook::match(Order& order, Listener& listener, std::vector<OrderSlot>& filled, const Clock& clock) {
+    auto& book = opposite<S>();
+    size_t tradeCount = 0;
+    size_t levels = 0;
+    Price lastPrice = 0;
+
+    while (!book.empty() && order.remaining > 0) {
+        PriceLevel& level = *book.best();
+        Price levelPrice = level.price;
+
+        // Check if prices cross — market orders take whatever is there
+        if constexpr (T != OrderType::Market) {
+            if (!Crosses<S>::at(order.price, levelPrice)) break;
+        }
+        levels++;
+
+        // Match against orders at this price level (FIFO)
+        while (!level.empty() && order.remaining > 0) {
+            Order* restingOrder = level.front(*pool_);
+
+            // Lazily cancelled: unlink it, its slot is released with the filled ones
+            if (restingOrder->remaining == 0) [[unlikely]] {
+                level.reclaim(restingOrder, *pool_);
+                filled.push_back(restingOrder->slot);
+                continue;
+            }
+
+            // The same account on both sides: one compare, and only then the table
+            if (restingOrder->account == order.account && risk_ && risk_->preventsSelfTrade(order.account)) [[unlikely]] {
+                cancelSelfTrade(level, restingOrder, listener, filled);
+                continue;
+            }
+
+            // Determine fill quantity
+            Quantity fillQty = std::min(order.remaining, restingOrder->remaining);
+
+            // Execute the fill
+            order.fill(fillQty);
+            restingOrder->fill(fillQty);
+            level.totalQuantity -= fillQty;
+            if (risk_) risk_->releaseOpen(restingOrder->account, levelPrice, fillQty);
+
+            if constexpr (S == Side::Buy) {
+                listener.onTrade(Trade(order.id, restingOrder->id, levelPrice, fillQty, clock.stamp(), order.symbol, S));
+            } else {
+                listener.onTrade(Trade(restingOrder->id, order.id, levelPrice, fillQty, clock.stamp(), order.symbol, S));
+            }
+            tradeCount++;
+            lastPrice = levelPrice;
+
+            // If resting order is fully filled, remove it and track for pool release
+            if (restingOrder->isFilled()) {
+                if (restingOrder->hidden > 0) {
+                    // Iceberg: show the next slice, at the back of the queue
+                    Quantity show = std::min(restingOrder->peak, restingOrder->hidden);
+                    restingOrder->hidden -= show;
+                    restingOrder->remaining = show;
+                    level.popFront(restingOrder, *pool_);
+                    level.addOrder(restingOrder, *pool_);
+                    continue;
+                }
+                orderLookup_->erase(restingOrder->id);
+                restingCount_--;
+                level.popFront(restingOrder, *pool_);
+                listener.onOrderFilled(*restingOrder);
+                filled.push_back(restingOrder->slot);
+            }
+        }
+
+        noteChange(order.symbol, oppositeSide(S), levelPrice);
+
+        // Only dead orders left behind the last fill — unlink them too
+        if (level.orderCount == 0 && !level.empty()) [[unlikely]] {
+            reclaimDead(level, filled);
+        }
+
+        // If price level is empty, remove it
+        if (level.empty()) {
+            book.erase(level);
+        }
+    }
+
+    // What the parked stops trigger against — one store per match, not per trade
+    if (tradeCount > 0) lastTradePrice_ = lastPrice;
+
+    count(Counter::Sweeps);
+    count(Counter::SweepFills, tradeCount);
+    count(Counter::SweepLevels, levels);
+    countMax(Counter::SweepMaxLevels, levels);
+    return tradeCount;
+}
+
+template <typename Listener>
+size_t OrderBook::uncross(const AuctionResult& at, Listener& listener, std::vector<OrderSlot>& filled, const Clock& clock) {
+    auction_ = false;
+    uint64_t left = at.volume;
+    size_t tradeCount = 0;
+    SymbolId symbol = 0;
+
+    // The computed volume is on offer at the price on both sides, so neither
+    // side runs out before it's traded
+    while (left > 0) {
+        PriceLevel& bid = *bids_.best();
+        PriceLevel& ask = *asks_.best();
+        Order* buy = bid.front(*pool_);
+        Order* sell = ask.front(*pool_);
+
+        // Lazily cancelled at the front of a queue: unlink it and look again
+        if (buy->remaining == 0) [[unlikely]] {
+            bid.reclaim(buy, *pool_);
+            filled.push_back(buy->slot);
+            continue;
+        }
+        if (sell->remaining == 0) [[unlikely]] {
+            ask.reclaim(sell, *pool_);
+            filled.push_back(sell->slot);
+            continue;
+        }
+
+        // Each queue is a chase through the pool: start loading the order
+        // behind each front, and the index slots the fronts will be erased from
+        if (buy->next != kNoSlot) __builtin_prefetch(pool_->at(buy->next), 1);
+        if (sell->next != kNoSlot) __builtin_prefetch(pool_->at(sell->next), 1);
+        orderLookup_->prefetch(buy->id);
+        orderLookup_->prefetch(sell->id);
+
+        symbol = buy->symbol;
+        auto qty = static_cast<Quantity>(std::min<uint64_t>({buy->remaining, sell->remaining, left}));
+        buy->fill(qty);
+        sell->fill(qty);
+        bid.totalQuantity -= qty;
+        ask.totalQuantity -= qty;
+        left -= qty;
+        if (risk_) {
+            risk_->releaseOpen(buy->account, buy->price, qty);
+            risk_->releaseOpen(sell->account, sell->price, qty);
+        }
+        listener.onTrade(Trade(buy->id, sell->id, at.price, qty, clock.stamp(), symbol, Side::Buy));
+        tradeCount++;
+
+        if (buy->isFilled()) retireFront<Side::Buy>(bid, buy, listener, filled);
+        if (sell->isFilled()) retireFront<Side::Sell>(ask, sell, listener, filled);
+    }
+
+    if (tradeCount > 0) {
+        lastTradePrice_ = at.price;
+        // The levels the uncross stopped in (the emptied ones were noted as they went)
+        if (const PriceLevel* level = bids_.best()) noteChange(symbol, Side::Buy, level->price);
+        if (const PriceLevel* level = asks_.best()) noteChange(symbol, Side::Sell, level->price);
+    }
+    return tradeCount;
+}
+
+template <typename Listener>
+void OrderBook::cancelSelfTrade(PriceLevel& level, Order* order, Listener& listener, std::vector<OrderSlot>& filled) {
+    risk_->releaseOpen(order->account, order->price, order->openQuantity());
+    orderLookup_->erase(order->id);
+    restingCount_--;
+    listener.onOrderCancelled(*order);
+    level.removeOrder(order, *pool_);
+    filled.push_back(order->slot);
+    count(Counter::SelfTradesPrevented);
+}
+
+template <Side S, typename Listener>
+void OrderBook::retireFront(PriceLevel& level, Order* order, Listener& listener, std::vector<OrderSlot>& filled) {
+    if (order->hidden > 0) {
+        // Iceberg: show the next slice, at the back of the queue
+        Quantity show = std::min(order->peak, order->hidden);
+        order->hidden -= show;
+        order->remaining = show;
+        level.popFront(order, *pool_);
+        level.addOrder(order, *pool_);
+        return;
+    }
+    orderLookup_->erase(order->id);
+    restingCount_--;
+    level.popFront(order, *pool_);
+    listener.onOrderFilled(*order);
+    filled.push_back(order->slot);
+
+    if (level.orderCount == 0 && !level.empty()) [[unlikely]] {
+        reclaimDead(level, filled);
+    }
+    if (level.empty()) {
+        noteChange(order->symbol, S, level.price);
+        own<S>().erase(level);
+    }
+}
+
 } // namespace engine
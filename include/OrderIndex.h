@@ -0,0 +1,245 @@
+#pragma once
+
+#include "Types.h"
+#include "Order.h"
+#include "Instrumentation.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+namespace engine {
+
+// How the order ID index finds a slot
+enum class IndexMode : uint8_t {
+    Hashed,   // open addressing with linear probing — works for any IDs
+    Direct    // slot = id mod capacity — for dense, sequential IDs
+};
+
+// Flat order ID → pool slot index, replacing std::unordered_map
+//
+// Hashed mode is one array of 8-byte (key, slot) entries with linear probing,
+// where the key is the low 32 bits of the ID — eight entries per cache line.
+// IDs that share a key share a probe chain; a key match is confirmed against
+// the order's own ID, which a cancel or fill touches next anyway.
+// Deletes shift the following entries back instead of leaving tombstones,
+// so probe chains never degrade. The table is sized to at least twice the
+// number of orders that can rest (the engine passes its pool size), so it
+// stays under 50% load and never rehashes while trading.
+//
+// Direct mode uses the same array indexed by id & (capacity - 1), with the
+// order's own id checked on lookup — no hashing and no probing. It requires the live IDs to span fewer
+// than `capacity` values, which holds for sequential IDs with bounded lifetime.
+//
+// Orders must come from `pool` (see acquireOrder) — entries are its slot numbers.
+class OrderIndex {
+public:
+    explicit OrderIndex(OrderPool& pool, size_t capacity = 1024, IndexMode mode = IndexMode::Hashed)
+        : pool_(&pool)
+        , mode_(mode)
+    {
+        allocate(std::bit_ceil(std::max<size_t>(capacity, 16)));
+    }
+
+    ~OrderIndex() { std::free(slots_); }
+
+    OrderIndex(const OrderIndex&) = delete;
+    OrderIndex& operator=(const OrderIndex&) = delete;
+
+    // Would insert(id) succeed? False if an order with this id is already in
+    // the index, or (Direct mode) another live id holds its slot. The engine
+    // asks before an order trades, so a clash can't leave it half entered.
+    bool canInsert(OrderId id) const {
+        if (mode_ == IndexMode::Direct) {
+            return slots_[id & mask_].slot == kNoSlot;
+        }
+        uint32_t key = keyOf(id);
+        for (size_t i = home(key); slots_[i].slot != kNoSlot; i = (i + 1) & mask_) {
+            if (slots_[i].key == key && pool_->at(slots_[i].slot)->id == id) return false;
+        }
+        return true;
+    }
+
+    // Add an order — the id must not already be in the index (see canInsert)
+    void insert(OrderId id, Order* order) {
+        if (mode_ == IndexMode::Direct) {
+            Slot& slot = slots_[id & mask_];
+            if (slot.slot != kNoSlot) {
+                throw std::runtime_error("Direct order index slot in use — live order IDs span the whole index");
+            }
+            slot = {keyOf(id), order->slot};
+            size_++;
+            return;
+        }
+
+        // Only reachable if the table was sized smaller than the pool
+        if ((size_ + 1) * 2 > mask_ + 1) {
+            grow();
+        }
+        place(keyOf(id), order->slot);
+    }
+
+    // Look up an order by id — nullptr if not found
+    Order* find(OrderId id) const {
+        if (mode_ == IndexMode::Direct) {
+            OrderSlot slot = slots_[id & mask_].slot;
+            noteLookup(1);
+            if (slot == kNoSlot) return nullptr;
+            Order* order = pool_->at(slot);
+            return order->id == id ? order : nullptr;
+        }
+
+        uint32_t key = keyOf(id);
+        size_t probes = 1;
+        for (size_t i = home(key); slots_[i].slot != kNoSlot; i = (i + 1) & mask_, ++probes) {
+            if (slots_[i].key == key) {
+                Order* order = pool_->at(slots_[i].slot);
+                if (order->id == id) {
+                    noteLookup(probes);
+                    return order;
+                }
+            }
+        }
+        noteLookup(probes);
+        return nullptr;
+    }
+
+    // Remove an order by id — returns false if it wasn't there
+    bool erase(OrderId id) {
+        if (mode_ == IndexMode::Direct) {
+            Slot& slot = slots_[id & mask_];
+            if (slot.slot == kNoSlot || pool_->at(slot.slot)->id != id) return false;
+            slot.slot = kNoSlot;
+            size_--;
+            return true;
+        }
+
+        uint32_t key = keyOf(id);
+        size_t i = home(key);
+        while (slots_[i].slot != kNoSlot && !(slots_[i].key == key && pool_->at(slots_[i].slot)->id == id)) {
+            i = (i + 1) & mask_;
+        }
+        if (slots_[i].slot == kNoSlot) return false;
+
+        // Backward-shift delete: pull later entries of the probe chain into the hole
+        // unless their home slot lies cyclically between the hole and themselves
+        size_t j = i;
+        while (true) {
+            j = (j + 1) & mask_;
+            if (slots_[j].slot == kNoSlot) break;
+            size_t k = home(slots_[j].key);
+            bool stays = (i <= j) ? (i < k && k <= j) : (i < k || k <= j);
+            if (stays) continue;
+            slots_[i] = slots_[j];
+            i = j;
+        }
+        slots_[i].slot = kNoSlot;
+        size_--;
+        return true;
+    }
+
+    size_t size() const { return size_; }
+    size_t capacity() const { return mask_ + 1; }
+    IndexMode mode() const { return mode_; }
+
+    // Bytes per table entry (the table has capacity() of them)
+    static constexpr size_t entryBytes() { return sizeof(Slot); }
+
+    // Start loading the slot an id lives in (or would be inserted at)
+    void prefetch(OrderId id) const {
+        size_t i = mode_ == IndexMode::Direct ? (id & mask_) : home(keyOf(id));
+        __builtin_prefetch(&slots_[i]);
+    }
+
+    // === Snapshot support ===
+    // Visit every entry as f(position, id, order), in table order
+    template <typename F>
+    void forEach(F&& f) const {
+        for (size_t i = 0; i <= mask_; ++i) {
+            if (slots_[i].slot != kNoSlot) {
+                const Order* order = pool_->at(slots_[i].slot);
+                f(i, order->id, order);
+            }
+        }
+    }
+
+    // Put an entry back at the position it had — no probing when the table
+    // has the same capacity; otherwise it's an ordinary insert
+    void restoreAt(size_t position, OrderId id, Order* order) {
+        if (position <= mask_ && slots_[position].slot == kNoSlot) {
+            slots_[position] = {keyOf(id), order->slot};
+            size_++;
+        } else {
+            insert(id, order);
+        }
+    }
+
+private:
+    struct Slot {
+        uint32_t key;       // low 32 bits of the order id
+        OrderSlot slot;     // kNoSlot = empty
+    };
+
+    OrderPool* pool_;
+    Slot* slots_ = nullptr;
+    size_t mask_ = 0;
+    size_t size_ = 0;
+    int shift_ = 0;       // 64 - log2(capacity), for Fibonacci hashing
+    IndexMode mode_;
+
+    static uint32_t keyOf(OrderId id) { return static_cast<uint32_t>(id); }
+
+    static void noteLookup(size_t probes) {
+        count(Counter::Lookups);
+        count(Counter::LookupProbes, probes);
+        countMax(Counter::LookupMaxProbe, probes);
+    }
+
+    // Fibonacci hashing on blocks of 16 consecutive IDs: each block lands on a
+    // random 16-slot run, and IDs inside a block fill that run in order. Random
+    // IDs still spread across the table, but sequential flow touches a new
+    // cache line every 8 IDs and a new page every 16 instead of on every insert.
+    size_t home(uint32_t key) const {
+        size_t block = static_cast<size_t>((static_cast<uint64_t>(key >> 4) * 0x9E3779B97F4A7C15ull) >> shift_);
+        return (block ^ static_cast<size_t>(key & 15)) & mask_;
+    }
+
+    void place(uint32_t key, OrderSlot slot) {
+        size_t i = home(key);
+        while (slots_[i].slot != kNoSlot) {
+            i = (i + 1) & mask_;
+        }
+        slots_[i] = {key, slot};
+        size_++;
+    }
+
+    void allocate(size_t capacity) {
+        Slot* slots = static_cast<Slot*>(std::malloc(capacity * sizeof(Slot)));
+        if (!slots) {
+            throw std::bad_alloc();
+        }
+        // Mark every entry empty now (all ones), so the page faults happen
+        // here, not on the first inserts while trading
+        std::memset(slots, 0xFF, capacity * sizeof(Slot));
+        slots_ = slots;
+        mask_ = capacity - 1;
+        shift_ = 64 - std::countr_zero(capacity);
+        size_ = 0;
+    }
+
+    void grow() {
+        Slot* old = slots_;
+        size_t oldCapacity = mask_ + 1;
+        allocate(oldCapacity * 2);
+        for (size_t i = 0; i < oldCapacity; ++i) {
+            if (old[i].slot != kNoSlot) place(old[i].key, old[i].slot);
+        }
+        std::free(old);
+    }
+};
+
+} // namespace engine
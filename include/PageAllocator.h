@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace engine {
+
+// Where a block of pool memory comes from
+enum class PageBacking : uint8_t {
+    Heap,              // aligned_alloc — 4K pages, faulted in on first touch
+    TransparentHuge,   // 2MB-aligned mmap with madvise(MADV_HUGEPAGE)
+    HugeTlb            // mmap(MAP_HUGETLB) from the reserved huge page pool
+};
+
+// Allocation policy for ObjectPool storage
+struct PoolOptions {
+    bool growable = false;                    // add a chunk instead of throwing when exhausted
+    PageBacking backing = PageBacking::Heap;
+    bool prefault = false;                    // touch every page now, not during trading
+    bool lockMemory = false;                  // mlock so pages can't be swapped out
+    int numaNode = -1;                        // -1 = no binding, kLocalNumaNode = node of the calling thread
+
+    static constexpr int kLocalNumaNode = -2;
+};
+
+// A block handed out by allocateBlock — keep it to free the memory later
+struct MemoryBlock {
+    void* data = nullptr;
+    size_t bytes = 0;                         // bytes actually mapped (rounded up to page size)
+    PageBacking backing = PageBacking::Heap;  // what we actually got (HugeTlb falls back to TransparentHuge)
+    bool locked = false;
+};
+
+// Allocate `bytes` aligned to at least `alignment` following the options
+// HugeTlb falls back to transparent huge pages if no huge pages are reserved;
+// the returned block records which backing was used. NUMA binding and huge
+// pages are Linux-only and ignored elsewhere.
+// Throws std::bad_alloc if no memory, std::system_error if mlock fails.
+MemoryBlock allocateBlock(size_t bytes, size_t alignment, const PoolOptions& options);
+
+void freeBlock(const MemoryBlock& block);
+
+// NUMA node the calling thread is running on (0 if unknown)
+int currentNumaNode();
+
+} // namespace engine
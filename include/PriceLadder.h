@@ -0,0 +1,380 @@
+#pragma once
+
+#include "Types.h"
+#include "Order.h"
+#include "Instrumentation.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace engine {
+
+// A single price level — holds all orders at one price
+// The FIFO queue is an intrusive doubly-linked list through Order::prev/next,
+// so add, remove from the middle (cancels) and pop_front never allocate
+struct PriceLevel {
+    Price price = 0;
+    OrderSlot head = kNoSlot;    // oldest order — next to match
+    OrderSlot tail = kNoSlot;    // newest order
+    uint32_t orderCount = 0;     // number of live orders at this level
+    Quantity totalQuantity = 0;  // total remaining qty at this level
+    uint32_t deadCount = 0;      // lazily cancelled orders still linked in the queue
+
+    PriceLevel() = default;
+    explicit PriceLevel(Price p) : price(p) {}
+
+    // Links are pool slots, so every operation that follows one takes the pool
+    void addOrder(Order* order, OrderPool& pool) {
+        order->prev = tail;
+        order->next = kNoSlot;
+        if (tail != kNoSlot) {
+            pool.at(tail)->next = order->slot;
+        } else {
+            head = order->slot;
+        }
+        tail = order->slot;
+        orderCount++;
+        totalQuantity += order->remaining;
+    }
+
+    void removeOrder(Order* order, OrderPool& pool) {
+        totalQuantity -= order->remaining;
+        unlink(order, pool);
+        orderCount--;
+    }
+
+    // Drop the front order once it's fully filled (its remaining is already 0)
+    void popFront(Order* front, OrderPool& pool) {
+        unlink(front, pool);
+        orderCount--;
+    }
+
+    // Lazy cancel: the order stays in the queue with nothing left to trade
+    // (remaining 0 marks it dead) until the match loop or a compaction unlinks it
+    void markDead(Order* order) {
+        totalQuantity -= order->remaining;
+        order->remaining = 0;
+        order->hidden = 0;
+        orderCount--;
+        deadCount++;
+    }
+
+    // Unlink an order markDead() left behind
+    void reclaim(Order* order, OrderPool& pool) {
+        unlink(order, pool);
+        deadCount--;
+    }
+
+    Order* front(OrderPool& pool) const { return pool.at(head); }
+    bool empty() const { return head == kNoSlot; }
+
+private:
+    void unlink(Order* order, OrderPool& pool) {
+        if (order->prev != kNoSlot) {
+            pool.at(order->prev)->next = order->next;
+        } else {
+            head = order->next;
+        }
+        if (order->next != kNoSlot) {
+            pool.at(order->next)->prev = order->prev;
+        } else {
+            tail = order->prev;
+        }
+        order->prev = kNoSlot;
+        order->next = kNoSlot;
+    }
+};
+
+// One side of the book as a contiguous array of price levels
+// Level i holds price basePrice + i * tickSize, so finding a level is just
+// a subtraction instead of a tree walk. A bitmap marks the non-empty levels,
+// which lets us jump to the next level with a count-zeros instruction,
+// and the best level index is cached so top of book is a single load.
+//
+// If a price falls outside the window the ladder re-centers (and grows if the
+// live levels don't fit) — that moves levels around, so it only happens on insert.
+// It never grows past maxLevels: a price too far from the live levels to
+// share a window with them can't get a level (see fits()).
+template <Side S>
+class PriceLadder {
+public:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    PriceLadder(Price tickSize, size_t levels, std::optional<Price> basePrice, size_t maxLevels = size_t{1} << 20)
+        : tick_(tickSize)
+        , levels_(std::bit_ceil(std::max<size_t>(levels, 64)))
+        , bits_(levels_.size() / 64, 0)
+        , maxLevels_(std::max(std::bit_ceil(maxLevels), levels_.size()))
+    {
+        if (basePrice) {
+            base_ = *basePrice;
+            anchored_ = true;
+        }
+    }
+
+    // Find the level at a price — nullptr if no orders rest there
+    PriceLevel* find(Price price) {
+        size_t idx = indexOf(price);
+        if (idx == npos || !testBit(idx)) return nullptr;
+        return &levels_[idx];
+    }
+    const PriceLevel* find(Price price) const { return const_cast<PriceLadder*>(this)->find(price); }
+
+    // Can a level at this price be created? Always inside the window;
+    // outside it, only if the window can move (growing up to maxLevels) to
+    // cover the price and every live level, and stay within Price's range
+    bool fits(Price price) const {
+        if (indexOf(price) != npos) return true;
+        Price margin = static_cast<Price>(maxLevels_) * tick_;
+        if (price < std::numeric_limits<Price>::min() + margin || price > std::numeric_limits<Price>::max() - margin) {
+            return false;
+        }
+        Price lo = price;
+        Price hi = price;
+        if (count_ > 0) {
+            lo = std::min(lo, levels_[findNextSet(0)].price);
+            hi = std::max(hi, levels_[findPrevSet(levels_.size() - 1)].price);
+        }
+        // Unsigned: two far-apart prices overflow Price
+        uint64_t ticks = (static_cast<uint64_t>(hi) - static_cast<uint64_t>(lo)) / static_cast<uint64_t>(tick_);
+        return ticks < maxLevels_ / 2;
+    }
+
+    // Find the level at a price, creating it if it's empty
+    // May re-center the window, so don't hold level references across this call.
+    // Throws std::length_error, changing nothing, if the price doesn't fit().
+    PriceLevel& getOrCreate(Price price) {
+        size_t idx = indexOf(price);
+        if (idx == npos) {
+            if (!fits(price)) {
+                throw std::length_error("Price too far from the book's other levels for the ladder window");
+            }
+            recenter(price);
+            idx = indexOf(price);
+            count(Counter::LadderRecenters);
+        }
+        if (!testBit(idx)) {
+            count(Counter::LevelsCreated);
+            levels_[idx].price = price;
+            setBit(idx);
+            count_++;
+            if (best_ == npos || isBetter(idx, best_)) {
+                best_ = idx;
+            }
+        }
+        return levels_[idx];
+    }
+
+    // Remove an empty level — if it was the best, move best to the next one
+    void erase(PriceLevel& level) {
+        size_t idx = index(level);
+        clearBit(idx);
+        count_--;
+        count(Counter::LevelsErased);
+        if (idx == best_) {
+            best_ = nextFrom(idx);
+        }
+    }
+
+    // Best level (highest bid / lowest ask) — nullptr if this side is empty
+    PriceLevel* best() { return best_ == npos ? nullptr : &levels_[best_]; }
+    const PriceLevel* best() const { return best_ == npos ? nullptr : &levels_[best_]; }
+
+    // Next non-empty level after this one, moving away from the spread
+    PriceLevel* next(const PriceLevel& level) {
+        size_t idx = nextFrom(index(level));
+        return idx == npos ? nullptr : &levels_[idx];
+    }
+    const PriceLevel* next(const PriceLevel& level) const {
+        size_t idx = nextFrom(index(level));
+        return idx == npos ? nullptr : &levels_[idx];
+    }
+
+    // Previous non-empty level before this one, back toward the spread (nullptr at the best)
+    PriceLevel* prev(const PriceLevel& level) {
+        size_t idx = prevFrom(index(level));
+        return idx == npos ? nullptr : &levels_[idx];
+    }
+    const PriceLevel* prev(const PriceLevel& level) const { return const_cast<PriceLadder*>(this)->prev(level); }
+
+    bool empty() const { return count_ == 0; }
+    size_t levelCount() const { return count_; }
+
+    // Start loading the level at a price, if it's inside the window
+    void prefetch(Price price) const {
+        size_t idx = indexOf(price);
+        if (idx != npos) __builtin_prefetch(&levels_[idx]);
+    }
+
+    // === Depth queries (see DepthKernels.h) ===
+    // The raw array: level idx is price priceAt(idx), and levels with no
+    // orders always hold totalQuantity 0, so a run can be summed without
+    // looking at the bitmap
+    const PriceLevel* levelData() const { return levels_.data(); }
+    size_t bestIndex() const { return best_; }
+    Price priceAt(size_t idx) const { return base_ + static_cast<Price>(idx) * tick_; }
+
+    // Levels from the best one (included) up to `price`, moving away from
+    // the spread and clipped to the window — 0 if price is better than the best
+    size_t levelsTo(Price price) const {
+        if (best_ == npos) return 0;
+        Price ticks = (S == Side::Buy ? levels_[best_].price - price : price - levels_[best_].price) / tick_;
+        if (ticks < 0) return 0;
+        return std::min(static_cast<size_t>(ticks) + 1, levelsFromBest());
+    }
+
+    // Levels from the best one (included) to the far end of the window
+    size_t levelsFromBest() const {
+        if (best_ == npos) return 0;
+        return S == Side::Buy ? best_ + 1 : levels_.size() - best_;
+    }
+
+    // Worst non-empty level among the first `levels` from the best (levels > 0)
+    const PriceLevel* worstWithin(size_t levels) const {
+        size_t idx = S == Side::Buy ? findNextSet(best_ + 1 - levels) : findPrevSet(best_ + levels - 1);
+        return &levels_[idx];
+    }
+
+    // Window currently covered by the array
+    Price basePrice() const { return base_; }
+    size_t capacity() const { return levels_.size(); }
+    size_t maxCapacity() const { return maxLevels_; }
+    bool anchored() const { return anchored_; }
+
+    // Set the window of an empty ladder (snapshot restore), so the levels
+    // that follow land at the same indices they had when it was taken
+    void restoreWindow(Price basePrice, size_t capacity) {
+        if (count_ != 0) {
+            throw std::logic_error("Can only restore the window of an empty ladder");
+        }
+        capacity = std::bit_ceil(std::max<size_t>(capacity, 64));
+        levels_.assign(capacity, PriceLevel{});
+        bits_.assign(capacity / 64, 0);
+        maxLevels_ = std::max(maxLevels_, capacity);
+        base_ = basePrice;
+        anchored_ = true;
+        best_ = npos;
+    }
+
+private:
+    Price tick_;
+    Price base_ = 0;
+    bool anchored_ = false;            // base is picked from the first price if not configured
+
+    std::vector<PriceLevel> levels_;   // one slot per tick in the window
+    std::vector<uint64_t> bits_;       // bit i set = levels_[i] has orders
+    size_t best_ = npos;
+    size_t count_ = 0;
+    size_t maxLevels_;                 // the window never grows past this
+
+    size_t index(const PriceLevel& level) const {
+        return static_cast<size_t>(&level - levels_.data());
+    }
+
+    size_t indexOf(Price price) const {
+        if (!anchored_ || price < base_) return npos;
+        // Unsigned, so a price far above the window can't overflow
+        uint64_t diff = static_cast<uint64_t>(price) - static_cast<uint64_t>(base_);
+        if (tick_ != 1) diff /= static_cast<uint64_t>(tick_);
+        if (diff >= levels_.size()) return npos;
+        return static_cast<size_t>(diff);
+    }
+
+    bool testBit(size_t i) const { return (bits_[i >> 6] >> (i & 63)) & 1; }
+    void setBit(size_t i) { bits_[i >> 6] |= uint64_t{1} << (i & 63); }
+    void clearBit(size_t i) { bits_[i >> 6] &= ~(uint64_t{1} << (i & 63)); }
+
+    // Bids get better going up, asks get better going down
+    static bool isBetter(size_t a, size_t b) {
+        if constexpr (S == Side::Buy) return a > b;
+        else return a < b;
+    }
+
+    // Next set level strictly worse than idx
+    size_t nextFrom(size_t idx) const {
+        if constexpr (S == Side::Buy) {
+            return idx == 0 ? npos : findPrevSet(idx - 1);
+        } else {
+            return findNextSet(idx + 1);
+        }
+    }
+
+    // Next set level strictly better than idx
+    size_t prevFrom(size_t idx) const {
+        if constexpr (S == Side::Buy) {
+            return findNextSet(idx + 1);
+        } else {
+            return idx == 0 ? npos : findPrevSet(idx - 1);
+        }
+    }
+
+    // First set bit at or above i
+    size_t findNextSet(size_t i) const {
+        if (i >= levels_.size()) return npos;
+        size_t word = i >> 6;
+        uint64_t bits = bits_[word] & (~uint64_t{0} << (i & 63));
+        while (bits == 0) {
+            if (++word == bits_.size()) return npos;
+            bits = bits_[word];
+        }
+        return (word << 6) + static_cast<size_t>(std::countr_zero(bits));
+    }
+
+    // Last set bit at or below i
+    size_t findPrevSet(size_t i) const {
+        size_t word = i >> 6;
+        uint64_t bits = bits_[word] & (~uint64_t{0} >> (63 - (i & 63)));
+        while (bits == 0) {
+            if (word-- == 0) return npos;
+            bits = bits_[word];
+        }
+        return (word << 6) + 63 - static_cast<size_t>(std::countl_zero(bits));
+    }
+
+    // Move the window so it covers `price` and every live level
+    // Grows the array when the live range is more than half the window
+    // (fits() has checked the result stays within maxLevels)
+    void recenter(Price price) {
+        Price lo = price;
+        Price hi = price;
+        if (count_ > 0) {
+            lo = std::min(lo, levels_[findNextSet(0)].price);
+            hi = std::max(hi, levels_[findPrevSet(levels_.size() - 1)].price);
+        }
+
+        size_t span = static_cast<size_t>((hi - lo) / tick_) + 1;
+        size_t size = levels_.size();
+        if (span > size / 2) {
+            size = std::bit_ceil(span * 2);
+        }
+
+        Price newBase = lo - static_cast<Price>((size - span) / 2) * tick_;
+
+        std::vector<PriceLevel> newLevels(size);
+        std::vector<uint64_t> newBits(size / 64, 0);
+        size_t newBest = npos;
+
+        for (size_t i = findNextSet(0); i != npos; i = findNextSet(i + 1)) {
+            size_t j = static_cast<size_t>((levels_[i].price - newBase) / tick_);
+            newLevels[j] = std::move(levels_[i]);
+            newBits[j >> 6] |= uint64_t{1} << (j & 63);
+            if (newBest == npos || isBetter(j, newBest)) {
+                newBest = j;
+            }
+        }
+
+        levels_ = std::move(newLevels);
+        bits_ = std::move(newBits);
+        best_ = newBest;
+        base_ = newBase;
+        anchored_ = true;
+    }
+};
+
+} // namespace engine
@@ -0,0 +1,157 @@
+#pragma once
+
+#include "Messages.h"
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace engine {
+
+// === Order-entry wire protocol ===
+//
+// Every frame is a fixed-size little-endian record — no length prefix and no
+// variable fields — so a receive buffer is decoded where it landed, frame by
+// frame, and the only copy is of a frame split across two receives.
+//
+// Client → gateway, 32 bytes:
+//    0  u8   FrameType
+//    1  u8   side (0 buy, 1 sell)                     new orders
+//    2  u8   OrderType (0 limit .. 7 stop-limit)      new orders; 1 = market
+//    3  u8   reserved, 0
+//    4  u32  symbol
+//    8  u64  client order id, below 2^40
+//   16  i64  price in ticks                           new limit orders, modify; stops: the stop price
+//   24  u32  quantity                                 new orders, modify
+//   28  u32  display quantity (iceberg peak)          icebergs; stop-limits: limit - stop price, as an i32
+//
+// Gateway → client, 40 bytes:
+//    0  u8   EventType
+//    1  u8   side of this client's order
+//    2  u16  reserved, 0
+//    4  u32  symbol
+//    8  u64  client order id
+//   16  u64  trades: the other order's client id if this session sent it too, else 0
+//   24  i64  price
+//   32  u32  quantity (as in EngineEvent)
+//   36  u32  reserved, 0
+enum class FrameType : uint8_t {
+    NewOrder = 1,
+    Cancel = 2,
+    Modify = 3
+};
+
+inline constexpr size_t kOrderFrameSize = 32;
+inline constexpr size_t kReportFrameSize = 40;
+inline constexpr uint64_t kMaxClientOrderId = (uint64_t{1} << 40) - 1;
+
+// Host order <-> little endian (a no-op on x86 and arm64)
+template <typename T>
+T toLittle(T value) {
+    if constexpr (std::endian::native == std::endian::big && sizeof(T) > 1) {
+        using U = std::conditional_t<sizeof(T) == 2, uint16_t, std::conditional_t<sizeof(T) == 4, uint32_t, uint64_t>>;
+        U bits = std::bit_cast<U>(value);
+        if constexpr (sizeof(T) == 2) bits = __builtin_bswap16(bits);
+        if constexpr (sizeof(T) == 4) bits = __builtin_bswap32(bits);
+        if constexpr (sizeof(T) == 8) bits = __builtin_bswap64(bits);
+        value = std::bit_cast<T>(bits);
+    }
+    return value;
+}
+
+template <typename T>
+T loadLittle(const char* p) {
+    T value;
+    std::memcpy(&value, p, sizeof(T));
+    return toLittle(value);
+}
+
+template <typename T>
+void storeLittle(char* p, T value) {
+    value = toLittle(value);
+    std::memcpy(p, &value, sizeof(T));
+}
+
+// Decode one order frame straight into the message the engine takes
+// Returns false if the frame is malformed; msg.id is set either way (for the reject).
+inline bool decodeOrderFrame(const char* frame, OrderMsg& msg) {
+    auto type = static_cast<uint8_t>(frame[0]);
+    auto side = static_cast<uint8_t>(frame[1]);
+    auto orderType = static_cast<uint8_t>(frame[2]);
+
+    msg.type = MsgType::NewLimit;
+    msg.side = side == 1 ? Side::Sell : Side::Buy;
+    msg.orderType = OrderType::Limit;
+    msg.symbol = loadLittle<uint32_t>(frame + 4);
+    msg.id = loadLittle<uint64_t>(frame + 8);
+    msg.price = loadLittle<int64_t>(frame + 16);
+    msg.quantity = loadLittle<uint32_t>(frame + 24);
+    msg.displayQty = loadLittle<uint32_t>(frame + 28);
+
+    if (frame[3] != 0 || msg.id > kMaxClientOrderId) return false;
+    switch (static_cast<FrameType>(type)) {
+    case FrameType::NewOrder:
+        if (side > 1 || orderType > static_cast<uint8_t>(OrderType::StopLimit)) return false;
+        msg.orderType = static_cast<OrderType>(orderType);
+        msg.type = msg.orderType == OrderType::Market ? MsgType::NewMarket
+                 : msg.orderType == OrderType::Stop || msg.orderType == OrderType::StopLimit ? MsgType::NewStop
+                 : MsgType::NewLimit;
+        return true;
+    case FrameType::Cancel:
+        msg.type = MsgType::Cancel;
+        return true;
+    case FrameType::Modify:
+        msg.type = MsgType::Modify;
+        return true;
+    }
+    return false;
+}
+
+// The client side: write msg (id = the client order id) as an order frame
+inline void encodeOrderFrame(const OrderMsg& msg, char* frame) {
+    FrameType type = msg.type == MsgType::Cancel ? FrameType::Cancel
+                   : msg.type == MsgType::Modify ? FrameType::Modify
+                   : FrameType::NewOrder;
+    frame[0] = static_cast<char>(type);
+    frame[1] = static_cast<char>(msg.side);
+    frame[2] = static_cast<char>(msg.type == MsgType::NewMarket ? OrderType::Market : msg.orderType);
+    frame[3] = 0;
+    storeLittle<uint32_t>(frame + 4, msg.symbol);
+    storeLittle<uint64_t>(frame + 8, msg.id);
+    storeLittle<int64_t>(frame + 16, msg.price);
+    storeLittle<uint32_t>(frame + 24, msg.quantity);
+    storeLittle<uint32_t>(frame + 28, msg.displayQty);
+}
+
+// An outbound frame, as the client sees it
+struct Report {
+    EventType type;
+    Side side;
+    SymbolId symbol;
+    uint64_t orderId;     // client order id
+    uint64_t otherId;
+    Price price;
+    Quantity quantity;
+};
+
+inline void encodeReport(const Report& report, char* frame) {
+    frame[0] = static_cast<char>(report.type);
+    frame[1] = static_cast<char>(report.side);
+    storeLittle<uint16_t>(frame + 2, 0);
+    storeLittle<uint32_t>(frame + 4, report.symbol);
+    storeLittle<uint64_t>(frame + 8, report.orderId);
+    storeLittle<uint64_t>(frame + 16, report.otherId);
+    storeLittle<int64_t>(frame + 24, report.price);
+    storeLittle<uint32_t>(frame + 32, report.quantity);
+    storeLittle<uint32_t>(frame + 36, 0);
+}
+
+inline Report decodeReport(const char* frame) {
+    return {static_cast<EventType>(frame[0]), static_cast<Side>(frame[1]), loadLittle<uint32_t>(frame + 4),
+            loadLittle<uint64_t>(frame + 8), loadLittle<uint64_t>(frame + 16), loadLittle<int64_t>(frame + 24),
+            loadLittle<uint32_t>(frame + 32)};
+}
+
+} // namespace engine
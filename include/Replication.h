@@ -0,0 +1,193 @@
+#pragma once
+
+#include "Journal.h"
+#include "SpscRing.h"
+#include "WaitStrategy.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace engine {
+
+// === Replication stream (TCP) ===
+//
+// A standby connects and sends a hello: the first sequence it doesn't have
+// and the shape of its engine. The primary answers with frames — a header,
+// then `count` journal records in sequence — starting where the standby
+// asked, so records sent before a reconnect are retransmitted from the
+// primary's history. After each frame it applies, the standby sends back
+// the last sequence applied (a u64). Records go out as they are in memory,
+// like the journal file, so both ends must share the architecture.
+inline constexpr char kReplicationMagic[8] = {'M', 'E', 'R', 'E', 'P', 'L', '0', '1'};
+
+struct ReplicationHello {
+    char magic[8];
+    uint64_t nextSequence;
+    EngineShape shape;
+};
+
+enum class ReplicationFrameType : uint32_t {
+    Records = 1,
+    Heartbeat = 2,   // nothing new since the last frame
+    Refused = 3      // a different engine shape, or nextSequence is no longer in the history
+};
+
+struct ReplicationFrame {
+    ReplicationFrameType type;
+    uint32_t count;            // records following the header
+    uint64_t firstSequence;    // of the first of them
+    uint64_t primaryLast;      // last sequence the primary has appended
+};
+
+static_assert(sizeof(ReplicationHello) == 72 && sizeof(ReplicationFrame) == 24, "Replication frames have no padding");
+
+struct ReplicationConfig {
+    std::string address = "0.0.0.0";          // the primary listens here; a standby connects to it
+    uint16_t port = 0;                         // primary: 0 = any free port (see port())
+    size_t ringCapacity = 1 << 16;             // records buffered between matching and the sender
+    size_t historyRecords = 1 << 20;           // latest records kept for retransmits (rounded up to a power of two)
+    size_t maxBatch = 512;                     // most records per frame
+    size_t maxStandbys = 8;
+    std::chrono::milliseconds heartbeat{100};  // idle time before a heartbeat frame
+    std::chrono::milliseconds reconnect{10};   // standby: pause between connection attempts
+    WaitStrategy wait = WaitStrategy::Backoff;
+};
+
+// Streams an engine's accepted messages to hot standbys
+//
+// Fed like the journal (see RunnerConfig::replication): append() copies the
+// record into a preallocated ring, so the matching thread makes no syscall
+// and only waits if the ring fills. A sender thread moves records into the
+// history and sends each standby everything past what it has, in frames of
+// up to maxBatch records, with non-blocking writes — a slow standby falls
+// behind in the history instead of holding up matching, and is dropped
+// once the history no longer holds what it needs next. A standby that
+// reconnects resumes from the sequence it asks for; one that asks for
+// records older than the history is refused (seed it from a snapshot and
+// the journal first).
+//
+// append() must be called from one thread (the matching thread).
+class ReplicationPrimary {
+public:
+    // Binds and listens — throws std::system_error
+    // After a recovery or a failover, pass the last sequence and trade digest
+    // the engine already holds (the journal's appended() and lastDigest(), or
+    // what ReplicationStandby::promote() returned), so numbering carries on.
+    ReplicationPrimary(const ReplicationConfig& config, const MatchingEngine& engine, uint64_t lastSequence = 0,
+                       const TradeDigest& lastDigest = {});
+    ~ReplicationPrimary();
+
+    ReplicationPrimary(const ReplicationPrimary&) = delete;
+    ReplicationPrimary& operator=(const ReplicationPrimary&) = delete;
+
+    void append(const OrderMsg& msg, const TradeDigest& digest);
+
+    uint64_t appended() const { return appended_.load(std::memory_order_acquire); }
+    const TradeDigest& lastDigest() const { return lastDigest_; }
+
+    // Standbys past their hello, and the lowest sequence they have all applied (0 if none)
+    size_t standbys() const { return standbys_.load(std::memory_order_acquire); }
+    uint64_t acknowledged() const { return acknowledged_.load(std::memory_order_acquire); }
+
+    uint16_t port() const { return port_; }
+    uint64_t framesSent() const { return frames_.load(std::memory_order_relaxed); }
+    uint64_t refused() const { return refused_.load(std::memory_order_relaxed); }
+
+private:
+    struct Standby;
+
+    ReplicationConfig config_;
+    EngineShape shape_;
+    int listenFd_ = -1;
+    uint16_t port_ = 0;
+    SpscRing<JournalRecord> ring_;
+    std::vector<JournalRecord> history_;   // record s at s & (size - 1)
+    uint64_t firstSequence_;               // oldest sequence this primary can ever send
+    uint64_t nextSequence_;                // matching thread's
+    TradeDigest lastDigest_;
+    std::thread thread_;
+
+    std::atomic<bool> stopping_{false};
+    alignas(kCacheLineSize) std::atomic<uint64_t> appended_;
+    alignas(kCacheLineSize) std::atomic<uint64_t> acknowledged_{0};
+    std::atomic<size_t> standbys_{0};
+    std::atomic<uint64_t> frames_{0};
+    std::atomic<uint64_t> refused_{0};
+
+    void run();
+};
+
+// Keeps a hot copy of the primary's engine by applying its stream
+//
+// The standby thread connects to the primary — and reconnects after a
+// drop — asking for the record after the last one it applied, and feeds
+// every record to its own engine. The engine is deterministic, so its books
+// stay identical to the primary's; each record's trade digest is checked
+// against the trades the standby made to prove it. A sequence gap drops the
+// connection and resumes from the last applied record; a digest mismatch
+// or a rejected record stops the standby for good (diverged()).
+//
+// Failover is promote(): apply whatever complete records have already
+// arrived, then stop — the engine is current, with no replay.
+// The engine belongs to the standby thread from start() until promote().
+class ReplicationStandby {
+public:
+    // `engine` has the primary's shape and holds its state up to
+    // appliedSequence (empty, for 0), with trade digest `digest` at that point.
+    // If the primary enforces risk, attach a table with its limits first.
+    ReplicationStandby(const ReplicationConfig& config, MatchingEngine& engine, uint64_t appliedSequence = 0,
+                       const TradeDigest& digest = {});
+    ~ReplicationStandby();
+
+    ReplicationStandby(const ReplicationStandby&) = delete;
+    ReplicationStandby& operator=(const ReplicationStandby&) = delete;
+
+    void start();
+
+    // Drain what has arrived, stop the standby thread and return the last
+    // sequence applied (digest() is then the trade digest at that point)
+    uint64_t promote();
+
+    uint64_t applied() const { return applied_.load(std::memory_order_acquire); }
+    uint64_t primarySequence() const { return primaryLast_.load(std::memory_order_acquire); }
+    uint64_t lag() const {
+        uint64_t primary = primarySequence();
+        uint64_t done = applied();
+        return primary > done ? primary - done : 0;
+    }
+    const TradeDigest& digest() const { return digest_; }   // after promote()
+
+    bool connected() const { return connected_.load(std::memory_order_acquire); }
+    bool diverged() const { return diverged_.load(std::memory_order_acquire); }
+    bool refused() const { return refusedByPrimary_.load(std::memory_order_acquire); }
+    uint64_t connects() const { return connects_.load(std::memory_order_relaxed); }
+    uint64_t gaps() const { return gaps_.load(std::memory_order_relaxed); }
+
+private:
+    ReplicationConfig config_;
+    MatchingEngine& engine_;
+    TradeDigest digest_;
+    std::vector<char> buffer_;
+    std::thread thread_;
+
+    std::atomic<bool> stopping_{false};
+    alignas(kCacheLineSize) std::atomic<uint64_t> applied_;
+    alignas(kCacheLineSize) std::atomic<uint64_t> primaryLast_{0};
+    std::atomic<bool> connected_{false};
+    std::atomic<bool> diverged_{false};
+    std::atomic<bool> refusedByPrimary_{false};
+    std::atomic<uint64_t> connects_{0};
+    std::atomic<uint64_t> gaps_{0};
+
+    void run();
+    // One connection, until it drops or the standby stops — false: stop for good
+    bool follow(int fd);
+    // Apply the complete frames in buffer_[0, end) — returns the bytes consumed, or -1 to drop the connection
+    long consume(size_t end);
+};
+
+} // namespace engine
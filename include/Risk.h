@@ -0,0 +1,149 @@
+#pragma once
+
+#include "Types.h"
+#include "Order.h"
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+namespace engine {
+
+// What the pre-trade risk stage made of an order
+enum class RiskCheck : uint8_t {
+    Passed,
+    UnknownAccount,   // the account has no row in the table
+    OrderSize,        // quantity over maxOrderQty
+    PriceBand,        // a buy priced more than priceBand above the best ask, or a sell as far below the best bid
+    OpenQuantity,     // resting, it would take the account's open quantity over maxOpenQty
+    OpenNotional      // resting, it would take the account's open price × quantity over maxOpenNotional
+};
+
+inline constexpr size_t kRiskCheckCount = 6;
+
+// One account's limits — the defaults let everything through
+struct RiskLimits {
+    Quantity maxOrderQty = UINT32_MAX;
+    Price priceBand = INT64_MAX;           // ticks through the opposite best price
+    uint64_t maxOpenQty = UINT64_MAX;      // displayed plus hidden, over every book
+    int64_t maxOpenNotional = INT64_MAX;   // Σ price (in ticks) × open quantity
+    bool preventSelfTrade = false;         // cancel a resting order of the account instead of trading with it
+};
+
+// An account's limits and what it has resting, on one cache line so a check
+// touches nothing else
+struct alignas(kCacheLineSize) AccountRisk {
+    RiskLimits limits;
+    uint64_t openQty = 0;
+    int64_t openNotional = 0;
+};
+
+static_assert(sizeof(AccountRisk) == kCacheLineSize, "An account's risk row must be exactly one cache line");
+
+// Per-account limits and open exposure for the engine's inline risk stage
+// (see MatchingEngine::enforceRisk). Accounts are numbered 0..accountCount-1
+// and every row is allocated by the constructor, so checking an order is an
+// index and a handful of compares, and keeping the exposure current as
+// orders rest, trade and leave is an add or subtract on the same row.
+//
+// Only orders resting in a book count as open: an order is checked against
+// what it would add if all of it rested, and parked stops count once they
+// trigger and rest. Market orders, IOC and FOK never rest, so they are only
+// held to the size and (priced ones) the band. The table belongs to the
+// matching thread.
+class RiskTable {
+public:
+    explicit RiskTable(size_t accountCount, const RiskLimits& defaults = {})
+        : accounts_(accountCount)
+    {
+        for (AccountRisk& row : accounts_) row.limits = defaults;
+    }
+
+    // Throws std::out_of_range for an account the table has no row for
+    void setLimits(AccountId account, const RiskLimits& limits) { row(account).limits = limits; }
+    const RiskLimits& limits(AccountId account) const { return row(account).limits; }
+
+    uint64_t openQuantity(AccountId account) const { return row(account).openQty; }
+    int64_t openNotional(AccountId account) const { return row(account).openNotional; }
+
+    size_t accountCount() const { return accounts_.size(); }
+
+    // Orders refused so far, by reason
+    uint64_t rejected(RiskCheck why) const { return rejected_[static_cast<size_t>(why)]; }
+
+    // Check a new order of type T and side S. `opposite` is the best price it
+    // would trade against (nullopt: that side is empty). A cancel-replace
+    // passes the open quantity and price of the order it replaces, which no
+    // longer count once it is replaced.
+    template <Side S, OrderType T>
+    RiskCheck check(AccountId account, Price price, Quantity qty, std::optional<Price> opposite,
+                    Quantity replacing = 0, Price replacingPrice = 0) {
+        constexpr bool priced = T != OrderType::Market && T != OrderType::Stop && T != OrderType::StopLimit;
+        constexpr bool rests = T == OrderType::Limit || T == OrderType::PostOnly || T == OrderType::Iceberg;
+
+        if (account >= accounts_.size()) [[unlikely]] return refuse(RiskCheck::UnknownAccount);
+        const AccountRisk& row = accounts_[account];
+        if (qty > row.limits.maxOrderQty) [[unlikely]] return refuse(RiskCheck::OrderSize);
+        if constexpr (priced) {
+            if (opposite) {
+                Price through = S == Side::Buy ? price - *opposite : *opposite - price;
+                if (through > row.limits.priceBand) [[unlikely]] return refuse(RiskCheck::PriceBand);
+            }
+        }
+        if constexpr (rests) {
+            if (row.openQty - replacing + qty > row.limits.maxOpenQty) [[unlikely]] {
+                return refuse(RiskCheck::OpenQuantity);
+            }
+            int64_t notional = row.openNotional - replacingPrice * static_cast<int64_t>(replacing);
+            if (price * static_cast<int64_t>(qty) > row.limits.maxOpenNotional - notional) [[unlikely]] {
+                return refuse(RiskCheck::OpenNotional);
+            }
+        }
+        return RiskCheck::Passed;
+    }
+
+    // Would an order of `account` trade against one of its own? (the match
+    // loop asks only when both orders have the same account)
+    bool preventsSelfTrade(AccountId account) const { return accounts_[account].limits.preventSelfTrade; }
+
+    // Exposure bookkeeping — OrderBook calls these as orders rest, fill and leave
+    void addOpen(AccountId account, Price price, Quantity qty) {
+        AccountRisk& row = accounts_[account];
+        row.openQty += qty;
+        row.openNotional += price * static_cast<int64_t>(qty);
+    }
+    void releaseOpen(AccountId account, Price price, Quantity qty) {
+        AccountRisk& row = accounts_[account];
+        row.openQty -= qty;
+        row.openNotional -= price * static_cast<int64_t>(qty);
+    }
+
+    // Forget every account's exposure (the books were emptied); limits stay
+    void clearOpen() {
+        for (AccountRisk& row : accounts_) {
+            row.openQty = 0;
+            row.openNotional = 0;
+        }
+    }
+
+private:
+    std::vector<AccountRisk> accounts_;
+    std::array<uint64_t, kRiskCheckCount> rejected_{};
+
+    RiskCheck refuse(RiskCheck why) {
+        rejected_[static_cast<size_t>(why)]++;
+        return why;
+    }
+
+    AccountRisk& row(AccountId account) {
+        if (account >= accounts_.size()) {
+            throw std::out_of_range("Unknown account");
+        }
+        return accounts_[account];
+    }
+    const AccountRisk& row(AccountId account) const { return const_cast<RiskTable*>(this)->row(account); }
+};
+
+} // namespace engine
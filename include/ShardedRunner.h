@@ -0,0 +1,79 @@
+#pragma once
+
+#include "EngineRunner.h"
+
+#include <memory>
+#include <vector>
+
+namespace engine {
+
+struct ShardConfig {
+    size_t shardCount = 1;
+    size_t symbolCount = 1;              // symbols 0..symbolCount-1, split into contiguous ranges
+    size_t poolSizePerShard = 1'000'000;
+    BookConfig bookConfig;               // every book in every shard
+    PoolOptions poolOptions;             // every shard's pool
+    Clock clock;
+    RunnerConfig runner;                 // runner.cpu is the first core; shard i runs on cpu + i
+                                         // (journal, replication, dropCopy and snapshots must be unset)
+};
+
+// Partitions symbols across several EngineRunners, one matching thread each
+//
+// Shard i owns symbols [i * perShard, (i + 1) * perShard) with its own
+// MatchingEngine — books, pool and ID index — so the matching threads share
+// nothing and never contend. When pinning, each shard's engine is built on the
+// core it will run on, so first-touch (or PoolOptions::kLocalNumaNode) places
+// its memory on that core's NUMA node.
+//
+// As with EngineRunner, one thread submits and one thread polls. Order IDs only
+// need to be unique within a shard; a cancel must carry the order's symbol so
+// it reaches the right shard.
+//
+// Journaling, replication, the drop copy and snapshots aren't supported:
+// their writers are fed from one matching thread and describe one engine,
+// and every shard would share the one in config.runner. The constructor
+// refuses a config that sets any of them.
+class ShardedRunner {
+public:
+    // Throws std::invalid_argument for a bad shard split, or a runner config
+    // with a journal, replication, drop copy or snapshot path
+    explicit ShardedRunner(const ShardConfig& config);
+    ~ShardedRunner();
+
+    ShardedRunner(const ShardedRunner&) = delete;
+    ShardedRunner& operator=(const ShardedRunner&) = delete;
+
+    void start();
+    void stop();
+
+    // Route to the shard owning msg.symbol — false if that shard's ring is full
+    // Throws std::out_of_range for a symbol outside 0..symbolCount-1
+    bool submit(const OrderMsg& msg);
+
+    // Next event from any shard (shards are visited round robin)
+    bool poll(EngineEvent& event);
+
+    size_t shardCount() const { return shards_.size(); }
+    size_t shardOf(SymbolId symbol) const;
+    uint64_t processed() const;
+
+    // A shard's engine, with shard-local symbol numbering — only touch it while stopped
+    const MatchingEngine& engine(size_t shard) const { return shards_[shard]->engine; }
+
+private:
+    struct Shard {
+        SymbolId firstSymbol;
+        MatchingEngine engine;
+        EngineRunner runner;
+
+        Shard(SymbolId first, size_t symbols, const ShardConfig& config, const RunnerConfig& runnerConfig);
+    };
+
+    std::vector<std::unique_ptr<Shard>> shards_;
+    size_t symbolCount_;
+    size_t symbolsPerShard_;
+    size_t nextPoll_ = 0;
+};
+
+} // namespace engine
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "MatchingEngine.h"
+#include "Journal.h"
+
+#include <memory>
+#include <optional>
+#include <string>
+
+#include <sys/types.h>
+
+namespace engine {
+
+// Where a snapshot sits in the journal
+struct SnapshotInfo {
+    uint64_t journalSequence = 0;   // last journal record already applied
+    TradeDigest digest;             // trades up to that record
+};
+
+// === File format ===
+// A SnapshotHeader followed by flat arrays, each at the offset the header
+// gives: the live orders (with their pool slot and their FIFO neighbours as
+// slot numbers rather than pointers), the pool's free list, each book's
+// ladder windows and last trade price, the non-empty price levels (parked
+// stop levels included, flagged), and the ID index entries with
+// their table positions. Nothing in the file is a pointer, so it can be
+// mmap'd anywhere; loading is a single pass over the mapping that turns slot
+// numbers back into pointers — no matching, no index probing, no re-centering.
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    EngineShape shape;
+    SnapshotInfo info;
+
+    uint64_t tradeCount;        // engine counters
+    uint64_t orderCount;
+    uint64_t highWater;         // pool slots ever handed out
+
+    uint64_t orders;            // element counts
+    uint64_t freeSlots;
+    uint64_t levels;
+    uint64_t indexEntries;
+
+    uint64_t ordersOffset;      // byte offsets from the start of the file
+    uint64_t freeOffset;
+    uint64_t booksOffset;       // shape.symbolCount entries: ladder windows, last trade price
+    uint64_t levelsOffset;
+    uint64_t indexOffset;
+    uint64_t fileSize;
+};
+
+// Write a snapshot of the engine as it is now
+// Call between messages (from the matching thread). The file is written to
+// `path`.tmp and renamed, so a crash never leaves a torn snapshot behind.
+// Throws std::system_error on I/O failure.
+void writeSnapshot(const MatchingEngine& engine, const std::string& path, const SnapshotInfo& info = {});
+
+// Same, from a forked child: fork() gives the child a copy-on-write view of
+// the engine, so the matching thread only pays for the fork itself and then
+// carries on while the child writes. Returns the child's pid.
+// The child only writes to a file descriptor — it doesn't allocate, so it's
+// safe to fork from a multi-threaded process.
+pid_t forkSnapshot(const MatchingEngine& engine, const std::string& path, const SnapshotInfo& info = {});
+
+// Has a forked snapshot finished? true = written, false = failed, nullopt = still running
+// With wait, blocks until the child exits.
+std::optional<bool> pollSnapshot(pid_t child, bool wait = false);
+
+struct LoadedSnapshot {
+    std::unique_ptr<MatchingEngine> engine;
+    SnapshotInfo info;
+};
+
+// Rebuild an engine from a snapshot file
+// Throws std::system_error if it can't be read, std::runtime_error if it isn't a valid snapshot.
+LoadedSnapshot loadSnapshot(const std::string& path, const Clock& clock = Clock());
+
+struct Recovery {
+    std::unique_ptr<MatchingEngine> engine;
+    bool fromSnapshot = false;
+    SnapshotInfo snapshot;          // where the snapshot left off
+    ReplayResult tail;              // journal records replayed after it
+};
+
+// Restart: load the snapshot if there is one, then replay only the journal
+// records after it. Either file may be missing, but not both. If the engine
+// that wrote them enforced risk, pass a table with the same limits: it is
+// attached before the first record, so refusals and self-trade prevention
+// replay as they ran (the table must outlive the engine).
+// Throws std::runtime_error if they come from different engines or the replay diverges.
+Recovery recover(const std::string& snapshotPath, const std::string& journalPath, const Clock& clock = Clock(),
+                 RiskTable* risk = nullptr);
+
+} // namespace engine
@@ -0,0 +1,139 @@
+#pragma once
+
+#include "Order.h"   // kCacheLineSize
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace engine {
+
+// Bounded single-producer / single-consumer ring buffer
+//
+// One thread pushes, one thread pops, no locks. head_ (consumer) and tail_
+// (producer) sit on their own cache lines so the two threads don't false-share,
+// and each side keeps a cached copy of the other's index so it only reads the
+// shared one when the ring looks full (producer) or empty (consumer).
+// Capacity is rounded up to a power of two; storage is allocated once.
+template <typename T>
+class SpscRing {
+    static_assert(std::is_trivially_copyable_v<T>, "Ring elements are copied bytewise");
+
+public:
+    explicit SpscRing(size_t capacity)
+        : buffer_(std::bit_ceil(std::max<size_t>(capacity, 2)))
+        , mask_(buffer_.size() - 1)
+    {}
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // Producer: returns false if the ring is full
+    bool tryPush(const T& item) {
+        size_t tail = tail_.value.load(std::memory_order_relaxed);
+        if (tail - cachedHead_ > mask_) {
+            cachedHead_ = head_.value.load(std::memory_order_acquire);
+            if (tail - cachedHead_ > mask_) return false;
+        }
+        buffer_[tail & mask_] = item;
+        tail_.value.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer: returns false if the ring is empty
+    bool tryPop(T& out) {
+        size_t head = head_.value.load(std::memory_order_relaxed);
+        if (head == cachedTail_) {
+            cachedTail_ = tail_.value.load(std::memory_order_acquire);
+            if (head == cachedTail_) return false;
+        }
+        out = buffer_[head & mask_];
+        head_.value.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer: pop up to maxItems in one go — one index publish for the whole batch
+    size_t popBatch(T* out, size_t maxItems) {
+        size_t head = head_.value.load(std::memory_order_relaxed);
+        if (cachedTail_ - head < maxItems) {
+            cachedTail_ = tail_.value.load(std::memory_order_acquire);
+        }
+        size_t count = std::min(maxItems, cachedTail_ - head);
+        for (size_t i = 0; i < count; ++i) {
+            out[i] = buffer_[(head + i) & mask_];
+        }
+        if (count > 0) {
+            head_.value.store(head + count, std::memory_order_release);
+        }
+        return count;
+    }
+
+    // === In place ===
+    // For elements built straight in the ring and handed to write() from it,
+    // with no copy on either side. Don't mix with tryPush / tryPop.
+
+    // Producer: the next free slot past those already claimed, to fill in
+    // place (nullptr if the ring is full). Nothing claimed is visible to the
+    // consumer until publish(), which hands over every claimed slot at once
+    // — until then the producer may still change them.
+    T* claim() {
+        size_t next = tail_.value.load(std::memory_order_relaxed) + claimed_;
+        if (next - cachedHead_ > mask_) {
+            cachedHead_ = head_.value.load(std::memory_order_acquire);
+            if (next - cachedHead_ > mask_) return nullptr;
+        }
+        claimed_++;
+        return &buffer_[next & mask_];
+    }
+    void publish() { publish(claimed_); }
+    // Only the first `count` of them; the rest stay claimed
+    void publish(size_t count) {
+        if (count == 0) return;
+        tail_.value.store(tail_.value.load(std::memory_order_relaxed) + count, std::memory_order_release);
+        claimed_ -= count;
+    }
+
+    // Consumer: the published elements from the head up to the end of the
+    // storage — call again after release() for the rest once it wraps
+    std::span<const T> readable() {
+        size_t head = head_.value.load(std::memory_order_relaxed);
+        if (head == cachedTail_) {
+            cachedTail_ = tail_.value.load(std::memory_order_acquire);
+        }
+        size_t start = head & mask_;
+        return {buffer_.data() + start, std::min(cachedTail_ - head, buffer_.size() - start)};
+    }
+    // Consumer: give the first `count` readable elements back to the producer
+    void release(size_t count) {
+        head_.value.store(head_.value.load(std::memory_order_relaxed) + count, std::memory_order_release);
+    }
+
+    // Approximate when called while the other side is running
+    size_t size() const {
+        return tail_.value.load(std::memory_order_acquire) - head_.value.load(std::memory_order_acquire);
+    }
+    bool empty() const { return size() == 0; }
+    size_t capacity() const { return buffer_.size(); }
+
+private:
+    struct alignas(kCacheLineSize) PaddedIndex {
+        std::atomic<size_t> value{0};
+    };
+
+    std::vector<T> buffer_;
+    size_t mask_;
+
+    PaddedIndex head_;                               // next slot to pop (written by consumer)
+    alignas(kCacheLineSize) size_t cachedTail_ = 0;  // consumer's copy of tail_
+
+    PaddedIndex tail_;                               // next slot to push (written by producer)
+    alignas(kCacheLineSize) size_t cachedHead_ = 0;  // producer's copy of head_
+    size_t claimed_ = 0;                             // slots claimed past tail_, not yet published
+};
+
+} // namespace engine
@@ -0,0 +1,140 @@
+#pragma once
+
+#include "Types.h"
+#include "Order.h"   // kCacheLineSize
+#include "WaitStrategy.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+
+namespace engine {
+
+// Best bid and offer of one book
+// A side with no orders has orderCount 0 (its price and quantity are 0 too).
+struct TopOfBook {
+    Price bidPrice = 0;
+    Price askPrice = 0;
+    Quantity bidQuantity = 0;
+    Quantity askQuantity = 0;
+    uint32_t bidOrders = 0;
+    uint32_t askOrders = 0;
+    uint64_t sequence = 0;    // number of updates published so far (set by BboSlot::read)
+
+    bool hasBid() const { return bidOrders != 0; }
+    bool hasAsk() const { return askOrders != 0; }
+
+    bool sameQuote(const TopOfBook& other) const {
+        return bidPrice == other.bidPrice && askPrice == other.askPrice
+            && bidQuantity == other.bidQuantity && askQuantity == other.askQuantity
+            && bidOrders == other.bidOrders && askOrders == other.askOrders;
+    }
+};
+
+// A TopOfBook one thread writes and any number of threads read, with a seqlock
+//
+// The writer bumps the sequence to odd, stores the fields, and bumps it to
+// even again; a reader takes the sequence, copies the fields and re-checks
+// it, retrying if a write overlapped. Readers never write the line, so they
+// don't slow the writer beyond the cache misses of sharing it, and the
+// writer never waits for them. Fields are relaxed atomics so the racing
+// copy is well defined; the fences give the ordering.
+//
+// One slot is exactly one cache line.
+class alignas(kCacheLineSize) BboSlot {
+public:
+    // Writer only — returns false (and doesn't touch the sequence) if nothing changed
+    bool publish(const TopOfBook& top) {
+        uint64_t bidSize = pack(top.bidQuantity, top.bidOrders);
+        uint64_t askSize = pack(top.askQuantity, top.askOrders);
+        if (bidPrice_.load(std::memory_order_relaxed) == top.bidPrice
+            && askPrice_.load(std::memory_order_relaxed) == top.askPrice
+            && bidSize_.load(std::memory_order_relaxed) == bidSize
+            && askSize_.load(std::memory_order_relaxed) == askSize) {
+            return false;
+        }
+
+        uint64_t seq = seq_.load(std::memory_order_relaxed);
+        seq_.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        bidPrice_.store(top.bidPrice, std::memory_order_relaxed);
+        askPrice_.store(top.askPrice, std::memory_order_relaxed);
+        bidSize_.store(bidSize, std::memory_order_relaxed);
+        askSize_.store(askSize, std::memory_order_relaxed);
+        seq_.store(seq + 2, std::memory_order_release);
+        return true;
+    }
+
+    // One attempt at a consistent copy — false if a write was in progress
+    bool tryRead(TopOfBook& out) const {
+        uint64_t before = seq_.load(std::memory_order_acquire);
+        if (before & 1) return false;
+        out.bidPrice = bidPrice_.load(std::memory_order_relaxed);
+        out.askPrice = askPrice_.load(std::memory_order_relaxed);
+        uint64_t bidSize = bidSize_.load(std::memory_order_relaxed);
+        uint64_t askSize = askSize_.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (seq_.load(std::memory_order_relaxed) != before) return false;
+
+        out.bidQuantity = static_cast<Quantity>(bidSize);
+        out.bidOrders = static_cast<uint32_t>(bidSize >> 32);
+        out.askQuantity = static_cast<Quantity>(askSize);
+        out.askOrders = static_cast<uint32_t>(askSize >> 32);
+        out.sequence = before / 2;
+        return true;
+    }
+
+    // Consistent copy, retrying until no write overlaps (a write is a few
+    // stores, so rarely more than once — backs off in case the writer was
+    // preempted mid-write on a shared core)
+    TopOfBook read() const {
+        TopOfBook top;
+        if (tryRead(top)) return top;
+        Waiter waiter(WaitStrategy::Backoff);
+        while (!tryRead(top)) {
+            waiter.idle();
+        }
+        return top;
+    }
+
+    // Updates published so far — cheap way for a poller to see if anything changed
+    uint64_t sequence() const { return seq_.load(std::memory_order_acquire) / 2; }
+
+private:
+    std::atomic<uint64_t> seq_{0};        // odd while a write is in progress
+    std::atomic<Price> bidPrice_{0};
+    std::atomic<Price> askPrice_{0};
+    std::atomic<uint64_t> bidSize_{0};    // quantity | orderCount << 32
+    std::atomic<uint64_t> askSize_{0};
+
+    static uint64_t pack(Quantity qty, uint32_t orders) {
+        return static_cast<uint64_t>(qty) | (static_cast<uint64_t>(orders) << 32);
+    }
+};
+
+static_assert(sizeof(BboSlot) == kCacheLineSize, "A BBO slot must be exactly one cache line");
+
+// One BboSlot per symbol, each on its own cache line
+// Hand it to MatchingEngine::publishTopOfBook; the table must outlive the engine's use of it.
+class BboTable {
+public:
+    explicit BboTable(size_t symbolCount)
+        : slots_(new BboSlot[symbolCount])
+        , size_(symbolCount)
+    {
+        if (symbolCount == 0) {
+            throw std::invalid_argument("BBO table needs at least one symbol");
+        }
+    }
+
+    BboSlot& operator[](SymbolId symbol) { return slots_[symbol]; }
+    const BboSlot& operator[](SymbolId symbol) const { return slots_[symbol]; }
+    size_t size() const { return size_; }
+
+private:
+    std::unique_ptr<BboSlot[]> slots_;
+    size_t size_;
+};
+
+} // namespace engine
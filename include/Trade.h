@@ -11,13 +11,19 @@ struct Trade {
     Price price;
     Quantity quantity;
     Timestamp timestamp;
+    SymbolId symbol;
+    Side aggressor;       // side of the incoming order that took liquidity
 
-    Trade(OrderId buyId, OrderId sellId, Price price, Quantity qty)
+    // The timestamp comes from the engine's Clock, so a sweep can stamp all its trades at once
+    Trade(OrderId buyId, OrderId sellId, Price price, Quantity qty, Timestamp ts, SymbolId symbol = 0,
+          Side aggressor = Side::Buy)
         : buyOrderId(buyId)
         , sellOrderId(sellId)
         , price(price)
         , quantity(qty)
-        , timestamp(now())
+        , timestamp(ts)
+        , symbol(symbol)
+        , aggressor(aggressor)
     {}
 
     // Print trade for debugging
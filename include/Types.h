@@ -12,6 +12,28 @@ using Price = int64_t;
 using Quantity = uint32_t;
 using OrderId = uint64_t;
 
+// Instruments are numbered 0..N-1 so a book can be found by indexing, not by hashing a name
+using SymbolId = uint32_t;
+
+// Accounts are numbered the same way, so per-account risk state is a flat array
+using AccountId = uint32_t;
+
+// Orders refer to each other (and levels and the ID index to them) by pool
+// slot number — 4 bytes instead of an 8-byte pointer
+using OrderSlot = uint32_t;
+inline constexpr OrderSlot kNoSlot = UINT32_MAX;
+
+// A reference to a live order that can be checked later: its slot, and the
+// slot's generation when it was handed out. Once the order fills or is
+// cancelled the generation moves on, so a kept handle is recognisably stale
+// instead of pointing at whatever reuses the slot.
+struct OrderHandle {
+    OrderSlot slot = kNoSlot;
+    uint32_t generation = 0;
+
+    bool operator==(const OrderHandle&) const = default;
+};
+
 // === Order side ===
 enum class Side : uint8_t {
     Buy,
@@ -21,7 +43,13 @@ enum class Side : uint8_t {
 // === Order type ===
 enum class OrderType : uint8_t {
     Limit,
-    Market
+    Market,
+    ImmediateOrCancel,   // limit price, trades what it can now, never rests
+    FillOrKill,          // limit price, fills completely now or is rejected untouched
+    PostOnly,            // rests only — rejected if it would trade on arrival
+    Iceberg,             // rests showing at most `peak`, refilled from `hidden` as it trades
+    Stop,                // parked until a trade reaches its stop price, then a market order
+    StopLimit            // parked the same way, then a limit order at its price
 };
 
 // === Timestamp ===
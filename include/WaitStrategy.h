@@ -0,0 +1,53 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace engine {
+
+// What a polling thread does when there's no work
+enum class WaitStrategy : uint8_t {
+    BusySpin,   // spin with a pause hint — lowest latency, burns the core
+    Backoff     // spin, then yield, then sleep — gives the core back when idle
+};
+
+inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+// Call idle() each time a poll finds nothing and reset() when it finds work
+class Waiter {
+public:
+    explicit Waiter(WaitStrategy strategy) : strategy_(strategy) {}
+
+    void idle() {
+        if (strategy_ == WaitStrategy::BusySpin || misses_ < kSpinLimit) {
+            cpuRelax();
+        } else if (misses_ < kYieldLimit) {
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+        misses_++;
+    }
+
+    void reset() { misses_ = 0; }
+
+private:
+    static constexpr uint32_t kSpinLimit = 1000;
+    static constexpr uint32_t kYieldLimit = 1100;
+
+    WaitStrategy strategy_;
+    uint32_t misses_ = 0;
+};
+
+} // namespace engine
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "Messages.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace engine {
+
+// Shape of a synthetic order flow
+// The mix is given as weights (they needn't add up to 1). New orders rest
+// passively at mid ± d ticks, with d drawn from a Zipf distribution so most
+// of the flow lands near the top of the book. Cancels and modifies target
+// orders the generator has sent and not cancelled (some will have traded
+// away by the time they arrive — the engine just reports a miss). When no
+// order is live they become new orders instead, so a cancel weight above the
+// new weight only holds until the initial depth runs out. The defaults
+// cancel about 90% of the orders sent.
+//
+// Arrivals alternate between a calm rate and bursts: each calm message
+// starts a burst with probability burstChance, and a burst runs for about
+// burstLength messages at burstRate.
+struct WorkloadConfig {
+    size_t messages = 1'000'000;
+    uint64_t seed = 42;
+    SymbolId symbols = 1;
+
+    double newWeight = 0.49;
+    double cancelWeight = 0.44;
+    double modifyWeight = 0.05;
+    double marketWeight = 0.02;
+
+    Price mid = 10'000;
+    uint32_t maxDistance = 200;      // ticks from mid
+    double zipfExponent = 1.1;       // 0 = uniform over 1..maxDistance
+    Quantity minQty = 1;
+    Quantity maxQty = 100;
+    size_t initialDepth = 20'000;    // resting orders sent first, before the mix starts
+
+    double calmRate = 1'000'000;     // messages per second
+    double burstRate = 20'000'000;
+    double burstChance = 0.001;
+    size_t burstLength = 500;
+};
+
+// Messages and the time (ns from the start) each one arrives
+// arrivalNs is empty for flows that have no timing, like a recorded journal.
+struct Workload {
+    std::vector<OrderMsg> messages;
+    std::vector<uint64_t> arrivalNs;
+    size_t warmup = 0;     // leading messages that only build the initial book (not measured)
+};
+
+// A workload file is this header, then `messages` OrderMsgs, then (if timed)
+// one u64 arrival time per message
+inline constexpr char kWorkloadMagic[8] = {'M', 'E', 'W', 'K', 'L', 'D', '0', '1'};
+
+struct WorkloadHeader {
+    char magic[8];
+    uint64_t messages;
+    uint64_t warmup;
+    uint32_t recordSize;
+    uint32_t timed;          // 1 if arrival times follow the messages
+};
+
+// Deterministic for a given config (same seed, same flow)
+Workload generateWorkload(const WorkloadConfig& config);
+
+// Binary workload file: a small header, then the messages and arrival times
+// Throws std::system_error on I/O errors.
+void saveWorkload(const Workload& workload, const std::string& path);
+
+// Loads a workload file, or the accepted messages of a journal (no timing)
+// Throws std::system_error if the file can't be read, std::runtime_error if it's neither.
+Workload loadWorkload(const std::string& path);
+
+} // namespace engine
@@ -0,0 +1,396 @@
+#include "Backtest.h"
+#include "Workload.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <queue>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace engine {
+
+namespace {
+
+using SteadyClock = std::chrono::steady_clock;
+
+double secondsSince(SteadyClock::time_point start) {
+    return std::chrono::duration<double>(SteadyClock::now() - start).count();
+}
+
+// One input file, mapped read-only for the whole run
+// Not populated up front: a day can be bigger than memory, and the split
+// pass reads it through in order anyway.
+class MappedDay {
+public:
+    explicit MappedDay(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            throw std::system_error(errno, std::generic_category(), "Can't open " + path);
+        }
+        struct stat st{};
+        if (::fstat(fd, &st) != 0) {
+            int err = errno;
+            ::close(fd);
+            throw std::system_error(err, std::generic_category(), "Can't stat " + path);
+        }
+        size_ = static_cast<size_t>(st.st_size);
+        if (size_ > 0) {
+            void* data = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            int err = errno;
+            ::close(fd);
+            if (data == MAP_FAILED) {
+                throw std::system_error(err, std::generic_category(), "Can't map " + path);
+            }
+            data_ = static_cast<const char*>(data);
+        } else {
+            ::close(fd);
+        }
+
+        try {
+            parse(path);
+        } catch (...) {
+            unmap();
+            throw;
+        }
+    }
+
+    ~MappedDay() { unmap(); }
+
+    MappedDay(const MappedDay&) = delete;
+    MappedDay& operator=(const MappedDay&) = delete;
+
+    size_t count() const { return count_; }
+
+    const OrderMsg& message(size_t i) const {
+        return *reinterpret_cast<const OrderMsg*>(data_ + first_ + i * stride_ + msgOffset_);
+    }
+    uint64_t timeNs(size_t i) const { return times_ ? times_[i] : 0; }
+    uint64_t sequence(size_t i) const {
+        if (!journal_) return i + 1;
+        return reinterpret_cast<const JournalRecord*>(data_ + first_ + i * stride_)->sequence;
+    }
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    size_t first_ = 0;      // offset of the first record
+    size_t stride_ = 0;     // bytes from one record to the next
+    size_t msgOffset_ = 0;  // of the message in a record
+    size_t count_ = 0;
+    const uint64_t* times_ = nullptr;
+    bool journal_ = false;
+
+    void parse(const std::string& path) {
+        if (size_ >= sizeof(WorkloadHeader) && std::memcmp(data_, kWorkloadMagic, sizeof(kWorkloadMagic)) == 0) {
+            WorkloadHeader header;
+            std::memcpy(&header, data_, sizeof(header));
+            if (header.recordSize != sizeof(OrderMsg)) {
+                throw std::runtime_error("Workload file written with a different message layout: " + path);
+            }
+            size_t body = header.messages * (sizeof(OrderMsg) + (header.timed ? sizeof(uint64_t) : 0));
+            if (size_ - sizeof(header) < body) {
+                throw std::runtime_error("Truncated workload file: " + path);
+            }
+            first_ = sizeof(header);
+            stride_ = sizeof(OrderMsg);
+            count_ = header.messages;
+            if (header.timed) {
+                times_ = reinterpret_cast<const uint64_t*>(data_ + first_ + count_ * sizeof(OrderMsg));
+            }
+            return;
+        }
+
+        JournalHeader header{};
+        if (size_ >= sizeof(header)) std::memcpy(&header, data_, sizeof(header));
+        if (size_ < sizeof(header) || !header.valid()) {
+            throw std::runtime_error("Neither a workload file nor a journal: " + path);
+        }
+        journal_ = true;
+        first_ = sizeof(header);
+        msgOffset_ = offsetof(JournalRecord, msg);
+        stride_ = sizeof(JournalRecord);
+        count_ = (size_ - sizeof(header)) / sizeof(JournalRecord);   // a torn last record is ignored
+    }
+
+    void unmap() {
+        if (data_) ::munmap(const_cast<char*>(data_), size_);
+        data_ = nullptr;
+    }
+};
+
+// Run tasks 0..n-1 on `threads` workers (the caller is worker 0) and return
+// how many were stolen
+//
+// Tasks are dealt out before the workers start, heaviest first and round
+// robin, so each queue's back holds its heaviest task. A worker pops its own
+// back and, when that's empty, takes the front (the lightest) of the next
+// non-empty queue — a thief picks up the small tasks that even out the
+// finish. Nothing is added once the workers run, so a worker that finds every
+// queue empty is done. A task is a whole symbol-day, so one lock per queue
+// costs nothing next to the work it hands out.
+// fn(worker, task) must not throw for bad input; if it does throw, the
+// remaining tasks are abandoned and the first exception is rethrown here.
+template <typename Fn>
+uint64_t runStealing(size_t threads, const std::vector<uint64_t>& weights, Fn&& fn) {
+    struct alignas(64) Queue {
+        std::mutex lock;
+        std::deque<uint32_t> tasks;
+    };
+    threads = std::max<size_t>(1, std::min(threads, weights.size()));
+    std::unique_ptr<Queue[]> queues(new Queue[threads]);
+
+    std::vector<uint32_t> order(weights.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return weights[a] > weights[b]; });
+    for (size_t k = 0; k < order.size(); ++k) {
+        queues[k % threads].tasks.push_front(order[k]);
+    }
+
+    std::atomic<uint64_t> steals{0};
+    std::atomic<bool> failed{false};
+    std::exception_ptr error;
+    std::mutex errorLock;
+
+    auto take = [&](size_t worker, uint32_t& task) {
+        {
+            Queue& own = queues[worker];
+            std::lock_guard<std::mutex> guard(own.lock);
+            if (!own.tasks.empty()) {
+                task = own.tasks.back();
+                own.tasks.pop_back();
+                return true;
+            }
+        }
+        for (size_t k = 1; k < threads; ++k) {
+            Queue& victim = queues[(worker + k) % threads];
+            std::lock_guard<std::mutex> guard(victim.lock);
+            if (!victim.tasks.empty()) {
+                task = victim.tasks.front();
+                victim.tasks.pop_front();
+                steals.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    };
+
+    auto work = [&](size_t worker) {
+        uint32_t task;
+        while (!failed.load(std::memory_order_relaxed) && take(worker, task)) {
+            try {
+                fn(worker, task);
+            } catch (...) {
+                std::lock_guard<std::mutex> guard(errorLock);
+                if (!error) error = std::current_exception();
+                failed.store(true, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(threads - 1);
+    for (size_t w = 1; w < threads; ++w) workers.emplace_back(work, w);
+    work(0);
+    for (std::thread& t : workers) t.join();
+
+    if (error) std::rethrow_exception(error);
+    return steals.load();
+}
+
+// One day's messages, split by symbol into positions in the file
+struct DaySplit {
+    std::vector<SymbolId> symbols;
+    std::vector<std::vector<uint32_t>> positions;   // parallel to symbols
+};
+
+DaySplit splitBySymbol(const MappedDay& day) {
+    if (day.count() > UINT32_MAX) {
+        throw std::runtime_error("Backtest input has more than 2^32 messages in one file");
+    }
+    DaySplit split;
+    std::unordered_map<SymbolId, size_t> where;
+    SymbolId lastSymbol = 0;
+    std::vector<uint32_t>* last = nullptr;
+    for (size_t i = 0; i < day.count(); ++i) {
+        SymbolId symbol = day.message(i).symbol;
+        if (!last || symbol != lastSymbol) {
+            auto [it, added] = where.try_emplace(symbol, split.symbols.size());
+            if (added) {
+                split.symbols.push_back(symbol);
+                split.positions.emplace_back();
+            }
+            lastSymbol = symbol;
+            last = &split.positions[it->second];
+        }
+        last->push_back(static_cast<uint32_t>(i));
+    }
+    return split;
+}
+
+struct Task {
+    uint32_t day;
+    SymbolId symbol;
+    const std::vector<uint32_t>* positions;
+};
+
+struct TaskOutput {
+    std::vector<BacktestTrade> trades;
+    uint64_t rejected = 0;
+};
+
+// Collects a task's trades, stamped with the message that made them
+struct TaskListener : EventListener {
+    std::vector<BacktestTrade>* out = nullptr;
+    SymbolId symbol = 0;    // the task's engine trades it as symbol 0
+    uint32_t day = 0;
+    uint64_t timeNs = 0;
+    uint64_t sequence = 0;
+
+    void onTrade(const Trade& trade) {
+        out->push_back({timeNs, sequence, day, trade});
+        out->back().trade.symbol = symbol;
+    }
+};
+
+} // namespace
+
+BacktestResult runBacktest(const std::vector<std::string>& days, const BacktestConfig& config) {
+    BacktestResult result;
+    result.threads = config.threads ? config.threads : std::max(1u, std::thread::hardware_concurrency());
+    if (days.size() > UINT32_MAX) {
+        throw std::invalid_argument("Too many backtest days");
+    }
+
+    // Map every day and split each by symbol, one day per task
+    auto start = SteadyClock::now();
+    std::vector<std::unique_ptr<MappedDay>> mapped;
+    mapped.reserve(days.size());
+    for (const std::string& path : days) mapped.push_back(std::make_unique<MappedDay>(path));
+
+    std::vector<DaySplit> splits(days.size());
+    std::vector<uint64_t> dayWeights;
+    for (const auto& day : mapped) dayWeights.push_back(day->count());
+    result.steals += runStealing(result.threads, dayWeights,
+                                 [&](size_t, uint32_t d) { splits[d] = splitBySymbol(*mapped[d]); });
+
+    std::vector<Task> tasks;
+    std::vector<uint64_t> taskWeights;
+    for (uint32_t d = 0; d < splits.size(); ++d) {
+        result.messages += mapped[d]->count();
+        for (size_t s = 0; s < splits[d].symbols.size(); ++s) {
+            tasks.push_back({d, splits[d].symbols[s], &splits[d].positions[s]});
+            taskWeights.push_back(splits[d].positions[s].size());
+        }
+    }
+    result.tasks = tasks.size();
+    result.splitSeconds = secondsSince(start);
+
+    // Replay: every worker keeps one single-book engine for all its tasks
+    // (built on the worker, so its pool is first touched there)
+    start = SteadyClock::now();
+    std::vector<TaskOutput> outputs(tasks.size());
+    std::vector<std::unique_ptr<MatchingEngine>> engines(std::min(result.threads, std::max<size_t>(tasks.size(), 1)));
+    PoolOptions poolOptions;
+    poolOptions.growable = true;
+
+    result.steals += runStealing(result.threads, taskWeights, [&](size_t worker, uint32_t t) {
+        std::unique_ptr<MatchingEngine>& engine = engines[worker];
+        if (!engine) {
+            engine = std::make_unique<MatchingEngine>(config.poolSize, config.book, poolOptions);
+        } else {
+            engine->reset();
+        }
+
+        const Task& task = tasks[t];
+        const MappedDay& day = *mapped[task.day];
+        TaskOutput& output = outputs[t];
+        TaskListener listener;
+        listener.out = &output.trades;
+        listener.symbol = task.symbol;
+        listener.day = task.day;
+
+        // A symbol's messages are spread through the file, one cache line
+        // apiece, so keep the next few in flight
+        constexpr size_t kPrefetchAhead = 8;
+        const std::vector<uint32_t>& positions = *task.positions;
+        for (size_t k = 0; k < positions.size(); ++k) {
+            if (k + kPrefetchAhead < positions.size()) __builtin_prefetch(&day.message(positions[k + kPrefetchAhead]));
+            uint32_t i = positions[k];
+            OrderMsg msg = day.message(i);
+            msg.symbol = 0;
+            listener.timeNs = day.timeNs(i);
+            listener.sequence = day.sequence(i);
+            bool accepted = false;
+            try {
+                accepted = engine->submit(msg, listener);
+            } catch (const std::exception&) {
+                // Bad price, pool exhausted, ... — rejected, as the runner would
+            }
+            output.rejected += !accepted;
+        }
+    });
+    result.replaySeconds = secondsSince(start);
+
+    // Merge each day's symbols back into one stream
+    start = SteadyClock::now();
+    struct Cursor {
+        uint64_t timeNs;
+        uint64_t sequence;
+        size_t output;
+        size_t next;
+        bool operator>(const Cursor& other) const {
+            return timeNs != other.timeNs ? timeNs > other.timeNs : sequence > other.sequence;
+        }
+    };
+    size_t total = 0;
+    for (const TaskOutput& output : outputs) {
+        total += output.trades.size();
+        result.rejected += output.rejected;
+    }
+    if (config.keepTrades) result.trades.reserve(total);
+
+    std::priority_queue<Cursor, std::vector<Cursor>, std::greater<Cursor>> heap;
+    size_t t = 0;
+    while (t < tasks.size()) {
+        uint32_t day = tasks[t].day;
+        for (; t < tasks.size() && tasks[t].day == day; ++t) {
+            const auto& trades = outputs[t].trades;
+            if (!trades.empty()) heap.push({trades[0].timeNs, trades[0].sequence, t, 0});
+        }
+        while (!heap.empty()) {
+            Cursor cursor = heap.top();
+            heap.pop();
+            std::vector<BacktestTrade>& trades = outputs[cursor.output].trades;
+            // Every trade of one message at once — they come from one task, in engine order
+            size_t i = cursor.next;
+            for (; i < trades.size() && trades[i].sequence == cursor.sequence; ++i) {
+                result.digest.add(trades[i].trade);
+                if (config.keepTrades) result.trades.push_back(trades[i]);
+            }
+            if (i < trades.size()) {
+                heap.push({trades[i].timeNs, trades[i].sequence, cursor.output, i});
+            } else {
+                std::vector<BacktestTrade>().swap(trades);
+            }
+        }
+    }
+    result.mergeSeconds = secondsSince(start);
+    return result;
+}
+
+} // namespace engine
@@ -0,0 +1,32 @@
+#include "Clock.h"
+
+namespace engine {
+
+const TscCalibration& TscCalibration::get() {
+    // Function-local static: calibrated once, thread-safe initialization
+    static const TscCalibration calibration;
+    return calibration;
+}
+
+TscCalibration::TscCalibration() {
+    using namespace std::chrono;
+
+    Timestamp startTime = engine::now();
+    uint64_t startTicks = readTscSerialized();
+
+    // Spin rather than sleep so the core stays at the same frequency
+    Timestamp endTime = startTime;
+    while (endTime - startTime < milliseconds(10)) {
+        endTime = engine::now();
+    }
+    uint64_t endTicks = readTscSerialized();
+
+    auto elapsedNs = duration_cast<nanoseconds>(endTime - startTime).count();
+    uint64_t elapsedTicks = endTicks - startTicks;
+    nsPerTick_ = elapsedTicks > 0 ? static_cast<double>(elapsedNs) / static_cast<double>(elapsedTicks) : 1.0;
+
+    baseTicks_ = endTicks;
+    baseTime_ = endTime;
+}
+
+} // namespace engine
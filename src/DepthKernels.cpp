@@ -0,0 +1,150 @@
+#include "DepthKernels.h"
+
+#include <algorithm>
+#include <cstddef>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace engine {
+
+namespace {
+
+// The vector kernels shift each level's third qword (orderCount, totalQuantity) right by 32
+static_assert(sizeof(PriceLevel) == 32, "Depth kernels read one level per 32 bytes");
+static_assert(offsetof(PriceLevel, totalQuantity) == 20, "totalQuantity must be the high half of the third qword");
+
+using Kernel = SweepResult (*)(const PriceLevel*, size_t, bool, uint64_t);
+
+// Carry on level by level from distance d — the tail, and the chunk the target falls in
+void finish(const PriceLevel* first, size_t d, size_t count, bool down, uint64_t target, SweepResult& r) {
+    for (; d < count && r.quantity < target; ++d) {
+        uint64_t q = (down ? first - d : first + d)->totalQuantity;
+        uint64_t take = std::min(q, target - r.quantity);
+        r.quantity += take;
+        r.weighted += take * d;
+        if (r.quantity == target) r.reachedAt = d;
+    }
+}
+
+SweepResult sweepScalar(const PriceLevel* first, size_t count, bool down, uint64_t target) {
+    SweepResult r;
+    finish(first, 0, count, down, target, r);
+    return r;
+}
+
+// Σ i·q_i over a chunk of L levels in address order, from its sum S and the
+// sum of its running prefix sums P: P = Σ q_i (L - i), so Σ i·q_i = L·S - P.
+// Walking down, the nearest level is the last in address order.
+uint64_t chunkWeight(uint64_t ascending, uint64_t sum, size_t length, size_t d, bool down) {
+    uint64_t inChunk = down ? (length - 1) * sum - ascending : ascending;
+    return d * sum + inChunk;
+}
+
+#if defined(__x86_64__)
+
+__attribute__((target("avx2")))
+SweepResult sweepAvx2(const PriceLevel* first, size_t count, bool down, uint64_t target) {
+    constexpr size_t kChunk = 16;
+    SweepResult r;
+    size_t d = 0;
+    for (; d + kChunk <= count && r.quantity < target; d += kChunk) {
+        const PriceLevel* lo = down ? first - d - (kChunk - 1) : first + d;
+        __m256i sum = _mm256_setzero_si256();
+        __m256i prefix = _mm256_setzero_si256();
+        for (size_t i = 0; i < kChunk; ++i) {
+            __m256i level = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lo + i));
+            sum = _mm256_add_epi64(sum, _mm256_srli_epi64(level, 32));   // qword 2 = totalQuantity
+            prefix = _mm256_add_epi64(prefix, sum);
+        }
+        auto s = static_cast<uint64_t>(_mm256_extract_epi64(sum, 2));
+        if (r.quantity + s >= target) break;   // the target is inside this chunk
+        auto p = static_cast<uint64_t>(_mm256_extract_epi64(prefix, 2));
+        r.quantity += s;
+        r.weighted += chunkWeight(kChunk * s - p, s, kChunk, d, down);
+    }
+    finish(first, d, count, down, target, r);
+    return r;
+}
+
+__attribute__((target("avx512f")))
+SweepResult sweepAvx512(const PriceLevel* first, size_t count, bool down, uint64_t target) {
+    constexpr size_t kChunk = 16;   // two levels per register: even ones in qword 2, odd ones in qword 6
+    constexpr size_t kLoads = kChunk / 2;
+    SweepResult r;
+    size_t d = 0;
+    alignas(64) uint64_t sums[8];
+    alignas(64) uint64_t prefixes[8];
+    for (; d + kChunk <= count && r.quantity < target; d += kChunk) {
+        const PriceLevel* lo = down ? first - d - (kChunk - 1) : first + d;
+        __m512i sum = _mm512_setzero_si512();
+        __m512i prefix = _mm512_setzero_si512();
+        for (size_t i = 0; i < kLoads; ++i) {
+            __m512i pair = _mm512_loadu_si512(lo + 2 * i);
+            sum = _mm512_add_epi64(sum, _mm512_maskz_srli_epi64(0x44, pair, 32));
+            prefix = _mm512_add_epi64(prefix, sum);
+        }
+        _mm512_store_si512(sums, sum);
+        uint64_t s = sums[2] + sums[6];
+        if (r.quantity + s >= target) break;
+        _mm512_store_si512(prefixes, prefix);
+        // Even levels sit at positions 2m, odd ones at 2m + 1, m = 0..7
+        uint64_t evenM = kLoads * sums[2] - prefixes[2];
+        uint64_t oddM = kLoads * sums[6] - prefixes[6];
+        uint64_t ascending = 2 * evenM + 2 * oddM + sums[6];
+        r.quantity += s;
+        r.weighted += chunkWeight(ascending, s, kChunk, d, down);
+    }
+    finish(first, d, count, down, target, r);
+    return r;
+}
+
+#endif
+
+SimdLevel detect() {
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("avx512f")) return SimdLevel::Avx512;
+    if (__builtin_cpu_supports("avx2")) return SimdLevel::Avx2;
+#endif
+    return SimdLevel::Scalar;
+}
+
+Kernel kernelFor(SimdLevel level) {
+#if defined(__x86_64__)
+    switch (level) {
+    case SimdLevel::Avx512: return sweepAvx512;
+    case SimdLevel::Avx2: return sweepAvx2;
+    case SimdLevel::Scalar: break;
+    }
+#else
+    (void)level;
+#endif
+    return sweepScalar;
+}
+
+const SimdLevel gSupported = detect();
+const Kernel gKernel = kernelFor(gSupported);
+
+} // namespace
+
+SimdLevel supportedSimd() { return gSupported; }
+
+const char* simdName(SimdLevel level) {
+    switch (level) {
+    case SimdLevel::Scalar: return "scalar";
+    case SimdLevel::Avx2: return "avx2";
+    case SimdLevel::Avx512: return "avx512";
+    }
+    return "?";
+}
+
+SweepResult sweepLevels(const PriceLevel* first, size_t count, bool down, uint64_t target) {
+    return gKernel(first, count, down, target);
+}
+
+SweepResult sweepLevels(SimdLevel level, const PriceLevel* first, size_t count, bool down, uint64_t target) {
+    return kernelFor(std::min(level, gSupported))(first, count, down, target);
+}
+
+} // namespace engine
@@ -0,0 +1,220 @@
+#include "DropCopy.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace engine {
+
+namespace {
+
+constexpr char kMagic[8] = {'M', 'E', 'D', 'R', 'O', 'P', '0', '1'};
+constexpr uint32_t kVersion = 1;
+
+[[noreturn]] void throwErrno(int err, const char* what) {
+    throw std::system_error(err, std::generic_category(), what);
+}
+
+} // namespace
+
+// === Writer ===
+
+DropCopyWriter::DropCopyWriter(const DropCopyConfig& config, const Clock& clock)
+    : config_(config)
+    , clock_(clock)
+    , ring_(config.ringCapacity)
+{
+    if (config_.maxBatch == 0) {
+        throw std::invalid_argument("Drop copy batch must hold at least one report");
+    }
+    if (config.fd >= 0) {
+        fd_ = config.fd;
+    } else {
+        fd_ = ::open(config.path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd_ < 0) {
+            throwErrno(errno, "Cannot open drop copy");
+        }
+        ownsFd_ = true;
+    }
+    struct stat st{};
+    socket_ = ::fstat(fd_, &st) == 0 && S_ISSOCK(st.st_mode);
+
+    DropCopyHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.recordSize = sizeof(ExecReport);
+    try {
+        iovec part{&header, sizeof(header)};
+        writeAll(&part, 1);
+    } catch (...) {
+        if (ownsFd_) ::close(fd_);
+        throw;
+    }
+
+    thread_ = std::thread([this]() { run(); });
+}
+
+DropCopyWriter::~DropCopyWriter() {
+    stopping_.store(true, std::memory_order_release);
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    if (ownsFd_) {
+        ::close(fd_);
+    }
+}
+
+void DropCopyWriter::throwError() const {
+    throwErrno(error_.load(std::memory_order_acquire), "Drop copy write failed");
+}
+
+ExecReport* DropCopyWriter::claimSlow() {
+    Waiter waiter(config_.wait);
+    while (true) {
+        // Hand over what this message has encoded so far, short of its latest
+        // trade (a fill may still mark it). If that trade leads and the
+        // message's reports alone fill the ring, it goes too, unmarked —
+        // otherwise nothing could ever free a slot.
+        uint64_t pending = encoded_ - published_;
+        uint64_t ready = (lastTrade_ ? lastTradeIndex_ : encoded_) - published_;
+        if (ready == 0 && pending == ring_.capacity()) {
+            ready = pending;
+            lastTrade_ = nullptr;
+        }
+        ring_.publish(ready);
+        published_ += ready;
+
+        if (ExecReport* slot = ring_.claim()) return slot;
+        checkError();
+        waiter.idle();
+    }
+}
+
+void DropCopyWriter::flush() {
+    Waiter waiter(config_.wait);
+    while (written() < committed()) {
+        checkError();
+        waiter.idle();
+    }
+}
+
+void DropCopyWriter::writeAll(iovec* parts, int count) {
+    msghdr msg{};
+    while (count > 0) {
+        ssize_t n;
+        if (socket_) {
+            msg.msg_iov = parts;
+            msg.msg_iovlen = static_cast<decltype(msg.msg_iovlen)>(count);
+#if defined(MSG_NOSIGNAL)
+            n = ::sendmsg(fd_, &msg, MSG_NOSIGNAL);
+#else
+            n = ::sendmsg(fd_, &msg, 0);
+#endif
+        } else {
+            n = ::writev(fd_, parts, count);
+        }
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throwErrno(errno, "Drop copy write failed");
+        }
+        // Skip what went out; a short write resumes mid-part
+        auto left = static_cast<size_t>(n);
+        while (count > 0 && left >= parts->iov_len) {
+            left -= parts->iov_len;
+            parts++;
+            count--;
+        }
+        if (count > 0) {
+            parts->iov_base = static_cast<char*>(parts->iov_base) + left;
+            parts->iov_len -= left;
+        }
+    }
+}
+
+// One frame straight from the ring: its header and the reports in a single writev()
+void DropCopyWriter::writeFrame(uint64_t firstSequence, std::span<const ExecReport> reports) {
+    DropCopyFrame frame{firstSequence, static_cast<uint32_t>(reports.size()), 0};
+    iovec parts[2] = {
+        {&frame, sizeof(frame)},
+        {const_cast<ExecReport*>(reports.data()), reports.size_bytes()},
+    };
+    writeAll(parts, 2);
+    bytes_.fetch_add(sizeof(frame) + reports.size_bytes(), std::memory_order_relaxed);
+    writes_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void DropCopyWriter::run() {
+    Waiter waiter(config_.wait);
+    uint64_t sequence = 1;
+
+    try {
+        while (true) {
+            // Whatever is published, up to the end of the storage — a batch
+            // that wraps goes out as two frames
+            std::span<const ExecReport> reports = ring_.readable();
+            if (!reports.empty()) {
+                reports = reports.first(std::min(reports.size(), config_.maxBatch));
+                writeFrame(sequence, reports);
+                ring_.release(reports.size());
+                sequence += reports.size();
+                written_.store(sequence - 1, std::memory_order_release);
+                waiter.reset();
+                continue;
+            }
+            if (stopping_.load(std::memory_order_acquire)) {
+                if (ring_.empty()) break;
+                continue;
+            }
+            waiter.idle();
+        }
+    } catch (const std::system_error& e) {
+        // Surface the failure to the matching thread on its next commit/flush
+        error_.store(e.code().value() ? e.code().value() : EIO, std::memory_order_release);
+    }
+}
+
+// === Reader ===
+
+std::vector<DecodedReport> readDropCopy(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("Cannot open drop copy: " + path);
+    }
+    DropCopyHeader header{};
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header))
+        || std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0
+        || header.version != kVersion || header.recordSize != sizeof(ExecReport)) {
+        throw std::runtime_error("Not a drop copy file (or written by an incompatible version): " + path);
+    }
+
+    std::vector<DecodedReport> reports;
+    int64_t timeNs = 0;
+    DropCopyFrame frame{};
+    while (in.read(reinterpret_cast<char*>(&frame), sizeof(frame))) {
+        if (frame.firstSequence != reports.size() + 1) {
+            throw std::runtime_error("Drop copy sequence gap: " + path);
+        }
+        size_t start = reports.size();
+        reports.resize(start + frame.count);
+        for (size_t i = 0; i < frame.count; ++i) {
+            ExecReport& report = reports[start + i].report;
+            if (!in.read(reinterpret_cast<char*>(&report), sizeof(report))) {
+                reports.resize(start);   // torn frame
+                return reports;
+            }
+            timeNs = report.type == ExecType::Clock ? report.price : timeNs + report.timeDelta;
+            reports[start + i].sequence = frame.firstSequence + i;
+            reports[start + i].timeNs = timeNs;
+        }
+    }
+    return reports;
+}
+
+} // namespace engine
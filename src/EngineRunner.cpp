@@ -0,0 +1,207 @@
+#include "EngineRunner.h"
+#include "DropCopy.h"
+#include "Journal.h"
+#include "Replication.h"
+#include "Snapshot.h"
+
+#include <exception>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace engine {
+
+bool pinCurrentThread(int cpu) {
+#if defined(__linux__)
+    if (cpu < 0) return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+// Turns engine callbacks into outbound events for the message being processed
+struct EngineRunner::RingListener : EventListener {
+    EngineRunner& runner;
+    Waiter& waiter;
+    TradeDigest digest;    // journaled with each message
+    DropCopyWriter* dropCopy;
+
+    RingListener(EngineRunner& r, Waiter& w) : runner(r), waiter(w), dropCopy(r.config_.dropCopy) {}
+
+    Timestamp stamp() const { return runner.engine_.clock().stamp(); }
+
+    void onTrade(const Trade& trade) {
+        digest.add(trade);
+        if (dropCopy) dropCopy->onTrade(trade);
+        // The aggressor is the message's order, or a stop it triggered
+        bool buy = trade.aggressor == Side::Buy;
+        runner.publish({EventType::Trade, trade.aggressor, trade.symbol, buy ? trade.buyOrderId : trade.sellOrderId,
+                        buy ? trade.sellOrderId : trade.buyOrderId, trade.price, trade.quantity, trade.timestamp, {}}, waiter);
+    }
+    void onOrderRested(const Order& order) {
+        if (dropCopy) dropCopy->onOrderRested(order);
+        runner.publish({EventType::Rested, order.side, order.symbol, order.id, 0, order.price, order.remaining, stamp(), order.handle()}, waiter);
+    }
+    void onOrderFilled(const Order& order) {
+        if (dropCopy) dropCopy->onOrderFilled(order);
+        runner.publish({EventType::Filled, order.side, order.symbol, order.id, 0, order.price, 0, stamp(), order.handle()}, waiter);
+    }
+    void onOrderCancelled(const Order& order) {
+        if (dropCopy) dropCopy->onOrderCancelled(order);
+        runner.publish({EventType::Cancelled, order.side, order.symbol, order.id, 0, order.price, order.remaining, stamp(), order.handle()}, waiter);
+    }
+    void onOrderModified(const Order& order) {
+        if (dropCopy) dropCopy->onOrderModified(order);
+        runner.publish({EventType::Modified, order.side, order.symbol, order.id, 0, order.price, order.remaining, stamp(), order.handle()}, waiter);
+    }
+    void onOrderTriggered(const Order& order) {
+        if (dropCopy) dropCopy->onOrderTriggered(order);
+        runner.publish({EventType::Triggered, order.side, order.symbol, order.id, 0, order.price, order.remaining, stamp(), order.handle()}, waiter);
+    }
+};
+
+EngineRunner::EngineRunner(MatchingEngine& engine, const RunnerConfig& config)
+    : engine_(engine)
+    , config_(config)
+    , inbound_(config.inboundCapacity)
+    , outbound_(config.outboundCapacity)
+{}
+
+EngineRunner::~EngineRunner() {
+    stop();
+}
+
+void EngineRunner::start() {
+    if (running_.exchange(true)) return;
+    thread_ = std::thread([this]() { run(); });
+}
+
+void EngineRunner::stop() {
+    running_.store(false, std::memory_order_release);
+    if (thread_.joinable()) {
+        thread_.join();
+        if (config_.journal) {
+            config_.journal->flush();
+        }
+        if (config_.dropCopy) {
+            config_.dropCopy->flush();
+        }
+    }
+}
+
+void EngineRunner::run() {
+    if (config_.cpu >= 0) {
+        pinCurrentThread(config_.cpu);
+    }
+
+    Waiter waiter(config_.wait);
+    Waiter publishWaiter(config_.wait);
+    RingListener listener(*this, publishWaiter);
+    std::vector<OrderMsg> batch(config_.batchSize);   // allocated once, before trading
+    if (config_.journal) {
+        listener.digest = config_.journal->lastDigest();   // carry on from a reopened journal
+    } else if (config_.replication) {
+        listener.digest = config_.replication->lastDigest();   // or from a promoted standby
+    }
+
+    bool lazyCancel = engine_.bookConfig().cancelMode == CancelMode::Lazy;
+    uint64_t processed = 0;
+    uint64_t lastSnapshotAt = 0;
+    int snapshotChild = -1;
+
+    while (true) {
+        size_t count = inbound_.popBatch(batch.data(), batch.size());
+        if (count == 0) {
+            // Only exit once everything submitted before stop() has been matched
+            if (!running_.load(std::memory_order_acquire) && inbound_.empty()) break;
+            // Spend idle time unlinking lazily cancelled orders, one level per poll
+            if (lazyCancel && engine_.compact(1)) continue;
+            waiter.idle();
+            continue;
+        }
+        waiter.reset();
+
+        for (size_t i = 0; i < count; ++i) {
+            process(batch[i], listener);
+        }
+        if (config_.dropCopy) {
+            config_.dropCopy->commit();
+        }
+        processed += count;
+        processed_.store(processed, std::memory_order_release);
+
+        if (config_.snapshotEvery) {
+            maybeSnapshot(listener, processed, lastSnapshotAt, snapshotChild);
+        }
+    }
+    reapSnapshot(snapshotChild, true);
+}
+
+// Between batches the engine is consistent, so fork a child to write it out
+void EngineRunner::maybeSnapshot(const RingListener& listener, uint64_t processed, uint64_t& lastSnapshotAt,
+                                 int& child) {
+    if (processed - lastSnapshotAt < config_.snapshotEvery) return;
+    reapSnapshot(child, false);
+    if (child >= 0) return;   // previous snapshot still being written
+
+    SnapshotInfo info;
+    info.journalSequence = config_.journal ? config_.journal->appended() : 0;
+    info.digest = listener.digest;
+    try {
+        child = forkSnapshot(engine_, config_.snapshotPath, info);
+    } catch (const std::exception&) {
+        snapshotsFailed_.fetch_add(1, std::memory_order_relaxed);
+    }
+    lastSnapshotAt = processed;
+}
+
+void EngineRunner::reapSnapshot(int& child, bool wait) {
+    if (child < 0) return;
+    std::optional<bool> done = pollSnapshot(child, wait);
+    if (!done) return;
+    (*done ? snapshotsWritten_ : snapshotsFailed_).fetch_add(1, std::memory_order_relaxed);
+    child = -1;
+}
+
+void EngineRunner::process(const OrderMsg& msg, RingListener& listener) {
+    bool accepted = false;
+    try {
+        accepted = engine_.submit(msg, listener);   // false: unknown order on cancel
+    } catch (const std::exception&) {
+        // Bad price, unknown symbol, pool exhausted, ... — the message is rejected, the engine is untouched
+    }
+
+    if (accepted) {
+        // Outside the try: losing the journal is fatal, not a rejection
+        if (config_.journal) {
+            config_.journal->append(msg, listener.digest);
+        }
+        if (config_.replication) {
+            config_.replication->append(msg, listener.digest);
+        }
+        return;
+    }
+    publish({EventType::Rejected, msg.side, msg.symbol, msg.id, 0, msg.price, msg.quantity, engine_.clock().now(), {}},
+            listener.waiter);
+}
+
+void EngineRunner::publish(const EngineEvent& event, Waiter& waiter) {
+    while (!outbound_.tryPush(event)) {
+        if (!running_.load(std::memory_order_acquire)) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        waiter.idle();
+    }
+    waiter.reset();
+}
+
+} // namespace engine
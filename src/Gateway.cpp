@@ -0,0 +1,489 @@
+#include "Gateway.h"
+#include "IoUring.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <system_error>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace engine {
+
+namespace {
+
+// Engine order id = client order id << 24 | session. The session goes in the
+// low bits so the same client id from many connections doesn't give the ID
+// index (keyed on the low 32 bits) one long probe chain.
+constexpr int kSessionBits = 24;
+constexpr uint32_t kSessionMask = (uint32_t{1} << kSessionBits) - 1;
+
+uint32_t sessionOf(OrderId id) { return static_cast<uint32_t>(id & kSessionMask); }
+uint64_t clientIdOf(OrderId id) { return id >> kSessionBits; }
+
+// Completion user_data = operation << 32 | connection index
+enum Op : uint64_t { kAccept = 1, kReceive = 2, kSend = 3, kCancel = 4 };
+
+uint64_t tag(Op op, uint32_t index) { return (static_cast<uint64_t>(op) << 32) | index; }
+
+constexpr uint64_t GatewayStats::* kStatFields[] = {
+    &GatewayStats::accepted, &GatewayStats::refused, &GatewayStats::open,
+    &GatewayStats::frames, &GatewayStats::badFrames, &GatewayStats::reports,
+    &GatewayStats::receives, &GatewayStats::syscalls, &GatewayStats::slowClients,
+};
+static_assert(std::size(kStatFields) * sizeof(uint64_t) == sizeof(GatewayStats), "Every stat must be published");
+
+[[noreturn]] void fail(const char* what) {
+    throw std::system_error(errno, std::system_category(), what);
+}
+
+} // namespace
+
+struct Gateway::Connection {
+    int fd = -1;
+    uint32_t session = 0;       // 0 = free
+    uint32_t index = 0;
+    bool open = false;          // false once close() has been called
+    bool receiving = false;     // a multishot receive is armed
+    bool sending = false;       // a send of `outgoing` is in flight
+    bool dirty = false;         // in dirty_
+    bool rearm = false;         // in rearm_
+
+    // A frame split across two receives — the only bytes ever copied on the way in
+    uint8_t partialBytes = 0;
+    char partial[kOrderFrameSize];
+
+    std::vector<char> queued;     // reports encoded since the last send started
+    std::vector<char> outgoing;   // the reports being sent
+    size_t sent = 0;
+};
+
+Gateway::Gateway(EngineRunner& runner, const GatewayConfig& config)
+    : runner_(runner)
+    , config_(config)
+{
+    if (config.maxConnections == 0 || config.maxConnections > kSessionMask) {
+        throw std::invalid_argument("Gateway maxConnections must be between 1 and 2^24 - 1");
+    }
+    if (config.eventBatch == 0) {
+        throw std::invalid_argument("Gateway eventBatch must be at least 1");
+    }
+
+    connections_.resize(config.maxConnections);
+    for (size_t i = 0; i < connections_.size(); ++i) connections_[i].index = static_cast<uint32_t>(i);
+    dirty_.reserve(config.maxConnections);
+    rearm_.reserve(config.maxConnections);
+    events_.resize(config.eventBatch);
+
+    try {
+        listenFd_ = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (listenFd_ < 0) fail("socket");
+        int one = 1;
+        ::setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(config.port);
+        if (::inet_pton(AF_INET, config.address.c_str(), &addr.sin_addr) != 1) {
+            throw std::invalid_argument("Gateway address is not an IPv4 address: " + config.address);
+        }
+        if (::bind(listenFd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) fail("bind");
+        if (::listen(listenFd_, SOMAXCONN) < 0) fail("listen");
+
+        socklen_t length = sizeof(addr);
+        if (::getsockname(listenFd_, reinterpret_cast<sockaddr*>(&addr), &length) < 0) fail("getsockname");
+        port_ = ntohs(addr.sin_port);
+
+        ring_ = std::make_unique<IoUring>(config.ringEntries);
+        buffers_ = std::make_unique<BufferRing>(*ring_, 0, config.receiveBuffers, config.receiveBufferSize);
+    } catch (...) {
+        if (listenFd_ >= 0) ::close(listenFd_);
+        throw;
+    }
+}
+
+Gateway::~Gateway() {
+    stop();
+    // Tear the ring down while the buffers any late operation points at still exist
+    buffers_.reset();
+    ring_.reset();
+    for (Connection& c : connections_) {
+        if (c.fd >= 0) ::close(c.fd);
+    }
+    ::close(listenFd_);
+}
+
+void Gateway::start() {
+    if (running_.exchange(true)) return;
+    thread_ = std::thread([this]() { run(); });
+}
+
+void Gateway::stop() {
+    running_.store(false, std::memory_order_release);
+    if (thread_.joinable()) thread_.join();
+}
+
+GatewayStats Gateway::stats() const {
+    static_assert(sizeof(published_) / sizeof(published_[0]) == std::size(kStatFields));
+    GatewayStats stats;
+    for (size_t i = 0; i < std::size(kStatFields); ++i) {
+        stats.*kStatFields[i] = published_[i].load(std::memory_order_relaxed);
+    }
+    return stats;
+}
+
+void Gateway::publishStats() {
+    for (size_t i = 0; i < std::size(kStatFields); ++i) {
+        published_[i].store(counts_.*kStatFields[i], std::memory_order_relaxed);
+    }
+}
+
+void Gateway::run() {
+    if (config_.cpu >= 0) {
+        pinCurrentThread(config_.cpu);
+    }
+
+    Waiter waiter(config_.wait);
+    stopping_ = false;
+    armAccept();
+
+    while (running_.load(std::memory_order_acquire)) {
+        size_t work = ring_->forEachCompletion([this](const io_uring_cqe& cqe) {
+            onCompletion(cqe.user_data, cqe.res, cqe.flags);
+        });
+        if (work) buffers_->publish();
+
+        // Receives that ran out of buffers or ended go back on now the buffers are returned
+        for (uint32_t index : rearm_) {
+            Connection& c = connections_[index];
+            c.rearm = false;
+            if (c.open && !c.receiving) armReceive(c);
+        }
+        rearm_.clear();
+        if (!acceptArmed_) armAccept();
+
+        work += drainEvents();
+        flush();
+
+        // Every re-arm and send of this pass in one syscall
+        if (ring_->queued()) {
+            ring_->submit();
+            counts_.syscalls++;
+        }
+        publishStats();
+
+        if (work) {
+            waiter.reset();
+        } else {
+            waiter.idle();
+        }
+    }
+    shutdown();
+    publishStats();
+}
+
+// Close everything and wait (briefly) for the kernel to finish with it
+void Gateway::shutdown() {
+    stopping_ = true;
+    if (acceptArmed_) {
+        io_uring_sqe* sqe = nextSqe();
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->addr = tag(kAccept, 0);
+        sqe->user_data = tag(kCancel, 0);
+    }
+    for (Connection& c : connections_) close(c);
+    rearm_.clear();
+    dirty_.clear();
+
+    auto busy = [this]() {
+        if (acceptArmed_) return true;
+        for (const Connection& c : connections_) {
+            if (c.session != 0) return true;
+        }
+        return false;
+    };
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    while (busy() && std::chrono::steady_clock::now() < deadline) {
+        if (ring_->queued()) ring_->submit();
+        if (ring_->forEachCompletion([this](const io_uring_cqe& cqe) { onCompletion(cqe.user_data, cqe.res, cqe.flags); })) {
+            buffers_->publish();
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void Gateway::onCompletion(uint64_t data, int result, uint32_t flags) {
+    auto op = static_cast<Op>(data >> 32);
+    auto index = static_cast<uint32_t>(data);
+    switch (op) {
+    case kAccept: onAccept(result, flags); break;
+    case kReceive: onReceive(connections_[index], result, flags); break;
+    case kSend: onSend(connections_[index], result); break;
+    case kCancel: break;
+    }
+}
+
+void Gateway::onAccept(int result, uint32_t flags) {
+    if (!(flags & IORING_CQE_F_MORE)) acceptArmed_ = false;
+    if (result < 0) return;
+    if (stopping_) {
+        ::close(result);
+        return;
+    }
+
+    // A session number whose table slot is free, so bySession() is one index and compare
+    uint32_t session = 0;
+    for (size_t tries = 0; tries < connections_.size() && session == 0; ++tries) {
+        uint32_t candidate = nextSession_;
+        nextSession_ = (nextSession_ + 1) & kSessionMask;
+        if (nextSession_ == 0) nextSession_ = 1;
+        if (connections_[candidate % connections_.size()].session == 0) session = candidate;
+    }
+    if (session == 0) {
+        ::close(result);
+        counts_.refused++;
+        return;
+    }
+
+    int one = 1;
+    ::setsockopt(result, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    Connection& c = connections_[session % connections_.size()];
+    c.fd = result;
+    c.session = session;
+    c.open = true;
+    c.partialBytes = 0;
+    c.sent = 0;
+    counts_.accepted++;
+    counts_.open++;
+    armReceive(c);
+}
+
+void Gateway::onReceive(Connection& c, int result, uint32_t flags) {
+    counts_.receives++;
+    if (!(flags & IORING_CQE_F_MORE)) c.receiving = false;
+
+    if (flags & IORING_CQE_F_BUFFER) {
+        auto id = static_cast<uint16_t>(flags >> IORING_CQE_BUFFER_SHIFT);
+        if (result > 0 && c.open) consume(c, buffers_->data(id), static_cast<size_t>(result));
+        buffers_->recycle(id);
+    }
+
+    if (result == 0 || (result < 0 && result != -ENOBUFS)) {
+        close(c);   // the peer went away
+    } else if (c.open && !c.receiving && !c.rearm) {
+        c.rearm = true;
+        rearm_.push_back(c.index);
+    }
+    release(c);
+}
+
+// Decode every whole frame where it sits in the receive buffer
+void Gateway::consume(Connection& c, const char* data, size_t length) {
+    if (c.partialBytes) {
+        size_t take = std::min(length, kOrderFrameSize - c.partialBytes);
+        std::memcpy(c.partial + c.partialBytes, data, take);
+        c.partialBytes = static_cast<uint8_t>(c.partialBytes + take);
+        data += take;
+        length -= take;
+        if (c.partialBytes < kOrderFrameSize) return;
+        c.partialBytes = 0;
+        handleFrame(c, c.partial);
+    }
+    for (; length >= kOrderFrameSize && c.open; data += kOrderFrameSize, length -= kOrderFrameSize) {
+        handleFrame(c, data);
+    }
+    if (length && c.open) {
+        std::memcpy(c.partial, data, length);
+        c.partialBytes = static_cast<uint8_t>(length);
+    }
+}
+
+void Gateway::handleFrame(Connection& c, const char* frame) {
+    OrderMsg msg;
+    if (!decodeOrderFrame(frame, msg) || !runner_.running()) {
+        counts_.badFrames++;
+        queueReport(c, {EventType::Rejected, msg.side, msg.symbol, msg.id & kMaxClientOrderId, 0, msg.price, msg.quantity});
+        return;
+    }
+    msg.id = (msg.id << kSessionBits) | c.session;
+
+    // Inbound ring full: keep draining events so the matching thread can't
+    // block on a full outbound ring while we wait for it
+    if (!runner_.submit(msg)) {
+        Waiter waiter(config_.wait);
+        while (!runner_.submit(msg)) {
+            if (drainEvents()) {
+                waiter.reset();
+            } else {
+                waiter.idle();
+            }
+        }
+    }
+    counts_.frames++;
+}
+
+size_t Gateway::drainEvents() {
+    size_t total = 0;
+    while (true) {
+        size_t count = runner_.poll(events_.data(), events_.size());
+        for (size_t i = 0; i < count; ++i) route(events_[i]);
+        total += count;
+        if (count < events_.size()) return total;
+    }
+}
+
+Gateway::Connection* Gateway::bySession(uint32_t session) {
+    Connection& c = connections_[session % connections_.size()];
+    return c.session == session && c.open ? &c : nullptr;
+}
+
+// Each event goes to the connection that sent the order — a trade to both sides'
+void Gateway::route(const EngineEvent& event) {
+    uint32_t session = sessionOf(event.orderId);
+    uint64_t clientId = clientIdOf(event.orderId);
+    Report report{event.type, event.side, event.symbol, clientId, 0, event.price, event.quantity};
+
+    if (event.type != EventType::Trade) {
+        if (Connection* c = bySession(session)) queueReport(*c, report);
+        return;
+    }
+
+    uint32_t otherSession = sessionOf(event.otherId);
+    uint64_t otherClientId = clientIdOf(event.otherId);
+    bool sameSession = otherSession == session;
+    if (Connection* c = bySession(session)) {
+        report.otherId = sameSession ? otherClientId : 0;
+        queueReport(*c, report);
+    }
+    if (Connection* c = bySession(otherSession)) {
+        report.side = event.side == Side::Buy ? Side::Sell : Side::Buy;
+        report.orderId = otherClientId;
+        report.otherId = sameSession ? clientId : 0;
+        queueReport(*c, report);
+    }
+}
+
+void Gateway::queueReport(Connection& c, const Report& report) {
+    if (!c.open) return;
+    size_t at = c.queued.size();
+    if (at + kReportFrameSize > config_.maxQueuedBytes) {
+        counts_.slowClients++;
+        close(c);
+        release(c);
+        return;
+    }
+    c.queued.resize(at + kReportFrameSize);
+    encodeReport(report, c.queued.data() + at);
+    counts_.reports++;
+    if (!c.dirty) {
+        c.dirty = true;
+        dirty_.push_back(c.index);
+    }
+}
+
+void Gateway::flush() {
+    for (uint32_t index : dirty_) {
+        Connection& c = connections_[index];
+        c.dirty = false;
+        if (c.open && !c.sending && !c.queued.empty()) {
+            std::swap(c.queued, c.outgoing);
+            c.sent = 0;
+            startSend(c);
+        }
+    }
+    dirty_.clear();
+}
+
+// Send what's left of `outgoing`; reports arriving meanwhile collect in `queued`
+void Gateway::startSend(Connection& c) {
+    io_uring_sqe* sqe = nextSqe();
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = c.fd;
+    sqe->addr = reinterpret_cast<uint64_t>(c.outgoing.data() + c.sent);
+    sqe->len = static_cast<uint32_t>(c.outgoing.size() - c.sent);
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = tag(kSend, c.index);
+    c.sending = true;
+}
+
+void Gateway::onSend(Connection& c, int result) {
+    if (result < 0) {
+        c.sending = false;
+        close(c);
+        release(c);
+        return;
+    }
+    c.sent += static_cast<size_t>(result);
+    if (c.open && c.sent < c.outgoing.size()) {
+        startSend(c);   // a short send: the rest goes out next pass
+        return;
+    }
+    c.sending = false;
+    c.outgoing.clear();
+    if (!c.open) {
+        release(c);
+    } else if (!c.queued.empty() && !c.dirty) {
+        c.dirty = true;
+        dirty_.push_back(c.index);
+    }
+}
+
+void Gateway::armAccept() {
+    io_uring_sqe* sqe = nextSqe();
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = listenFd_;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_CLOEXEC;
+    sqe->user_data = tag(kAccept, 0);
+    acceptArmed_ = true;
+}
+
+void Gateway::armReceive(Connection& c) {
+    io_uring_sqe* sqe = nextSqe();
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = c.fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = buffers_->group();
+    sqe->user_data = tag(kReceive, c.index);
+    c.receiving = true;
+}
+
+// Stop taking frames and queueing reports — operations still in flight end with errors
+void Gateway::close(Connection& c) {
+    if (!c.open) return;
+    c.open = false;
+    c.queued.clear();
+    c.partialBytes = 0;
+    ::shutdown(c.fd, SHUT_RDWR);
+    counts_.open--;
+}
+
+// Free the slot once nothing in the kernel refers to the connection any more
+void Gateway::release(Connection& c) {
+    if (c.open || c.receiving || c.sending || c.session == 0) return;
+    ::close(c.fd);
+    c.fd = -1;
+    c.session = 0;
+    c.outgoing.clear();
+}
+
+io_uring_sqe* Gateway::nextSqe() {
+    io_uring_sqe* sqe;
+    while (!(sqe = ring_->getSqe())) {
+        ring_->submit();
+        counts_.syscalls++;
+    }
+    return sqe;
+}
+
+} // namespace engine
@@ -0,0 +1,127 @@
+#include "Instrumentation.h"
+
+#include <algorithm>
+
+namespace engine {
+
+namespace {
+
+ThreadCounters gBlocks[kMaxCounterThreads];
+std::atomic<size_t> gClaimed{0};
+
+size_t usedBlocks() {
+    return std::min(gClaimed.load(std::memory_order_acquire), kMaxCounterThreads);
+}
+
+void accumulate(CounterSnapshot& into, const ThreadCounters& block) {
+    for (size_t c = 0; c < kCounterCount; ++c) {
+        uint64_t value = block.values[c].load(std::memory_order_relaxed);
+        if (isMaxCounter(static_cast<Counter>(c))) {
+            into.values[c] = std::max(into.values[c], value);
+        } else {
+            into.values[c] += value;
+        }
+    }
+    for (size_t p = 0; p < kPhaseCount; ++p) {
+        into.phaseTicks[p] += block.phaseTicks[p].load(std::memory_order_relaxed);
+        into.phaseCalls[p] += block.phaseCalls[p].load(std::memory_order_relaxed);
+    }
+}
+
+} // namespace
+
+const char* counterName(Counter counter) {
+    switch (counter) {
+    case Counter::LevelsCreated: return "levels_created";
+    case Counter::LevelsErased: return "levels_erased";
+    case Counter::LadderRecenters: return "ladder_recenters";
+    case Counter::Lookups: return "lookups";
+    case Counter::LookupProbes: return "lookup_probes";
+    case Counter::LookupMaxProbe: return "lookup_max_probe";
+    case Counter::Sweeps: return "sweeps";
+    case Counter::SweepFills: return "sweep_fills";
+    case Counter::SweepLevels: return "sweep_levels";
+    case Counter::SweepMaxLevels: return "sweep_max_levels";
+    case Counter::PoolHighWater: return "pool_high_water";
+    case Counter::StopsTriggered: return "stops_triggered";
+    case Counter::SelfTradesPrevented: return "self_trades_prevented";
+    case Counter::Count: break;
+    }
+    return "?";
+}
+
+const char* phaseName(Phase phase) {
+    switch (phase) {
+    case Phase::Lookup: return "lookup";
+    case Phase::Match: return "match";
+    case Phase::Rest: return "rest";
+    case Phase::Release: return "release";
+    case Phase::Count: break;
+    }
+    return "?";
+}
+
+ThreadCounters& registerCounterThread() {
+    size_t slot = gClaimed.fetch_add(1, std::memory_order_acq_rel);
+    return gBlocks[std::min(slot, kMaxCounterThreads - 1)];
+}
+
+double CounterSnapshot::phaseNs(Phase phase) const {
+    return static_cast<double>(phaseTicks[static_cast<size_t>(phase)]) * TscCalibration::get().nsPerTick();
+}
+
+size_t counterThreads() { return usedBlocks(); }
+
+CounterSnapshot readCounters() {
+    CounterSnapshot snapshot;
+    snapshot.threads = usedBlocks();
+    for (size_t t = 0; t < snapshot.threads; ++t) accumulate(snapshot, gBlocks[t]);
+    return snapshot;
+}
+
+CounterSnapshot readCounters(size_t thread) {
+    CounterSnapshot snapshot;
+    if (thread < usedBlocks()) {
+        snapshot.threads = 1;
+        accumulate(snapshot, gBlocks[thread]);
+    }
+    return snapshot;
+}
+
+void resetCounters() {
+    for (size_t t = 0; t < usedBlocks(); ++t) {
+        for (auto& value : gBlocks[t].values) value.store(0, std::memory_order_relaxed);
+        for (auto& ticks : gBlocks[t].phaseTicks) ticks.store(0, std::memory_order_relaxed);
+        for (auto& calls : gBlocks[t].phaseCalls) calls.store(0, std::memory_order_relaxed);
+    }
+}
+
+CounterExporter::CounterExporter(std::chrono::milliseconds interval, std::function<void(const CounterSnapshot&)> sink)
+    : interval_(interval)
+    , sink_(std::move(sink))
+    , thread_([this] { run(); })
+{}
+
+CounterExporter::~CounterExporter() { stop(); }
+
+void CounterExporter::stop() {
+    stopping_.store(true, std::memory_order_release);
+    if (thread_.joinable()) thread_.join();
+}
+
+void CounterExporter::run() {
+    using clock = std::chrono::steady_clock;
+    auto next = clock::now() + interval_;
+    while (!stopping_.load(std::memory_order_acquire)) {
+        // Sleep in short steps so stop() doesn't wait out a whole interval
+        if (clock::now() < next) {
+            std::this_thread::sleep_for(std::min<clock::duration>(next - clock::now(), std::chrono::milliseconds(5)));
+            continue;
+        }
+        sink_(readCounters());
+        next += interval_;
+    }
+    sink_(readCounters());
+}
+
+} // namespace engine
@@ -0,0 +1,175 @@
+#include "IoUring.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <system_error>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace engine {
+
+namespace {
+
+[[noreturn]] void fail(int error, const char* what) {
+    throw std::system_error(error, std::system_category(), what);
+}
+
+void* mapRing(int fd, size_t bytes, off_t offset) {
+    void* p = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+    return p == MAP_FAILED ? nullptr : p;
+}
+
+template <typename T>
+T* at(void* base, unsigned offset) {
+    return reinterpret_cast<T*>(static_cast<char*>(base) + offset);
+}
+
+} // namespace
+
+IoUring::IoUring(unsigned entries) {
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    fd_ = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+    if (fd_ < 0) fail(errno, "io_uring_setup");
+
+    sqRingBytes_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingBytes_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single) sqRingBytes_ = cqRingBytes_ = std::max(sqRingBytes_, cqRingBytes_);
+
+    sqRing_ = mapRing(fd_, sqRingBytes_, IORING_OFF_SQ_RING);
+    cqRing_ = single ? sqRing_ : mapRing(fd_, cqRingBytes_, IORING_OFF_CQ_RING);
+    sqesBytes_ = params.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = static_cast<io_uring_sqe*>(mapRing(fd_, sqesBytes_, IORING_OFF_SQES));
+    if (!sqRing_ || !cqRing_ || !sqes_) {
+        int error = errno;
+        unmap();
+        fail(error, "io_uring mmap");
+    }
+
+    sqHead_ = at<unsigned>(sqRing_, params.sq_off.head);
+    sqTail_ = at<unsigned>(sqRing_, params.sq_off.tail);
+    sqArray_ = at<unsigned>(sqRing_, params.sq_off.array);
+    sqMask_ = *at<unsigned>(sqRing_, params.sq_off.ring_mask);
+    sqEntries_ = params.sq_entries;
+    sqeTail_ = sqeSubmitted_ = *sqTail_;
+
+    cqHead_ = at<unsigned>(cqRing_, params.cq_off.head);
+    cqTail_ = at<unsigned>(cqRing_, params.cq_off.tail);
+    cqes_ = at<io_uring_cqe>(cqRing_, params.cq_off.cqes);
+    cqMask_ = *at<unsigned>(cqRing_, params.cq_off.ring_mask);
+}
+
+IoUring::~IoUring() {
+    unmap();
+}
+
+void IoUring::unmap() {
+    if (sqes_) ::munmap(sqes_, sqesBytes_);
+    if (cqRing_ && cqRing_ != sqRing_) ::munmap(cqRing_, cqRingBytes_);
+    if (sqRing_) ::munmap(sqRing_, sqRingBytes_);
+    if (fd_ >= 0) ::close(fd_);
+    sqes_ = nullptr;
+    cqRing_ = sqRing_ = nullptr;
+    fd_ = -1;
+}
+
+io_uring_sqe* IoUring::getSqe() {
+    unsigned head = std::atomic_ref<unsigned>(*sqHead_).load(std::memory_order_acquire);
+    if (sqeTail_ - head >= sqEntries_) return nullptr;
+    unsigned index = sqeTail_ & sqMask_;
+    sqArray_[index] = index;
+    sqeTail_++;
+    io_uring_sqe* sqe = &sqes_[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+unsigned IoUring::submit(unsigned waitFor) {
+    unsigned toSubmit = sqeTail_ - sqeSubmitted_;
+    std::atomic_ref<unsigned>(*sqTail_).store(sqeTail_, std::memory_order_release);
+    unsigned flags = waitFor ? IORING_ENTER_GETEVENTS : 0;
+    while (true) {
+        long taken = ::syscall(__NR_io_uring_enter, fd_, toSubmit, waitFor, flags, nullptr, 0);
+        if (taken >= 0) {
+            sqeSubmitted_ += static_cast<unsigned>(taken);
+            return static_cast<unsigned>(taken);
+        }
+        if (errno == EINTR) continue;
+        // Completion queue overflowing: reap completions and submit again
+        if (errno == EBUSY || errno == EAGAIN) return 0;
+        fail(errno, "io_uring_enter");
+    }
+}
+
+int IoUring::registerOp(unsigned opcode, void* arg, unsigned count) {
+    long result = ::syscall(__NR_io_uring_register, fd_, opcode, arg, count);
+    return result < 0 ? -errno : static_cast<int>(result);
+}
+
+BufferRing::BufferRing(IoUring& ring, uint16_t group, unsigned count, size_t size)
+    : ring_(ring)
+    , size_(size)
+    , count_(count)
+    , group_(group)
+{
+    if (count == 0 || count > 32768 || (count & (count - 1)) != 0) {
+        fail(EINVAL, "BufferRing count must be a power of two up to 32768");
+    }
+
+    // The kernel wants the entry ring page aligned, which an anonymous mapping is
+    entriesBytes_ = count * sizeof(io_uring_buf);
+    void* entries = ::mmap(nullptr, entriesBytes_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (entries == MAP_FAILED) fail(errno, "BufferRing mmap");
+    entries_ = static_cast<io_uring_buf*>(entries);
+
+    buffers_ = static_cast<char*>(std::aligned_alloc(4096, (count * size + 4095) / 4096 * 4096));
+    if (!buffers_) {
+        ::munmap(entries, entriesBytes_);
+        throw std::bad_alloc();
+    }
+
+    io_uring_buf_reg reg;
+    std::memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = reinterpret_cast<uint64_t>(entries_);
+    reg.ring_entries = count;
+    reg.bgid = group;
+    int result = ring_.registerOp(IORING_REGISTER_PBUF_RING, &reg, 1);
+    if (result < 0) {
+        std::free(buffers_);
+        ::munmap(entries, entriesBytes_);
+        fail(-result, "IORING_REGISTER_PBUF_RING");
+    }
+
+    for (unsigned id = 0; id < count; ++id) recycle(static_cast<uint16_t>(id));
+    publish();
+}
+
+BufferRing::~BufferRing() {
+    io_uring_buf_reg reg;
+    std::memset(&reg, 0, sizeof(reg));
+    reg.bgid = group_;
+    ring_.registerOp(IORING_UNREGISTER_PBUF_RING, &reg, 1);
+    std::free(buffers_);
+    ::munmap(entries_, entriesBytes_);
+}
+
+void BufferRing::recycle(uint16_t id) {
+    io_uring_buf& buf = entries_[tail_ & (count_ - 1)];
+    buf.addr = reinterpret_cast<uint64_t>(data(id));
+    buf.len = static_cast<uint32_t>(size_);
+    buf.bid = id;
+    tail_++;
+}
+
+void BufferRing::publish() {
+    // The ring's tail is the first entry's reserved field
+    std::atomic_ref<uint16_t>(entries_[0].resv).store(tail_, std::memory_order_release);
+}
+
+} // namespace engine
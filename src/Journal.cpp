@@ -0,0 +1,276 @@
+#include "Journal.h"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace engine {
+
+namespace {
+
+constexpr char kMagic[8] = {'M', 'E', 'J', 'R', 'N', 'L', '0', '1'};
+constexpr uint32_t kVersion = 3;   // 2: OrderMsg carries orderType and displayQty; 3: and the account
+constexpr size_t kWriteBatch = 1024;     // records per write() call
+constexpr size_t kReadBatch = 4096;      // records per read() call
+
+[[noreturn]] void throwErrno(int err, const char* what) {
+    throw std::system_error(err, std::generic_category(), what);
+}
+
+void syncFile(int fd) {
+#if defined(__APPLE__)
+    fsync(fd);
+#else
+    fdatasync(fd);
+#endif
+}
+
+} // namespace
+
+// === Header ===
+
+JournalHeader JournalHeader::describe(const MatchingEngine& engine) {
+    JournalHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.recordSize = sizeof(JournalRecord);
+    header.shape = EngineShape::of(engine);
+    return header;
+}
+
+bool JournalHeader::valid() const {
+    return std::memcmp(magic, kMagic, sizeof(kMagic)) == 0
+        && version == kVersion
+        && recordSize == sizeof(JournalRecord);
+}
+
+// === Writer ===
+
+JournalWriter::JournalWriter(const JournalConfig& config, const MatchingEngine& engine)
+    : config_(config)
+    , ring_(config.ringCapacity)
+{
+    JournalHeader header = JournalHeader::describe(engine);
+
+    if (config.append && ::access(config.path.c_str(), F_OK) == 0) {
+        fd_ = ::open(config.path.c_str(), O_RDWR | O_CLOEXEC);
+        if (fd_ < 0) {
+            throwErrno(errno, "Cannot open journal");
+        }
+        try {
+            reopen(header);
+        } catch (...) {
+            ::close(fd_);
+            throw;
+        }
+    } else {
+        fd_ = ::open(config.path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd_ < 0) {
+            throwErrno(errno, "Cannot open journal");
+        }
+        try {
+            writeAll(&header, sizeof(header));
+        } catch (...) {
+            ::close(fd_);
+            throw;
+        }
+    }
+    if (config_.sync) {
+        syncFile(fd_);
+    }
+    durable_.store(nextSequence_ - 1, std::memory_order_relaxed);
+
+    thread_ = std::thread([this]() { run(); });
+}
+
+// Continue an existing journal: check it belongs to this engine, drop a torn
+// last record and pick up the sequence and trade digest where it stopped
+void JournalWriter::reopen(const JournalHeader& expected) {
+    JournalHeader existing{};
+    if (::pread(fd_, &existing, sizeof(existing), 0) != static_cast<ssize_t>(sizeof(existing)) || !existing.valid()) {
+        throw std::runtime_error("Not a journal file (or written by an incompatible version): " + config_.path);
+    }
+    if (!(existing.shape == expected.shape)) {
+        throw std::invalid_argument("Journal was written by a differently configured engine: " + config_.path);
+    }
+
+    off_t end = ::lseek(fd_, 0, SEEK_END);
+    if (end < 0) {
+        throwErrno(errno, "Cannot seek journal");
+    }
+    size_t records = (static_cast<size_t>(end) - sizeof(JournalHeader)) / sizeof(JournalRecord);
+    off_t whole = static_cast<off_t>(sizeof(JournalHeader) + records * sizeof(JournalRecord));
+    if (whole != end && ::ftruncate(fd_, whole) != 0) {
+        throwErrno(errno, "Cannot truncate torn journal record");
+    }
+
+    if (records > 0) {
+        JournalRecord last;
+        if (::pread(fd_, &last, sizeof(last), whole - static_cast<off_t>(sizeof(last))) != static_cast<ssize_t>(sizeof(last))) {
+            throwErrno(errno, "Journal read failed");
+        }
+        nextSequence_ = last.sequence + 1;
+        lastDigest_ = last.digest;
+    }
+    if (::lseek(fd_, whole, SEEK_SET) < 0) {
+        throwErrno(errno, "Cannot seek journal");
+    }
+}
+
+JournalWriter::~JournalWriter() {
+    stopping_.store(true, std::memory_order_release);
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    ::close(fd_);
+}
+
+void JournalWriter::checkError() const {
+    if (int err = error_.load(std::memory_order_acquire)) {
+        throwErrno(err, "Journal write failed");
+    }
+}
+
+void JournalWriter::append(const OrderMsg& msg, const TradeDigest& digest) {
+    JournalRecord record{nextSequence_, msg, digest};
+    if (!ring_.tryPush(record)) {
+        // Writer has fallen behind — wait rather than lose a record
+        Waiter waiter(config_.wait);
+        while (!ring_.tryPush(record)) {
+            checkError();
+            waiter.idle();
+        }
+    }
+    nextSequence_++;
+}
+
+void JournalWriter::flush() {
+    Waiter waiter(config_.wait);
+    while (durable() < appended()) {
+        checkError();
+        waiter.idle();
+    }
+}
+
+void JournalWriter::writeAll(const void* data, size_t bytes) {
+    auto* p = static_cast<const char*>(data);
+    while (bytes > 0) {
+        ssize_t n = ::write(fd_, p, bytes);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throwErrno(errno, "Journal write failed");
+        }
+        p += n;
+        bytes -= static_cast<size_t>(n);
+    }
+}
+
+void JournalWriter::run() {
+    using SteadyClock = std::chrono::steady_clock;
+
+    std::vector<JournalRecord> batch(kWriteBatch);
+    Waiter waiter(config_.wait);
+    uint64_t written = 0;            // last sequence handed to write()
+    size_t unsynced = 0;
+    SteadyClock::time_point oldestUnsynced{};
+
+    auto commit = [&]() {
+        if (config_.sync) {
+            syncFile(fd_);
+            syncs_.fetch_add(1, std::memory_order_relaxed);
+        }
+        durable_.store(written, std::memory_order_release);
+        unsynced = 0;
+    };
+
+    try {
+        while (true) {
+            size_t count = ring_.popBatch(batch.data(), batch.size());
+            if (count > 0) {
+                writeAll(batch.data(), count * sizeof(JournalRecord));
+                written = batch[count - 1].sequence;
+                if (unsynced == 0) oldestUnsynced = SteadyClock::now();
+                unsynced += count;
+                waiter.reset();
+            }
+
+            bool stopping = stopping_.load(std::memory_order_acquire);
+            if (unsynced > 0 && (unsynced >= config_.syncBatch || count == 0 || stopping)) {
+                // Commit a full batch at once; a partial one only when the window
+                // has run out or there's nothing else to write
+                if (unsynced >= config_.syncBatch || stopping
+                    || SteadyClock::now() - oldestUnsynced >= config_.syncInterval) {
+                    commit();
+                }
+            }
+
+            if (count == 0) {
+                if (stopping && ring_.empty()) {
+                    if (unsynced > 0) commit();
+                    break;
+                }
+                waiter.idle();
+            }
+        }
+    } catch (const std::system_error& e) {
+        // Surface the failure to the matching thread on its next append/flush
+        error_.store(e.code().value() ? e.code().value() : EIO, std::memory_order_release);
+    }
+}
+
+// === Reader ===
+
+JournalReader::JournalReader(const std::string& path)
+    : buffer_(kReadBatch)
+{
+    fd_ = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd_ < 0) {
+        throwErrno(errno, "Cannot open journal");
+    }
+    ssize_t n = ::read(fd_, &header_, sizeof(header_));
+    if (n != static_cast<ssize_t>(sizeof(header_)) || !header_.valid()) {
+        ::close(fd_);
+        throw std::runtime_error("Not a journal file (or written by an incompatible version): " + path);
+    }
+}
+
+JournalReader::~JournalReader() {
+    ::close(fd_);
+}
+
+bool JournalReader::refill() {
+    // Read whole records only; a torn tail is dropped
+    auto* data = reinterpret_cast<char*>(buffer_.data());
+    size_t want = buffer_.size() * sizeof(JournalRecord);
+    size_t got = 0;
+    while (got < want) {
+        ssize_t n = ::read(fd_, data + got, want - got);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throwErrno(errno, "Journal read failed");
+        }
+        if (n == 0) break;
+        got += static_cast<size_t>(n);
+    }
+    bufferPos_ = 0;
+    bufferEnd_ = got / sizeof(JournalRecord);
+    return bufferEnd_ > 0;
+}
+
+bool JournalReader::next(JournalRecord& record) {
+    if (bufferPos_ == bufferEnd_ && !refill()) {
+        return false;
+    }
+    record = buffer_[bufferPos_++];
+    if (record.sequence != lastSequence_ + 1) {
+        throw std::runtime_error("Journal sequence gap after record " + std::to_string(lastSequence_));
+    }
+    lastSequence_ = record.sequence;
+    return true;
+}
+
+} // namespace engine
@@ -0,0 +1,41 @@
+#include "MarketData.h"
+
+#include <algorithm>
+#include <tuple>
+
+namespace engine {
+
+L2Publisher::L2Publisher(MatchingEngine& engine, size_t capacity)
+    : engine_(engine)
+{
+    changes_.reserve(capacity);
+    updates_.reserve(capacity);
+    engine_.trackLevelChanges(&changes_);
+}
+
+L2Publisher::~L2Publisher() {
+    engine_.trackLevelChanges(nullptr);
+}
+
+std::span<const LevelUpdate> L2Publisher::publish() {
+    updates_.clear();
+    if (changes_.empty()) return {};
+
+    // Usually a handful of entries, so sorting is cheaper than a per-level dirty flag
+    auto key = [](const LevelChange& c) { return std::tie(c.symbol, c.side, c.price); };
+    std::sort(changes_.begin(), changes_.end(),
+              [&](const LevelChange& a, const LevelChange& b) { return key(a) < key(b); });
+    auto last = std::unique(changes_.begin(), changes_.end(),
+                            [&](const LevelChange& a, const LevelChange& b) { return key(a) == key(b); });
+
+    for (auto it = changes_.begin(); it != last; ++it) {
+        const PriceLevel* level = engine_.book(it->symbol).level(it->side, it->price);
+        updates_.push_back({it->symbol, it->side, it->price,
+                            level ? level->totalQuantity : 0,
+                            level ? level->orderCount : 0});
+    }
+    changes_.clear();
+    return updates_;
+}
+
+} // namespace engine
@@ -1,55 +1,149 @@
 #include "MatchingEngine.h"
 
+#include <bit>
+#include <cstring>
+
 namespace engine {
 
-std::vector<Trade> MatchingEngine::submitLimit(OrderId id, Side side, Price price, Quantity qty) {
-    // Acquire from the pool — no heap allocation, just grab a pre-allocated slot
-    Order* order = orderPool_.acquire(id, side, OrderType::Limit, price, qty);
+EngineShape EngineShape::of(const MatchingEngine& engine) {
+    EngineShape shape{};
+    const BookConfig& config = engine.bookConfig();
+    shape.poolSize = engine.poolSize();
+    shape.symbolCount = engine.symbolCount();
+    shape.ladderLevels = config.ladderLevels;
+    shape.maxOrders = config.maxOrders;
+    shape.tickSize = config.tickSize;
+    shape.hasBasePrice = config.basePrice.has_value();
+    shape.basePrice = config.basePrice.value_or(0);
+    shape.indexMode = config.indexMode;
+    shape.cancelMode = config.cancelMode;
+    if (config.maxLadderLevels != BookConfig{}.maxLadderLevels) {   // 0 for the default, as in older files
+        shape.maxLadderLog2 = static_cast<uint8_t>(std::countr_zero(std::bit_ceil(config.maxLadderLevels)));
+    }
+    return shape;
+}
+
+BookConfig EngineShape::bookConfig() const {
+    BookConfig config;
+    config.tickSize = tickSize;
+    config.ladderLevels = ladderLevels;
+    if (hasBasePrice) config.basePrice = basePrice;
+    config.maxOrders = maxOrders;
+    config.indexMode = indexMode;
+    config.cancelMode = cancelMode;
+    if (maxLadderLog2) config.maxLadderLevels = size_t{1} << maxLadderLog2;
+    return config;
+}
 
-    orderCount_++;
+std::unique_ptr<MatchingEngine> EngineShape::makeEngine(const Clock& clock) const {
+    PoolOptions pool;
+    pool.growable = true;
+    return std::make_unique<MatchingEngine>(poolSize, bookConfig(), pool, clock, symbolCount);
+}
 
-    // Try to match first
-    auto result = book_.match(*order);
-    tradeCount_ += result.trades.size();
+bool EngineShape::operator==(const EngineShape& other) const {
+    return std::memcmp(this, &other, sizeof(EngineShape)) == 0;
+}
 
-    // Release filled resting orders back to the pool
-    for (Order* filled : result.filledOrders) {
-        orderPool_.release(filled);
+void MatchingEngine::publishTopOfBook(BboTable* table) {
+    if (table && table->size() < books_.size()) {
+        throw std::invalid_argument("BBO table has fewer slots than the engine has symbols");
+    }
+    bbo_ = table;
+    if (bbo_) {
+        for (SymbolId s = 0; s < books_.size(); ++s) updateTop(s);
     }
+}
 
-    // If order still has remaining quantity, add it to the book as a resting order
-    if (!order->isFilled()) {
-        book_.addOrder(order);
-    } else {
-        // Fully filled — return the slot to the pool immediately
-        orderPool_.release(order);
+void MatchingEngine::enforceRisk(RiskTable* table) {
+    if (table) {
+        // Check every account first, so a bad one leaves the table as it was
+        auto eachOrder = [&](const auto& ladder, auto&& f) {
+            for (const PriceLevel* level = ladder.best(); level; level = ladder.next(*level)) {
+                for (OrderSlot s = level->head; s != kNoSlot; s = orderPool_.at(s)->next) f(*orderPool_.at(s));
+            }
+        };
+        auto known = [table](const Order& order) {
+            if (order.account >= table->accountCount()) {
+                throw std::out_of_range("Resting order's account has no row in the risk table");
+            }
+        };
+        for (const OrderBook& book : books_) {
+            eachOrder(book.bids(), known);
+            eachOrder(book.asks(), known);
+            eachOrder(book.buyStops(), known);
+            eachOrder(book.sellStops(), known);
+        }
+        table->clearOpen();
+        auto open = [table](const Order& order) {
+            if (order.remaining > 0) table->addOpen(order.account, order.price, order.openQuantity());   // lazily cancelled: 0
+        };
+        for (const OrderBook& book : books_) {
+            eachOrder(book.bids(), open);
+            eachOrder(book.asks(), open);
+        }
     }
+    risk_ = table;
+    for (OrderBook& book : books_) book.trackRisk(table);
+}
 
-    return result.trades;
+// The vector-returning API is a thin wrapper over the listener API
+
+std::vector<Trade> MatchingEngine::submitLimit(SymbolId symbol, OrderId id, Side side, Price price, Quantity qty) {
+    std::vector<Trade> trades;
+    TradeCollector collector(trades);
+    submitLimit(symbol, id, side, price, qty, collector);
+    return trades;
 }
 
-std::vector<Trade> MatchingEngine::submitMarket(OrderId id, Side side, Quantity qty) {
-    Order* order = orderPool_.acquire(id, side, OrderType::Market, 0, qty);
+std::vector<Trade> MatchingEngine::submitMarket(SymbolId symbol, OrderId id, Side side, Quantity qty) {
+    std::vector<Trade> trades;
+    TradeCollector collector(trades);
+    submitMarket(symbol, id, side, qty, collector);
+    return trades;
+}
 
-    orderCount_++;
+bool MatchingEngine::cancel(OrderId id) {
+    EventListener ignore;
+    return cancel(id, ignore);
+}
 
-    // Market orders just match — they never rest in the book
-    auto result = book_.match(*order);
-    tradeCount_ += result.trades.size();
+bool MatchingEngine::cancel(OrderHandle handle) {
+    EventListener ignore;
+    return cancel(handle, ignore);
+}
 
-    // Release filled resting orders back to the pool
-    for (Order* filled : result.filledOrders) {
-        orderPool_.release(filled);
+size_t MatchingEngine::compact(size_t maxLevels) {
+    size_t compacted = 0;
+    for (size_t visited = 0; visited < books_.size() && compacted < maxLevels; ++visited) {
+        SymbolId symbol = static_cast<SymbolId>(compactCursor_);
+        compactCursor_ = (compactCursor_ + 1) % books_.size();
+        if (books_[symbol].pendingCompactions() == 0) continue;
+        {
+            PhaseTimer timer(Phase::Release);
+            compacted += books_[symbol].compact(maxLevels - compacted, filledScratch_);
+        }
+        releaseFilled();
     }
+    return compacted;
+}
 
-    // Market orders never rest — always release back to pool
-    orderPool_.release(order);
-
-    return result.trades;
+void MatchingEngine::reset() {
+    for (SymbolId symbol = 0; symbol < books_.size(); ++symbol) {
+        books_[symbol].clear(filledScratch_);
+        updateTop(symbol);
+    }
+    releaseFilled();
+    if (risk_) risk_->clearOpen();
+    triggeredScratch_.clear();
+    tradeCount_ = 0;
+    orderCount_ = 0;
+    compactCursor_ = 0;
 }
 
-bool MatchingEngine::cancel(OrderId id) {
-    return book_.cancelOrder(id);
+bool MatchingEngine::modify(OrderId id, Price newPrice, Quantity newQty) {
+    EventListener ignore;
+    return modify(id, newPrice, newQty, ignore);
 }
 
 } // namespace engine
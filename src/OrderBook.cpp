@@ -4,168 +4,345 @@
 
 namespace engine {
 
-// === Add an order to the resting book ===
-void OrderBook::addOrder(Order* order) {
-    if (order->side == Side::Buy) {
-        addToBids(order);
-    } else {
-        addToAsks(order);
-    }
-    orderLookup_[order->id] = order;
-}
-
-void OrderBook::addToBids(Order* order) {
-    // If no price level exists yet, create one
-    auto it = bids_.find(order->price);
-    if (it == bids_.end()) {
-        auto [newIt, _] = bids_.emplace(order->price, PriceLevel(order->price));
-        it = newIt;
+// === Cancel an order ===
+Order* OrderBook::cancelOrder(OrderId id) {
+    Order* order = orderLookup_->find(id);
+    if (!order) {
+        return nullptr; // order not found
     }
-    it->second.addOrder(order);
-}
 
-void OrderBook::addToAsks(Order* order) {
-    auto it = asks_.find(order->price);
-    if (it == asks_.end()) {
-        auto [newIt, _] = asks_.emplace(order->price, PriceLevel(order->price));
-        it = newIt;
+    if (order->isStop()) {
+        removeStop(order);
+    } else {
+        removeOrder(order);
     }
-    it->second.addOrder(order);
+    return order;
 }
 
-// === Cancel an order ===
-bool OrderBook::cancelOrder(OrderId id) {
-    auto it = orderLookup_.find(id);
-    if (it == orderLookup_.end()) {
-        return false; // order not found
-    }
-
-    Order* order = it->second;
-
+void OrderBook::removeOrder(Order* order) {
+    if (risk_) risk_->releaseOpen(order->account, order->price, order->openQuantity());
     if (order->side == Side::Buy) {
-        auto levelIt = bids_.find(order->price);
-        if (levelIt != bids_.end()) {
-            levelIt->second.removeOrder(order);
-            if (levelIt->second.empty()) {
-                bids_.erase(levelIt); // remove empty price level
+        if (PriceLevel* level = bids_.find(order->price)) {
+            level->removeOrder(order, *pool_);
+            if (level->empty()) {
+                bids_.erase(*level); // remove empty price level
             }
         }
     } else {
-        auto levelIt = asks_.find(order->price);
-        if (levelIt != asks_.end()) {
-            levelIt->second.removeOrder(order);
-            if (levelIt->second.empty()) {
-                asks_.erase(levelIt);
+        if (PriceLevel* level = asks_.find(order->price)) {
+            level->removeOrder(order, *pool_);
+            if (level->empty()) {
+                asks_.erase(*level);
             }
         }
     }
 
-    orderLookup_.erase(it);
-    return true;
+    orderLookup_->erase(order->id);
+    restingCount_--;
+    noteChange(order->symbol, order->side, order->price);
 }
 
-// === Matching logic ===
-MatchResult OrderBook::match(Order& incomingOrder) {
-    if (incomingOrder.side == Side::Buy) {
-        return matchBuy(incomingOrder);
-    } else {
-        return matchSell(incomingOrder);
+void OrderBook::markCancelled(Order* order, std::vector<OrderSlot>& freed) {
+    Side side = order->side;
+    Price price = order->price;
+    PriceLevel* level = side == Side::Buy ? bids_.find(price) : asks_.find(price);
+    if (risk_) risk_->releaseOpen(order->account, price, order->openQuantity());
+    orderLookup_->erase(order->id);
+    restingCount_--;
+    noteChange(order->symbol, side, price);
+    if (!level) return;
+
+    level->markDead(order);
+    if (level->orderCount == 0) {
+        // Nothing live left to match against — never leave an all-dead level in the ladder
+        reclaimDead(*level, freed);
+        if (side == Side::Buy) {
+            bids_.erase(*level);
+        } else {
+            asks_.erase(*level);
+        }
+        return;
     }
-}
 
-// Incoming BUY matches against resting ASKS (sells)
-// A buy matches if the buy price >= ask price
-MatchResult OrderBook::matchBuy(Order& buyOrder) {
-    MatchResult result;
-
-    // Walk through asks from lowest price up
-    while (!asks_.empty() && buyOrder.remaining > 0) {
-        auto& [askPrice, level] = *asks_.begin(); // best (lowest) ask
+    // Queue the level once, when its dead share first goes over the ratio
+    double linked = static_cast<double>(level->orderCount + level->deadCount);
+    if (level->deadCount > compactRatio_ * linked && level->deadCount - 1 <= compactRatio_ * linked) {
+        pendingCompaction_.push_back({side, price});
+    }
+}
 
-        // Check if prices cross — can we match?
-        if (buyOrder.type == OrderType::Limit && buyOrder.price < askPrice) {
-            break; // buy price too low, no more matches possible
+size_t OrderBook::compact(size_t maxLevels, std::vector<OrderSlot>& freed) {
+    size_t compacted = 0;
+    while (compacted < maxLevels && !pendingCompaction_.empty()) {
+        PendingLevel pending = pendingCompaction_.back();
+        pendingCompaction_.pop_back();
+        // The level may have been matched away (or emptied and refilled) since
+        PriceLevel* level = pending.side == Side::Buy ? bids_.find(pending.price) : asks_.find(pending.price);
+        if (level && level->deadCount > 0) {
+            reclaimDead(*level, freed);
+            compacted++;
         }
+    }
+    return compacted;
+}
 
-        // Match against orders at this price level (FIFO)
-        while (!level.orders.empty() && buyOrder.remaining > 0) {
-            Order* restingOrder = level.orders.front();
+void OrderBook::reclaimDead(PriceLevel& level, std::vector<OrderSlot>& freed) {
+    for (OrderSlot s = level.head; s != kNoSlot && level.deadCount > 0;) {
+        Order* order = pool_->at(s);
+        s = order->next;
+        if (order->remaining == 0) {
+            level.reclaim(order, *pool_);
+            freed.push_back(order->slot);
+        }
+    }
+}
 
-            // Determine fill quantity
-            Quantity fillQty = std::min(buyOrder.remaining, restingOrder->remaining);
+void OrderBook::clear(std::vector<OrderSlot>& freed) {
+    auto drain = [&](auto& ladder) {
+        while (PriceLevel* level = ladder.best()) {
+            for (OrderSlot s = level->head; s != kNoSlot;) {
+                Order* order = pool_->at(s);
+                s = order->next;
+                // Dead orders left the index when they were cancelled
+                if (order->remaining > 0) orderLookup_->erase(order->id);
+                freed.push_back(order->slot);
+            }
+            *level = PriceLevel(level->price);
+            ladder.erase(*level);
+        }
+    };
+    drain(bids_);
+    drain(asks_);
+    drain(buyStops_);
+    drain(sellStops_);
+    restingCount_ = 0;
+    stopCount_ = 0;
+    pendingCompaction_.clear();
+    lastTradePrice_.reset();
+    auction_ = false;
+}
 
-            // Execute the fill
-            buyOrder.fill(fillQty);
-            restingOrder->fill(fillQty);
-            level.totalQuantity -= fillQty;
+void OrderBook::reduceOrder(Order* order, Quantity newOpen) {
+    if (risk_) risk_->releaseOpen(order->account, order->price, order->openQuantity() - newOpen);
+    if (newOpen >= order->remaining) {
+        order->hidden = newOpen - order->remaining;   // only the reserve shrinks
+        return;
+    }
+    PriceLevel* level = order->side == Side::Buy ? bids_.find(order->price) : asks_.find(order->price);
+    level->totalQuantity -= order->remaining - newOpen;
+    order->remaining = newOpen;
+    order->hidden = 0;
+    noteChange(order->symbol, order->side, order->price);
+}
 
-            // Record the trade (trades happen at the resting order's price)
-            result.trades.emplace_back(buyOrder.id, restingOrder->id, askPrice, fillQty);
+// === Stop orders ===
+void OrderBook::addStop(Order* order) {
+    PriceLevel& level = order->side == Side::Buy ? buyStops_.getOrCreate(order->stopPrice)
+                                                 : sellStops_.getOrCreate(order->stopPrice);
+    level.addOrder(order, *pool_);
+    orderLookup_->insert(order->id, order);
+    stopCount_++;
+}
 
-            // If resting order is fully filled, remove it and track for pool release
-            if (restingOrder->isFilled()) {
-                orderLookup_.erase(restingOrder->id);
-                level.orders.pop_front();
-                result.filledOrders.push_back(restingOrder);
-            }
+void OrderBook::removeStop(Order* order) {
+    if (order->side == Side::Buy) {
+        if (PriceLevel* level = buyStops_.find(order->stopPrice)) {
+            level->removeOrder(order, *pool_);
+            if (level->empty()) buyStops_.erase(*level);
         }
-
-        // If price level is empty, remove it
-        if (level.empty()) {
-            asks_.erase(asks_.begin());
+    } else {
+        if (PriceLevel* level = sellStops_.find(order->stopPrice)) {
+            level->removeOrder(order, *pool_);
+            if (level->empty()) sellStops_.erase(*level);
         }
     }
+    orderLookup_->erase(order->id);
+    stopCount_--;
+}
 
-    return result;
+namespace {
+
+// Pop whole levels off a stop ladder, best first, while reached(stop price) holds
+template <typename Ladder, typename Reached>
+size_t popReached(Ladder& stops, OrderPool& pool, OrderIndex& index, Reached reached, std::vector<OrderSlot>& out) {
+    size_t taken = 0;
+    while (PriceLevel* level = stops.best()) {
+        if (!reached(level->price)) break;
+        for (OrderSlot s = level->head; s != kNoSlot;) {
+            Order* order = pool.at(s);
+            s = order->next;
+            order->prev = kNoSlot;
+            order->next = kNoSlot;
+            index.erase(order->id);
+            out.push_back(order->slot);
+        }
+        taken += level->orderCount;
+        *level = PriceLevel(level->price);
+        stops.erase(*level);
+    }
+    return taken;
 }
 
-// Incoming SELL matches against resting BIDS (buys)
-// A sell matches if the sell price <= bid price
-MatchResult OrderBook::matchSell(Order& sellOrder) {
-    MatchResult result;
+} // namespace
+
+void OrderBook::takeTriggered(std::vector<OrderSlot>& triggered) {
+    if (stopCount_ == 0 || !lastTradePrice_) return;
+    Price last = *lastTradePrice_;
+    size_t taken = popReached(buyStops_, *pool_, *orderLookup_,
+                              [last](Price stop) { return Crosses<Side::Buy>::at(last, stop); }, triggered);
+    taken += popReached(sellStops_, *pool_, *orderLookup_,
+                        [last](Price stop) { return Crosses<Side::Sell>::at(last, stop); }, triggered);
+    stopCount_ -= taken;
+    count(Counter::StopsTriggered, taken);
+}
 
-    while (!bids_.empty() && sellOrder.remaining > 0) {
-        auto& [bidPrice, level] = *bids_.begin(); // best (highest) bid
+// === Auctions ===
+AuctionResult OrderBook::auctionPrice() const {
+    AuctionResult best;
+    const PriceLevel* topBid = bids_.best();
+    const PriceLevel* topAsk = asks_.best();
+    if (!topBid || !topAsk || topBid->price < topAsk->price) return best;
+    Price low = topAsk->price;
+    Price high = topBid->price;
+
+    // Quantity offered at or below the best bid, and the highest such ask
+    uint64_t asksAtOrBelow = 0;
+    const PriceLevel* ask = topAsk;
+    for (const PriceLevel* level = topAsk; level && level->price <= high; level = asks_.next(*level)) {
+        asksAtOrBelow += level->totalQuantity;
+        ask = level;
+    }
 
-        if (sellOrder.type == OrderType::Limit && sellOrder.price > bidPrice) {
-            break;
+    auto distance = [this](Price price) {
+        Price d = price - *lastTradePrice_;
+        return d < 0 ? -d : d;
+    };
+    auto better = [&](Price price, uint64_t volume, int64_t surplus) {
+        if (volume != best.volume) return volume > best.volume;
+        uint64_t imbalance = surplus < 0 ? -static_cast<uint64_t>(surplus) : static_cast<uint64_t>(surplus);
+        uint64_t bestImbalance = best.surplus < 0 ? -static_cast<uint64_t>(best.surplus) : static_cast<uint64_t>(best.surplus);
+        if (imbalance != bestImbalance) return imbalance < bestImbalance;
+        if (lastTradePrice_ && distance(price) != distance(best.price)) return distance(price) < distance(best.price);
+        return true;   // walking down, so the lower of two equal prices wins
+    };
+
+    // Down from the best bid, visiting every level of either side in the range
+    uint64_t bidsAtOrAbove = 0;
+    const PriceLevel* bid = topBid;
+    while (bid || ask) {
+        Price price = !bid ? ask->price : !ask ? bid->price : std::max(bid->price, ask->price);
+        if (bid && bid->price == price) {
+            bidsAtOrAbove += bid->totalQuantity;
+            bid = bids_.next(*bid);
+            if (bid && bid->price < low) bid = nullptr;
+        }
+        uint64_t volume = std::min(bidsAtOrAbove, asksAtOrBelow);
+        auto surplus = static_cast<int64_t>(bidsAtOrAbove) - static_cast<int64_t>(asksAtOrBelow);
+        if (volume > 0 && better(price, volume, surplus)) {
+            best = {price, volume, surplus};
         }
+        if (ask && ask->price == price) {
+            asksAtOrBelow -= ask->totalQuantity;
+            ask = asks_.prev(*ask);
+        }
+    }
+    return best;
+}
 
-        while (!level.orders.empty() && sellOrder.remaining > 0) {
-            Order* restingOrder = level.orders.front();
+// === Matching logic ===
+MatchResult OrderBook::match(Order& incomingOrder) {
+    MatchResult result;
+    TradeCollector collector(result.trades);
+    Clock clock;
+    clock.beginMessage();
+    match(incomingOrder, collector, result.filledOrders, clock);
+    return result;
+}
 
-            Quantity fillQty = std::min(sellOrder.remaining, restingOrder->remaining);
+// === Depth queries ===
+namespace {
 
-            sellOrder.fill(fillQty);
-            restingOrder->fill(fillQty);
-            level.totalQuantity -= fillQty;
+template <Side S>
+uint64_t depthOf(const PriceLadder<S>& ladder, size_t ticks) {
+    size_t levels = std::min(ticks + 1, ladder.levelsFromBest());
+    if (levels == 0) return 0;
+    const PriceLevel* best = ladder.levelData() + ladder.bestIndex();
+    return sweepLevels(best, levels, S == Side::Buy, UINT64_MAX).quantity;
+}
 
-            result.trades.emplace_back(restingOrder->id, sellOrder.id, bidPrice, fillQty);
+// Sweep the resting side R (the other side of the order)
+template <Side R>
+FillEstimate estimateAgainst(const PriceLadder<R>& ladder, uint64_t qty, std::optional<Price> limit, Price tick) {
+    FillEstimate estimate;
+    size_t levels = limit ? ladder.levelsTo(*limit) : ladder.levelsFromBest();
+    if (levels == 0 || qty == 0) return estimate;
+
+    const PriceLevel* best = ladder.levelData() + ladder.bestIndex();
+    SweepResult sweep = sweepLevels(best, levels, R == Side::Buy, qty);
+    if (sweep.quantity == 0) return estimate;
+
+    // Level d is d ticks away from the best price, so Σ q·d gives the average
+    double awayTicks = static_cast<double>(sweep.weighted) / static_cast<double>(sweep.quantity);
+    double direction = R == Side::Buy ? -1.0 : 1.0;
+    estimate.quantity = sweep.quantity;
+    estimate.averagePrice = static_cast<double>(best->price) + direction * awayTicks * static_cast<double>(tick);
+    estimate.complete = sweep.reachedAt != kNotReached;
+    estimate.worstPrice = estimate.complete
+        ? ladder.priceAt(R == Side::Buy ? ladder.bestIndex() - sweep.reachedAt : ladder.bestIndex() + sweep.reachedAt)
+        : ladder.worstWithin(levels)->price;
+    return estimate;
+}
 
-            if (restingOrder->isFilled()) {
-                orderLookup_.erase(restingOrder->id);
-                level.orders.pop_front();
-                result.filledOrders.push_back(restingOrder);
-            }
-        }
+} // namespace
 
-        if (level.empty()) {
-            bids_.erase(bids_.begin());
-        }
-    }
+uint64_t OrderBook::depthWithin(Side side, size_t ticks) const {
+    return side == Side::Buy ? depthOf(bids_, ticks) : depthOf(asks_, ticks);
+}
 
-    return result;
+FillEstimate OrderBook::estimateFill(Side side, uint64_t qty, std::optional<Price> limit) const {
+    return side == Side::Buy ? estimateAgainst(asks_, qty, limit, tickSize_)
+                             : estimateAgainst(bids_, qty, limit, tickSize_);
 }
 
 // === Market data ===
 std::optional<Price> OrderBook::bestBid() const {
     if (bids_.empty()) return std::nullopt;
-    return bids_.begin()->first;
+    return bids_.best()->price;
 }
 
 std::optional<Price> OrderBook::bestAsk() const {
     if (asks_.empty()) return std::nullopt;
-    return asks_.begin()->first;
+    return asks_.best()->price;
+}
+
+TopOfBook OrderBook::top() const {
+    TopOfBook top;
+    if (const PriceLevel* bid = bids_.best()) {
+        top.bidPrice = bid->price;
+        top.bidQuantity = bid->totalQuantity;
+        top.bidOrders = bid->orderCount;
+    }
+    if (const PriceLevel* ask = asks_.best()) {
+        top.askPrice = ask->price;
+        top.askQuantity = ask->totalQuantity;
+        top.askOrders = ask->orderCount;
+    }
+    return top;
+}
+
+size_t OrderBook::depth(Side side, DepthLevel* out, size_t maxLevels) const {
+    size_t n = 0;
+    auto copy = [&](const auto& ladder) {
+        for (const PriceLevel* level = ladder.best(); level && n < maxLevels; level = ladder.next(*level)) {
+            out[n++] = {level->price, level->totalQuantity, level->orderCount};
+        }
+    };
+    if (side == Side::Buy) {
+        copy(bids_);
+    } else {
+        copy(asks_);
+    }
+    return n;
 }
 
 std::optional<Price> OrderBook::spread() const {
@@ -182,15 +359,15 @@ void OrderBook::printBook(int depth) const {
     // Print asks (reversed so highest price is on top)
     std::vector<std::pair<Price, const PriceLevel*>> askLevels;
     int count = 0;
-    for (const auto& [price, level] : asks_) {
+    for (const PriceLevel* level = asks_.best(); level; level = asks_.next(*level)) {
         if (count++ >= depth) break;
-        askLevels.push_back({price, &level});
+        askLevels.push_back({level->price, level});
     }
 
     for (auto it = askLevels.rbegin(); it != askLevels.rend(); ++it) {
         std::cout << "  ASK  " << std::setw(8) << it->first
                   << "  |  qty: " << std::setw(6) << it->second->totalQuantity
-                  << "  |  orders: " << it->second->orders.size() << "\n";
+                  << "  |  orders: " << it->second->orderCount << "\n";
     }
 
     std::cout << "  -------- spread: ";
@@ -202,11 +379,11 @@ void OrderBook::printBook(int depth) const {
     std::cout << " --------\n";
 
     count = 0;
-    for (const auto& [price, level] : bids_) {
+    for (const PriceLevel* level = bids_.best(); level; level = bids_.next(*level)) {
         if (count++ >= depth) break;
-        std::cout << "  BID  " << std::setw(8) << price
-                  << "  |  qty: " << std::setw(6) << level.totalQuantity
-                  << "  |  orders: " << level.orders.size() << "\n";
+        std::cout << "  BID  " << std::setw(8) << level->price
+                  << "  |  qty: " << std::setw(6) << level->totalQuantity
+                  << "  |  orders: " << level->orderCount << "\n";
     }
 
     std::cout << "================================\n\n";
@@ -0,0 +1,154 @@
+#include "PageAllocator.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <new>
+#include <system_error>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#endif
+
+namespace engine {
+
+namespace {
+
+constexpr size_t kHugePageSize = 2 * 1024 * 1024;
+
+size_t roundUp(size_t n, size_t to) {
+    return (n + to - 1) / to * to;
+}
+
+size_t pageSize() {
+    static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return size;
+}
+
+// Map anonymous memory aligned to `alignment` by over-mapping and trimming both ends
+void* mapAligned(size_t bytes, size_t alignment) {
+    size_t span = bytes + alignment;
+    void* raw = mmap(nullptr, span, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) return nullptr;
+
+    auto start = reinterpret_cast<uintptr_t>(raw);
+    uintptr_t aligned = roundUp(start, alignment);
+    if (aligned > start) {
+        munmap(raw, aligned - start);
+    }
+    uintptr_t tail = aligned + bytes;
+    if (start + span > tail) {
+        munmap(reinterpret_cast<void*>(tail), start + span - tail);
+    }
+    return reinterpret_cast<void*>(aligned);
+}
+
+// Best effort: a kernel without NUMA support just keeps the default policy
+void bindToNode(void* data, size_t bytes, int node) {
+#if defined(__linux__)
+    unsigned long mask[16] = {};   // room for 1024 nodes
+    if (node < 0 || node >= static_cast<int>(sizeof(mask) * 8)) return;
+    mask[node / 64] |= 1ul << (node % 64);
+    syscall(SYS_mbind, data, bytes, MPOL_BIND, mask, sizeof(mask) * 8, 0);
+#else
+    (void)data; (void)bytes; (void)node;
+#endif
+}
+
+// Write to every page so the faults (and NUMA placement) happen now
+void prefaultPages(void* data, size_t bytes) {
+    auto* p = static_cast<volatile unsigned char*>(data);
+    for (size_t off = 0; off < bytes; off += pageSize()) {
+        p[off] = 0;
+    }
+}
+
+} // namespace
+
+int currentNumaNode() {
+#if defined(__linux__)
+    unsigned cpu = 0;
+    unsigned node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0) {
+        return static_cast<int>(node);
+    }
+#endif
+    return 0;
+}
+
+MemoryBlock allocateBlock(size_t bytes, size_t alignment, const PoolOptions& options) {
+    MemoryBlock block;
+    block.backing = options.backing;
+
+#if defined(__linux__)
+    if (block.backing == PageBacking::HugeTlb) {
+        block.bytes = roundUp(bytes, kHugePageSize);
+        void* data = mmap(nullptr, block.bytes, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (data != MAP_FAILED) {
+            block.data = data;
+        } else {
+            // No huge pages reserved (vm.nr_hugepages) — fall back to THP
+            block.backing = PageBacking::TransparentHuge;
+        }
+    }
+    if (block.backing == PageBacking::TransparentHuge) {
+        block.bytes = roundUp(bytes, kHugePageSize);
+        block.data = mapAligned(block.bytes, kHugePageSize);
+        if (block.data) {
+            madvise(block.data, block.bytes, MADV_HUGEPAGE);
+        }
+    }
+#else
+    block.backing = PageBacking::Heap;
+#endif
+
+    if (block.backing == PageBacking::Heap) {
+        // Page-align when binding so mbind covers exactly this block
+        if (options.numaNode != -1) {
+            alignment = std::max(alignment, pageSize());
+        }
+        block.bytes = roundUp(bytes, alignment);
+        block.data = std::aligned_alloc(alignment, block.bytes);
+    }
+
+    if (!block.data) {
+        throw std::bad_alloc();
+    }
+
+    if (options.numaNode != -1) {
+        int node = options.numaNode == PoolOptions::kLocalNumaNode ? currentNumaNode() : options.numaNode;
+        bindToNode(block.data, block.bytes, node);
+    }
+
+    if (options.prefault) {
+        prefaultPages(block.data, block.bytes);
+    }
+
+    if (options.lockMemory && mlock(block.data, block.bytes) != 0) {
+        int err = errno;
+        freeBlock(block);
+        throw std::system_error(err, std::generic_category(), "mlock of pool memory failed");
+    }
+    block.locked = options.lockMemory;
+
+    return block;
+}
+
+void freeBlock(const MemoryBlock& block) {
+    if (!block.data) return;
+    if (block.locked) {
+        munlock(block.data, block.bytes);
+    }
+    if (block.backing == PageBacking::Heap) {
+        std::free(block.data);
+    } else {
+        munmap(block.data, block.bytes);
+    }
+}
+
+} // namespace engine
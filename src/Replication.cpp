@@ -0,0 +1,459 @@
+#include "Replication.h"
+
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace engine {
+
+namespace {
+
+using SteadyClock = std::chrono::steady_clock;
+
+constexpr uint32_t kMaxFrameRecords = 1 << 20;   // anything bigger is a corrupt stream
+constexpr int kStopReads = 64;                   // most reads promote() waits for while records keep coming
+
+#if defined(MSG_NOSIGNAL)
+constexpr int kSendFlags = MSG_NOSIGNAL | MSG_DONTWAIT;
+#else
+constexpr int kSendFlags = MSG_DONTWAIT;
+#endif
+
+[[noreturn]] void fail(const char* what) {
+    throw std::system_error(errno, std::system_category(), what);
+}
+
+sockaddr_in addressOf(const ReplicationConfig& config) {
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(config.port);
+    if (::inet_pton(AF_INET, config.address.c_str(), &addr.sin_addr) != 1) {
+        throw std::invalid_argument("Replication address is not an IPv4 address: " + config.address);
+    }
+    return addr;
+}
+
+void setNonBlocking(int fd) {
+    ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+    int one = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+} // namespace
+
+// === Primary ===
+
+struct ReplicationPrimary::Standby {
+    int fd = -1;
+    bool greeted = false;
+    ReplicationHello hello{};
+    size_t helloBytes = 0;
+    uint64_t next = 0;            // next sequence to send
+    uint64_t acked = 0;
+    char ack[sizeof(uint64_t)];
+    size_t ackBytes = 0;
+    std::vector<char> out;        // the frame being sent
+    size_t outPos = 0;
+    bool closeWhenSent = false;   // refused
+    SteadyClock::time_point lastSend = SteadyClock::now();
+};
+
+ReplicationPrimary::ReplicationPrimary(const ReplicationConfig& config, const MatchingEngine& engine,
+                                       uint64_t lastSequence, const TradeDigest& lastDigest)
+    : config_(config)
+    , shape_(EngineShape::of(engine))
+    , ring_(config.ringCapacity)
+    , history_(std::bit_ceil(std::max(config.historyRecords, config.maxBatch)))
+    , firstSequence_(lastSequence + 1)
+    , nextSequence_(lastSequence + 1)
+    , lastDigest_(lastDigest)
+    , appended_(lastSequence)
+{
+    if (config.maxBatch == 0) {
+        throw std::invalid_argument("Replication needs a positive batch size");
+    }
+    sockaddr_in addr = addressOf(config);
+    listenFd_ = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listenFd_ < 0) fail("socket");
+    try {
+        int one = 1;
+        ::setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (::bind(listenFd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) fail("bind");
+        if (::listen(listenFd_, SOMAXCONN) < 0) fail("listen");
+        socklen_t length = sizeof(addr);
+        if (::getsockname(listenFd_, reinterpret_cast<sockaddr*>(&addr), &length) < 0) fail("getsockname");
+        port_ = ntohs(addr.sin_port);
+        ::fcntl(listenFd_, F_SETFL, ::fcntl(listenFd_, F_GETFL) | O_NONBLOCK);
+    } catch (...) {
+        ::close(listenFd_);
+        throw;
+    }
+    thread_ = std::thread([this]() { run(); });
+}
+
+ReplicationPrimary::~ReplicationPrimary() {
+    stopping_.store(true, std::memory_order_release);
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    ::close(listenFd_);
+}
+
+void ReplicationPrimary::append(const OrderMsg& msg, const TradeDigest& digest) {
+    JournalRecord record{nextSequence_, msg, digest};
+    if (!ring_.tryPush(record)) {
+        // The sender has fallen behind — wait rather than lose a record
+        Waiter waiter(config_.wait);
+        while (!ring_.tryPush(record)) waiter.idle();
+    }
+    appended_.store(nextSequence_++, std::memory_order_release);
+}
+
+void ReplicationPrimary::run() {
+    const uint64_t mask = history_.size() - 1;
+    std::vector<JournalRecord> batch(config_.maxBatch);
+    std::vector<Standby> standbys;
+    std::vector<pollfd> fds;
+    uint64_t newest = firstSequence_ - 1;      // last sequence in the history
+    Waiter waiter(config_.wait);
+
+    auto close = [&](Standby& s) {
+        ::close(s.fd);
+        s.fd = -1;
+    };
+
+    // Queue a frame, with records [first, first + count) from the history
+    auto queue = [&](Standby& s, ReplicationFrameType type, uint64_t first, uint32_t count) {
+        ReplicationFrame frame{type, count, first, newest};
+        s.out.resize(sizeof(frame) + count * sizeof(JournalRecord));
+        std::memcpy(s.out.data(), &frame, sizeof(frame));
+        char* p = s.out.data() + sizeof(frame);
+        for (uint64_t seq = first; seq < first + count; ++seq, p += sizeof(JournalRecord)) {
+            std::memcpy(p, &history_[seq & mask], sizeof(JournalRecord));
+        }
+        s.outPos = 0;
+        frames_.fetch_add(1, std::memory_order_relaxed);
+    };
+
+    auto greet = [&](Standby& s) {
+        s.greeted = true;
+        uint64_t oldest = newest >= history_.size() ? std::max(firstSequence_, newest - mask) : firstSequence_;
+        uint64_t wanted = s.hello.nextSequence;
+        bool ok = std::memcmp(s.hello.magic, kReplicationMagic, sizeof(kReplicationMagic)) == 0
+               && s.hello.shape == shape_ && wanted >= oldest && wanted <= newest + 1;
+        if (!ok) {
+            refused_.fetch_add(1, std::memory_order_relaxed);
+            queue(s, ReplicationFrameType::Refused, wanted, 0);
+            s.closeWhenSent = true;
+            return;
+        }
+        s.next = wanted;
+        s.acked = wanted - 1;
+    };
+
+    auto receive = [&](Standby& s) {
+        char data[4096];
+        while (s.fd >= 0) {
+            ssize_t n = ::recv(s.fd, data, sizeof(data), MSG_DONTWAIT);
+            if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+                close(s);
+                return;
+            }
+            if (n < 0) return;
+            const char* p = data;
+            const char* end = data + n;
+            if (!s.greeted) {
+                size_t take = std::min<size_t>(end - p, sizeof(s.hello) - s.helloBytes);
+                std::memcpy(reinterpret_cast<char*>(&s.hello) + s.helloBytes, p, take);
+                s.helloBytes += take;
+                p += take;
+                if (s.helloBytes == sizeof(s.hello)) greet(s);
+            }
+            // Acks: only the latest complete one matters
+            for (; p < end; ++p) {
+                s.ack[s.ackBytes++] = *p;
+                if (s.ackBytes == sizeof(s.ack)) {
+                    std::memcpy(&s.acked, s.ack, sizeof(s.acked));
+                    s.ackBytes = 0;
+                }
+            }
+        }
+    };
+
+    // Returns true if anything was written
+    auto send = [&](Standby& s, SteadyClock::time_point now) {
+        if (s.fd < 0 || !s.greeted) return false;
+        if (s.out.empty() && !s.closeWhenSent) {
+            if (s.next <= newest) {
+                auto count = static_cast<uint32_t>(std::min<uint64_t>(config_.maxBatch, newest - s.next + 1));
+                queue(s, ReplicationFrameType::Records, s.next, count);
+                s.next += count;
+            } else if (now - s.lastSend >= config_.heartbeat) {
+                queue(s, ReplicationFrameType::Heartbeat, s.next, 0);
+            } else {
+                return false;
+            }
+        }
+        bool wrote = false;
+        while (s.outPos < s.out.size()) {
+            ssize_t n = ::send(s.fd, s.out.data() + s.outPos, s.out.size() - s.outPos, kSendFlags);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                if (errno != EAGAIN && errno != EWOULDBLOCK) close(s);
+                return wrote;
+            }
+            s.outPos += static_cast<size_t>(n);
+            wrote = true;
+        }
+        s.out.clear();
+        s.lastSend = now;
+        if (s.closeWhenSent) close(s);
+        return wrote;
+    };
+
+    SteadyClock::time_point stopDeadline{};
+    while (true) {
+        bool busy = false;
+        size_t count = ring_.popBatch(batch.data(), batch.size());
+        for (size_t i = 0; i < count; ++i) {
+            history_[batch[i].sequence & mask] = batch[i];
+        }
+        if (count > 0) {
+            newest = batch[count - 1].sequence;
+            busy = true;
+            // Next record already overwritten: this standby can't catch up from here
+            for (Standby& s : standbys) {
+                if (s.fd >= 0 && s.greeted && !s.closeWhenSent && s.next + history_.size() <= newest) close(s);
+            }
+        }
+
+        fds.clear();
+        fds.push_back({listenFd_, POLLIN, 0});
+        for (const Standby& s : standbys) {
+            fds.push_back({s.fd, static_cast<short>(POLLIN | (s.out.empty() ? 0 : POLLOUT)), 0});
+        }
+        if (::poll(fds.data(), fds.size(), 0) > 0) {
+            if (fds[0].revents & POLLIN) {
+                while (true) {
+                    int fd = ::accept(listenFd_, nullptr, nullptr);
+                    if (fd < 0) break;
+                    if (standbys.size() >= config_.maxStandbys) {
+                        ::close(fd);
+                        continue;
+                    }
+                    setNonBlocking(fd);
+                    standbys.emplace_back().fd = fd;
+                }
+                busy = true;
+            }
+            for (size_t i = 1; i < fds.size() && i <= standbys.size(); ++i) {
+                if (fds[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+                    receive(standbys[i - 1]);
+                    busy = true;
+                }
+            }
+        }
+
+        auto now = SteadyClock::now();
+        bool drained = true;
+        for (Standby& s : standbys) {
+            busy |= send(s, now);
+            drained = drained && (s.fd < 0 || !s.greeted || (s.out.empty() && s.next > newest));
+        }
+        standbys.erase(std::remove_if(standbys.begin(), standbys.end(), [](const Standby& s) { return s.fd < 0; }),
+                       standbys.end());
+
+        size_t greeted = 0;
+        uint64_t acked = UINT64_MAX;
+        for (const Standby& s : standbys) {
+            if (!s.greeted || s.closeWhenSent) continue;
+            greeted++;
+            acked = std::min(acked, s.acked);
+        }
+        standbys_.store(greeted, std::memory_order_release);
+        acknowledged_.store(greeted ? acked : 0, std::memory_order_release);
+
+        // On the way out, give standbys a heartbeat's time to take the rest
+        if (stopping_.load(std::memory_order_acquire) && ring_.empty()) {
+            if (stopDeadline == SteadyClock::time_point{}) stopDeadline = now + config_.heartbeat;
+            if (drained || now >= stopDeadline) break;
+        }
+        if (busy) {
+            waiter.reset();
+        } else {
+            waiter.idle();
+        }
+    }
+    for (Standby& s : standbys) close(s);
+    standbys_.store(0, std::memory_order_release);
+}
+
+// === Standby ===
+
+ReplicationStandby::ReplicationStandby(const ReplicationConfig& config, MatchingEngine& engine,
+                                       uint64_t appliedSequence, const TradeDigest& digest)
+    : config_(config)
+    , engine_(engine)
+    , digest_(digest)
+    , buffer_(sizeof(ReplicationFrame) + std::max<size_t>(config.maxBatch, 4096) * sizeof(JournalRecord))
+    , applied_(appliedSequence)
+{
+    addressOf(config_);   // throws for a bad address now, not on the standby thread
+}
+
+ReplicationStandby::~ReplicationStandby() {
+    promote();
+}
+
+void ReplicationStandby::start() {
+    if (thread_.joinable()) return;
+    thread_ = std::thread([this]() { run(); });
+}
+
+uint64_t ReplicationStandby::promote() {
+    stopping_.store(true, std::memory_order_release);
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    return applied();
+}
+
+void ReplicationStandby::run() {
+    sockaddr_in addr = addressOf(config_);
+    while (!stopping_.load(std::memory_order_acquire)) {
+        int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) return;
+        setNonBlocking(fd);
+
+        // Connect without blocking, so promote() never waits on a dead primary
+        bool up = ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0;
+        if (!up && errno == EINPROGRESS) {
+            pollfd p{fd, POLLOUT, 0};
+            int error = 0;
+            socklen_t length = sizeof(error);
+            up = ::poll(&p, 1, static_cast<int>(config_.reconnect.count())) == 1
+              && ::getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length) == 0 && error == 0;
+        }
+        bool again = true;
+        if (up) {
+            connects_.fetch_add(1, std::memory_order_relaxed);
+            connected_.store(true, std::memory_order_release);
+            again = follow(fd);
+            connected_.store(false, std::memory_order_release);
+        }
+        ::close(fd);
+        if (!again) return;
+        if (!up) std::this_thread::sleep_for(config_.reconnect);
+    }
+}
+
+bool ReplicationStandby::follow(int fd) {
+    ReplicationHello hello{};
+    std::memcpy(hello.magic, kReplicationMagic, sizeof(kReplicationMagic));
+    hello.nextSequence = applied() + 1;
+    hello.shape = EngineShape::of(engine_);
+    if (::send(fd, &hello, sizeof(hello), kSendFlags) != static_cast<ssize_t>(sizeof(hello))) return true;
+
+    size_t filled = 0;
+    int readsSinceStop = 0;
+    // The ack going out; a short send keeps its tail for the next pass, since
+    // the primary reassembles acks byte by byte
+    char ack[sizeof(uint64_t)];
+    size_t ackPos = sizeof(ack);
+    bool ackDue = false;
+    Waiter waiter(config_.wait);
+    while (true) {
+        bool stopping = stopping_.load(std::memory_order_acquire);
+        if (stopping && readsSinceStop++ == kStopReads) return false;
+        if (ackDue && ackPos == sizeof(ack)) {
+            uint64_t last = applied();
+            std::memcpy(ack, &last, sizeof(ack));
+            ackPos = 0;
+            ackDue = false;
+        }
+        while (ackPos < sizeof(ack)) {
+            ssize_t n = ::send(fd, ack + ackPos, sizeof(ack) - ackPos, kSendFlags);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                if (errno != EAGAIN && errno != EWOULDBLOCK) return !stopping;
+                break;
+            }
+            ackPos += static_cast<size_t>(n);
+        }
+        if (filled == buffer_.size()) buffer_.resize(buffer_.size() * 2);   // a frame bigger than the buffer
+        ssize_t n = ::recv(fd, buffer_.data() + filled, buffer_.size() - filled, MSG_DONTWAIT);
+        if (n > 0) {
+            filled += static_cast<size_t>(n);
+            long used = consume(filled);
+            if (used < 0) {
+                // A gap resumes on a new connection; divergence and refusal are final
+                return !diverged() && !refused() && !stopping;
+            }
+            std::memmove(buffer_.data(), buffer_.data() + used, filled - static_cast<size_t>(used));
+            filled -= static_cast<size_t>(used);
+            ackDue = true;   // sent on the next pass, once any earlier ack is out
+            waiter.reset();
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) return !stopping;
+        if (stopping) return false;   // everything that had arrived is applied
+        waiter.idle();
+    }
+}
+
+long ReplicationStandby::consume(size_t end) {
+    EventListener ignore;
+    DigestListener<EventListener> listener{ignore, digest_};
+    size_t pos = 0;
+    while (end - pos >= sizeof(ReplicationFrame)) {
+        ReplicationFrame frame;
+        std::memcpy(&frame, buffer_.data() + pos, sizeof(frame));
+        if (frame.count > kMaxFrameRecords) return -1;
+        size_t bytes = sizeof(frame) + frame.count * sizeof(JournalRecord);
+        if (end - pos < bytes) break;
+        primaryLast_.store(frame.primaryLast, std::memory_order_release);
+
+        if (frame.type == ReplicationFrameType::Refused) {
+            refusedByPrimary_.store(true, std::memory_order_release);
+            return -1;
+        }
+        const char* p = buffer_.data() + pos + sizeof(frame);
+        for (uint32_t i = 0; i < frame.count; ++i, p += sizeof(JournalRecord)) {
+            JournalRecord record;
+            std::memcpy(&record, p, sizeof(record));
+            uint64_t expected = applied() + 1;
+            if (record.sequence < expected) continue;   // already applied before a reconnect
+            if (record.sequence > expected) {
+                gaps_.fetch_add(1, std::memory_order_relaxed);
+                return -1;
+            }
+            bool accepted = false;
+            try {
+                accepted = engine_.submit(record.msg, listener);
+            } catch (const std::exception&) {
+            }
+            // Only accepted messages are streamed, so a rejection is a divergence too
+            if (!accepted || !(digest_ == record.digest)) {
+                diverged_.store(true, std::memory_order_release);
+                return -1;
+            }
+            applied_.store(record.sequence, std::memory_order_release);
+        }
+        pos += bytes;
+    }
+    return static_cast<long>(pos);
+}
+
+} // namespace engine
@@ -0,0 +1,116 @@
+#include "ShardedRunner.h"
+
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+
+namespace engine {
+
+ShardedRunner::Shard::Shard(SymbolId first, size_t symbols, const ShardConfig& config,
+                            const RunnerConfig& runnerConfig)
+    : firstSymbol(first)
+    , engine(config.poolSizePerShard, config.bookConfig, config.poolOptions, config.clock, symbols)
+    , runner(engine, runnerConfig)
+{}
+
+ShardedRunner::ShardedRunner(const ShardConfig& config)
+    : symbolCount_(config.symbolCount)
+{
+    if (config.shardCount == 0 || config.symbolCount < config.shardCount) {
+        throw std::invalid_argument("Need at least one shard and one symbol per shard");
+    }
+    // Each of these is single-threaded and tied to one engine; every shard would share it
+    const RunnerConfig& shared = config.runner;
+    if (shared.journal || shared.replication || shared.dropCopy || !shared.snapshotPath.empty()) {
+        throw std::invalid_argument("Sharded runners don't support a journal, replication, drop copy or snapshots");
+    }
+
+    symbolsPerShard_ = (config.symbolCount + config.shardCount - 1) / config.shardCount;
+    size_t shardCount = (config.symbolCount + symbolsPerShard_ - 1) / symbolsPerShard_;
+
+    shards_.reserve(shardCount);
+    for (size_t i = 0; i < shardCount; ++i) {
+        auto first = static_cast<SymbolId>(i * symbolsPerShard_);
+        size_t symbols = std::min(symbolsPerShard_, config.symbolCount - first);
+
+        RunnerConfig runnerConfig = config.runner;
+        if (runnerConfig.cpu >= 0) {
+            runnerConfig.cpu += static_cast<int>(i);
+        }
+
+        if (runnerConfig.cpu < 0) {
+            shards_.push_back(std::make_unique<Shard>(first, symbols, config, runnerConfig));
+            continue;
+        }
+
+        // Build the shard on its own core so its memory is local to it
+        std::unique_ptr<Shard> shard;
+        std::exception_ptr error;
+        std::thread builder([&]() {
+            pinCurrentThread(runnerConfig.cpu);
+            try {
+                shard = std::make_unique<Shard>(first, symbols, config, runnerConfig);
+            } catch (...) {
+                error = std::current_exception();
+            }
+        });
+        builder.join();
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        shards_.push_back(std::move(shard));
+    }
+}
+
+ShardedRunner::~ShardedRunner() {
+    stop();
+}
+
+void ShardedRunner::start() {
+    for (auto& shard : shards_) {
+        shard->runner.start();
+    }
+}
+
+void ShardedRunner::stop() {
+    for (auto& shard : shards_) {
+        shard->runner.stop();
+    }
+}
+
+size_t ShardedRunner::shardOf(SymbolId symbol) const {
+    if (symbol >= symbolCount_) {
+        throw std::out_of_range("Unknown symbol");
+    }
+    return symbol / symbolsPerShard_;
+}
+
+bool ShardedRunner::submit(const OrderMsg& msg) {
+    Shard& shard = *shards_[shardOf(msg.symbol)];
+    OrderMsg local = msg;
+    local.symbol -= shard.firstSymbol;
+    return shard.runner.submit(local);
+}
+
+bool ShardedRunner::poll(EngineEvent& event) {
+    for (size_t n = 0; n < shards_.size(); ++n) {
+        Shard& shard = *shards_[nextPoll_];
+        nextPoll_ = nextPoll_ + 1 == shards_.size() ? 0 : nextPoll_ + 1;
+        if (shard.runner.poll(event)) {
+            event.symbol += shard.firstSymbol;
+            return true;
+        }
+    }
+    return false;
+}
+
+uint64_t ShardedRunner::processed() const {
+    uint64_t total = 0;
+    for (const auto& shard : shards_) {
+        total += shard->runner.processed();
+    }
+    return total;
+}
+
+} // namespace engine
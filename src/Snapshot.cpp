@@ -0,0 +1,498 @@
+#include "Snapshot.h"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace engine {
+
+namespace {
+
+constexpr char kMagic[8] = {'M', 'E', 'S', 'N', 'A', 'P', '0', '1'};
+constexpr uint32_t kVersion = 4;   // 2: orders carry iceberg reserve and peak; 3: parked stops, last trade price, auction phase;
+                                   // 4: orders carry their account
+
+// === On-disk records (no pointers, no padding left uninitialized) ===
+
+struct SnapshotOrder {
+    uint32_t slot;
+    uint32_t prev;              // kNoSlot at the ends of the level
+    uint32_t next;
+    Quantity remaining;
+    OrderId id;
+    Price price;
+    SymbolId symbol;
+    Side side;
+    OrderType type;
+    uint16_t reserved;
+    Quantity originalQuantity;  // OrderMeta
+    Quantity hidden;            // iceberg reserve
+    int64_t timestampNs;
+    Quantity peak;
+    AccountId account;
+    Price stopPrice;
+};
+
+struct SnapshotLadder {
+    Price basePrice;
+    uint64_t capacity;
+    uint8_t anchored;
+    uint8_t reserved[7];
+};
+
+struct SnapshotBook {
+    SnapshotLadder bids;
+    SnapshotLadder asks;
+    Price lastTradePrice;       // what parked stops trigger against
+    uint8_t hasLastTrade;
+    uint8_t auction;            // in its call phase (the levels may cross)
+    uint8_t reserved[6];
+};
+
+struct SnapshotLevel {
+    SymbolId symbol;
+    Side side;
+    uint8_t stops;              // a level of parked stops, keyed by stop price
+    uint8_t reserved[2];
+    Price price;
+    uint32_t head;
+    uint32_t tail;
+    uint32_t orderCount;
+    Quantity totalQuantity;
+};
+
+struct SnapshotIndexEntry {
+    uint64_t position;
+    OrderId id;
+    uint64_t slot;
+};
+
+[[noreturn]] void throwErrno(int err, const char* what) {
+    throw std::system_error(err, std::generic_category(), what);
+}
+
+// Buffered writes to a file descriptor from a fixed buffer — no allocation,
+// so it can run in a child forked from a multi-threaded process
+class FdWriter {
+public:
+    explicit FdWriter(int fd) : fd_(fd) {}
+
+    void put(const void* data, size_t bytes) {
+        auto* p = static_cast<const char*>(data);
+        while (bytes > 0) {
+            size_t n = std::min(bytes, sizeof(buffer_) - used_);
+            std::memcpy(buffer_ + used_, p, n);
+            used_ += n;
+            p += n;
+            bytes -= n;
+            if (used_ == sizeof(buffer_)) drain();
+        }
+    }
+
+    // Returns 0 or the first errno hit
+    int finish() {
+        drain();
+        return error_;
+    }
+
+private:
+    int fd_;
+    int error_ = 0;
+    size_t used_ = 0;
+    char buffer_[64 * 1024];
+
+    void drain() {
+        size_t off = 0;
+        while (off < used_ && error_ == 0) {
+            ssize_t n = ::write(fd_, buffer_ + off, used_ - off);
+            if (n < 0) {
+                if (errno != EINTR) error_ = errno;
+                continue;
+            }
+            off += static_cast<size_t>(n);
+        }
+        used_ = 0;
+    }
+};
+
+} // namespace
+
+// Walks the engine's books, pool and index — a friend of MatchingEngine
+struct SnapshotAccess {
+    using Pool = OrderPool;
+
+    // Visit every non-empty level of every book as f(symbol, side, level, stops),
+    // parked stop levels (stops = true) after the book's own
+    template <typename F>
+    static void forEachLevel(const MatchingEngine& engine, F&& f) {
+        for (SymbolId s = 0; s < engine.books_.size(); ++s) {
+            const OrderBook& book = engine.books_[s];
+            for (const PriceLevel* level = book.bids().best(); level; level = book.bids().next(*level)) {
+                f(s, Side::Buy, *level, false);
+            }
+            for (const PriceLevel* level = book.asks().best(); level; level = book.asks().next(*level)) {
+                f(s, Side::Sell, *level, false);
+            }
+            for (const PriceLevel* level = book.buyStops().best(); level; level = book.buyStops().next(*level)) {
+                f(s, Side::Buy, *level, true);
+            }
+            for (const PriceLevel* level = book.sellStops().best(); level; level = book.sellStops().next(*level)) {
+                f(s, Side::Sell, *level, true);
+            }
+        }
+    }
+
+    // Lazily cancelled orders (remaining 0) are left out: the snapshot links
+    // each live order to its nearest live neighbours and lists dead slots as
+    // free, so a restored book starts compacted
+    static OrderSlot liveAfter(const Pool& pool, OrderSlot s) {
+        while (s != kNoSlot && pool.at(s)->remaining == 0) s = pool.at(s)->next;
+        return s;
+    }
+    static OrderSlot liveBefore(const Pool& pool, OrderSlot s) {
+        while (s != kNoSlot && pool.at(s)->remaining == 0) s = pool.at(s)->prev;
+        return s;
+    }
+
+    // Visit the dead orders still linked in the levels as f(slot)
+    template <typename F>
+    static void forEachDead(const MatchingEngine& engine, F&& f) {
+        const Pool& pool = engine.orderPool_;
+        forEachLevel(engine, [&](SymbolId, Side, const PriceLevel& level, bool) {
+            if (level.deadCount == 0) return;
+            for (OrderSlot s = level.head; s != kNoSlot; s = pool.at(s)->next) {
+                if (pool.at(s)->remaining == 0) f(s);
+            }
+        });
+    }
+
+    // Write the whole snapshot to fd — returns 0 or an errno, never throws or allocates
+    static int write(const MatchingEngine& engine, int fd, const SnapshotInfo& info) {
+        const Pool& pool = engine.orderPool_;
+
+        SnapshotHeader header{};
+        std::memcpy(header.magic, kMagic, sizeof(kMagic));
+        header.version = kVersion;
+        header.shape = EngineShape::of(engine);
+        header.info = info;
+        header.tradeCount = engine.tradeCount_;
+        header.orderCount = engine.orderCount_;
+        header.highWater = pool.highWater();
+
+        // Count first so every section's offset is known before writing
+        forEachLevel(engine, [&](SymbolId, Side, const PriceLevel& level, bool) {
+            header.levels++;
+            header.orders += level.orderCount;
+        });
+        pool.forEachFree([&](size_t) { header.freeSlots++; });
+        forEachDead(engine, [&](OrderSlot) { header.freeSlots++; });
+        header.indexEntries = engine.orderLookup_.size();
+
+        header.ordersOffset = sizeof(SnapshotHeader);
+        header.freeOffset = header.ordersOffset + header.orders * sizeof(SnapshotOrder);
+        // Free list is padded to 8 bytes so the sections after it stay aligned in the mapping
+        header.booksOffset = header.freeOffset + (header.freeSlots + 1) / 2 * 8;
+        header.levelsOffset = header.booksOffset + engine.books_.size() * sizeof(SnapshotBook);
+        header.indexOffset = header.levelsOffset + header.levels * sizeof(SnapshotLevel);
+        header.fileSize = header.indexOffset + header.indexEntries * sizeof(SnapshotIndexEntry);
+
+        FdWriter out(fd);
+        out.put(&header, sizeof(header));
+
+        forEachLevel(engine, [&](SymbolId, Side, const PriceLevel& level, bool) {
+            OrderSlot prev = kNoSlot;
+            for (OrderSlot s = liveAfter(pool, level.head); s != kNoSlot;) {
+                const Order* order = pool.at(s);
+                OrderSlot next = liveAfter(pool, order->next);
+                SnapshotOrder rec{};
+                rec.slot = order->slot;
+                rec.prev = prev;
+                rec.next = next;
+                rec.remaining = order->remaining;
+                rec.id = order->id;
+                rec.price = order->price;
+                rec.symbol = order->symbol;
+                rec.side = order->side;
+                rec.type = order->type;
+                rec.hidden = order->hidden;
+                rec.peak = order->peak;
+                rec.stopPrice = order->stopPrice;
+                rec.account = order->account;
+                const OrderMeta& meta = pool.cold(order);
+                rec.originalQuantity = meta.quantity;
+                rec.timestampNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    meta.timestamp.time_since_epoch()).count();
+                out.put(&rec, sizeof(rec));
+                prev = s;
+                s = next;
+            }
+        });
+
+        pool.forEachFree([&](size_t slot) {
+            auto rec = static_cast<uint32_t>(slot);
+            out.put(&rec, sizeof(rec));
+        });
+        forEachDead(engine, [&](OrderSlot slot) { out.put(&slot, sizeof(slot)); });
+        if (header.freeSlots % 2) {
+            uint32_t padding = 0;
+            out.put(&padding, sizeof(padding));
+        }
+
+        for (const OrderBook& book : engine.books_) {
+            SnapshotBook rec{};
+            rec.bids.basePrice = book.bids().basePrice();
+            rec.bids.capacity = book.bids().capacity();
+            rec.bids.anchored = book.bids().anchored();
+            rec.asks.basePrice = book.asks().basePrice();
+            rec.asks.capacity = book.asks().capacity();
+            rec.asks.anchored = book.asks().anchored();
+            rec.lastTradePrice = book.lastTradePrice().value_or(0);
+            rec.hasLastTrade = book.lastTradePrice().has_value();
+            rec.auction = book.inAuction();
+            out.put(&rec, sizeof(rec));
+        }
+
+        forEachLevel(engine, [&](SymbolId symbol, Side side, const PriceLevel& level, bool stops) {
+            SnapshotLevel rec{};
+            rec.symbol = symbol;
+            rec.side = side;
+            rec.stops = stops;
+            rec.price = level.price;
+            rec.head = liveAfter(pool, level.head);
+            rec.tail = liveBefore(pool, level.tail);
+            rec.orderCount = level.orderCount;
+            rec.totalQuantity = level.totalQuantity;
+            out.put(&rec, sizeof(rec));
+        });
+
+        engine.orderLookup_.forEach([&](size_t position, OrderId id, const Order* order) {
+            SnapshotIndexEntry rec{position, id, order->slot};
+            out.put(&rec, sizeof(rec));
+        });
+
+        return out.finish();
+    }
+
+    static void load(MatchingEngine& engine, const char* base, const SnapshotHeader& header) {
+        Pool& pool = engine.orderPool_;
+
+        auto* freeSlots = reinterpret_cast<const uint32_t*>(base + header.freeOffset);
+        for (uint64_t i = 0; i < header.freeSlots; ++i) {
+            if (freeSlots[i] >= header.highWater) throw std::runtime_error("Snapshot free list is corrupt");
+        }
+        pool.restore(header.highWater, freeSlots, header.freeSlots);
+
+        // Links are slot numbers already — only check they're in range
+        auto slot = [&](uint64_t index) -> OrderSlot {
+            if (index != kNoSlot && index >= header.highWater) throw std::runtime_error("Snapshot slot out of range");
+            return static_cast<OrderSlot>(index);
+        };
+        auto checkedSlot = [&](uint64_t index) -> OrderSlot {
+            if (slot(index) == kNoSlot) throw std::runtime_error("Snapshot slot out of range");
+            return static_cast<OrderSlot>(index);
+        };
+
+
+        auto* orders = reinterpret_cast<const SnapshotOrder*>(base + header.ordersOffset);
+        for (uint64_t i = 0; i < header.orders; ++i) {
+            const SnapshotOrder& rec = orders[i];
+            Order* order = new (pool.slotAt(checkedSlot(rec.slot))) Order(rec.id, rec.side, rec.type, rec.price, rec.remaining, rec.symbol);
+            order->hidden = rec.hidden;
+            order->peak = rec.peak;
+            order->stopPrice = rec.stopPrice;
+            order->account = rec.account;
+            order->slot = rec.slot;
+            order->generation = pool.generation(rec.slot);
+            order->prev = slot(rec.prev);
+            order->next = slot(rec.next);
+            pool.cold(order) = OrderMeta{rec.originalQuantity,
+                                         Timestamp(std::chrono::duration_cast<Timestamp::duration>(
+                                             std::chrono::nanoseconds(rec.timestampNs)))};
+        }
+
+        auto* books = reinterpret_cast<const SnapshotBook*>(base + header.booksOffset);
+        for (SymbolId s = 0; s < engine.books_.size(); ++s) {
+            const SnapshotBook& rec = books[s];
+            if (rec.bids.anchored) {
+                engine.books_[s].restoreWindow(Side::Buy, rec.bids.basePrice, rec.bids.capacity);
+            }
+            if (rec.asks.anchored) {
+                engine.books_[s].restoreWindow(Side::Sell, rec.asks.basePrice, rec.asks.capacity);
+            }
+            if (rec.hasLastTrade) {
+                engine.books_[s].restoreLastTrade(rec.lastTradePrice);
+            }
+            if (rec.auction) {
+                engine.books_[s].startAuction();
+            }
+        }
+
+        auto* levels = reinterpret_cast<const SnapshotLevel*>(base + header.levelsOffset);
+        for (uint64_t i = 0; i < header.levels; ++i) {
+            const SnapshotLevel& rec = levels[i];
+            if (rec.symbol >= engine.books_.size()) throw std::runtime_error("Snapshot level symbol out of range");
+            OrderBook& book = engine.books_[rec.symbol];
+            if (rec.stops) {
+                book.restoreStopLevel(rec.side, rec.price, slot(rec.head), slot(rec.tail), rec.orderCount, rec.totalQuantity);
+            } else {
+                book.restoreLevel(rec.side, rec.price, slot(rec.head), slot(rec.tail), rec.orderCount, rec.totalQuantity);
+            }
+        }
+
+        auto* index = reinterpret_cast<const SnapshotIndexEntry*>(base + header.indexOffset);
+        for (uint64_t i = 0; i < header.indexEntries; ++i) {
+            engine.orderLookup_.restoreAt(index[i].position, index[i].id, pool.at(checkedSlot(index[i].slot)));
+        }
+
+        engine.tradeCount_ = header.tradeCount;
+        engine.orderCount_ = header.orderCount;
+    }
+};
+
+namespace {
+
+// Write to path.tmp, fsync, rename — returns 0 or an errno; no allocation
+int writeSnapshotFile(const MatchingEngine& engine, const char* tmpPath, const char* path, const SnapshotInfo& info) {
+    int fd = ::open(tmpPath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return errno;
+
+    int err = SnapshotAccess::write(engine, fd, info);
+    if (err == 0 && ::fsync(fd) != 0) err = errno;
+    ::close(fd);
+    if (err == 0 && ::rename(tmpPath, path) != 0) err = errno;
+    if (err != 0) ::unlink(tmpPath);
+    return err;
+}
+
+} // namespace
+
+void writeSnapshot(const MatchingEngine& engine, const std::string& path, const SnapshotInfo& info) {
+    std::string tmpPath = path + ".tmp";
+    if (int err = writeSnapshotFile(engine, tmpPath.c_str(), path.c_str(), info)) {
+        throwErrno(err, "Snapshot write failed");
+    }
+}
+
+pid_t forkSnapshot(const MatchingEngine& engine, const std::string& path, const SnapshotInfo& info) {
+    std::string tmpPath = path + ".tmp";   // built before fork — the child must not allocate
+    pid_t child = ::fork();
+    if (child < 0) {
+        throwErrno(errno, "fork for snapshot failed");
+    }
+    if (child == 0) {
+        int err = writeSnapshotFile(engine, tmpPath.c_str(), path.c_str(), info);
+        ::_exit(err == 0 ? 0 : 1);   // no atexit handlers, no flushing the parent's stdio buffers
+    }
+    return child;
+}
+
+std::optional<bool> pollSnapshot(pid_t child, bool wait) {
+    int status = 0;
+    pid_t r;
+    do {
+        r = ::waitpid(child, &status, wait ? 0 : WNOHANG);
+    } while (r < 0 && errno == EINTR);
+    if (r == 0) return std::nullopt;
+    if (r < 0) return false;
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+LoadedSnapshot loadSnapshot(const std::string& path, const Clock& clock) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throwErrno(errno, "Cannot open snapshot");
+    }
+    struct stat st{};
+    if (::fstat(fd, &st) != 0) {
+        int err = errno;
+        ::close(fd);
+        throwErrno(err, "Cannot stat snapshot");
+    }
+    auto size = static_cast<size_t>(st.st_size);
+    if (size < sizeof(SnapshotHeader)) {
+        ::close(fd);
+        throw std::runtime_error("Not a snapshot file: " + path);
+    }
+
+    // Map it and fault it all in with one sequential read-ahead
+    int flags = MAP_PRIVATE;
+#if defined(MAP_POPULATE)
+    flags |= MAP_POPULATE;
+#endif
+    void* data = ::mmap(nullptr, size, PROT_READ, flags, fd, 0);
+    int err = errno;
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        throwErrno(err, "Cannot map snapshot");
+    }
+
+    LoadedSnapshot result;
+    try {
+        const char* base = static_cast<const char*>(data);
+        SnapshotHeader header;
+        std::memcpy(&header, base, sizeof(header));
+        if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion) {
+            throw std::runtime_error("Not a snapshot file (or written by an incompatible version): " + path);
+        }
+        if (header.fileSize != size
+            || header.indexOffset + header.indexEntries * sizeof(SnapshotIndexEntry) != size
+            || header.booksOffset + header.shape.symbolCount * sizeof(SnapshotBook) != header.levelsOffset) {
+            throw std::runtime_error("Snapshot is truncated or corrupt: " + path);
+        }
+
+        result.engine = header.shape.makeEngine(clock);
+        result.info = header.info;
+        SnapshotAccess::load(*result.engine, base, header);
+    } catch (...) {
+        ::munmap(data, size);
+        throw;
+    }
+    ::munmap(data, size);
+    return result;
+}
+
+Recovery recover(const std::string& snapshotPath, const std::string& journalPath, const Clock& clock,
+                 RiskTable* risk) {
+    Recovery result;
+    bool haveSnapshot = !snapshotPath.empty() && ::access(snapshotPath.c_str(), F_OK) == 0;
+    bool haveJournal = !journalPath.empty() && ::access(journalPath.c_str(), F_OK) == 0;
+    if (!haveSnapshot && !haveJournal) {
+        throw std::runtime_error("Nothing to recover from: no snapshot and no journal");
+    }
+
+    if (haveSnapshot) {
+        LoadedSnapshot loaded = loadSnapshot(snapshotPath, clock);
+        result.engine = std::move(loaded.engine);
+        result.snapshot = loaded.info;
+        result.fromSnapshot = true;
+        if (risk) result.engine->enforceRisk(risk);
+    }
+    if (!haveJournal) {
+        result.tail.digest = result.snapshot.digest;
+        return result;
+    }
+
+    JournalReader reader(journalPath);
+    if (!result.engine) {
+        result.engine = reader.header().shape.makeEngine(clock);
+        if (risk) result.engine->enforceRisk(risk);
+    } else if (!(reader.header().shape == EngineShape::of(*result.engine))) {
+        throw std::runtime_error("Snapshot and journal were written by differently configured engines");
+    }
+
+    EventListener ignore;
+    result.tail = replayJournal(reader, *result.engine, ignore, result.snapshot.journalSequence, result.snapshot.digest);
+    if (!result.tail.matched) {
+        throw std::runtime_error("Journal replay diverged at record " + std::to_string(result.tail.mismatchSequence));
+    }
+    return result;
+}
+
+} // namespace engine
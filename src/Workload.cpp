@@ -0,0 +1,196 @@
+#include "Workload.h"
+#include "Journal.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <system_error>
+
+namespace engine {
+
+namespace {
+
+// Inverse-CDF sampling of d in 1..n with P(d) ∝ 1/d^s
+class ZipfDistance {
+public:
+    ZipfDistance(uint32_t n, double exponent) : cdf_(n) {
+        double sum = 0;
+        for (uint32_t d = 1; d <= n; ++d) {
+            sum += 1.0 / std::pow(static_cast<double>(d), exponent);
+            cdf_[d - 1] = sum;
+        }
+        for (double& c : cdf_) c /= sum;
+    }
+
+    template <typename Rng>
+    uint32_t operator()(Rng& rng) {
+        double u = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+        auto it = std::lower_bound(cdf_.begin(), cdf_.end(), u);
+        return static_cast<uint32_t>(std::min<size_t>(it - cdf_.begin(), cdf_.size() - 1)) + 1;
+    }
+
+private:
+    std::vector<double> cdf_;
+};
+
+struct LiveOrder {
+    OrderId id;
+    SymbolId symbol;
+    Side side;
+    Price price;
+    Quantity qty;
+};
+
+void throwErrno(const std::string& what, const std::string& path) {
+    throw std::system_error(errno, std::generic_category(), what + " " + path);
+}
+
+} // namespace
+
+Workload generateWorkload(const WorkloadConfig& config) {
+    if (config.symbols == 0 || config.maxDistance == 0 || config.minQty == 0 || config.maxQty < config.minQty) {
+        throw std::invalid_argument("Invalid workload configuration");
+    }
+    double totalWeight = config.newWeight + config.cancelWeight + config.modifyWeight + config.marketWeight;
+    if (totalWeight <= 0) {
+        throw std::invalid_argument("Workload mix needs a positive weight");
+    }
+
+    std::mt19937_64 rng(config.seed);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::uniform_int_distribution<Quantity> qtyDist(config.minQty, config.maxQty);
+    ZipfDistance distance(config.maxDistance, config.zipfExponent);
+
+    Workload workload;
+    workload.messages.reserve(config.initialDepth + config.messages);
+    workload.arrivalNs.reserve(config.initialDepth + config.messages);
+
+    std::vector<LiveOrder> live;
+    live.reserve(config.initialDepth + config.messages);
+    OrderId nextId = 1;
+    double clockNs = 0;
+    size_t burstLeft = 0;
+
+    auto arrive = [&]() {
+        double rate = config.calmRate;
+        if (burstLeft > 0) {
+            rate = config.burstRate;
+            burstLeft--;
+        } else if (unit(rng) < config.burstChance) {
+            // Geometric burst length with the configured mean
+            burstLeft = static_cast<size_t>(std::ceil(-std::log(1.0 - unit(rng)) * static_cast<double>(config.burstLength)));
+        }
+        clockNs += -std::log(1.0 - unit(rng)) * 1e9 / rate;   // exponential gap
+        workload.arrivalNs.push_back(static_cast<uint64_t>(clockNs));
+    };
+
+    auto newOrder = [&]() {
+        auto symbol = static_cast<SymbolId>(rng() % config.symbols);
+        Side side = rng() & 1 ? Side::Buy : Side::Sell;
+        Price offset = static_cast<Price>(distance(rng));
+        Price price = side == Side::Buy ? config.mid - offset : config.mid + offset;
+        Quantity qty = qtyDist(rng);
+        workload.messages.push_back(OrderMsg::limit(nextId, side, price, qty, symbol));
+        live.push_back({nextId++, symbol, side, price, qty});
+    };
+
+    for (size_t i = 0; i < config.initialDepth; ++i) {
+        newOrder();
+        workload.arrivalNs.push_back(0);
+    }
+    workload.warmup = config.initialDepth;
+
+    double newEnd = config.newWeight / totalWeight;
+    double cancelEnd = newEnd + config.cancelWeight / totalWeight;
+    double modifyEnd = cancelEnd + config.modifyWeight / totalWeight;
+
+    for (size_t i = 0; i < config.messages; ++i) {
+        arrive();
+        double roll = unit(rng);
+        if (roll < newEnd || (roll < modifyEnd && live.empty())) {
+            newOrder();
+        } else if (roll < cancelEnd) {
+            size_t pick = rng() % live.size();
+            workload.messages.push_back(OrderMsg::cancel(live[pick].id, live[pick].symbol));
+            live[pick] = live.back();
+            live.pop_back();
+        } else if (roll < modifyEnd) {
+            // Half amend-downs (keep priority), half one-tick reprices that stay off the mid
+            LiveOrder& order = live[rng() % live.size()];
+            if (rng() & 1 && order.qty > 1) {
+                order.qty /= 2;
+            } else if (order.side == Side::Buy) {
+                order.price += order.price < config.mid - 1 ? 1 : -1;
+            } else {
+                order.price += order.price > config.mid + 1 ? -1 : 1;
+            }
+            workload.messages.push_back(OrderMsg::modify(order.id, order.price, order.qty, order.symbol));
+        } else {
+            auto symbol = static_cast<SymbolId>(rng() % config.symbols);
+            Side side = rng() & 1 ? Side::Buy : Side::Sell;
+            workload.messages.push_back(OrderMsg::market(nextId++, side, qtyDist(rng), symbol));
+        }
+    }
+    return workload;
+}
+
+void saveWorkload(const Workload& workload, const std::string& path) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) throwErrno("Can't create", path);
+
+    WorkloadHeader header{};
+    std::memcpy(header.magic, kWorkloadMagic, sizeof(kWorkloadMagic));
+    header.messages = workload.messages.size();
+    header.warmup = workload.warmup;
+    header.recordSize = sizeof(OrderMsg);
+    header.timed = workload.arrivalNs.size() == workload.messages.size() && !workload.messages.empty();
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(workload.messages.data()),
+              static_cast<std::streamsize>(workload.messages.size() * sizeof(OrderMsg)));
+    if (header.timed) {
+        out.write(reinterpret_cast<const char*>(workload.arrivalNs.data()),
+                  static_cast<std::streamsize>(workload.arrivalNs.size() * sizeof(uint64_t)));
+    }
+    if (!out.flush()) throwErrno("Can't write", path);
+}
+
+Workload loadWorkload(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) throwErrno("Can't open", path);
+
+    WorkloadHeader header{};
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    Workload workload;
+
+    if (in && std::memcmp(header.magic, kWorkloadMagic, sizeof(kWorkloadMagic)) == 0) {
+        if (header.recordSize != sizeof(OrderMsg)) {
+            throw std::runtime_error("Workload file written with a different message layout: " + path);
+        }
+        workload.warmup = header.warmup;
+        workload.messages.resize(header.messages);
+        in.read(reinterpret_cast<char*>(workload.messages.data()),
+                static_cast<std::streamsize>(header.messages * sizeof(OrderMsg)));
+        if (header.timed) {
+            workload.arrivalNs.resize(header.messages);
+            in.read(reinterpret_cast<char*>(workload.arrivalNs.data()),
+                    static_cast<std::streamsize>(header.messages * sizeof(uint64_t)));
+        }
+        if (!in) throw std::runtime_error("Truncated workload file: " + path);
+        return workload;
+    }
+
+    // Not a workload file — try it as a journal (JournalReader throws if it isn't one either)
+    in.close();
+    JournalReader reader(path);
+    JournalRecord record;
+    while (reader.next(record)) {
+        workload.messages.push_back(record.msg);
+    }
+    return workload;
+}
+
+} // namespace engine
@@ -0,0 +1,107 @@
+#include "Backtest.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace engine;
+
+// Replay days of recorded flow (journals or saved workloads), split by
+// symbol across a pool of workers, and report the merged result
+//
+//   backtest [options] <file>...
+//     --threads N       workers (default: one per hardware thread)
+//     --scaling         run with 1, 2, 4, ... 64 workers (capped at the
+//                       hardware threads) and report the scaling efficiency
+//     --max-threads N   cap for --scaling instead of the hardware threads
+//     --pool N          each worker's first pool size (default 65536, grows)
+namespace {
+
+[[noreturn]] void usage(const char* argv0) {
+    std::cerr << "usage: " << argv0 << " [--threads N] [--scaling] [--max-threads N] [--pool N] <file>...\n";
+    std::exit(2);
+}
+
+void printRun(const BacktestResult& r) {
+    std::printf("  %3zu threads: %12.0f msgs/sec  (split %.3fs, replay %.3fs, merge %.3fs, %llu steals)\n",
+                r.threads, r.messagesPerSecond(), r.splitSeconds, r.replaySeconds, r.mergeSeconds,
+                static_cast<unsigned long long>(r.steals));
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    BacktestConfig config;
+    config.keepTrades = false;
+    bool scaling = false;
+    size_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--scaling") {
+            scaling = true;
+        } else if (arg.rfind("--", 0) == 0) {
+            if (i + 1 >= argc) usage(argv[0]);
+            std::string value = argv[++i];
+            if (arg == "--threads") config.threads = std::stoull(value);
+            else if (arg == "--max-threads") maxThreads = std::stoull(value);
+            else if (arg == "--pool") config.poolSize = std::stoull(value);
+            else usage(argv[0]);
+        } else {
+            files.push_back(arg);
+        }
+    }
+    if (files.empty()) usage(argv[0]);
+
+    try {
+        // Books like the recording engine's, if the first day is a journal;
+        // the ID index is sized from each worker's pool, not the original's
+        try {
+            JournalReader reader(files[0]);
+            config.book = reader.header().shape.bookConfig();
+            if (config.book.indexMode == IndexMode::Hashed) config.book.maxOrders = 0;
+        } catch (const std::runtime_error&) {
+            // A workload file — default books
+        }
+
+        if (!scaling) {
+            BacktestResult r = runBacktest(files, config);
+            std::cout << "Backtest: " << files.size() << " days, " << r.tasks << " symbol-days\n"
+                      << "  messages: " << r.messages << " (" << r.rejected << " rejected)\n"
+                      << "  trades:   " << r.digest.count << " (digest " << std::hex << r.digest.hash << std::dec
+                      << ")\n";
+            printRun(r);
+            return 0;
+        }
+
+        std::cout << "Backtest scaling: " << files.size() << " days\n";
+        BacktestResult first;
+        bool same = true;
+        for (size_t threads = 1; threads <= std::min<size_t>(maxThreads, 64); threads *= 2) {
+            config.threads = threads;
+            BacktestResult r = runBacktest(files, config);
+            if (threads == 1) {
+                first = r;
+                std::cout << "  " << r.tasks << " symbol-days, " << r.messages << " messages, " << r.digest.count
+                          << " trades (digest " << std::hex << r.digest.hash << std::dec << ")\n";
+            }
+            same = same && r.digest == first.digest;
+            printRun(r);
+            double speedup = r.messagesPerSecond() / first.messagesPerSecond();
+            std::printf("               speedup %.2fx, efficiency %.0f%%\n", speedup,
+                        100.0 * speedup / static_cast<double>(threads));
+        }
+        if (!same) {
+            std::cout << "MISMATCH — runs with different thread counts traded differently\n";
+            return 1;
+        }
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "backtest: " << e.what() << "\n";
+        return 2;
+    }
+}
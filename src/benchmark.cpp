@@ -1,4 +1,14 @@
 #include "MatchingEngine.h"
+#include "EngineRunner.h"
+#include "ShardedRunner.h"
+#include "Journal.h"
+#include "Snapshot.h"
+#include "MarketData.h"
+#include "Instrumentation.h"
+#include "Workload.h"
+#include "Backtest.h"
+#include "Replication.h"
+#include "DropCopy.h"
 #include <iostream>
 #include <chrono>
 #include <random>
@@ -6,9 +16,40 @@
 #include <algorithm>
 #include <numeric>
 #include <iomanip>
+#include <memory>
+#include <list>
+#include <unordered_map>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <thread>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <malloc.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 
 using namespace engine;
 
+// Count every heap allocation so benchmarks can report allocations per order
+static std::atomic<size_t> g_allocations{0};
+
+// noinline keeps GCC from pairing the inlined malloc/free and warning about new/delete mismatch
+[[gnu::noinline]] void* operator new(size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size)) return p;
+    throw std::bad_alloc();
+}
+
+[[gnu::noinline]] void operator delete(void* p) noexcept { std::free(p); }
+[[gnu::noinline]] void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+size_t allocationCount() { return g_allocations.load(std::memory_order_relaxed); }
+
 // Helper to measure a single operation in nanoseconds
 template <typename Func>
 long long timeNs(Func&& f) {
@@ -39,6 +80,61 @@ void printStats(const std::string& label, std::vector<long long>& latencies) {
     std::cout << "\n";
 }
 
+// User-space instruction and branch-miss counters for this thread
+// Unavailable (ok() false) without PMU access — VMs, or perf_event_paranoid > 2.
+class HwCounters {
+public:
+    HwCounters() {
+        instructions_ = open(PERF_COUNT_HW_INSTRUCTIONS, -1);
+        if (instructions_ >= 0) branchMisses_ = open(PERF_COUNT_HW_BRANCH_MISSES, instructions_);
+    }
+    ~HwCounters() {
+        if (branchMisses_ >= 0) close(branchMisses_);
+        if (instructions_ >= 0) close(instructions_);
+    }
+
+    bool ok() const { return instructions_ >= 0 && branchMisses_ >= 0; }
+
+    void start() {
+        if (!ok()) return;
+        ioctl(instructions_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(instructions_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+    void stop() {
+        if (!ok()) return;
+        ioctl(instructions_, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+        if (::read(instructions_, &instructionCount, sizeof(instructionCount)) != sizeof(instructionCount)
+            || ::read(branchMisses_, &branchMissCount, sizeof(branchMissCount)) != sizeof(branchMissCount)) {
+            instructionCount = branchMissCount = 0;
+        }
+    }
+
+    uint64_t instructionCount = 0;
+    uint64_t branchMissCount = 0;
+
+private:
+    int instructions_ = -1;
+    int branchMisses_ = -1;
+
+    static int open(uint64_t config, int group) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = config;
+        attr.disabled = group < 0;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group, 0));
+    }
+};
+
+// Listener that only counts trades — what a caller with its own trade handling looks like
+struct TradeCounter : EventListener {
+    size_t trades = 0;
+    void onTrade(const Trade&) { trades++; }
+};
+
 int main() {
     const int NUM_ORDERS = 1'000'000;
     std::mt19937 rng(42);
@@ -71,6 +167,67 @@ int main() {
         std::cout << "  Throughput: " << static_cast<int>(ordersPerSec) << " orders/sec\n\n";
     }
 
+    // ============================================================
+    // BENCHMARK 1b: Batched throughput
+    // ============================================================
+    // The same kind of flow as Benchmark 1 plus cancels, through submitBatch
+    // at several batch sizes, against one submit() per message. Events go to
+    // one reserved EventBuffer in both cases.
+    std::cout << "=== Benchmark 1b: Batched Throughput ===\n\n";
+    {
+        rng.seed(42);
+        std::vector<OrderMsg> flow;
+        flow.reserve(NUM_ORDERS);
+        for (int i = 0; i < NUM_ORDERS; ++i) {
+            if (i > 0 && rng() % 5 == 0) {
+                flow.push_back(OrderMsg::cancel(static_cast<OrderId>(rng() % i)));
+                continue;
+            }
+            Side side = sideDist(rng) == 0 ? Side::Buy : Side::Sell;
+            flow.push_back(OrderMsg::limit(static_cast<OrderId>(i), side, priceDist(rng), qtyDist(rng)));
+        }
+
+        std::vector<EngineEvent> events;
+        events.reserve(1 << 16);
+
+        auto report = [&](const std::string& label, long long us, uint64_t trades) {
+            double msgsPerSec = (static_cast<double>(NUM_ORDERS) / us) * 1'000'000;
+            std::cout << "  " << std::left << std::setw(16) << label << std::right
+                      << std::setw(6) << us / 1000 << " ms  "
+                      << std::setw(9) << static_cast<int>(msgsPerSec) << " msgs/sec  ("
+                      << trades << " trades)\n";
+        };
+
+        {
+            MatchingEngine engine;
+            EventBuffer sink(engine.clock(), events);
+            auto start = std::chrono::high_resolution_clock::now();
+            for (size_t i = 0; i < flow.size(); ++i) {
+                if (!engine.submit(flow[i], sink)) sink.onRejected(flow[i]);
+                if (events.size() > 60'000) events.clear();
+            }
+            auto end = std::chrono::high_resolution_clock::now();
+            report("per message", std::chrono::duration_cast<std::chrono::microseconds>(end - start).count(),
+                   engine.totalTrades());
+        }
+
+        for (size_t batchSize : {1, 16, 64, 256, 1024}) {
+            MatchingEngine engine;
+            EventBuffer sink(engine.clock(), events);
+            events.clear();
+            auto start = std::chrono::high_resolution_clock::now();
+            for (size_t i = 0; i < flow.size(); i += batchSize) {
+                size_t n = std::min(batchSize, flow.size() - i);
+                engine.submitBatch(std::span<const OrderMsg>(flow.data() + i, n), sink);
+                events.clear();
+            }
+            auto end = std::chrono::high_resolution_clock::now();
+            report("batch " + std::to_string(batchSize),
+                   std::chrono::duration_cast<std::chrono::microseconds>(end - start).count(), engine.totalTrades());
+        }
+        std::cout << "\n";
+    }
+
     // ============================================================
     // BENCHMARK 2: Per-operation latency distribution
     // ============================================================
@@ -170,7 +327,7 @@ int main() {
     }
 
     // ============================================================
-    // BENCHMARK 5: Impact of book depth on std::map
+    // BENCHMARK 5: Impact of book depth on the price ladder
     // ============================================================
     std::cout << "=== Benchmark 5: Impact of Book Depth ===\n\n";
     {
@@ -203,5 +360,1837 @@ int main() {
         std::cout << "\n";
     }
 
+    // ============================================================
+    // BENCHMARK 6: Heap allocations per resting order
+    // ============================================================
+    std::cout << "=== Benchmark 6: Allocations per Resting Order ===\n\n";
+    {
+        const int N = 100'000;
+
+        // Before: PriceLevel kept a std::list<Order*> — one node per resting order
+        OrderPool pool(N);
+        std::vector<Order*> orders;
+        orders.reserve(N);
+        for (int i = 0; i < N; ++i) {
+            orders.push_back(acquireOrder(pool, i, Side::Buy, OrderType::Limit, 9000 + (i % 100), 50));
+        }
+        std::list<Order*> listQueue;
+        size_t before = allocationCount();
+        for (Order* order : orders) {
+            listQueue.push_back(order);
+        }
+        size_t listAllocs = allocationCount() - before;
+
+        // After: intrusive FIFO through Order::prev/next — resting an order is just slot writes
+        PriceLevel level(9000);
+        before = allocationCount();
+        for (Order* order : orders) {
+            level.addOrder(order, pool);
+        }
+        size_t intrusiveAllocs = allocationCount() - before;
+
+        // Whole engine path (level FIFO plus ID lookup)
+        MatchingEngine engine;
+        for (int i = 0; i < 100; ++i) {
+            engine.submitLimit(static_cast<OrderId>(N + i), Side::Buy, 9000 + i, 50); // create the levels
+        }
+        before = allocationCount();
+        for (int i = 0; i < N; ++i) {
+            engine.submitLimit(static_cast<OrderId>(i), Side::Buy, 9000 + (i % 100), 50);
+        }
+        size_t engineAllocs = allocationCount() - before;
+
+        std::cout << std::fixed << std::setprecision(2);
+        std::cout << "  Resting " << N << " orders:\n";
+        std::cout << "    std::list<Order*> FIFO: " << static_cast<double>(listAllocs) / N << " allocs/order\n";
+        std::cout << "    Intrusive FIFO:         " << static_cast<double>(intrusiveAllocs) / N << " allocs/order\n";
+        std::cout << "    Engine submitLimit:     " << static_cast<double>(engineAllocs) / N << " allocs/order\n\n";
+    }
+
+    // ============================================================
+    // BENCHMARK 7: Order ID index
+    // ============================================================
+    std::cout << "=== Benchmark 7: Order ID Index ===\n\n";
+    {
+        const int N = 1'000'000;
+        const int LIVE = 100'000;   // orders resting at once — ids roll forward like real flow
+
+        std::mt19937_64 idRng(7);
+        for (bool sequential : {true, false}) {
+            std::vector<OrderId> ids(N);
+            for (int i = 0; i < N; ++i) {
+                ids[i] = sequential ? static_cast<OrderId>(i) : idRng();
+            }
+            OrderPool pool(N);
+            std::vector<Order*> orders;
+            orders.reserve(N);
+            for (int i = 0; i < N; ++i) {
+                orders.push_back(acquireOrder(pool, ids[i], Side::Buy, OrderType::Limit, 10000, 50));
+            }
+
+            std::cout << "  --- " << (sequential ? "Sequential" : "Random") << " ids ---\n";
+
+            // Each op = insert a new id and erase the one LIVE ids back
+            std::vector<long long> latencies;
+            latencies.reserve(N);
+            {
+                std::unordered_map<OrderId, Order*> map;
+                for (int i = 0; i < N; ++i) {
+                    latencies.push_back(timeNs([&]() {
+                        map[ids[i]] = orders[i];
+                        if (i >= LIVE) map.erase(ids[i - LIVE]);
+                    }));
+                }
+                printStats("std::unordered_map insert+erase", latencies);
+            }
+
+            for (IndexMode mode : {IndexMode::Hashed, IndexMode::Direct}) {
+                if (mode == IndexMode::Direct && !sequential) continue;
+                OrderIndex index(pool, LIVE * 2, mode);
+                latencies.clear();
+                for (int i = 0; i < N; ++i) {
+                    latencies.push_back(timeNs([&]() {
+                        index.insert(ids[i], orders[i]);
+                        if (i >= LIVE) index.erase(ids[i - LIVE]);
+                    }));
+                }
+                printStats(mode == IndexMode::Hashed ? "OrderIndex (hashed) insert+erase"
+                                                     : "OrderIndex (direct) insert+erase", latencies);
+            }
+        }
+    }
+
+    // ============================================================
+    // BENCHMARK 8: std::vector<Trade> API vs listener API
+    // ============================================================
+    std::cout << "=== Benchmark 8: Vector API vs Listener API ===\n\n";
+    {
+        // Same flow as Benchmark 1, run once untimed per order for throughput
+        // and once with per-order timing for the latency distribution
+        for (bool useListener : {false, true}) {
+            const char* label = useListener ? "Listener API" : "Vector API";
+
+            MatchingEngine engine;
+            TradeCounter counter;
+            rng.seed(42);
+            size_t allocsBefore = allocationCount();
+            auto start = std::chrono::high_resolution_clock::now();
+            for (int i = 0; i < NUM_ORDERS; ++i) {
+                Side side = sideDist(rng) == 0 ? Side::Buy : Side::Sell;
+                Price price = priceDist(rng);
+                Quantity qty = qtyDist(rng);
+                if (useListener) {
+                    engine.submitLimit(static_cast<OrderId>(i), side, price, qty, counter);
+                } else {
+                    engine.submitLimit(static_cast<OrderId>(i), side, price, qty);
+                }
+            }
+            auto end = std::chrono::high_resolution_clock::now();
+            size_t allocs = allocationCount() - allocsBefore;
+            auto durationUs = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+
+            std::cout << "  " << label << ":\n";
+            std::cout << "    Throughput: " << static_cast<int>((static_cast<double>(NUM_ORDERS) / durationUs) * 1'000'000) << " orders/sec\n";
+            std::cout << "    Allocs:     " << std::fixed << std::setprecision(2)
+                      << static_cast<double>(allocs) / NUM_ORDERS << " per order\n\n";
+
+            MatchingEngine timedEngine;
+            std::vector<long long> latencies;
+            latencies.reserve(NUM_ORDERS);
+            rng.seed(42);
+            for (int i = 0; i < NUM_ORDERS; ++i) {
+                Side side = sideDist(rng) == 0 ? Side::Buy : Side::Sell;
+                Price price = priceDist(rng);
+                Quantity qty = qtyDist(rng);
+                latencies.push_back(timeNs([&]() {
+                    if (useListener) {
+                        timedEngine.submitLimit(static_cast<OrderId>(i), side, price, qty, counter);
+                    } else {
+                        timedEngine.submitLimit(static_cast<OrderId>(i), side, price, qty);
+                    }
+                }));
+            }
+            printStats(std::string(label) + " latency", latencies);
+        }
+    }
+
+    // ============================================================
+    // BENCHMARK 9: Pool page backing on a deep book
+    // ============================================================
+    std::cout << "=== Benchmark 9: Pool Page Backing ===\n\n";
+    {
+        const int BOOK = 1'000'000;
+        const int CANCELS = 200'000;
+
+        struct Variant {
+            const char* label;
+            PageBacking backing;
+            bool prefault;
+        };
+        const Variant variants[] = {
+            {"4K heap",               PageBacking::Heap,            false},
+            {"4K heap, prefaulted",   PageBacking::Heap,            true},
+            {"THP, prefaulted",       PageBacking::TransparentHuge, true},
+            {"HugeTLB, prefaulted",   PageBacking::HugeTlb,         true},
+        };
+
+        for (const Variant& v : variants) {
+            PoolOptions options;
+            options.backing = v.backing;
+            options.prefault = v.prefault;
+            options.numaNode = PoolOptions::kLocalNumaNode;
+            MatchingEngine engine(2'000'000, {}, options);
+
+            // Deep, non-crossing book spread over 20k levels per side
+            std::mt19937 bookRng(9);
+            std::uniform_int_distribution<Price> offsetDist(1, 20'000);
+            auto start = std::chrono::high_resolution_clock::now();
+            for (int i = 0; i < BOOK; ++i) {
+                if (i % 2 == 0) {
+                    engine.submitLimit(static_cast<OrderId>(i), Side::Buy, 50'000 - offsetDist(bookRng), 10);
+                } else {
+                    engine.submitLimit(static_cast<OrderId>(i), Side::Sell, 50'000 + offsetDist(bookRng), 10);
+                }
+            }
+            auto end = std::chrono::high_resolution_clock::now();
+            auto buildNs = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+
+            // Cancels hit random orders all over the pool — TLB-bound
+            std::vector<OrderId> ids(BOOK);
+            std::iota(ids.begin(), ids.end(), OrderId{0});
+            std::shuffle(ids.begin(), ids.end(), bookRng);
+            std::vector<long long> latencies;
+            latencies.reserve(CANCELS);
+            for (int i = 0; i < CANCELS; ++i) {
+                latencies.push_back(timeNs([&]() { engine.cancel(ids[i]); }));
+            }
+
+            const char* actual = engine.poolBacking() == PageBacking::HugeTlb ? "HugeTLB"
+                               : engine.poolBacking() == PageBacking::TransparentHuge ? "THP" : "4K heap";
+            std::cout << "  " << v.label << " (got " << actual << "): build "
+                      << buildNs / BOOK << " ns/order\n";
+            printStats("Random cancel", latencies);
+        }
+    }
+
+    // ============================================================
+    // BENCHMARK 10: Order layout and deep-level match loop
+    // ============================================================
+    std::cout << "=== Benchmark 10: Order Layout ===\n\n";
+    {
+        // How many of every 8 consecutive orders in an array cross a line boundary
+        auto straddling = [](size_t size) {
+            int count = 0;
+            for (size_t i = 0; i < 8; ++i) {
+                size_t offset = (i * size) % kCacheLineSize;
+                if (offset + std::min(size, kCacheLineSize) > kCacheLineSize) count++;
+            }
+            return count;
+        };
+
+        // Previous layout: hot and cold fields together, 8-byte aligned
+        const size_t previousSize = 56;
+        std::cout << std::fixed << std::setprecision(2);
+        std::cout << "  Previous Order: " << previousSize << " bytes, "
+                  << static_cast<double>(kCacheLineSize) / previousSize << " orders/line, "
+                  << straddling(previousSize) << " of 8 straddle two lines\n";
+        std::cout << "  Hot Order:      " << sizeof(Order) << " bytes, "
+                  << static_cast<double>(kCacheLineSize) / sizeof(Order) << " orders/line, "
+                  << straddling(sizeof(Order)) << " of 8 straddle two lines\n";
+        std::cout << "  Cold OrderMeta: " << sizeof(OrderMeta) << " bytes in a parallel array\n\n";
+
+        // 1000 levels x 100 orders, swept by market orders one level at a time
+        const int LEVELS = 1000;
+        const int PER_LEVEL = 100;
+        const int ROUNDS = 5;
+        long long sweepNs = 0;
+        size_t fills = 0;
+
+        for (int round = 0; round < ROUNDS; ++round) {
+            MatchingEngine engine;
+            TradeCounter counter;
+            OrderId id = 0;
+            for (int level = 0; level < LEVELS; ++level) {
+                for (int k = 0; k < PER_LEVEL; ++k) {
+                    engine.submitLimit(id++, Side::Sell, 10000 + level, 10);
+                }
+            }
+
+            auto start = std::chrono::high_resolution_clock::now();
+            for (int level = 0; level < LEVELS; ++level) {
+                engine.submitMarket(id++, Side::Buy, 10 * PER_LEVEL, counter);
+            }
+            auto end = std::chrono::high_resolution_clock::now();
+            sweepNs += std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+            fills += counter.trades;
+        }
+
+        std::cout << "  Deep-level sweep (" << PER_LEVEL << " orders/level):\n";
+        std::cout << "    Fills:      " << fills << "\n";
+        std::cout << "    Per fill:   " << static_cast<double>(sweepNs) / fills << " ns\n";
+        std::cout << "    Throughput: " << static_cast<long long>(fills * 1e9 / sweepNs) << " fills/sec\n\n";
+    }
+
+    // ============================================================
+    // BENCHMARK 11: Clock source
+    // ============================================================
+    std::cout << "=== Benchmark 11: Clock Source ===\n\n";
+    {
+        const int READS = 10'000'000;
+        Clock steady(ClockSource::Steady, false);
+        Clock tsc(ClockSource::Tsc, false);
+
+        for (const Clock* clock : {&steady, &tsc}) {
+            Timestamp sink{};
+            auto start = std::chrono::high_resolution_clock::now();
+            for (int i = 0; i < READS; ++i) {
+                sink = std::max(sink, clock->now());
+            }
+            auto end = std::chrono::high_resolution_clock::now();
+            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+            std::cout << "  " << (clock == &steady ? "steady_clock" : "TSC         ") << " read: "
+                      << std::fixed << std::setprecision(1) << static_cast<double>(ns) / READS << " ns\n";
+        }
+        std::cout << "\n";
+
+        // Benchmark 1 flow with each clock configuration
+        struct Variant {
+            const char* label;
+            ClockSource source;
+            bool perMessage;
+        };
+        const Variant variants[] = {
+            {"steady_clock, every trade", ClockSource::Steady, false},
+            {"steady_clock, per message", ClockSource::Steady, true},
+            {"TSC, per message         ", ClockSource::Tsc,    true},
+        };
+        for (const Variant& v : variants) {
+            MatchingEngine engine(2'000'000, {}, {}, Clock(v.source, v.perMessage));
+            TradeCounter counter;
+            rng.seed(42);
+            auto start = std::chrono::high_resolution_clock::now();
+            for (int i = 0; i < NUM_ORDERS; ++i) {
+                Side side = sideDist(rng) == 0 ? Side::Buy : Side::Sell;
+                engine.submitLimit(static_cast<OrderId>(i), side, priceDist(rng), qtyDist(rng), counter);
+            }
+            auto end = std::chrono::high_resolution_clock::now();
+            auto durationUs = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+            std::cout << "  " << v.label << ": "
+                      << static_cast<int>((static_cast<double>(NUM_ORDERS) / durationUs) * 1'000'000) << " orders/sec\n";
+        }
+        std::cout << "\n";
+    }
+
+    // ============================================================
+    // BENCHMARK 12: Threaded runner — enqueue to trade event
+    // ============================================================
+    std::cout << "=== Benchmark 12: Engine Runner Round Trip ===\n\n";
+    {
+        const int ROUND_TRIPS = 20'000;
+        bool multiCore = std::thread::hardware_concurrency() >= 2;
+        if (!multiCore) {
+            std::cout << "  (single core: busy-spin skipped, backoff numbers include thread switches)\n\n";
+        }
+
+        for (WaitStrategy wait : {WaitStrategy::BusySpin, WaitStrategy::Backoff}) {
+            if (wait == WaitStrategy::BusySpin && !multiCore) continue;
+
+            MatchingEngine engine(100'000);
+            RunnerConfig config;
+            config.wait = wait;
+            config.cpu = multiCore ? 1 : -1;
+            EngineRunner runner(engine, config);
+            runner.start();
+
+            // Ping-pong: rest a sell, then time a crossing buy until its trade comes back
+            std::vector<long long> latencies;
+            latencies.reserve(ROUND_TRIPS);
+            EngineEvent event;
+            OrderId id = 0;
+            Waiter waiter(wait);   // this thread waits the same way, or a single core never switches over
+            auto pollOne = [&]() {
+                while (!runner.poll(event)) waiter.idle();
+                waiter.reset();
+            };
+            for (int i = 0; i < ROUND_TRIPS; ++i) {
+                while (!runner.submit(OrderMsg::limit(++id, Side::Sell, 10000, 10))) {}
+                pollOne();   // the resting ack
+
+                auto start = std::chrono::high_resolution_clock::now();
+                while (!runner.submit(OrderMsg::limit(++id, Side::Buy, 10000, 10))) {}
+                do {
+                    pollOne();
+                } while (event.type != EventType::Trade);
+                auto end = std::chrono::high_resolution_clock::now();
+                latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+
+                while (runner.processed() < id) waiter.idle();   // collect the two fill events
+                waiter.reset();
+                while (runner.poll(event)) {}
+            }
+            runner.stop();
+            printStats(wait == WaitStrategy::BusySpin ? "Submit -> trade (busy spin)" : "Submit -> trade (backoff)",
+                       latencies);
+        }
+    }
+
+    // ============================================================
+    // BENCHMARK 13: Symbol sharding — throughput vs shard count
+    // ============================================================
+    std::cout << "=== Benchmark 13: Sharded Engine Scaling ===\n\n";
+    {
+        const int SHARD_ORDERS = 1'000'000;
+        const size_t SYMBOLS = 1024;
+        size_t cores = std::max(1u, std::thread::hardware_concurrency());
+        if (cores < 2) {
+            std::cout << "  (single core: only 1 shard measured)\n";
+        }
+
+        // Same order flow for every shard count: random symbol, side, price and size
+        std::uniform_int_distribution<SymbolId> symbolDist(0, SYMBOLS - 1);
+        std::uniform_int_distribution<Price> nearMid(9950, 10050);
+        std::vector<OrderMsg> flow;
+        flow.reserve(SHARD_ORDERS);
+        rng.seed(42);
+        for (int i = 0; i < SHARD_ORDERS; ++i) {
+            Side side = sideDist(rng) == 0 ? Side::Buy : Side::Sell;
+            flow.push_back(OrderMsg::limit(static_cast<OrderId>(i), side, nearMid(rng), qtyDist(rng), symbolDist(rng)));
+        }
+
+        double oneShardRate = 0;
+        for (size_t shards = 1; shards <= cores; shards *= 2) {
+            ShardConfig config;
+            config.shardCount = shards;
+            config.symbolCount = SYMBOLS;
+            config.poolSizePerShard = std::max<size_t>(SHARD_ORDERS / shards, 65536);
+            config.poolOptions.growable = true;
+            config.bookConfig.ladderLevels = 256;
+            config.bookConfig.basePrice = 10000 - 128;
+            config.runner.wait = cores > shards ? WaitStrategy::BusySpin : WaitStrategy::Backoff;
+            config.runner.cpu = cores > shards ? 1 : -1;   // keep core 0 for this (gateway) thread
+            ShardedRunner runner(config);
+            runner.start();
+
+            Waiter waiter(WaitStrategy::Backoff);
+            EngineEvent event;
+            auto start = std::chrono::high_resolution_clock::now();
+            for (const OrderMsg& msg : flow) {
+                while (!runner.submit(msg)) {
+                    while (runner.poll(event)) {}
+                    waiter.idle();
+                }
+                waiter.reset();
+            }
+            while (runner.processed() < flow.size()) {
+                while (runner.poll(event)) {}
+                waiter.idle();
+            }
+            auto end = std::chrono::high_resolution_clock::now();
+            runner.stop();
+
+            auto durationUs = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+            double rate = static_cast<double>(SHARD_ORDERS) / durationUs * 1'000'000;
+            if (shards == 1) oneShardRate = rate;
+            std::cout << "  " << std::setw(3) << shards << " shard" << (shards == 1 ? " " : "s") << ": "
+                      << static_cast<int>(rate) << " orders/sec  (x" << std::fixed << std::setprecision(2)
+                      << rate / oneShardRate << ")\n";
+        }
+        std::cout << "\n";
+    }
+
+    // ============================================================
+    // BENCHMARK 14: Journal — cost on the matching path, and replay rate
+    // ============================================================
+    std::cout << "=== Benchmark 14: Write-Ahead Journal ===\n\n";
+    {
+        const int JOURNAL_ORDERS = 1'000'000;
+        std::string path = "benchmark.journal";
+
+        // Limits with an occasional cancel of a recent order
+        std::vector<OrderMsg> flow;
+        flow.reserve(JOURNAL_ORDERS);
+        rng.seed(42);
+        for (int i = 0; i < JOURNAL_ORDERS; ++i) {
+            if (i > 10 && i % 10 == 0) {
+                flow.push_back(OrderMsg::cancel(static_cast<OrderId>(i - 1 - rng() % 10)));
+                continue;
+            }
+            Side side = sideDist(rng) == 0 ? Side::Buy : Side::Sell;
+            flow.push_back(OrderMsg::limit(static_cast<OrderId>(i), side, priceDist(rng), qtyDist(rng)));
+        }
+
+        auto runFlow = [&](JournalWriter* journal, MatchingEngine& engine) {
+            RunnerConfig config;
+            config.journal = journal;
+            EngineRunner runner(engine, config);
+            runner.start();
+            Waiter waiter(WaitStrategy::Backoff);
+            EngineEvent event;
+            auto start = std::chrono::high_resolution_clock::now();
+            for (const OrderMsg& msg : flow) {
+                while (!runner.submit(msg)) {
+                    while (runner.poll(event)) {}
+                    waiter.idle();
+                }
+                waiter.reset();
+            }
+            while (runner.processed() < flow.size()) {
+                while (runner.poll(event)) {}
+                waiter.idle();
+            }
+            runner.stop();   // includes the final fsync when journaling
+            auto end = std::chrono::high_resolution_clock::now();
+            return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+        };
+        auto rate = [](size_t messages, long long us) {
+            return static_cast<int>(static_cast<double>(messages) / us * 1'000'000);
+        };
+
+        {
+            MatchingEngine engine;
+            auto us = runFlow(nullptr, engine);
+            std::cout << "  No journal:              " << rate(flow.size(), us) << " messages/sec\n";
+        }
+        for (size_t syncBatch : {size_t{1}, size_t{64}, size_t{1024}}) {
+            MatchingEngine engine;
+            JournalConfig config;
+            config.path = path;
+            config.syncBatch = syncBatch;
+            config.syncInterval = std::chrono::milliseconds(5);
+            JournalWriter journal(config, engine);
+            auto us = runFlow(&journal, engine);
+            std::cout << "  Journal, syncBatch " << std::setw(4) << syncBatch << ":   " << rate(flow.size(), us)
+                      << " messages/sec  (" << journal.syncCount() << " fsyncs, " << journal.appended()
+                      << " records)\n";
+        }
+
+        JournalReader reader(path);
+        auto engine = reader.header().shape.makeEngine();
+        EventListener ignore;
+        auto start = std::chrono::high_resolution_clock::now();
+        ReplayResult result = replayJournal(reader, *engine, ignore);
+        auto end = std::chrono::high_resolution_clock::now();
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+        std::cout << "  Replay:                  " << rate(result.messages, us) << " messages/sec  ("
+                  << (result.matched ? "trades match" : "MISMATCH") << ", " << result.digest.count << " trades)\n\n";
+        std::remove(path.c_str());
+    }
+
+    // ============================================================
+    // BENCHMARK 15: Cold start — journal replay vs snapshot load
+    // ============================================================
+    std::cout << "=== Benchmark 15: Snapshot Cold Start ===\n\n";
+    {
+        const int DEEP_ORDERS = 1'000'000;
+        std::string journalPath = "benchmark_deep.journal";
+        std::string snapshotPath = "benchmark_deep.snapshot";
+        auto ms = [](auto start, auto end) {
+            return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1000.0;
+        };
+
+        // A deep, non-crossing book: bids below 10000, asks above, journaled as it's built
+        MatchingEngine engine;
+        {
+            JournalConfig config;
+            config.path = journalPath;
+            config.sync = false;
+            JournalWriter journal(config, engine);
+            TradeDigest digest;
+            EventListener ignore;
+            DigestListener<EventListener> listener{ignore, digest};
+            rng.seed(42);
+            std::uniform_int_distribution<Price> depth(1, 2000);
+            for (int i = 0; i < DEEP_ORDERS; ++i) {
+                Side side = sideDist(rng) == 0 ? Side::Buy : Side::Sell;
+                Price price = side == Side::Buy ? 10000 - depth(rng) : 10000 + depth(rng);
+                OrderMsg msg = OrderMsg::limit(static_cast<OrderId>(i), side, price, qtyDist(rng));
+                engine.submit(msg, listener);
+                journal.append(msg, digest);
+            }
+            journal.flush();
+        }
+        std::cout << "  Book: " << engine.book().orderCount() << " resting orders, "
+                  << engine.book().bidLevelCount() + engine.book().askLevelCount() << " levels\n\n";
+
+        auto t0 = std::chrono::high_resolution_clock::now();
+        writeSnapshot(engine, snapshotPath);
+        auto t1 = std::chrono::high_resolution_clock::now();
+        std::cout << "  Snapshot write (blocking): " << std::fixed << std::setprecision(1) << ms(t0, t1) << " ms\n";
+
+        t0 = std::chrono::high_resolution_clock::now();
+        pid_t child = forkSnapshot(engine, snapshotPath);
+        t1 = std::chrono::high_resolution_clock::now();
+        bool ok = pollSnapshot(child, true).value_or(false);
+        auto t2 = std::chrono::high_resolution_clock::now();
+        std::cout << "  Snapshot via fork:         " << ms(t0, t1) << " ms matching pause, "
+                  << ms(t1, t2) << " ms in the child" << (ok ? "" : " (FAILED)") << "\n\n";
+
+        t0 = std::chrono::high_resolution_clock::now();
+        Recovery fromJournal = recover("", journalPath);
+        t1 = std::chrono::high_resolution_clock::now();
+        double replayMs = ms(t0, t1);
+
+        t0 = std::chrono::high_resolution_clock::now();
+        LoadedSnapshot fromSnapshot = loadSnapshot(snapshotPath);
+        t1 = std::chrono::high_resolution_clock::now();
+        double loadMs = ms(t0, t1);
+
+        std::cout << "  Cold start, replay journal: " << replayMs << " ms ("
+                  << fromJournal.engine->book().orderCount() << " orders)\n";
+        std::cout << "  Cold start, load snapshot:  " << loadMs << " ms ("
+                  << fromSnapshot.engine->book().orderCount() << " orders, x"
+                  << std::setprecision(1) << replayMs / loadMs << " faster)\n\n";
+
+        std::remove(journalPath.c_str());
+        std::remove(snapshotPath.c_str());
+    }
+
+    // ============================================================
+    // BENCHMARK 16: L2 publisher overhead
+    // ============================================================
+    // Benchmark 1's flow with no feed, with an L2Publisher published after
+    // every message, and published once per 64-message batch.
+    std::cout << "=== Benchmark 16: L2 Publisher Overhead ===\n\n";
+    {
+        rng.seed(42);
+        std::vector<OrderMsg> flow;
+        flow.reserve(NUM_ORDERS);
+        for (int i = 0; i < NUM_ORDERS; ++i) {
+            Side side = sideDist(rng) == 0 ? Side::Buy : Side::Sell;
+            flow.push_back(OrderMsg::limit(static_cast<OrderId>(i), side, priceDist(rng), qtyDist(rng)));
+        }
+        EventListener ignore;
+
+        auto nsPerMsg = [&](auto start, auto end) {
+            return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()) / NUM_ORDERS;
+        };
+
+        double plainNs;
+        {
+            MatchingEngine engine;
+            auto start = std::chrono::high_resolution_clock::now();
+            for (const OrderMsg& msg : flow) engine.submit(msg, ignore);
+            plainNs = nsPerMsg(start, std::chrono::high_resolution_clock::now());
+        }
+
+        double perMsgNs;
+        size_t perMsgUpdates = 0;
+        {
+            MatchingEngine engine;
+            L2Publisher feed(engine);
+            size_t allocsBefore = allocationCount();
+            auto start = std::chrono::high_resolution_clock::now();
+            for (const OrderMsg& msg : flow) {
+                engine.submit(msg, ignore);
+                perMsgUpdates += feed.publish().size();
+            }
+            perMsgNs = nsPerMsg(start, std::chrono::high_resolution_clock::now());
+            std::cout << "  Heap allocations (whole run, incl. ladder growth): " << allocationCount() - allocsBefore << "\n";
+        }
+
+        double batchNs;
+        size_t batchUpdates = 0;
+        {
+            MatchingEngine engine;
+            L2Publisher feed(engine);
+            auto start = std::chrono::high_resolution_clock::now();
+            for (size_t i = 0; i < flow.size(); i += 64) {
+                size_t n = std::min<size_t>(64, flow.size() - i);
+                engine.submitBatch(std::span<const OrderMsg>(flow.data() + i, n), ignore);
+                batchUpdates += feed.publish().size();
+            }
+            batchNs = nsPerMsg(start, std::chrono::high_resolution_clock::now());
+        }
+
+        std::cout << std::fixed << std::setprecision(1);
+        std::cout << "  No feed:             " << plainNs << " ns/msg\n";
+        std::cout << "  Publish per message: " << perMsgNs << " ns/msg (+" << perMsgNs - plainNs << "), "
+                  << static_cast<double>(perMsgUpdates) / NUM_ORDERS << " updates/msg\n";
+        std::cout << "  Publish per batch:   " << batchNs << " ns/msg, "
+                  << static_cast<double>(batchUpdates) / NUM_ORDERS << " updates/msg (x64 batches)\n\n";
+        std::cout.unsetf(std::ios::fixed);
+    }
+
+    // ============================================================
+    // BENCHMARK 17: Seqlock top-of-book readers
+    // ============================================================
+    // Benchmark 1's flow on this thread, publishing the BBO after every
+    // change, while reader threads poll it as fast as they can. On a
+    // single core the readers share the CPU with matching, so compare the
+    // matching rate with and without them.
+    std::cout << "=== Benchmark 17: Top-of-Book Readers ===\n\n";
+    {
+        rng.seed(42);
+        std::vector<OrderMsg> flow;
+        flow.reserve(NUM_ORDERS);
+        for (int i = 0; i < NUM_ORDERS; ++i) {
+            Side side = sideDist(rng) == 0 ? Side::Buy : Side::Sell;
+            flow.push_back(OrderMsg::limit(static_cast<OrderId>(i), side, priceDist(rng), qtyDist(rng)));
+        }
+        EventListener ignore;
+        unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+
+        for (unsigned readerCount : {0u, 1u, std::max(1u, cores - 1)}) {
+            MatchingEngine engine;
+            BboTable table(1);
+            engine.publishTopOfBook(&table);
+
+            std::atomic<bool> done{false};
+            std::vector<uint64_t> reads(readerCount, 0);
+            std::vector<uint64_t> retries(readerCount, 0);
+            std::vector<std::thread> readers;
+            for (unsigned r = 0; r < readerCount; ++r) {
+                readers.emplace_back([&, r]() {
+                    TopOfBook top;
+                    uint64_t n = 0, missed = 0;
+                    Price sink = 0;
+                    while (!done.load(std::memory_order_relaxed)) {
+                        if (table[0].tryRead(top)) {
+                            sink += top.bidPrice;
+                            n++;
+                        } else {
+                            missed++;
+                        }
+                    }
+                    reads[r] = n + (sink == 42);   // keep the reads from being optimised away
+                    retries[r] = missed;
+                });
+            }
+
+            auto start = std::chrono::high_resolution_clock::now();
+            for (const OrderMsg& msg : flow) engine.submit(msg, ignore);
+            auto end = std::chrono::high_resolution_clock::now();
+            done.store(true);
+            for (std::thread& t : readers) t.join();
+
+            double seconds = std::chrono::duration<double>(end - start).count();
+            uint64_t totalReads = std::accumulate(reads.begin(), reads.end(), uint64_t{0});
+            uint64_t totalRetries = std::accumulate(retries.begin(), retries.end(), uint64_t{0});
+            std::cout << "  " << readerCount << " reader(s): matching " << static_cast<int>(NUM_ORDERS / seconds)
+                      << " orders/sec, " << table[0].sequence() << " BBO updates";
+            if (readerCount > 0) {
+                std::cout << ", " << static_cast<long long>(totalReads / seconds) << " reads/sec, "
+                          << totalRetries << " torn reads retried";
+            }
+            std::cout << "\n";
+            if (cores == 1 && readerCount == 1) break;   // the third row would repeat this one
+        }
+        std::cout << "\n";
+    }
+
+    // ============================================================
+    // BENCHMARK 18: Cancel / modify-heavy order flow
+    // ============================================================
+    // Market-maker style flow: passive quotes either side of 10000, a few
+    // percent aggressive orders, and the rest cancels and amend-downs of
+    // live quotes. The last two profiles are the same million actions, with
+    // the amends sent once as modify() and once as cancel + new order —
+    // compare their total time.
+    std::cout << "=== Benchmark 18: Cancel / Modify Profiles ===\n\n";
+    {
+        struct Profile {
+            const char* name;
+            int newPct, cancelPct;      // the rest are amend-downs
+            bool amendAsCancelNew;
+        };
+        const Profile profiles[] = {
+            {"new-heavy", 80, 15, false},
+            {"cancel-heavy", 40, 55, false},
+            {"amend via modify", 30, 10, false},
+            {"amend via cxl+new", 30, 10, true},
+        };
+
+        struct Live { OrderId id; Side side; Price price; Quantity qty; };
+
+        for (const Profile& profile : profiles) {
+            rng.seed(7);
+            std::vector<OrderMsg> flow;
+            flow.reserve(NUM_ORDERS * 2);
+            std::vector<Live> live;
+            live.reserve(NUM_ORDERS);
+            OrderId nextId = 1;
+            size_t amends = 0;
+
+            auto quote = [&]() {
+                Side side = sideDist(rng) == 0 ? Side::Buy : Side::Sell;
+                Price price = side == Side::Buy ? 9950 + static_cast<Price>(rng() % 50) : 10001 + static_cast<Price>(rng() % 50);
+                Quantity qty = 10 + static_cast<Quantity>(rng() % 90);
+                flow.push_back(OrderMsg::limit(nextId, side, price, qty));
+                live.push_back({nextId++, side, price, qty});
+            };
+
+            for (int i = 0; i < 20'000; ++i) quote();   // start with a book
+            size_t warmup = flow.size();
+
+            for (int step = 0; step < NUM_ORDERS; ++step) {
+                int roll = static_cast<int>(rng() % 100);
+                if (roll < profile.newPct || live.empty()) {
+                    if (rng() % 20 == 0) {
+                        // Aggressive order that takes some liquidity
+                        Side side = sideDist(rng) == 0 ? Side::Buy : Side::Sell;
+                        flow.push_back(OrderMsg::limit(nextId++, side, side == Side::Buy ? 10010 : 9990, 20));
+                    } else {
+                        quote();
+                    }
+                    continue;
+                }
+                size_t pick = rng() % live.size();
+                Live& target = live[pick];
+                if (roll < profile.newPct + profile.cancelPct || target.qty < 2) {
+                    flow.push_back(OrderMsg::cancel(target.id));
+                    target = live.back();
+                    live.pop_back();
+                    continue;
+                }
+                target.qty /= 2;
+                amends++;
+                if (profile.amendAsCancelNew) {
+                    flow.push_back(OrderMsg::cancel(target.id));
+                    target.id = nextId++;
+                    flow.push_back(OrderMsg::limit(target.id, target.side, target.price, target.qty));
+                } else {
+                    flow.push_back(OrderMsg::modify(target.id, target.price, target.qty));
+                }
+            }
+
+            MatchingEngine engine;
+            EventListener ignore;
+            for (size_t i = 0; i < warmup; ++i) engine.submit(flow[i], ignore);
+
+            size_t rejected = 0;
+            auto start = std::chrono::high_resolution_clock::now();
+            for (size_t i = warmup; i < flow.size(); ++i) {
+                if (!engine.submit(flow[i], ignore)) rejected++;
+            }
+            auto end = std::chrono::high_resolution_clock::now();
+
+            double ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+            size_t messages = flow.size() - warmup;
+            std::cout << "  " << std::left << std::setw(19) << profile.name << std::right
+                      << std::setw(5) << static_cast<long long>(ns / 1e6) << " ms  "
+                      << std::setw(9) << static_cast<long long>(messages / ns * 1e9) << " msgs/sec  "
+                      << std::setw(7) << messages << " msgs  " << amends << " amends  "
+                      << rejected << " misses\n";
+        }
+        std::cout << "\n";
+    }
+
+    // ============================================================
+    // BENCHMARK 19: Compile-time specialised matching
+    // ============================================================
+    // Per-order cost of the three paths the engine picks between at entry:
+    // crossing limit orders (Benchmark 1's flow), add-only limit orders that
+    // never reach the match loop, and market orders against a deep book.
+    // Instructions and branch misses come from the PMU where it's available.
+    std::cout << "=== Benchmark 19: Specialised Match Paths ===\n\n";
+    {
+        struct Path {
+            const char* name;
+            std::vector<OrderMsg> setup;
+            std::vector<OrderMsg> flow;
+        };
+        std::vector<Path> paths(3);
+        const int count = NUM_ORDERS / 2;
+
+        rng.seed(42);
+        paths[0].name = "crossing limits";
+        for (int i = 0; i < count; ++i) {
+            Side side = sideDist(rng) == 0 ? Side::Buy : Side::Sell;
+            paths[0].flow.push_back(OrderMsg::limit(static_cast<OrderId>(i), side, priceDist(rng), qtyDist(rng)));
+        }
+
+        paths[1].name = "add-only limits";
+        for (int i = 0; i < count; ++i) {
+            Side side = sideDist(rng) == 0 ? Side::Buy : Side::Sell;
+            Price price = side == Side::Buy ? 9000 + static_cast<Price>(rng() % 500) : 10500 + static_cast<Price>(rng() % 500);
+            paths[1].flow.push_back(OrderMsg::limit(static_cast<OrderId>(i), side, price, qtyDist(rng)));
+        }
+
+        paths[2].name = "market orders";
+        for (int i = 0; i < count; ++i) {
+            Side side = i % 2 ? Side::Buy : Side::Sell;
+            Price price = side == Side::Buy ? 9000 + static_cast<Price>(rng() % 500) : 10500 + static_cast<Price>(rng() % 500);
+            paths[2].setup.push_back(OrderMsg::limit(static_cast<OrderId>(i), side, price, 100));
+        }
+        for (int i = 0; i < count; ++i) {
+            Side side = sideDist(rng) == 0 ? Side::Buy : Side::Sell;
+            paths[2].flow.push_back(OrderMsg::market(static_cast<OrderId>(count + i), side, 1 + rng() % 50));
+        }
+
+        HwCounters counters;
+        if (!counters.ok()) std::cout << "  (hardware counters unavailable here — timings only)\n";
+        for (const Path& path : paths) {
+            MatchingEngine engine;
+            EventListener ignore;
+            for (const OrderMsg& msg : path.setup) engine.submit(msg, ignore);
+
+            counters.start();
+            auto start = std::chrono::high_resolution_clock::now();
+            for (const OrderMsg& msg : path.flow) engine.submit(msg, ignore);
+            auto end = std::chrono::high_resolution_clock::now();
+            counters.stop();
+
+            double n = static_cast<double>(path.flow.size());
+            double ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+            std::cout << "  " << std::left << std::setw(17) << path.name << std::right
+                      << std::fixed << std::setprecision(1) << std::setw(7) << ns / n << " ns/order";
+            if (counters.ok()) {
+                std::cout << std::setw(8) << counters.instructionCount / n << " instr/order"
+                          << std::setw(7) << std::setprecision(2) << counters.branchMissCount / n << " branch-miss/order";
+            }
+            std::cout << "\n";
+            std::cout.unsetf(std::ios::fixed);
+        }
+        std::cout << "\n";
+    }
+
+    // ============================================================
+    // BENCHMARK 20: Extended order types
+    // ============================================================
+    // Each row starts from a fresh book of passive quotes either side of
+    // 10000 and times one order type. The reject rows show the pre-checks:
+    // a post-only that would cross and a FOK too large to fill, neither of
+    // which takes a pool slot or touches a resting order.
+    std::cout << "=== Benchmark 20: Extended Order Types ===\n\n";
+    {
+        const int count = 200'000;
+        auto passiveBook = [&](MatchingEngine& engine, OrderId& nextId, OrderType type) {
+            EventListener ignore;
+            rng.seed(3);
+            for (int i = 0; i < count; ++i) {
+                Side side = i % 2 ? Side::Buy : Side::Sell;
+                Price price = side == Side::Buy ? 9900 + static_cast<Price>(rng() % 100) : 10001 + static_cast<Price>(rng() % 100);
+                if (type == OrderType::Iceberg) {
+                    engine.submitIceberg(0, nextId++, side, price, 1000, 10, ignore);
+                } else {
+                    engine.submitLimit(0, nextId++, side, price, 100, ignore);
+                }
+            }
+        };
+
+        struct Row {
+            const char* name;
+            OrderType bookType;   // what rests (Iceberg for the refill row)
+            OrderType type;
+            bool crossing;        // aggressive price, or passive
+            Quantity qty;         // 0: random 1..20
+        };
+        const Row rows[] = {
+            {"limit (crossing)", OrderType::Limit, OrderType::Limit, true, 0},
+            {"IOC", OrderType::Limit, OrderType::ImmediateOrCancel, true, 0},
+            {"FOK (fills)", OrderType::Limit, OrderType::FillOrKill, true, 0},
+            {"FOK (too big)", OrderType::Limit, OrderType::FillOrKill, true, 1'000'000'000},
+            {"post-only rests", OrderType::Limit, OrderType::PostOnly, false, 0},
+            {"post-only reject", OrderType::Limit, OrderType::PostOnly, true, 0},
+            {"iceberg rests", OrderType::Limit, OrderType::Iceberg, false, 0},
+            {"limit vs icebergs", OrderType::Iceberg, OrderType::Limit, true, 10},
+        };
+
+        for (const Row& row : rows) {
+            MatchingEngine engine;
+            OrderId nextId = 1;
+            passiveBook(engine, nextId, row.bookType);
+
+            std::vector<OrderMsg> flow;
+            flow.reserve(count);
+            for (int i = 0; i < count; ++i) {
+                Side side = sideDist(rng) == 0 ? Side::Buy : Side::Sell;
+                Price price;
+                if (row.crossing) {
+                    price = side == Side::Buy ? 10005 : 9995;
+                } else {
+                    price = side == Side::Buy ? 9900 + static_cast<Price>(rng() % 100) : 10001 + static_cast<Price>(rng() % 100);
+                }
+                Quantity qty = row.qty ? row.qty : 1 + static_cast<Quantity>(rng() % 20);
+                OrderMsg msg = OrderMsg::limit(nextId++, side, price, qty);
+                msg.orderType = row.type;
+                if (row.type == OrderType::Iceberg) msg.displayQty = 5;
+                flow.push_back(msg);
+            }
+
+            EventListener ignore;
+            size_t accepted = 0;
+            size_t tradesBefore = engine.totalTrades();
+            auto start = std::chrono::high_resolution_clock::now();
+            for (const OrderMsg& msg : flow) accepted += engine.submit(msg, ignore);
+            auto end = std::chrono::high_resolution_clock::now();
+
+            double ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+            std::cout << "  " << std::left << std::setw(18) << row.name << std::right
+                      << std::fixed << std::setprecision(1) << std::setw(7) << ns / count << " ns/order  "
+                      << std::setw(6) << accepted << " accepted  "
+                      << engine.totalTrades() - tradesBefore << " trades\n";
+            std::cout.unsetf(std::ios::fixed);
+        }
+        std::cout << "\n";
+    }
+
+    // ============================================================
+    // BENCHMARK 21: Instrumentation overhead
+    // ============================================================
+    // The same generated flow (the load test's default mix) through the
+    // engine as built: ./benchmark has the hooks compiled out — empty inline
+    // functions and empty timer objects, so this row is the bare engine —
+    // and ./benchmark_instrumented has them in. Compare the two rows; the
+    // instrumented build also prints what the counters saw.
+    std::cout << "=== Benchmark 21: Instrumentation (" << (kInstrumented ? "compiled in" : "compiled out")
+              << ") ===\n\n";
+    {
+        WorkloadConfig config;
+        config.messages = NUM_ORDERS;
+        Workload workload = generateWorkload(config);
+
+        const int runs = 5;
+        double best = 0;
+        HwCounters counters;
+        CounterSnapshot seen;
+        for (int run = 0; run < runs; ++run) {
+            PoolOptions pool;
+            pool.prefault = true;
+            MatchingEngine engine(1 << 20, {}, pool);
+            EventListener ignore;
+            for (size_t i = 0; i < workload.warmup; ++i) engine.submit(workload.messages[i], ignore);
+            resetCounters();
+
+            counters.start();
+            auto start = std::chrono::high_resolution_clock::now();
+            for (size_t i = workload.warmup; i < workload.messages.size(); ++i) {
+                engine.submit(workload.messages[i], ignore);
+            }
+            auto end = std::chrono::high_resolution_clock::now();
+            counters.stop();
+
+            double ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+            if (run == 0 || ns < best) best = ns;
+            seen = readCounters();
+        }
+
+        double n = static_cast<double>(workload.messages.size() - workload.warmup);
+        std::cout << "  " << std::fixed << std::setprecision(1) << best / n << " ns/msg (best of " << runs << ")";
+        if (counters.ok()) {
+            std::cout << ", " << counters.instructionCount / n << " instr/msg";
+        }
+        std::cout << "\n";
+
+        if constexpr (kInstrumented) {
+            std::cout << "\n  Counters (last run):\n";
+            for (size_t c = 0; c < kCounterCount; ++c) {
+                std::cout << "    " << std::left << std::setw(18) << counterName(static_cast<Counter>(c)) << std::right
+                          << std::setw(12) << seen.values[c] << "\n";
+            }
+            std::cout << "  Phases:\n";
+            for (size_t p = 0; p < kPhaseCount; ++p) {
+                auto phase = static_cast<Phase>(p);
+                uint64_t calls = seen.phaseCalls[p];
+                std::cout << "    " << std::left << std::setw(18) << phaseName(phase) << std::right
+                          << std::setw(12) << calls << " calls" << std::setw(8)
+                          << (calls ? seen.phaseNs(phase) / static_cast<double>(calls) : 0.0) << " ns/call\n";
+            }
+        } else {
+            std::cout << "  (run ./benchmark_instrumented for the same flow with counters and phase timers)\n";
+        }
+        std::cout.unsetf(std::ios::fixed);
+        std::cout << "\n";
+    }
+
+    // ============================================================
+    // BENCHMARK 22: Memory of a deep book, and cancel by handle
+    // ============================================================
+    // Resident memory for a 2M-order book, measured from /proc/self/statm.
+    // Levels, queue links and the ID index hold 4-byte pool slots instead of
+    // 8-byte pointers; the pointer-based layout measured 64 MB for the empty
+    // engine and 216 MB (113.7 B/order) with 2M orders resting.
+    std::cout << "=== Benchmark 22: Deep Book Memory and Handle Cancels ===\n\n";
+    {
+        auto residentKb = []() -> size_t {
+            size_t pages = 0, resident = 0;
+            if (FILE* f = std::fopen("/proc/self/statm", "r")) {
+                if (std::fscanf(f, "%zu %zu", &pages, &resident) != 2) resident = 0;
+                std::fclose(f);
+            }
+            return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE)) / 1024;
+        };
+
+        const OrderId N = 2'000'000;
+        const size_t KEEP = 20;   // keep every 20th order's handle for the cancel timing
+
+        struct HandleSink : EventListener {
+            std::vector<OrderHandle>* handles;
+            OrderId keep;
+            void onOrderRested(const Order& order) {
+                if (order.id % keep == 0) handles->push_back(order.handle());
+            }
+        };
+        std::vector<OrderHandle> handles;
+        handles.reserve(N / KEEP);
+        HandleSink sink;
+        sink.handles = &handles;
+        sink.keep = KEEP;
+
+        // Earlier benchmarks leave freed heap resident and raise malloc's mmap
+        // threshold; hand that memory back so the engine's pages are counted
+        mallopt(M_MMAP_THRESHOLD, 128 * 1024);
+        malloc_trim(0);
+
+        size_t start = residentKb();
+        auto engine = std::make_unique<MatchingEngine>(N);
+        size_t empty = residentKb();
+        for (OrderId i = 1; i <= N; ++i) {
+            Side side = i % 2 ? Side::Buy : Side::Sell;
+            Price price = side == Side::Buy ? 9999 - static_cast<Price>(i % 1000) : 10001 + static_cast<Price>(i % 1000);
+            engine->submitLimit(0, i, side, price, 10, sink);
+        }
+        size_t full = residentKb();
+
+        std::cout << std::fixed << std::setprecision(1);
+        std::cout << "  Index entry:        " << OrderIndex::entryBytes() << " B\n";
+        std::cout << "  PriceLevel:         " << sizeof(PriceLevel) << " B\n";
+        std::cout << "  Empty engine:       " << (empty - start) / 1024 << " MB\n";
+        std::cout << "  With " << N / 1'000'000 << "M resting:    " << (full - start) / 1024 << " MB  ("
+                  << static_cast<double>(full - start) * 1024 / static_cast<double>(N) << " B/order)\n";
+
+        // Half the kept orders cancelled by id, half by handle
+        std::vector<long long> byId, byHandle;
+        byId.reserve(handles.size() / 2);
+        byHandle.reserve(handles.size() / 2);
+        for (size_t i = 0; i < handles.size(); ++i) {
+            OrderId id = static_cast<OrderId>(i + 1) * KEEP;
+            if (i % 2) {
+                byHandle.push_back(timeNs([&]() { engine->cancel(handles[i]); }));
+            } else {
+                byId.push_back(timeNs([&]() { engine->cancel(id); }));
+            }
+        }
+        printStats("Cancel by id", byId);
+        printStats("Cancel by handle", byHandle);
+
+        // A stale handle costs one generation compare
+        std::vector<long long> stale;
+        stale.reserve(handles.size());
+        for (OrderHandle handle : handles) {
+            stale.push_back(timeNs([&]() { engine->cancel(handle); }));
+        }
+        printStats("Cancel by stale handle", stale);
+        std::cout.unsetf(std::ios::fixed);
+        std::cout << "\n";
+    }
+
+    // ============================================================
+    // BENCHMARK 23: Eager vs lazy cancel on a cancel-heavy flow
+    // ============================================================
+    // 90% cancels against a deep book (long queues on few levels). Lazy mode
+    // only marks a cancelled order dead; the match loop unlinks dead orders it
+    // reaches and compact() (here: one level every 16 messages, standing in
+    // for the runner's idle polls) cleans levels that are mostly dead.
+    std::cout << "=== Benchmark 23: Eager vs Lazy Cancel (90% cancels) ===\n\n";
+    {
+        WorkloadConfig config;
+        config.messages = 300'000;
+        config.initialDepth = 400'000;
+        config.newWeight = 0.08;
+        config.cancelWeight = 0.90;
+        config.modifyWeight = 0.0;
+        config.marketWeight = 0.02;
+        config.maxDistance = 50;
+        Workload workload = generateWorkload(config);
+        size_t cancels = 0;
+        for (size_t i = workload.warmup; i < workload.messages.size(); ++i) {
+            cancels += workload.messages[i].type == MsgType::Cancel;
+        }
+        double n = static_cast<double>(workload.messages.size() - workload.warmup);
+        std::cout << "  " << std::fixed << std::setprecision(1) << 100.0 * static_cast<double>(cancels) / n
+                  << "% cancels over " << config.initialDepth << " resting orders\n\n";
+
+        for (CancelMode mode : {CancelMode::Eager, CancelMode::Lazy}) {
+            const char* name = mode == CancelMode::Eager ? "Eager" : "Lazy";
+            BookConfig book;
+            book.cancelMode = mode;
+            PoolOptions pool;
+            pool.prefault = true;
+            EventListener ignore;
+
+            // Throughput: the whole flow, untimed per message; compaction is
+            // timed on its own, since the runner only does it when idle
+            double best = 0;
+            double bestCompact = 0;
+            for (int run = 0; run < 3; ++run) {
+                MatchingEngine engine(1 << 20, book, pool);
+                for (size_t i = 0; i < workload.warmup; ++i) engine.submit(workload.messages[i], ignore);
+                long long compactNs = 0;
+                auto start = std::chrono::high_resolution_clock::now();
+                for (size_t i = workload.warmup; i < workload.messages.size(); ++i) {
+                    engine.submit(workload.messages[i], ignore);
+                    if (mode == CancelMode::Lazy && i % 16 == 0) {
+                        compactNs += timeNs([&]() { engine.compact(1); });
+                    }
+                }
+                auto end = std::chrono::high_resolution_clock::now();
+                double ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()
+                                                - compactNs);
+                if (run == 0 || ns < best) {
+                    best = ns;
+                    bestCompact = static_cast<double>(compactNs);
+                }
+            }
+            std::cout << "  " << name << ": " << best / n << " ns/msg (best of 3)";
+            if (mode == CancelMode::Lazy) std::cout << ", plus " << bestCompact / n << " ns/msg of compaction";
+            std::cout << "\n";
+
+            // Latency of each cancel, and of each message that can trade
+            MatchingEngine engine(1 << 20, book, pool);
+            for (size_t i = 0; i < workload.warmup; ++i) engine.submit(workload.messages[i], ignore);
+            std::vector<long long> cancelLatencies;
+            std::vector<long long> tradeLatencies;
+            cancelLatencies.reserve(workload.messages.size());
+            tradeLatencies.reserve(workload.messages.size());
+            for (size_t i = workload.warmup; i < workload.messages.size(); ++i) {
+                const OrderMsg& msg = workload.messages[i];
+                long long ns = timeNs([&]() { engine.submit(msg, ignore); });
+                (msg.type == MsgType::Cancel ? cancelLatencies : tradeLatencies).push_back(ns);
+                if (mode == CancelMode::Lazy && i % 16 == 0) engine.compact(1);
+            }
+            printStats(std::string(name) + " cancel", cancelLatencies);
+            printStats(std::string(name) + " new/market", tradeLatencies);
+        }
+        std::cout.unsetf(std::ios::fixed);
+    }
+
+    // ============================================================
+    // BENCHMARK 24: Depth scans — scalar vs AVX2 vs AVX-512
+    // ============================================================
+    // A dense ask side (one order on every tick) queried for the quantity
+    // within `depth` levels and for the cost of sweeping half of it, with each
+    // kernel, against walking the levels through the bitmap the way the
+    // match loop and canFill do.
+    std::cout << "=== Benchmark 24: Depth Scans (this CPU: " << simdName(supportedSimd()) << ") ===\n\n";
+    {
+        uint64_t checksum = 0;
+        std::cout << "  " << std::left << std::setw(8) << "levels" << std::right << std::setw(12) << "level walk";
+        for (SimdLevel simd : {SimdLevel::Scalar, SimdLevel::Avx2, SimdLevel::Avx512}) {
+            std::cout << std::setw(10) << simdName(simd);
+        }
+        std::cout << std::setw(12) << "fill est." << "   (ns/query)\n";
+
+        for (size_t depth : {16, 128, 1024, 8192}) {
+            BookConfig config;
+            config.ladderLevels = depth * 4;
+            MatchingEngine engine(depth + 16, config);
+            for (size_t i = 0; i < depth; ++i) {
+                engine.submitLimit(static_cast<OrderId>(i + 1), Side::Sell, 10'000 + static_cast<Price>(i),
+                                   static_cast<Quantity>(1 + i % 100));
+            }
+            const OrderBook& book = engine.book();
+            const PriceLevel* best = book.asks().levelData() + book.asks().bestIndex();
+            const size_t reps = std::max<size_t>(1, 4'000'000 / depth);
+
+            auto perQuery = [&](auto&& query) {
+                auto start = std::chrono::high_resolution_clock::now();
+                for (size_t r = 0; r < reps; ++r) checksum += query();
+                auto end = std::chrono::high_resolution_clock::now();
+                return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count())
+                     / static_cast<double>(reps);
+            };
+
+            double walk = perQuery([&]() {
+                uint64_t total = 0;
+                for (const PriceLevel* level = book.asks().best(); level; level = book.asks().next(*level)) {
+                    total += level->totalQuantity;
+                }
+                return total;
+            });
+            std::cout << "  " << std::left << std::setw(8) << depth << std::right << std::fixed << std::setprecision(1)
+                      << std::setw(12) << walk;
+            for (SimdLevel simd : {SimdLevel::Scalar, SimdLevel::Avx2, SimdLevel::Avx512}) {
+                double ns = perQuery([&]() { return sweepLevels(simd, best, depth, false, UINT64_MAX).quantity; });
+                std::cout << std::setw(10) << ns;
+            }
+            uint64_t half = book.depthWithin(Side::Sell, depth) / 2;
+            double fill = perQuery([&]() { return book.estimateFill(Side::Buy, half).quantity; });
+            std::cout << std::setw(12) << fill << "\n";
+        }
+        std::cout.unsetf(std::ios::fixed);
+        std::cout << "  (checksum " << checksum << ")\n\n";
+    }
+
+    // ============================================================
+    // BENCHMARK 25: Stop cascades
+    // ============================================================
+    // One market buy sets off every parked stop. Chain: a stop on each tick
+    // above the last trade, each lifting the ask that triggers the next, so
+    // the cascade is `stops` matches deep. Burst: every stop at one price,
+    // all triggered by the first trade. Then the cost of stops that are
+    // parked but never reached on an ordinary trading flow.
+    std::cout << "=== Benchmark 25: Stop Cascades ===\n\n";
+    {
+        EventListener ignore;
+        PoolOptions pool;
+        pool.prefault = true;
+
+        // Best-of-3 time of the triggering message, after setting up the book
+        auto cascade = [&](size_t stops, bool chain) {
+            double best = 0;
+            for (int run = 0; run < 3; ++run) {
+                MatchingEngine engine(stops * 2 + 16, {}, pool);
+                engine.submitLimit(1, Side::Sell, 10'000, 1);
+                engine.submitLimit(2, Side::Buy, 10'000, 1);   // last trade 10000, nothing triggered
+                OrderId id = 10;
+                engine.submitLimit(0, id++, Side::Sell, 10'001, 1, ignore);
+                for (size_t i = 0; i < stops; ++i) {
+                    Price price = chain ? 10'001 + static_cast<Price>(i) : 10'001;
+                    engine.submitLimit(0, id++, Side::Sell, chain ? price + 1 : price, 1, ignore);
+                    engine.submitStop(0, id++, Side::Buy, price, 1, ignore);
+                }
+                double ns = static_cast<double>(timeNs([&]() { engine.submitMarket(0, id, Side::Buy, 1, ignore); }));
+                if (engine.book().stopCount() != 0 || engine.book().bestAsk()) {
+                    std::cout << "  (cascade did not trigger every stop)\n";
+                }
+                if (run == 0 || ns < best) best = ns;
+            }
+            return best;
+        };
+
+        std::cout << "  " << std::left << std::setw(10) << "stops" << std::right << std::setw(14) << "chain total"
+                  << std::setw(14) << "per stop" << std::setw(14) << "burst total" << std::setw(14) << "per stop\n";
+        for (size_t stops : {1'000, 10'000, 100'000}) {
+            double chain = cascade(stops, true);
+            double burst = cascade(stops, false);
+            double n = static_cast<double>(stops);
+            std::cout << "  " << std::left << std::setw(10) << stops << std::right << std::fixed << std::setprecision(1)
+                      << std::setw(11) << chain / 1000 << " us" << std::setw(11) << chain / n << " ns"
+                      << std::setw(11) << burst / 1000 << " us" << std::setw(11) << burst / n << " ns\n";
+        }
+
+        // Trades with 100k stops parked out of reach cost what they do with none
+        constexpr size_t kRounds = 200'000;
+        for (size_t parked : {0, 100'000}) {
+            double best = 0;
+            for (int run = 0; run < 3; ++run) {
+                MatchingEngine engine(parked + 16, {}, pool);
+                for (size_t i = 0; i < parked; ++i) {
+                    engine.submitStop(0, static_cast<OrderId>(1'000'000 + i), i % 2 ? Side::Buy : Side::Sell,
+                                      i % 2 ? 20'000 + static_cast<Price>(i) : 5'000 - static_cast<Price>(i % 4'000), 1,
+                                      ignore);
+                }
+                auto start = std::chrono::high_resolution_clock::now();
+                for (size_t r = 0; r < kRounds; ++r) {
+                    engine.submitLimit(0, 2 * r + 1, Side::Sell, 10'000, 1, ignore);
+                    engine.submitMarket(0, 2 * r + 2, Side::Buy, 1, ignore);
+                }
+                auto end = std::chrono::high_resolution_clock::now();
+                double ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+                if (run == 0 || ns < best) best = ns;
+            }
+            std::cout << "  " << std::setw(7) << parked << " stops parked: " << best / kRounds
+                      << " ns per rest + trade (best of 3)\n";
+        }
+        std::cout.unsetf(std::ios::fixed);
+        std::cout << "\n";
+    }
+
+    // ============================================================
+    // BENCHMARK 26: Auction uncross
+    // ============================================================
+    // 500k orders entered in the call phase, bids and asks spread over the
+    // same 1000 ticks so about half of everything crosses. Finding the price
+    // is one walk over the crossed level totals; the uncross then trades the
+    // whole cross at that price into the listener — a null one, and an
+    // EventBuffer reserved up front.
+    std::cout << "=== Benchmark 26: Auction Uncross (500k orders) ===\n\n";
+    {
+        constexpr size_t kOrders = 500'000;
+        PoolOptions pool;
+        pool.prefault = true;
+        std::mt19937_64 rng(26);
+        std::vector<OrderMsg> orders;
+        orders.reserve(kOrders);
+        for (size_t i = 0; i < kOrders; ++i) {
+            Side side = i % 2 ? Side::Sell : Side::Buy;
+            orders.push_back(OrderMsg::limit(i + 1, side, 9'500 + static_cast<Price>(rng() % 1'000),
+                                             static_cast<Quantity>(1 + rng() % 100)));
+        }
+
+        std::vector<EngineEvent> events;
+        events.reserve(kOrders * 2);
+        double bestPrice = 0;
+        double bestNull = 0;
+        double bestSink = 0;
+        AuctionResult result;
+        size_t trades = 0;
+        for (int run = 0; run < 3; ++run) {
+            for (bool sink : {false, true}) {
+                MatchingEngine engine(kOrders + 16, {}, pool);
+                engine.startAuction();
+                EventListener ignore;
+                for (const OrderMsg& msg : orders) engine.submit(msg, ignore);
+
+                double priceNs = static_cast<double>(timeNs([&]() { result = engine.indicativeUncross(); }));
+                size_t before = engine.totalTrades();
+                double ns = 0;
+                if (sink) {
+                    events.clear();
+                    EventBuffer buffer(engine.clock(), events);
+                    ns = static_cast<double>(timeNs([&]() { engine.uncross(0, buffer); }));
+                } else {
+                    ns = static_cast<double>(timeNs([&]() { engine.uncross(0, ignore); }));
+                }
+                trades = engine.totalTrades() - before;
+                if (auto bid = engine.book().bestBid(); bid && engine.book().crosses(Side::Buy, *bid)) {
+                    std::cout << "  (book still crossed after the uncross)\n";
+                }
+                if (run == 0 || priceNs < bestPrice) bestPrice = priceNs;
+                double& best = sink ? bestSink : bestNull;
+                if (run == 0 || ns < best) best = ns;
+            }
+        }
+        std::cout << std::fixed << std::setprecision(1)
+                  << "  Equilibrium: price " << result.price << ", volume " << result.volume << ", surplus "
+                  << result.surplus << ", " << trades << " fills\n"
+                  << "  Price search:         " << bestPrice / 1000 << " us\n"
+                  << "  Uncross, null sink:   " << bestNull / 1e6 << " ms (" << bestNull / static_cast<double>(trades)
+                  << " ns/fill)\n"
+                  << "  Uncross, EventBuffer: " << bestSink / 1e6 << " ms (" << bestSink / static_cast<double>(trades)
+                  << " ns/fill)\n\n";
+        std::cout.unsetf(std::ios::fixed);
+    }
+
+    // ============================================================
+    // BENCHMARK 27: Parallel backtest scaling
+    // ============================================================
+    // Four days of 32 symbols, written as workload files and replayed with
+    // 1, 2, 4, ... workers, up to the hardware threads (and at most 64).
+    // Rates count the replay phase only; split and merge are shown apart.
+    // Efficiency is speedup over one worker divided by workers. The baseline
+    // is the same days through one 32-symbol engine, which shows what the
+    // split costs a single worker.
+    std::cout << "=== Benchmark 27: Parallel Backtest (4 days x 32 symbols) ===\n\n";
+    {
+        WorkloadConfig config;
+        config.symbols = 32;
+        config.messages = 1'000'000;
+        config.initialDepth = 32'000;
+        auto dir = std::filesystem::temp_directory_path();
+        std::vector<std::string> days;
+        uint64_t baselineMessages = 0;
+        double baselineNs = 0;
+        for (int d = 0; d < 4; ++d) {
+            config.seed = 2700 + d;
+            Workload day = generateWorkload(config);
+            days.push_back((dir / ("matching_engine_bench_day" + std::to_string(d) + ".workload")).string());
+            saveWorkload(day, days.back());
+            MatchingEngine engine(1 << 20, {}, {}, Clock(), config.symbols);
+            EventListener ignore;
+            baselineNs += static_cast<double>(timeNs([&]() {
+                for (const OrderMsg& msg : day.messages) engine.submit(msg, ignore);
+            }));
+            baselineMessages += day.messages.size();
+        }
+        std::cout << std::fixed << std::setprecision(0) << "  One engine, all symbols: "
+                  << static_cast<double>(baselineMessages) * 1e9 / baselineNs << " msgs/sec\n";
+
+        BacktestConfig backtest;
+        backtest.keepTrades = false;
+        size_t maxThreads = std::min<size_t>(64, std::max(1u, std::thread::hardware_concurrency()));
+        double oneRate = 0;
+        for (size_t threads = 1; threads <= maxThreads; threads *= 2) {
+            backtest.threads = threads;
+            BacktestResult best;
+            for (int run = 0; run < 3; ++run) {
+                BacktestResult r = runBacktest(days, backtest);
+                if (run == 0 || r.messagesPerSecond() > best.messagesPerSecond()) best = std::move(r);
+            }
+            if (threads == 1) oneRate = best.messagesPerSecond();
+            double speedup = best.messagesPerSecond() / oneRate;
+            std::cout << std::setprecision(0) << "  " << std::setw(2) << threads << " workers: " << std::setw(10)
+                      << best.messagesPerSecond() << " msgs/sec, speedup " << std::setprecision(2) << speedup
+                      << "x, efficiency " << std::setprecision(0) << 100 * speedup / static_cast<double>(threads)
+                      << "% (split " << std::setprecision(1) << best.splitSeconds * 1e3 << " ms, merge "
+                      << best.mergeSeconds * 1e3 << " ms, " << best.steals << " steals)\n";
+        }
+        if (maxThreads == 1) std::cout << "  (one hardware thread — no scaling to measure)\n";
+        std::cout << "\n";
+        std::cout.unsetf(std::ios::fixed);
+        for (const std::string& path : days) std::filesystem::remove(path);
+    }
+
+    // ============================================================
+    // BENCHMARK 28: Replication to a hot standby
+    // ============================================================
+    // The Benchmark 14 flow through the runner three ways: no replication,
+    // streaming with nobody connected, and streaming to one standby over
+    // loopback. The driver samples how far the standby is behind the
+    // primary's appended sequence while the flow runs at full rate, then
+    // times its catch-up after the last message and promote(). append()
+    // itself is timed into an empty ring.
+    std::cout << "=== Benchmark 28: Replication (1M messages, one standby on loopback) ===\n\n";
+    {
+        const int REPL_ORDERS = 1'000'000;
+        std::vector<OrderMsg> flow;
+        flow.reserve(REPL_ORDERS);
+        rng.seed(42);
+        for (int i = 0; i < REPL_ORDERS; ++i) {
+            if (i > 10 && i % 10 == 0) {
+                flow.push_back(OrderMsg::cancel(static_cast<OrderId>(i - 1 - rng() % 10)));
+                continue;
+            }
+            Side side = sideDist(rng) == 0 ? Side::Buy : Side::Sell;
+            flow.push_back(OrderMsg::limit(static_cast<OrderId>(i), side, priceDist(rng), qtyDist(rng)));
+        }
+        if (std::thread::hardware_concurrency() < 3) {
+            std::cout << "  (fewer than 3 cores: matching, sender and standby threads share them — lag includes"
+                         " scheduling)\n";
+        }
+
+        ReplicationConfig config;
+        config.address = "127.0.0.1";
+        struct Lag {
+            uint64_t max = 0;
+            double sum = 0;
+            uint64_t samples = 0;
+        };
+        auto runFlow = [&](ReplicationPrimary* primary, MatchingEngine& engine, ReplicationStandby* standby, Lag& lag) {
+            RunnerConfig runnerConfig;
+            runnerConfig.replication = primary;
+            EngineRunner runner(engine, runnerConfig);
+            runner.start();
+            Waiter waiter(WaitStrategy::Backoff);
+            EngineEvent event;
+            auto sample = [&]() {
+                if (!standby) return;
+                uint64_t behind = primary->appended() - std::min(primary->appended(), standby->applied());
+                lag.max = std::max(lag.max, behind);
+                lag.sum += static_cast<double>(behind);
+                lag.samples++;
+            };
+            auto start = std::chrono::high_resolution_clock::now();
+            for (size_t i = 0; i < flow.size(); ++i) {
+                while (!runner.submit(flow[i])) {
+                    while (runner.poll(event)) {}
+                    waiter.idle();
+                }
+                waiter.reset();
+                if ((i & 1023) == 0) sample();
+            }
+            while (runner.processed() < flow.size()) {
+                while (runner.poll(event)) {}
+                sample();
+                waiter.idle();
+            }
+            auto end = std::chrono::high_resolution_clock::now();
+            runner.stop();
+            return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+        };
+        auto rate = [](size_t messages, long long us) {
+            return static_cast<int>(static_cast<double>(messages) / us * 1'000'000);
+        };
+
+        Lag none;
+        {
+            MatchingEngine engine;
+            std::cout << "  No replication:          " << rate(flow.size(), runFlow(nullptr, engine, nullptr, none))
+                      << " messages/sec\n";
+        }
+        {
+            MatchingEngine engine;
+            ReplicationPrimary primary(config, engine);
+            std::cout << "  Streaming, no standby:   " << rate(flow.size(), runFlow(&primary, engine, nullptr, none))
+                      << " messages/sec\n";
+        }
+        {
+            MatchingEngine engine;
+            MatchingEngine copy;
+            ReplicationPrimary primary(config, engine);
+            ReplicationConfig follow = config;
+            follow.port = primary.port();
+            ReplicationStandby standby(follow, copy);
+            standby.start();
+            while (primary.standbys() == 0) std::this_thread::sleep_for(std::chrono::microseconds(100));
+
+            Lag lag;
+            auto us = runFlow(&primary, engine, &standby, lag);
+            auto caughtUpStart = std::chrono::high_resolution_clock::now();
+            while (standby.applied() < primary.appended()) std::this_thread::yield();
+            auto caughtUp = std::chrono::high_resolution_clock::now();
+            uint64_t promoted = 0;
+            auto promoteNs = timeNs([&]() { promoted = standby.promote(); });
+            std::cout << "  Streaming to a standby:  " << rate(flow.size(), us) << " messages/sec  ("
+                      << primary.framesSent() << " frames)\n"
+                      << std::fixed << std::setprecision(0)
+                      << "  Standby lag at full rate: mean " << lag.sum / static_cast<double>(std::max<uint64_t>(lag.samples, 1))
+                      << " records, max " << lag.max << "\n"
+                      << "  Catch-up after the last message: "
+                      << std::chrono::duration_cast<std::chrono::microseconds>(caughtUp - caughtUpStart).count()
+                      << " us; promote(): " << static_cast<double>(promoteNs) / 1000 << " us ("
+                      << (promoted == primary.appended() && copy.totalTrades() == engine.totalTrades() ? "books match"
+                                                                                                        : "MISMATCH")
+                      << ")\n";
+            std::cout.unsetf(std::ios::fixed);
+        }
+        {
+            // append() alone: a burst that fits the ring, so the sender never holds it up
+            MatchingEngine engine;
+            ReplicationPrimary primary(config, engine);
+            const size_t burst = config.ringCapacity / 2;
+            TradeDigest digest;
+            double best = 0;
+            for (int run = 0; run < 5; ++run) {
+                auto ns = timeNs([&]() {
+                    for (size_t i = 0; i < burst; ++i) primary.append(flow[i], digest);
+                });
+                double per = static_cast<double>(ns) / static_cast<double>(burst);
+                if (run == 0 || per < best) best = per;
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));   // let the sender drain it
+            }
+            std::cout << std::fixed << std::setprecision(1) << "  append() on the matching thread: " << best
+                      << " ns/record\n\n";
+            std::cout.unsetf(std::ios::fixed);
+        }
+    }
+
+
+    // ============================================================
+    // BENCHMARK 29: Inline pre-trade risk
+    // ============================================================
+    // 1M messages (limits, 10% cancels) from 4096 accounts through
+    // submit(), with no risk table, with one whose limits nothing reaches,
+    // and with self-trade prevention on for every account as well. The
+    // difference per message is what the risk stage costs: the check on
+    // entry plus the exposure updates as orders rest, fill and leave. The
+    // check alone is also timed in a loop over the same orders.
+    std::cout << "=== Benchmark 29: Inline Risk Checks (1M messages, 4096 accounts) ===\n\n";
+    {
+        constexpr size_t kRiskOrders = 1'000'000;
+        constexpr size_t kAccounts = 4096;
+        constexpr double kBudgetNs = 20;
+        std::vector<OrderMsg> flow;
+        flow.reserve(kRiskOrders);
+        rng.seed(29);
+        for (size_t i = 0; i < kRiskOrders; ++i) {
+            if (i > 10 && i % 10 == 0) {
+                flow.push_back(OrderMsg::cancel(static_cast<OrderId>(i - 1 - rng() % 10)));
+                continue;
+            }
+            Side side = sideDist(rng) == 0 ? Side::Buy : Side::Sell;
+            flow.push_back(OrderMsg::limit(static_cast<OrderId>(i), side, priceDist(rng), qtyDist(rng))
+                               .from(static_cast<AccountId>(rng() % kAccounts)));
+        }
+
+        PoolOptions pool;
+        pool.prefault = true;
+        auto run = [&](RiskTable* risk) {
+            double best = 0;
+            for (int r = 0; r < 5; ++r) {
+                MatchingEngine engine(kRiskOrders, {}, pool);
+                if (risk) {
+                    risk->clearOpen();
+                    engine.enforceRisk(risk);
+                }
+                EventListener ignore;
+                auto ns = timeNs([&]() {
+                    for (const OrderMsg& msg : flow) engine.submit(msg, ignore);
+                });
+                double per = static_cast<double>(ns) / static_cast<double>(flow.size());
+                if (r == 0 || per < best) best = per;
+                if (risk) engine.enforceRisk(nullptr);
+            }
+            return best;
+        };
+
+        RiskLimits loose;
+        loose.maxOrderQty = 1'000;
+        loose.priceBand = 1'000;
+        loose.maxOpenQty = UINT32_MAX;
+        loose.maxOpenNotional = INT64_MAX / 2;
+        RiskTable risk(kAccounts, loose);
+        RiskLimits stpLimits = loose;
+        stpLimits.preventSelfTrade = true;
+        RiskTable stpRisk(kAccounts, stpLimits);
+
+        double plain = run(nullptr);
+        double checked = run(&risk);
+        double stp = run(&stpRisk);
+
+        // The check alone, against a fixed best price
+        std::vector<OrderMsg> orders;
+        std::copy_if(flow.begin(), flow.end(), std::back_inserter(orders),
+                     [](const OrderMsg& msg) { return msg.type == MsgType::NewLimit; });
+        uint64_t passed = 0;
+        double checkNs = 0;
+        for (int r = 0; r < 5; ++r) {
+            auto ns = timeNs([&]() {
+                for (const OrderMsg& msg : orders) {
+                    RiskCheck verdict = msg.side == Side::Buy
+                        ? risk.check<Side::Buy, OrderType::Limit>(msg.account, msg.price, msg.quantity, Price{10'000})
+                        : risk.check<Side::Sell, OrderType::Limit>(msg.account, msg.price, msg.quantity, Price{10'000});
+                    passed += verdict == RiskCheck::Passed;
+                }
+            });
+            double per = static_cast<double>(ns) / static_cast<double>(orders.size());
+            if (r == 0 || per < checkNs) checkNs = per;
+        }
+
+        uint64_t refused = 0;
+        for (size_t why = 1; why < kRiskCheckCount; ++why) refused += risk.rejected(static_cast<RiskCheck>(why));
+        std::cout << std::fixed << std::setprecision(1)
+                  << "  No risk table:               " << plain << " ns/msg\n"
+                  << "  Risk stage:                  " << checked << " ns/msg (+" << checked - plain << " ns, "
+                  << (checked - plain < kBudgetNs ? "within" : "OVER") << " the " << kBudgetNs << " ns budget)\n"
+                  << "  With self-trade prevention:  " << stp << " ns/msg (+" << stp - plain << " ns)\n"
+                  << "  check() alone:               " << checkNs << " ns/order (" << passed / 5 << " of "
+                  << orders.size() << " passed)\n"
+                  << "  Orders refused by the loose limits: " << refused << "\n\n";
+        std::cout.unsetf(std::ios::fixed);
+    }
+
+    // ============================================================
+    // BENCHMARK 30: Drop copy vs formatted trades
+    // ============================================================
+    // The same 1M-message flow two ways. The old path: each message's trades
+    // collected into a std::vector<Trade> and written with operator<< to an
+    // ofstream, on the matching thread. The drop copy: every event (trades,
+    // rests, cancels) encoded in place as a 40-byte ExecReport and written
+    // from the writer thread, with the matching thread committing after each
+    // message. Bytes per trade count the whole stream. Then the writer alone:
+    // a flood of trades committed 64 at a time, timed until flush(), against
+    // formatting the same trades to an ofstream.
+    std::cout << "=== Benchmark 30: Drop Copy (1M messages, then a 4M-trade flood) ===\n\n";
+    {
+        constexpr size_t kDropOrders = 1'000'000;
+        constexpr size_t kFlood = 4'000'000;
+        std::vector<OrderMsg> flow;
+        flow.reserve(kDropOrders);
+        rng.seed(30);
+        for (size_t i = 0; i < kDropOrders; ++i) {
+            if (i > 10 && i % 10 == 0) {
+                flow.push_back(OrderMsg::cancel(static_cast<OrderId>(i - 1 - rng() % 10)));
+                continue;
+            }
+            Side side = sideDist(rng) == 0 ? Side::Buy : Side::Sell;
+            flow.push_back(OrderMsg::limit(static_cast<OrderId>(i), side, priceDist(rng), qtyDist(rng)));
+        }
+        std::string path = (std::filesystem::temp_directory_path() / "matching_engine_bench.dropcopy").string();
+        PoolOptions pool;
+        pool.prefault = true;
+
+        struct TradeCollector : EventListener {
+            std::vector<Trade> trades;
+            void onTrade(const Trade& trade) { trades.push_back(trade); }
+        };
+
+        double textNs = 0;
+        uint64_t trades = 0;
+        uintmax_t textBytes = 0;
+        for (int r = 0; r < 3; ++r) {
+            MatchingEngine engine(kDropOrders, {}, pool);
+            TradeCollector collector;
+            collector.trades.reserve(1024);
+            std::ofstream out(path);
+            auto ns = timeNs([&]() {
+                for (const OrderMsg& msg : flow) {
+                    collector.trades.clear();
+                    engine.submit(msg, collector);
+                    for (const Trade& trade : collector.trades) out << trade << '\n';
+                }
+                out.flush();
+            });
+            double per = static_cast<double>(ns) / static_cast<double>(flow.size());
+            if (r == 0 || per < textNs) textNs = per;
+            trades = engine.totalTrades();
+            out.close();
+            textBytes = std::filesystem::file_size(path);
+        }
+
+        double dropNs = 0;
+        double dropFlushedNs = 0;
+        uint64_t reports = 0;
+        uint64_t dropBytes = 0;
+        uint64_t dropWrites = 0;
+        for (int r = 0; r < 3; ++r) {
+            MatchingEngine engine(kDropOrders, {}, pool);
+            DropCopyConfig config;
+            config.path = path;
+            DropCopyWriter writer(config, engine.clock());
+            long long matchedNs = 0;
+            auto ns = timeNs([&]() {
+                matchedNs = timeNs([&]() {
+                    for (const OrderMsg& msg : flow) {
+                        engine.submit(msg, writer);
+                        writer.commit();
+                    }
+                });
+                writer.flush();
+            });
+            double per = static_cast<double>(matchedNs) / static_cast<double>(flow.size());
+            if (r == 0 || per < dropNs) {
+                dropNs = per;
+                dropFlushedNs = static_cast<double>(ns) / static_cast<double>(flow.size());
+            }
+            reports = writer.written();
+            dropBytes = writer.bytesWritten() + sizeof(DropCopyHeader);
+            dropWrites = writer.writes();
+        }
+
+        std::cout << std::fixed << std::setprecision(1)
+                  << "  vector<Trade> + ostream:  " << textNs << " ns/msg, "
+                  << static_cast<double>(textBytes) / static_cast<double>(trades) << " bytes/trade (" << trades
+                  << " trades, no timestamps)\n"
+                  << "  Drop copy:                " << dropNs << " ns/msg on the matching thread, " << dropFlushedNs
+                  << " ns/msg until written\n"
+                  << "                            " << static_cast<double>(dropBytes) / static_cast<double>(trades)
+                  << " bytes/trade for every event (" << reports << " reports, "
+                  << static_cast<double>(dropBytes) / static_cast<double>(reports) << " bytes each with framing, "
+                  << reports / std::max<uint64_t>(dropWrites, 1) << " per write)\n";
+
+        // The writer alone
+        Clock clock;
+        std::vector<Trade> flood;
+        flood.reserve(kFlood);
+        Timestamp now = clock.now();
+        for (size_t i = 0; i < kFlood; ++i) {
+            flood.emplace_back(static_cast<OrderId>(i), static_cast<OrderId>(i + 1), priceDist(rng), qtyDist(rng),
+                               now + std::chrono::nanoseconds(i * 50));
+        }
+        double floodSeconds = 0;
+        uint64_t floodBytes = 0;
+        uint64_t floodWrites = 0;
+        for (int r = 0; r < 3; ++r) {
+            DropCopyConfig config;
+            config.path = path;
+            DropCopyWriter writer(config, clock);
+            auto ns = timeNs([&]() {
+                for (size_t i = 0; i < kFlood; ++i) {
+                    writer.onTrade(flood[i]);
+                    if ((i & 63) == 63) writer.commit();
+                }
+                writer.commit();
+                writer.flush();
+            });
+            double seconds = static_cast<double>(ns) / 1e9;
+            if (r == 0 || seconds < floodSeconds) {
+                floodSeconds = seconds;
+                floodBytes = writer.bytesWritten();
+                floodWrites = writer.writes();
+            }
+        }
+        double textSeconds = 0;
+        for (int r = 0; r < 3; ++r) {
+            std::ofstream out(path);
+            auto ns = timeNs([&]() {
+                for (const Trade& trade : flood) out << trade << '\n';
+                out.flush();
+            });
+            double seconds = static_cast<double>(ns) / 1e9;
+            if (r == 0 || seconds < textSeconds) textSeconds = seconds;
+        }
+        uintmax_t floodText = std::filesystem::file_size(path);
+        std::filesystem::remove(path);
+
+        std::cout << "  Writer sustained:         " << static_cast<double>(kFlood) / floodSeconds / 1e6
+                  << "M trades/sec, " << static_cast<double>(floodBytes) / floodSeconds / 1e6 << " MB/s ("
+                  << kFlood / std::max<uint64_t>(floodWrites, 1) << " reports per write)\n"
+                  << "  ostream sustained:        " << static_cast<double>(kFlood) / textSeconds / 1e6
+                  << "M trades/sec, " << static_cast<double>(floodText) / textSeconds / 1e6 << " MB/s\n\n";
+        std::cout.unsetf(std::ios::fixed);
+    }
+
     return 0;
 }
@@ -0,0 +1,407 @@
+#include "Gateway.h"
+#include "Histogram.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace engine;
+
+// Load generator for the order-entry gateway: round-trip latency percentiles
+// at a series of connection counts, and the most connections it sustained
+//
+//   gateway_load [options]
+//     --host ADDR           gateway address (default 127.0.0.1)
+//     --port N              gateway port; without it a gateway, runner and
+//                           engine are started in this process on loopback
+//     --connections LIST    connection counts to step through (default 1,16,64,256,1024)
+//     --window N            orders each connection keeps in flight (default 1)
+//     --seconds S           measured time per step (default 2)
+//     --warmup S            unmeasured time at the start of each step (default 0.5)
+//     --max-p99 US          p99 round trip a step must stay under to count as sustained (default 1000)
+//     --busy-spin           in-process gateway and runner spin instead of backing off
+//     --json FILE           also write the results as JSON
+//
+// Every connection sends a limit order near mid, cancels it once it's acked
+// (rested or traded), then sends the next — so the book stays shallow. A
+// round trip is from writing a frame to reading its first report (for a
+// cancel, its Cancelled or Rejected).
+namespace {
+
+struct Options {
+    std::string host = "127.0.0.1";
+    int port = -1;
+    std::vector<size_t> connections{1, 16, 64, 256, 1024};
+    size_t window = 1;
+    double seconds = 2.0;
+    double warmup = 0.5;
+    uint64_t maxP99Us = 1000;
+    bool busySpin = false;
+    std::string jsonPath;
+};
+
+[[noreturn]] void usage(const char* argv0) {
+    std::cerr << "usage: " << argv0 << " [--host ADDR] [--port N] [--connections LIST] [--window N]\n"
+                 "       [--seconds S] [--warmup S] [--max-p99 US] [--busy-spin] [--json FILE]\n";
+    std::exit(2);
+}
+
+Options parse(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--busy-spin") {
+            options.busySpin = true;
+            continue;
+        }
+        if (i + 1 >= argc) usage(argv[0]);
+        std::string value = argv[++i];
+        if (arg == "--host") options.host = value;
+        else if (arg == "--port") options.port = std::stoi(value);
+        else if (arg == "--window") options.window = std::max<size_t>(1, std::stoull(value));
+        else if (arg == "--seconds") options.seconds = std::stod(value);
+        else if (arg == "--warmup") options.warmup = std::stod(value);
+        else if (arg == "--max-p99") options.maxP99Us = std::stoull(value);
+        else if (arg == "--json") options.jsonPath = value;
+        else if (arg == "--connections") {
+            options.connections.clear();
+            std::istringstream in(value);
+            std::string item;
+            while (std::getline(in, item, ',')) options.connections.push_back(std::stoull(item));
+            if (options.connections.empty()) usage(argv[0]);
+        } else {
+            usage(argv[0]);
+        }
+    }
+    return options;
+}
+
+uint64_t nowNs() {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+struct InFlight {
+    uint64_t id;
+    uint64_t sentAt;
+    bool cancel;
+};
+
+struct Client {
+    int fd = -1;
+    bool dropped = false;
+    uint64_t nextId = 1;
+    uint64_t completed = 0;
+    std::vector<InFlight> inFlight;
+    std::vector<char> in;
+    size_t inBytes = 0;
+    std::vector<char> out;
+};
+
+struct Step {
+    size_t connections = 0;
+    size_t connected = 0;
+    size_t dropped = 0;
+    size_t idle = 0;           // connections with no round trip measured
+    uint64_t roundTrips = 0;
+    double seconds = 0;
+    Histogram rtt;
+    GatewayStats gateway;      // in-process only: the gateway's counters over the step
+    bool sustained = false;
+};
+
+class LoadClient {
+public:
+    LoadClient(const Options& options, std::mt19937_64& rng) : options_(options), rng_(rng) {}
+
+    Step run(size_t connections, const sockaddr_in& addr);
+
+private:
+    const Options& options_;
+    std::mt19937_64& rng_;
+
+    void sendNew(Client& c, uint64_t now);
+    void sendCancel(Client& c, uint64_t id, uint64_t now);
+    void onReport(Client& c, const Report& report, uint64_t now, bool measuring, Step& step);
+};
+
+void LoadClient::sendNew(Client& c, uint64_t now) {
+    std::uniform_int_distribution<int> offset(-10, 10);
+    std::uniform_int_distribution<Quantity> qty(1, 100);
+    Side side = rng_() & 1 ? Side::Sell : Side::Buy;
+    OrderMsg msg = OrderMsg::limit(c.nextId, side, 10'000 + offset(rng_), qty(rng_));
+    size_t at = c.out.size();
+    c.out.resize(at + kOrderFrameSize);
+    encodeOrderFrame(msg, c.out.data() + at);
+    c.inFlight.push_back({c.nextId++, now, false});
+}
+
+void LoadClient::sendCancel(Client& c, uint64_t id, uint64_t now) {
+    size_t at = c.out.size();
+    c.out.resize(at + kOrderFrameSize);
+    encodeOrderFrame(OrderMsg::cancel(id), c.out.data() + at);
+    c.inFlight.push_back({id, now, true});
+}
+
+void LoadClient::onReport(Client& c, const Report& report, uint64_t now, bool measuring, Step& step) {
+    for (size_t i = 0; i < c.inFlight.size(); ++i) {
+        InFlight f = c.inFlight[i];
+        if (f.id != report.orderId) continue;
+        if (f.cancel && report.type != EventType::Cancelled && report.type != EventType::Rejected) continue;
+
+        c.inFlight[i] = c.inFlight.back();
+        c.inFlight.pop_back();
+        if (measuring) {
+            step.rtt.record(now - f.sentAt);
+            step.roundTrips++;
+            c.completed++;
+        }
+        bool acked = report.type == EventType::Rested || report.type == EventType::Trade;
+        if (!f.cancel && acked) {
+            sendCancel(c, f.id, now);
+        } else {
+            sendNew(c, now);
+        }
+        return;
+    }
+}
+
+Step LoadClient::run(size_t connections, const sockaddr_in& addr) {
+    Step step;
+    step.connections = connections;
+    std::vector<Client> clients(connections);
+
+    int epoll = ::epoll_create1(EPOLL_CLOEXEC);
+    if (epoll < 0) throw std::runtime_error("epoll_create1 failed");
+    for (size_t i = 0; i < connections; ++i) {
+        Client& c = clients[i];
+        c.fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (c.fd < 0 || ::connect(c.fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) < 0) {
+            if (c.fd >= 0) ::close(c.fd);
+            c.fd = -1;
+            c.dropped = true;
+            continue;
+        }
+        int one = 1;
+        ::setsockopt(c.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        ::fcntl(c.fd, F_SETFL, ::fcntl(c.fd, F_GETFL) | O_NONBLOCK);
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.u64 = i;
+        ::epoll_ctl(epoll, EPOLL_CTL_ADD, c.fd, &ev);
+        c.in.resize(64 * 1024);
+        step.connected++;
+    }
+
+    uint64_t start = nowNs();
+    for (Client& c : clients) {
+        if (c.fd < 0) continue;
+        for (size_t w = 0; w < options_.window; ++w) sendNew(c, start);
+    }
+
+    auto warmupNs = static_cast<uint64_t>(options_.warmup * 1e9);
+    auto endNs = start + warmupNs + static_cast<uint64_t>(options_.seconds * 1e9);
+    std::vector<epoll_event> ready(1024);
+    uint64_t measuredFrom = 0;
+    while (true) {
+        // Write everything each connection has to send — one write per connection per pass
+        for (Client& c : clients) {
+            if (c.out.empty() || c.dropped) continue;
+            ssize_t n = ::send(c.fd, c.out.data(), c.out.size(), MSG_NOSIGNAL);
+            if (n < 0 && errno != EAGAIN) {
+                c.dropped = true;
+                continue;
+            }
+            if (n > 0) c.out.erase(c.out.begin(), c.out.begin() + n);
+        }
+
+        uint64_t now = nowNs();
+        if (now >= endNs) break;
+        bool measuring = now >= start + warmupNs;
+        if (measuring && measuredFrom == 0) measuredFrom = now;
+
+        int count = ::epoll_wait(epoll, ready.data(), static_cast<int>(ready.size()), 10);
+        now = nowNs();
+        for (int e = 0; e < count; ++e) {
+            Client& c = clients[ready[e].data.u64];
+            if (c.dropped) continue;
+            while (true) {
+                ssize_t n = ::recv(c.fd, c.in.data() + c.inBytes, c.in.size() - c.inBytes, 0);
+                if (n == 0 || (n < 0 && errno != EAGAIN)) {
+                    c.dropped = true;
+                    break;
+                }
+                if (n < 0) break;
+                c.inBytes += static_cast<size_t>(n);
+                size_t used = 0;
+                for (; used + kReportFrameSize <= c.inBytes; used += kReportFrameSize) {
+                    onReport(c, decodeReport(c.in.data() + used), now, measuring, step);
+                }
+                std::memmove(c.in.data(), c.in.data() + used, c.inBytes - used);
+                c.inBytes -= used;
+            }
+        }
+    }
+    step.seconds = static_cast<double>(nowNs() - (measuredFrom ? measuredFrom : start)) / 1e9;
+
+    for (Client& c : clients) {
+        if (c.fd >= 0) {
+            if (c.dropped) step.dropped++;
+            else if (c.completed == 0) step.idle++;
+            ::close(c.fd);
+        } else {
+            step.dropped++;
+        }
+    }
+    ::close(epoll);
+
+    step.sustained = step.dropped == 0 && step.idle == 0 && step.rtt.count() > 0 &&
+                     step.rtt.percentile(99) <= options_.maxP99Us * 1000;
+    return step;
+}
+
+void raiseFileLimit() {
+    rlimit limit;
+    if (::getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        ::setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+double us(uint64_t ns) { return static_cast<double>(ns) / 1000.0; }
+
+void printStep(const Step& s) {
+    std::cout << std::setw(8) << s.connections << std::setw(12) << static_cast<uint64_t>(static_cast<double>(s.roundTrips) / s.seconds)
+              << std::fixed << std::setprecision(1) << std::setw(9) << us(s.rtt.percentile(50)) << std::setw(9)
+              << us(s.rtt.percentile(90)) << std::setw(9) << us(s.rtt.percentile(99)) << std::setw(10)
+              << us(s.rtt.percentile(99.9)) << std::setw(10) << us(s.rtt.max()) << std::defaultfloat << std::setw(9)
+              << s.dropped << std::setw(7) << s.idle << "  " << (s.sustained ? "yes" : "no") << "\n";
+}
+
+void writeJson(const std::string& path, const Options& options, const std::vector<Step>& steps, size_t sustained) {
+    std::ofstream out(path);
+    out << "{\n  \"window\": " << options.window << ",\n  \"seconds\": " << options.seconds
+        << ",\n  \"max_p99_us\": " << options.maxP99Us << ",\n  \"sustained_connections\": " << sustained
+        << ",\n  \"steps\": [";
+    for (size_t i = 0; i < steps.size(); ++i) {
+        const Step& s = steps[i];
+        out << (i ? "," : "") << "\n    {\"connections\": " << s.connections << ", \"connected\": " << s.connected
+            << ", \"dropped\": " << s.dropped << ", \"idle\": " << s.idle << ", \"round_trips\": " << s.roundTrips
+            << ", \"seconds\": " << s.seconds << ", \"rtt_ns\": {\"p50\": " << s.rtt.percentile(50)
+            << ", \"p90\": " << s.rtt.percentile(90) << ", \"p99\": " << s.rtt.percentile(99)
+            << ", \"p99_9\": " << s.rtt.percentile(99.9) << ", \"max\": " << s.rtt.max()
+            << "}, \"gateway_syscalls\": " << s.gateway.syscalls << ", \"gateway_receives\": " << s.gateway.receives
+            << ", \"gateway_frames\": " << s.gateway.frames << ", \"sustained\": " << (s.sustained ? "true" : "false")
+            << "}";
+    }
+    out << "\n  ]\n}\n";
+    if (!out) throw std::runtime_error("Can't write " + path);
+}
+
+GatewayStats since(const GatewayStats& now, const GatewayStats& before) {
+    GatewayStats d = now;
+    d.frames -= before.frames;
+    d.receives -= before.receives;
+    d.syscalls -= before.syscalls;
+    d.reports -= before.reports;
+    return d;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options = parse(argc, argv);
+    raiseFileLimit();
+
+    try {
+        size_t most = *std::max_element(options.connections.begin(), options.connections.end());
+        WaitStrategy wait = options.busySpin ? WaitStrategy::BusySpin : WaitStrategy::Backoff;
+
+        // Without --port, serve from this process
+        std::unique_ptr<MatchingEngine> engine;
+        std::unique_ptr<EngineRunner> runner;
+        std::unique_ptr<Gateway> gateway;
+        if (options.port < 0) {
+            engine = std::make_unique<MatchingEngine>(1 << 20);
+            RunnerConfig rc;
+            rc.wait = wait;
+            runner = std::make_unique<EngineRunner>(*engine, rc);
+            GatewayConfig gc;
+            gc.address = "127.0.0.1";
+            gc.maxConnections = most;
+            gc.wait = wait;
+            gateway = std::make_unique<Gateway>(*runner, gc);
+            options.port = gateway->port();
+            runner->start();
+            gateway->start();
+        }
+
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(options.port));
+        if (::inet_pton(AF_INET, options.host.c_str(), &addr.sin_addr) != 1) {
+            std::cerr << "gateway_load: bad address " << options.host << "\n";
+            return 2;
+        }
+
+        std::cout << "Gateway " << options.host << ":" << options.port << (gateway ? " (in process)" : "")
+                  << ", window " << options.window << ", " << options.seconds << " s per step, sustained = no drops and p99 <= "
+                  << options.maxP99Us << " us\n\n"
+                  << "   conns   trips/sec  p50(us)  p90(us)  p99(us) p99.9(us)   max(us)  dropped  idle  sustained\n";
+
+        std::mt19937_64 rng(42);
+        LoadClient client(options, rng);
+        std::vector<Step> steps;
+        size_t sustained = 0;
+        for (size_t connections : options.connections) {
+            GatewayStats before = gateway ? gateway->stats() : GatewayStats{};
+            Step step = client.run(connections, addr);
+            if (gateway) step.gateway = since(gateway->stats(), before);
+            printStep(step);
+            if (step.sustained) sustained = std::max(sustained, connections);
+            steps.push_back(std::move(step));
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));   // let the gateway free the slots
+        }
+
+        std::cout << "\nSustained up to " << sustained << " connections\n";
+        if (gateway) {
+            GatewayStats total = gateway->stats();
+            std::cout << "Gateway: " << total.frames << " frames in " << total.receives << " receives, "
+                      << total.syscalls << " io_uring_enter calls ("
+                      << std::fixed << std::setprecision(1)
+                      << (total.syscalls ? static_cast<double>(total.frames) / static_cast<double>(total.syscalls) : 0.0)
+                      << std::defaultfloat << " frames per syscall), " << total.refused << " refused\n";
+            gateway->stop();
+            runner->stop();
+        }
+
+        if (!options.jsonPath.empty()) {
+            writeJson(options.jsonPath, options, steps, sustained);
+            std::cout << "\nResults written to " << options.jsonPath << "\n";
+        }
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "gateway_load: " << e.what() << "\n";
+        return 2;
+    }
+}
@@ -0,0 +1,82 @@
+#include "Gateway.h"
+
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+using namespace engine;
+
+// Serve one matching engine over the binary order-entry protocol (Protocol.h)
+// until SIGINT or SIGTERM
+//
+//   gateway_server [options]
+//     --address ADDR        address to listen on (default 0.0.0.0)
+//     --port N              port to listen on (default 9000)
+//     --max-connections N   connections served at once (default 1024)
+//     --symbols N           books, for symbols 0..N-1 (default 1)
+//     --gateway-cpu N       core to pin the gateway thread to
+//     --engine-cpu N        core to pin the matching thread to
+//     --busy-spin           spin when idle instead of backing off
+namespace {
+
+[[noreturn]] void usage(const char* argv0) {
+    std::cerr << "usage: " << argv0 << " [--address ADDR] [--port N] [--max-connections N] [--symbols N]\n"
+                 "       [--gateway-cpu N] [--engine-cpu N] [--busy-spin]\n";
+    std::exit(2);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    GatewayConfig gc;
+    gc.port = 9000;
+    RunnerConfig rc;
+    size_t symbols = 1;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--busy-spin") {
+            gc.wait = rc.wait = WaitStrategy::BusySpin;
+            continue;
+        }
+        if (i + 1 >= argc) usage(argv[0]);
+        std::string value = argv[++i];
+        if (arg == "--address") gc.address = value;
+        else if (arg == "--port") gc.port = static_cast<uint16_t>(std::stoul(value));
+        else if (arg == "--max-connections") gc.maxConnections = std::stoull(value);
+        else if (arg == "--symbols") symbols = std::stoull(value);
+        else if (arg == "--gateway-cpu") gc.cpu = std::stoi(value);
+        else if (arg == "--engine-cpu") rc.cpu = std::stoi(value);
+        else usage(argv[0]);
+    }
+
+    // Block the signals here so every thread inherits the mask and sigwait gets them
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    try {
+        MatchingEngine engine(2'000'000, {}, {}, Clock(), symbols);
+        EngineRunner runner(engine, rc);
+        Gateway gateway(runner, gc);
+        runner.start();
+        gateway.start();
+        std::cout << "Listening on " << gc.address << ":" << gateway.port() << "\n";
+
+        int signal = 0;
+        sigwait(&signals, &signal);
+
+        gateway.stop();
+        runner.stop();
+        GatewayStats s = gateway.stats();
+        std::cout << "Served " << s.accepted << " connections (" << s.refused << " refused, " << s.slowClients
+                  << " dropped as slow): " << s.frames << " frames, " << s.badFrames << " bad, " << s.reports
+                  << " reports, " << s.syscalls << " io_uring_enter calls\n";
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "gateway_server: " << e.what() << "\n";
+        return 2;
+    }
+}
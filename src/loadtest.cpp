@@ -0,0 +1,257 @@
+#include "MatchingEngine.h"
+#include "Histogram.h"
+#include "Workload.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+using namespace engine;
+
+// Drive the engine with a synthetic or recorded order flow and report
+// throughput and per-message-type latency percentiles
+//
+//   loadtest [options]
+//     --messages N          measured messages to generate (default 1000000)
+//     --seed N              generator seed
+//     --symbols N           books to spread the flow over
+//     --mix N,C,M,K         weights of new / cancel / modify / market messages
+//     --zipf S              Zipf exponent of the distance from mid (0 = uniform)
+//     --max-distance N      furthest a new order rests from mid, in ticks
+//     --depth N             resting orders to build before measuring
+//     --calm-rate R         arrivals per second outside bursts
+//     --burst-rate R        arrivals per second inside bursts
+//     --burst-chance P      chance each calm message starts a burst
+//     --burst-length N      mean burst length in messages
+//     --no-prefault         leave the order pool's pages to fault in during the run
+//     --paced               submit at the generated arrival times; latency
+//                           then includes queueing behind a burst
+//     --replay FILE         use a saved workload or a journal instead of generating
+//     --save FILE           write the generated workload for later --replay
+//     --json FILE           also write the results as JSON
+namespace {
+
+enum Kind : size_t { Limit, Market, Cancel, Modify, KindCount };
+const char* const kKindNames[KindCount] = {"limit", "market", "cancel", "modify"};
+
+Kind kindOf(const OrderMsg& msg) {
+    switch (msg.type) {
+    case MsgType::NewLimit:
+    case MsgType::NewStop: return Limit;
+    case MsgType::NewMarket: return Market;
+    case MsgType::Cancel: return Cancel;
+    case MsgType::Modify: return Modify;
+    case MsgType::StartAuction:
+    case MsgType::Uncross: break;
+    }
+    return Limit;
+}
+
+struct Options {
+    WorkloadConfig workload;
+    bool paced = false;
+    bool prefault = true;
+    std::string replayPath;
+    std::string savePath;
+    std::string jsonPath;
+};
+
+[[noreturn]] void usage(const char* argv0) {
+    std::cerr << "usage: " << argv0 << " [--messages N] [--seed N] [--symbols N] [--mix N,C,M,K] [--zipf S]\n"
+                 "       [--max-distance N] [--depth N] [--calm-rate R] [--burst-rate R] [--burst-chance P]\n"
+                 "       [--burst-length N] [--no-prefault] [--paced] [--replay FILE] [--save FILE] [--json FILE]\n";
+    std::exit(2);
+}
+
+Options parse(int argc, char** argv) {
+    Options options;
+    WorkloadConfig& w = options.workload;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--paced") {
+            options.paced = true;
+            continue;
+        }
+        if (arg == "--no-prefault") {
+            options.prefault = false;
+            continue;
+        }
+        if (i + 1 >= argc) usage(argv[0]);
+        std::string value = argv[++i];
+        if (arg == "--messages") w.messages = std::stoull(value);
+        else if (arg == "--seed") w.seed = std::stoull(value);
+        else if (arg == "--symbols") w.symbols = static_cast<SymbolId>(std::stoul(value));
+        else if (arg == "--zipf") w.zipfExponent = std::stod(value);
+        else if (arg == "--max-distance") w.maxDistance = static_cast<uint32_t>(std::stoul(value));
+        else if (arg == "--depth") w.initialDepth = std::stoull(value);
+        else if (arg == "--calm-rate") w.calmRate = std::stod(value);
+        else if (arg == "--burst-rate") w.burstRate = std::stod(value);
+        else if (arg == "--burst-chance") w.burstChance = std::stod(value);
+        else if (arg == "--burst-length") w.burstLength = std::stoull(value);
+        else if (arg == "--replay") options.replayPath = value;
+        else if (arg == "--save") options.savePath = value;
+        else if (arg == "--json") options.jsonPath = value;
+        else if (arg == "--mix") {
+            std::istringstream in(value);
+            char comma;
+            if (!(in >> w.newWeight >> comma >> w.cancelWeight >> comma >> w.modifyWeight >> comma >> w.marketWeight)) {
+                usage(argv[0]);
+            }
+        } else {
+            usage(argv[0]);
+        }
+    }
+    return options;
+}
+
+struct Results {
+    double seconds = 0;
+    uint64_t measured = 0;
+    uint64_t rejected = 0;
+    uint64_t trades = 0;
+    Histogram all;
+    Histogram byKind[KindCount];
+    uint64_t rejectedByKind[KindCount] = {};
+};
+
+void writeStats(std::ostream& out, const Histogram& h) {
+    out << "{\"count\": " << h.count() << ", \"min\": " << h.min() << ", \"mean\": " << std::fixed
+        << std::setprecision(1) << h.mean() << std::defaultfloat << ", \"p50\": " << h.percentile(50)
+        << ", \"p90\": " << h.percentile(90) << ", \"p99\": " << h.percentile(99)
+        << ", \"p99_9\": " << h.percentile(99.9) << ", \"p99_99\": " << h.percentile(99.99)
+        << ", \"max\": " << h.max() << "}";
+}
+
+void writeJson(const std::string& path, const Options& options, const Results& r) {
+    std::ofstream out(path);
+    const WorkloadConfig& w = options.workload;
+    out << "{\n  \"workload\": ";
+    if (!options.replayPath.empty()) {
+        out << "{\"replay\": \"" << options.replayPath << "\"}";
+    } else {
+        out << "{\"messages\": " << w.messages << ", \"seed\": " << w.seed << ", \"symbols\": " << w.symbols
+            << ", \"mix\": [" << w.newWeight << ", " << w.cancelWeight << ", " << w.modifyWeight << ", "
+            << w.marketWeight << "], \"zipf\": " << w.zipfExponent << ", \"max_distance\": " << w.maxDistance
+            << ", \"depth\": " << w.initialDepth << ", \"calm_rate\": " << w.calmRate
+            << ", \"burst_rate\": " << w.burstRate << ", \"burst_chance\": " << w.burstChance
+            << ", \"burst_length\": " << w.burstLength << "}";
+    }
+    out << ",\n  \"paced\": " << (options.paced ? "true" : "false")
+        << ",\n  \"prefault\": " << (options.prefault ? "true" : "false")
+        << ",\n  \"messages\": " << r.measured
+        << ",\n  \"rejected\": " << r.rejected
+        << ",\n  \"trades\": " << r.trades
+        << ",\n  \"seconds\": " << r.seconds
+        << ",\n  \"throughput\": " << static_cast<uint64_t>(r.measured / r.seconds)
+        << ",\n  \"latency_ns\": {\n    \"all\": ";
+    writeStats(out, r.all);
+    for (size_t k = 0; k < KindCount; ++k) {
+        out << ",\n    \"" << kKindNames[k] << "\": ";
+        writeStats(out, r.byKind[k]);
+    }
+    out << "\n  }\n}\n";
+    if (!out) throw std::runtime_error("Can't write " + path);
+}
+
+void printRow(const char* name, const Histogram& h, uint64_t rejected) {
+    std::cout << "  " << std::left << std::setw(8) << name << std::right << std::setw(10) << h.count()
+              << std::setw(8) << h.percentile(50) << std::setw(8) << h.percentile(90) << std::setw(8)
+              << h.percentile(99) << std::setw(9) << h.percentile(99.9) << std::setw(10) << h.percentile(99.99)
+              << std::setw(10) << h.max() << std::setw(10) << rejected << "\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options = parse(argc, argv);
+
+    try {
+        Workload workload = options.replayPath.empty() ? generateWorkload(options.workload)
+                                                       : loadWorkload(options.replayPath);
+        if (!options.savePath.empty()) {
+            saveWorkload(workload, options.savePath);
+            std::cout << "Saved " << workload.messages.size() << " messages to " << options.savePath << "\n";
+        }
+        if (options.paced && workload.arrivalNs.size() != workload.messages.size()) {
+            std::cerr << "loadtest: --paced needs arrival times (a recorded journal has none)\n";
+            return 2;
+        }
+
+        SymbolId symbols = 1;
+        for (const OrderMsg& msg : workload.messages) symbols = std::max<SymbolId>(symbols, msg.symbol + 1);
+
+        PoolOptions pool;
+        pool.growable = true;
+        pool.prefault = options.prefault;
+        MatchingEngine engine(1 << 20, {}, pool, Clock(), symbols);
+        EventListener ignore;
+
+        for (size_t i = 0; i < workload.warmup; ++i) {
+            engine.submit(workload.messages[i], ignore);
+        }
+
+        const TscCalibration& tsc = TscCalibration::get();
+        const double nsPerTick = tsc.nsPerTick();
+        const double ticksPerNs = tsc.ticksPerNs();
+        Results r;
+        uint64_t tradesBefore = engine.totalTrades();
+
+        uint64_t begin = readTscSerialized();
+        for (size_t i = workload.warmup; i < workload.messages.size(); ++i) {
+            const OrderMsg& msg = workload.messages[i];
+            uint64_t start;
+            if (options.paced) {
+                // Measure from when the message was due, so time spent stuck behind a burst counts
+                start = begin + static_cast<uint64_t>(static_cast<double>(workload.arrivalNs[i]) * ticksPerNs);
+                while (readTsc() < start) {}
+            } else {
+                start = readTsc();
+            }
+
+            bool accepted;
+            try {
+                accepted = engine.submit(msg, ignore);
+            } catch (const std::exception&) {
+                accepted = false;
+            }
+            uint64_t end = readTscSerialized();
+
+            auto ns = static_cast<uint64_t>(static_cast<double>(end - start) * nsPerTick);
+            Kind kind = kindOf(msg);
+            r.all.record(ns);
+            r.byKind[kind].record(ns);
+            if (!accepted) {
+                r.rejected++;
+                r.rejectedByKind[kind]++;
+            }
+        }
+        r.seconds = static_cast<double>(readTscSerialized() - begin) * nsPerTick / 1e9;
+        r.measured = workload.messages.size() - workload.warmup;
+        r.trades = engine.totalTrades() - tradesBefore;
+
+        std::cout << "Workload: " << (options.replayPath.empty() ? std::string("generated") : options.replayPath)
+                  << ", " << r.measured << " messages measured after " << workload.warmup << " warmup"
+                  << (options.paced ? ", paced" : ", flat out") << "\n"
+                  << "  Throughput: " << static_cast<uint64_t>(r.measured / r.seconds) << " msgs/sec, "
+                  << r.trades << " trades, " << r.rejected << " rejected or missed\n\n"
+                  << "  latency (ns)   count     p50     p90     p99    p99.9   p99.99       max  rejected\n";
+        printRow("all", r.all, r.rejected);
+        for (size_t k = 0; k < KindCount; ++k) {
+            printRow(kKindNames[k], r.byKind[k], r.rejectedByKind[k]);
+        }
+
+        if (!options.jsonPath.empty()) {
+            writeJson(options.jsonPath, options, r);
+            std::cout << "\nResults written to " << options.jsonPath << "\n";
+        }
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "loadtest: " << e.what() << "\n";
+        return 2;
+    }
+}
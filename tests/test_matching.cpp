@@ -1,6 +1,35 @@
 #include "MatchingEngine.h"
+#include "EngineRunner.h"
+#include "ShardedRunner.h"
+#include "Journal.h"
+#include "Snapshot.h"
+#include "MarketData.h"
+#include "Histogram.h"
+#include "Workload.h"
+#include "Instrumentation.h"
+#include "Protocol.h"
+#include "Backtest.h"
+#include "Replication.h"
+#include "DropCopy.h"
 #include <iostream>
+#include <cstring>
 #include <cassert>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <algorithm>
+#include <thread>
+#include <random>
+#include <tuple>
+#include <vector>
+
+#if defined(__linux__)
+#include "Gateway.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
 
 using namespace engine;
 
@@ -140,6 +169,2329 @@ void testMultipleFillsAtSameLevel() {
     check(engine.book().orderCount() == 1, "One sell order remains");
 }
 
+void testBestPriceAfterLevelEmpties() {
+    std::cout << "\n--- Test: Best Price After Level Empties ---\n";
+    MatchingEngine engine;
+
+    engine.submitLimit(1, Side::Buy, 10000, 50);
+    engine.submitLimit(2, Side::Buy, 9990, 50);
+    engine.submitLimit(3, Side::Buy, 9900, 50);
+
+    engine.cancel(1);
+    check(engine.book().bestBid().value() == 9990, "Best bid moves to next level after cancel");
+
+    engine.submitLimit(4, Side::Sell, 9990, 50);
+    check(engine.book().bestBid().value() == 9900, "Best bid skips gap after level is matched away");
+    check(engine.book().bidLevelCount() == 1, "Only one bid level left");
+}
+
+void testLadderRecenter() {
+    std::cout << "\n--- Test: Ladder Re-centers on Price Drift ---\n";
+    BookConfig config;
+    config.ladderLevels = 64;
+    config.basePrice = 10000;
+    MatchingEngine engine(1000, config);
+
+    engine.submitLimit(1, Side::Sell, 10010, 10);
+    engine.submitLimit(2, Side::Sell, 10500, 20);   // outside the window
+    engine.submitLimit(3, Side::Sell, 9000, 30);    // outside on the other side
+
+    check(engine.book().askLevelCount() == 3, "All levels kept after re-centering");
+    check(engine.book().bestAsk().value() == 9000, "Best ask is correct after re-centering");
+
+    auto trades = engine.submitMarket(4, Side::Buy, 60);
+    check(trades.size() == 3, "Sweep walks all levels in price order");
+    check(trades[1].price == 10010 && trades[2].price == 10500, "Levels kept their orders");
+    check(engine.book().orderCount() == 0, "Book is empty after sweep");
+
+    // An outlier too far from the resting levels to share a window is refused before it trades
+    MatchingEngine outlier(1000);
+    outlier.submitLimit(1, Side::Buy, 100, 10);
+    outlier.submitLimit(2, Side::Sell, 200, 10);
+    auto refused = [&](auto submit) {
+        try {
+            submit();
+        } catch (const std::invalid_argument&) {
+            return true;
+        }
+        return false;
+    };
+    check(refused([&]() { outlier.submitLimit(3, Side::Buy, 100 + (Price{1} << 36), 20); })
+              && outlier.totalTrades() == 0 && outlier.book().bidLevelCount() == 1 && outlier.poolInUse() == 2,
+          "A crossing order priced outside any window is refused without trading");
+    check(refused([&]() { outlier.submitLimit(4, Side::Sell, INT64_MAX, 5); })
+              && refused([&]() { outlier.modify(1, INT64_MIN + 1, 10); }) && outlier.book().bestBid() == 100,
+          "Prices at the ends of the range are refused, and an amend to one leaves the order alone");
+    std::vector<EngineEvent> events;
+    EventBuffer sink(outlier.clock(), events);
+    outlier.submitStop(0, 5, Side::Buy, 300, 5, sink);
+    events.clear();
+    check(refused([&]() { outlier.submitStop(0, 6, Side::Buy, Price{1} << 40, 5, sink); }) && events.empty()
+              && outlier.book().stopCount() == 1,
+          "A stop price too far from the parked stops is refused");
+    BookConfig capped;
+    capped.ladderLevels = 64;
+    capped.maxLadderLevels = 256;
+    MatchingEngine small(1000, capped);
+    small.submitLimit(1, Side::Buy, 1000, 10);
+    small.submitLimit(2, Side::Buy, 1100, 10);
+    check(refused([&]() { small.submitLimit(3, Side::Buy, 1200, 10); }) && small.book().bids().capacity() <= 256,
+          "The window grows up to maxLadderLevels and no further");
+}
+
+void testTickSize() {
+    std::cout << "\n--- Test: Tick Size ---\n";
+    BookConfig config;
+    config.tickSize = 5;
+    MatchingEngine engine(1000, config);
+
+    engine.submitLimit(1, Side::Buy, 10000, 10);
+    engine.submitLimit(2, Side::Buy, 10005, 10);
+    check(engine.book().bestBid().value() == 10005, "Best bid on tick grid");
+
+    bool threw = false;
+    try {
+        engine.submitLimit(3, Side::Sell, 10002, 10);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    check(threw, "Off-tick price is rejected");
+    check(engine.book().orderCount() == 2, "Rejected order did not trade or rest");
+}
+
+void testCancelFromMiddleOfLevel() {
+    std::cout << "\n--- Test: Cancel From Middle of Level ---\n";
+    MatchingEngine engine;
+
+    engine.submitLimit(1, Side::Sell, 10000, 10);
+    engine.submitLimit(2, Side::Sell, 10000, 20);
+    engine.submitLimit(3, Side::Sell, 10000, 30);
+
+    engine.cancel(2);
+
+    auto trades = engine.submitLimit(4, Side::Buy, 10000, 40);
+    check(trades.size() == 2, "Cancelled order skipped");
+    check(trades[0].sellOrderId == 1 && trades[1].sellOrderId == 3, "FIFO order kept around the gap");
+    check(engine.book().askLevelCount() == 0, "Level removed once empty");
+}
+
+void testOrderIndex() {
+    std::cout << "\n--- Test: Order ID Index ---\n";
+    const int N = 5000;
+    std::mt19937_64 rng(1);
+
+    OrderPool pool(N);
+    std::vector<Order*> orders;
+    orders.reserve(N);
+    for (int i = 0; i < N; ++i) {
+        orders.push_back(acquireOrder(pool, rng(), Side::Buy, OrderType::Limit, 10000, 10));
+    }
+
+    OrderIndex index(pool, N * 2);
+    for (Order* order : orders) {
+        index.insert(order->id, order);
+    }
+    for (int i = 0; i < N; i += 2) {
+        index.erase(orders[i]->id);
+    }
+
+    bool allFound = true;
+    bool noneStale = true;
+    for (int i = 0; i < N; ++i) {
+        Order* found = index.find(orders[i]->id);
+        if (i % 2 == 0 && found) noneStale = false;
+        if (i % 2 == 1 && found != orders[i]) allFound = false;
+    }
+    check(allFound, "Hashed index finds every live id after deletes");
+    check(noneStale, "Hashed index forgets erased ids");
+    check(index.size() == N / 2, "Hashed index size tracks inserts and erases");
+    check(!index.erase(orders[0]->id), "Erasing a missing id returns false");
+
+    // IDs that differ only above bit 32 share a key; both must stay distinct
+    OrderIndex shared(pool, 64);
+    Order* low = orders[1];
+    Order* high = orders[3];
+    low->id = 5;
+    high->id = 5 + (1ull << 32);
+    shared.insert(low->id, low);
+    shared.insert(high->id, high);
+    check(shared.find(5) == low && shared.find(5 + (1ull << 32)) == high, "IDs sharing their low 32 bits are both found");
+    check(shared.erase(5) && shared.find(5 + (1ull << 32)) == high, "Erasing one leaves the other");
+}
+
+void testDirectIndexMode() {
+    std::cout << "\n--- Test: Direct Index Mode ---\n";
+    const int N = 1000;
+
+    OrderPool pool(N);
+    std::vector<Order*> orders;
+    orders.reserve(N);
+    for (int i = 0; i < N; ++i) {
+        orders.push_back(acquireOrder(pool, static_cast<OrderId>(i), Side::Buy, OrderType::Limit, 10000, 10));
+    }
+
+    // IDs keep rolling forward past the index size; only the live ones must fit
+    OrderIndex index(pool, 16, IndexMode::Direct);
+    for (int i = 0; i < N; ++i) {
+        index.insert(orders[i]->id, orders[i]);
+        if (i >= 8) index.erase(orders[i - 8]->id);
+    }
+    check(index.size() == 8, "Only the last 8 ids are live");
+    check(index.find(N - 1) == orders[N - 1], "Latest id found through direct index");
+    check(index.find(N - 16 - 1) == nullptr, "Old id that shares a slot is not found");
+
+    BookConfig config;
+    config.indexMode = IndexMode::Direct;
+    MatchingEngine engine(1000, config);
+    engine.submitLimit(7, Side::Buy, 10000, 10);
+    check(engine.cancel(7), "Engine cancels through direct index");
+
+    // An ID whose slot is taken, or one already live, is refused before it trades or links
+    auto refused = [](auto submit) {
+        try {
+            submit();
+        } catch (const std::invalid_argument&) {
+            return true;
+        }
+        return false;
+    };
+    MatchingEngine small(16, config);   // 32 index slots
+    small.submitLimit(1, Side::Buy, 100, 10);
+    small.submitLimit(2, Side::Sell, 101, 10);
+    check(refused([&]() { small.submitLimit(33, Side::Buy, 101, 10); }) && small.totalTrades() == 0
+              && small.book().orderCount() == 2 && small.book().bidLevelCount() == 1 && small.poolInUse() == 2,
+          "A direct index collision is refused with the book untouched");
+    check(refused([&]() { small.submitLimit(1, Side::Buy, 99, 10); }) && small.book().bidLevelCount() == 1
+              && small.poolInUse() == 2,
+          "A duplicate live ID is refused without adding a level");
+    std::vector<EngineEvent> events;
+    EventBuffer sink(small.clock(), events);
+    check(refused([&]() { small.submitStop(0, 34, Side::Buy, 105, 5, sink); }) && small.book().stopCount() == 0
+              && small.poolInUse() == 2,
+          "A stop whose direct index slot is taken is refused");
+    check(small.cancel(1) && small.cancel(2) && small.poolInUse() == 0, "The resting orders can still be cancelled");
+
+    MatchingEngine hashed(1000);
+    hashed.submitLimit(1, Side::Sell, 100, 10);
+    check(refused([&]() { hashed.submitLimit(1, Side::Buy, 100, 5); }) && hashed.totalTrades() == 0
+              && refused([&]() { hashed.submitStop(0, 1, Side::Sell, 90, 5, sink); }) && hashed.poolInUse() == 1,
+          "A hashed index refuses a duplicate live ID too");
+}
+
+// Records every event so tests can check what the engine reported
+struct RecordingListener : EventListener {
+    std::vector<Trade> trades;
+    std::vector<OrderId> filled;
+    std::vector<OrderId> rested;
+    std::vector<OrderId> cancelled;
+
+    void onTrade(const Trade& trade) { trades.push_back(trade); }
+    void onOrderFilled(const Order& order) { filled.push_back(order.id); }
+    void onOrderRested(const Order& order) { rested.push_back(order.id); }
+    void onOrderCancelled(const Order& order) { cancelled.push_back(order.id); }
+};
+
+void testListenerEvents() {
+    std::cout << "\n--- Test: Listener Events ---\n";
+    MatchingEngine engine;
+    RecordingListener events;
+
+    engine.submitLimit(1, Side::Sell, 10000, 30, events);
+    engine.submitLimit(2, Side::Sell, 10100, 30, events);
+    check(events.rested.size() == 2, "Non-crossing orders reported as rested");
+
+    engine.submitLimit(3, Side::Buy, 10000, 50, events);
+    check(events.trades.size() == 1 && events.trades[0].quantity == 30, "Trade reported during match");
+    check(events.filled.size() == 1 && events.filled[0] == 1, "Filled resting order reported");
+    check(events.rested.size() == 3 && events.rested[2] == 3, "Remainder of incoming order reported as rested");
+
+    engine.submitMarket(4, Side::Buy, 40, events);
+    check(events.filled.size() == 2 && events.filled[1] == 2, "Market sweep fills resting order");
+    check(events.cancelled.size() == 1 && events.cancelled[0] == 4, "Unfilled market remainder reported as cancelled");
+
+    check(engine.cancel(3, events), "Cancel through listener API");
+    check(events.cancelled.size() == 2 && events.cancelled[1] == 3, "Cancel reported to listener");
+    check(engine.totalTrades() == 2, "Trade count kept with listener API");
+}
+
+void testCancelReleasesPoolSlot() {
+    std::cout << "\n--- Test: Cancel Releases Pool Slot ---\n";
+    MatchingEngine engine(16);
+
+    // Far more orders than slots — only works if cancel gives slots back
+    bool threw = false;
+    try {
+        for (OrderId id = 0; id < 10'000; ++id) {
+            engine.submitLimit(id, Side::Buy, 10000 + static_cast<Price>(id % 7), 10);
+            engine.cancel(id);
+        }
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    check(!threw, "Cancel-heavy flow doesn't exhaust the pool");
+    check(engine.poolInUse() == 0, "No slots held after every order is cancelled");
+}
+
+void testGrowablePool() {
+    std::cout << "\n--- Test: Growable Pool ---\n";
+    MatchingEngine fixed(4);
+    bool threw = false;
+    try {
+        for (OrderId id = 0; id < 5; ++id) fixed.submitLimit(id, Side::Buy, 10000, 10);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    check(threw, "Fixed pool throws when exhausted");
+
+    PoolOptions options;
+    options.growable = true;
+    MatchingEngine growing(4, {}, options);
+    for (OrderId id = 0; id < 100; ++id) {
+        growing.submitLimit(id, Side::Buy, 10000 + static_cast<Price>(id), 10);
+    }
+    check(growing.book().orderCount() == 100, "Growable pool adds chunks instead of throwing");
+    check(growing.book().bestBid().value() == 10099, "Orders in later chunks are matched normally");
+
+    auto trades = growing.submitMarket(1000, Side::Sell, 1000);
+    check(trades.size() == 100 && growing.poolInUse() == 0, "All chunks' slots returned after sweep");
+}
+
+void testPoolBackingOptions() {
+    std::cout << "\n--- Test: Pool Backing Options ---\n";
+
+    for (PageBacking backing : {PageBacking::Heap, PageBacking::TransparentHuge, PageBacking::HugeTlb}) {
+        PoolOptions options;
+        options.backing = backing;
+        options.prefault = true;
+        options.lockMemory = true;
+        options.numaNode = PoolOptions::kLocalNumaNode;
+        MatchingEngine engine(1000, {}, options);
+
+        engine.submitLimit(1, Side::Sell, 10000, 50);
+        auto trades = engine.submitLimit(2, Side::Buy, 10000, 50);
+        bool expectedBacking = backing == PageBacking::HugeTlb
+            ? engine.poolBacking() != PageBacking::Heap     // falls back to THP without reserved pages
+            : engine.poolBacking() == backing;
+        check(trades.size() == 1 && expectedBacking, "Engine matches on prefaulted, locked, NUMA-bound pool");
+    }
+}
+
+void testOrderMeta() {
+    std::cout << "\n--- Test: Cold Order Metadata ---\n";
+    MatchingEngine engine(1000);
+
+    // Reads the cold side array while the order is alive
+    struct MetaListener : EventListener {
+        const MatchingEngine* engine = nullptr;
+        Quantity restedQuantity = 0;
+        Quantity restedRemaining = 0;
+        void onOrderRested(const Order& order) {
+            restedQuantity = engine->orderMeta(order).quantity;
+            restedRemaining = order.remaining;
+        }
+    } listener;
+    listener.engine = &engine;
+
+    engine.submitLimit(1, Side::Sell, 10000, 30);
+    engine.submitLimit(2, Side::Buy, 10000, 100, listener);
+    check(listener.restedQuantity == 100, "Original quantity kept in cold metadata");
+    check(listener.restedRemaining == 70, "Remaining quantity kept in hot order");
+}
+
+void testClockSources() {
+    std::cout << "\n--- Test: Clock Sources ---\n";
+
+    Clock tsc(ClockSource::Tsc, false);
+    Timestamp steadyNow = now();
+    Timestamp tscNow = tsc.now();
+    auto diff = std::chrono::abs(tscNow - steadyNow);
+    check(diff < std::chrono::milliseconds(1), "Calibrated TSC clock agrees with steady_clock");
+
+    Timestamp later = tsc.now();
+    check(later >= tscNow, "TSC clock doesn't go backwards");
+
+    // One stamp per message: every trade in a sweep shares the message time
+    MatchingEngine perMessage(1000, {}, {}, Clock(ClockSource::Tsc, true));
+    for (OrderId id = 1; id <= 5; ++id) perMessage.submitLimit(id, Side::Sell, 10000 + static_cast<Price>(id), 10);
+    auto trades = perMessage.submitMarket(10, Side::Buy, 50);
+    bool shared = trades.size() == 5;
+    for (const Trade& t : trades) shared = shared && t.timestamp == trades[0].timestamp;
+    check(shared, "Trades from one message share its timestamp");
+
+    // Restamping each trade keeps them in order
+    MatchingEngine perTrade(1000, {}, {}, Clock(ClockSource::Steady, false));
+    for (OrderId id = 1; id <= 5; ++id) perTrade.submitLimit(id, Side::Sell, 10000 + static_cast<Price>(id), 10);
+    trades = perTrade.submitMarket(10, Side::Buy, 50);
+    bool ordered = trades.size() == 5;
+    for (size_t i = 1; i < trades.size(); ++i) ordered = ordered && trades[i].timestamp >= trades[i - 1].timestamp;
+    check(ordered, "Per-trade timestamps are non-decreasing");
+}
+
+void testSpscRing() {
+    std::cout << "\n--- Test: SPSC Ring ---\n";
+
+    SpscRing<int> ring(5);
+    check(ring.capacity() == 8, "Capacity rounds up to a power of two");
+
+    int pushed = 0;
+    while (ring.tryPush(pushed)) pushed++;
+    check(pushed == 8 && ring.size() == 8, "Push fails once the ring is full");
+
+    int value = -1;
+    bool fifo = true;
+    for (int i = 0; i < 3; ++i) fifo = fifo && ring.tryPop(value) && value == i;
+    check(fifo, "Pops come out in push order");
+
+    // Wrap around the end of the buffer
+    for (int i = 8; i < 11; ++i) ring.tryPush(i);
+    int batch[16];
+    size_t n = ring.popBatch(batch, 16);
+    bool inOrder = n == 8;
+    for (size_t i = 0; i < n; ++i) inOrder = inOrder && batch[i] == static_cast<int>(i) + 3;
+    check(inOrder, "Batch pop drains across the wrap point in order");
+    check(ring.empty() && !ring.tryPop(value), "Ring is empty after draining");
+}
+
+void testEngineRunner() {
+    std::cout << "\n--- Test: Engine Runner ---\n";
+
+    MatchingEngine engine(1000);
+    RunnerConfig config;
+    config.wait = WaitStrategy::Backoff;
+    EngineRunner runner(engine, config);
+    runner.start();
+
+    runner.submit(OrderMsg::limit(1, Side::Sell, 10000, 100));
+    runner.submit(OrderMsg::limit(2, Side::Buy, 10000, 40));
+    runner.submit(OrderMsg::cancel(99));
+    runner.submit(OrderMsg::limit(3, Side::Buy, 10001, 10));
+    runner.submit(OrderMsg::cancel(1));
+
+    std::vector<EngineEvent> events;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (runner.processed() < 5 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+    runner.stop();
+    EngineEvent e;
+    while (runner.poll(e)) events.push_back(e);
+
+    check(runner.processed() == 5, "Runner processed every message");
+    check(!events.empty() && events[0].type == EventType::Rested && events[0].orderId == 1,
+          "Resting sell is acknowledged");
+
+    auto trade = std::find_if(events.begin(), events.end(), [](const EngineEvent& ev) { return ev.type == EventType::Trade; });
+    check(trade != events.end() && trade->orderId == 2 && trade->otherId == 1 && trade->quantity == 40
+              && trade->side == Side::Buy,
+          "Trade event names the aggressor and the resting order");
+
+    auto rejected = std::find_if(events.begin(), events.end(), [](const EngineEvent& ev) { return ev.type == EventType::Rejected; });
+    check(rejected != events.end() && rejected->orderId == 99, "Cancel of an unknown order is rejected");
+
+    check(!events.empty() && events.back().type == EventType::Cancelled && events.back().orderId == 1
+              && events.back().quantity == 50,
+          "Cancel reports the remaining quantity");
+    check(engine.book().orderCount() == 0 && engine.totalTrades() == 2, "Engine state matches the events");
+}
+
+void testMultiSymbolEngine() {
+    std::cout << "\n--- Test: Multi-Symbol Engine ---\n";
+
+    BookConfig config;
+    config.ladderLevels = 64;
+    MatchingEngine engine(1000, config, {}, Clock(), 4);
+    check(engine.symbolCount() == 4, "Engine has one book per symbol");
+
+    engine.submitLimit(1, 1, Side::Sell, 10000, 100);
+    auto trades = engine.submitLimit(2, 2, Side::Buy, 10000, 100);
+    check(trades.empty(), "Orders in different symbols don't cross");
+    check(engine.book(1).orderCount() == 1 && engine.book(2).orderCount() == 1, "Each order rests in its own book");
+
+    trades = engine.submitLimit(1, 3, Side::Buy, 10000, 40);
+    check(trades.size() == 1 && trades[0].symbol == 1 && trades[0].sellOrderId == 1,
+          "Trade is tagged with its symbol");
+
+    check(engine.cancel(2) && engine.book(2).orderCount() == 0, "Cancel by ID finds the order's book");
+    check(engine.book(1).orderCount() == 1, "Other books are untouched");
+
+    bool threw = false;
+    try {
+        engine.submitLimit(4, 5, Side::Buy, 10000, 10);
+    } catch (const std::out_of_range&) {
+        threw = true;
+    }
+    check(threw && engine.poolInUse() == 1, "Unknown symbol is rejected before touching the pool");
+}
+
+void testShardedRunner() {
+    std::cout << "\n--- Test: Sharded Runner ---\n";
+
+    ShardConfig config;
+    config.shardCount = 2;
+    config.symbolCount = 5;
+    config.poolSizePerShard = 1000;
+    config.bookConfig.ladderLevels = 64;
+    ShardedRunner runner(config);
+    check(runner.shardCount() == 2 && runner.shardOf(2) == 0 && runner.shardOf(3) == 1,
+          "Symbols are split into contiguous ranges");
+
+    runner.start();
+    // The same order ID can be used in two shards
+    runner.submit(OrderMsg::limit(1, Side::Sell, 10000, 50, 0));
+    runner.submit(OrderMsg::limit(1, Side::Sell, 10000, 50, 4));
+    runner.submit(OrderMsg::limit(2, Side::Buy, 10000, 50, 4));
+    runner.submit(OrderMsg::cancel(1, 0));
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (runner.processed() < 4 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+    runner.stop();
+
+    std::vector<EngineEvent> events;
+    EngineEvent e;
+    while (runner.poll(e)) events.push_back(e);
+
+    auto trade = std::find_if(events.begin(), events.end(), [](const EngineEvent& ev) { return ev.type == EventType::Trade; });
+    check(trade != events.end() && trade->symbol == 4 && trade->orderId == 2 && trade->otherId == 1,
+          "Trade comes back with the global symbol");
+    check(std::count_if(events.begin(), events.end(), [](const EngineEvent& ev) {
+              return ev.type == EventType::Cancelled && ev.symbol == 0;
+          }) == 1,
+          "Cancel is routed to the owning shard");
+    check(runner.engine(0).book(0).orderCount() == 0 && runner.engine(1).book(1).orderCount() == 0,
+          "Each shard's engine holds its own books");
+
+    // Writers fed by one matching thread can't be shared by every shard
+    auto refused = [](const ShardConfig& bad) {
+        try {
+            ShardedRunner shared(bad);
+        } catch (const std::invalid_argument&) {
+            return true;
+        }
+        return false;
+    };
+    ShardConfig snapshots = config;
+    snapshots.runner.snapshotPath = "shards.snapshot";
+    snapshots.runner.snapshotEvery = 100;
+    std::string path = (std::filesystem::temp_directory_path() / "matching_engine_shards.dropcopy").string();
+    MatchingEngine engine(16);
+    DropCopyConfig dropConfig;
+    dropConfig.path = path;
+    DropCopyWriter dropCopy(dropConfig, engine.clock());
+    ShardConfig dropCopied = config;
+    dropCopied.runner.dropCopy = &dropCopy;
+    check(refused(snapshots) && refused(dropCopied), "A shared snapshot path or drop copy is refused");
+    std::filesystem::remove(path);
+}
+
+void testJournalReplay() {
+    std::cout << "\n--- Test: Journal Replay ---\n";
+
+    std::string path = (std::filesystem::temp_directory_path() / "matching_engine_test.journal").string();
+    BookConfig config;
+    config.ladderLevels = 64;
+
+    // Original run: a random flow through the runner, journaled
+    MatchingEngine original(10'000, config, {}, Clock(), 2);
+    TradeDigest liveDigest;
+    size_t rejected = 0;
+    {
+        JournalConfig journalConfig;
+        journalConfig.path = path;
+        journalConfig.syncBatch = 64;
+        JournalWriter journal(journalConfig, original);
+
+        RunnerConfig runnerConfig;
+        runnerConfig.journal = &journal;
+        EngineRunner runner(original, runnerConfig);
+        runner.start();
+
+        std::mt19937 rng(7);
+        const int MESSAGES = 2000;
+        for (int i = 1; i <= MESSAGES; ++i) {
+            auto id = static_cast<OrderId>(i);
+            auto symbol = static_cast<SymbolId>(rng() % 2);
+            Side side = rng() % 2 ? Side::Buy : Side::Sell;
+            OrderMsg msg = rng() % 5 == 0 ? OrderMsg::cancel(rng() % i + 1, symbol)
+                         : OrderMsg::limit(id, side, 9990 + static_cast<Price>(rng() % 20), 1 + rng() % 50, symbol);
+            while (!runner.submit(msg)) std::this_thread::yield();
+        }
+        while (runner.processed() < MESSAGES) std::this_thread::yield();
+        runner.stop();
+        check(journal.durable() == journal.appended(), "Stopping the runner makes the journal durable");
+
+        EngineEvent e;
+        while (runner.poll(e)) {
+            if (e.type == EventType::Trade) liveDigest.count++;
+            if (e.type == EventType::Rejected) rejected++;
+        }
+        check(journal.appended() == MESSAGES - rejected, "Only accepted messages are journaled");
+    }
+
+    // Replay into a fresh engine of the same shape
+    JournalReader reader(path);
+    auto replayed = reader.header().shape.makeEngine();
+    check(replayed->symbolCount() == 2 && replayed->poolSize() == 10'000, "Journal header describes the engine");
+
+    EventListener ignore;
+    ReplayResult result = replayJournal(reader, *replayed, ignore);
+    check(result.matched && result.digest.count == liveDigest.count, "Replay reproduces the trade sequence");
+
+    bool sameBooks = replayed->poolInUse() == original.poolInUse();
+    for (SymbolId s = 0; s < 2; ++s) {
+        sameBooks = sameBooks && replayed->book(s).orderCount() == original.book(s).orderCount()
+                 && replayed->book(s).bestBid() == original.book(s).bestBid()
+                 && replayed->book(s).bestAsk() == original.book(s).bestAsk()
+                 && replayed->book(s).bidLevelCount() == original.book(s).bidLevelCount();
+    }
+    check(sameBooks, "Replayed books and pool match the original");
+
+    // A torn record at the end (crash mid-write) is ignored
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::app);
+        out.write("torn", 4);
+    }
+    JournalReader torn(path);
+    auto again = torn.header().shape.makeEngine();
+    result = replayJournal(torn, *again, ignore);
+    check(result.matched && result.digest.count == liveDigest.count, "Torn tail record is skipped");
+
+    // Replaying onto a book that already has state diverges
+    JournalReader diverging(path);
+    auto dirty = diverging.header().shape.makeEngine();
+    dirty->submitLimit(0, 999'999, Side::Buy, 10'100, 1'000);
+    result = replayJournal(diverging, *dirty, ignore);
+    check(!result.matched && result.mismatchSequence > 0, "Replay detects a diverging trade sequence");
+
+    std::filesystem::remove(path);
+}
+
+// Same resting state, level by level, in two engines
+bool sameBooks(const MatchingEngine& a, const MatchingEngine& b) {
+    if (a.symbolCount() != b.symbolCount() || a.poolInUse() != b.poolInUse()
+        || a.totalTrades() != b.totalTrades() || a.totalOrders() != b.totalOrders()) {
+        return false;
+    }
+    for (SymbolId s = 0; s < a.symbolCount(); ++s) {
+        const OrderBook& x = a.book(s);
+        const OrderBook& y = b.book(s);
+        if (x.orderCount() != y.orderCount() || x.bestBid() != y.bestBid() || x.bestAsk() != y.bestAsk()
+            || x.bidLevelCount() != y.bidLevelCount() || x.askLevelCount() != y.askLevelCount()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Random limits and cancels across the engine's symbols
+void randomFlow(MatchingEngine& engine, std::mt19937& rng, OrderId firstId, int count) {
+    for (int i = 0; i < count; ++i) {
+        OrderId id = firstId + static_cast<OrderId>(i);
+        auto symbol = static_cast<SymbolId>(rng() % engine.symbolCount());
+        if (rng() % 4 == 0) {
+            engine.cancel(firstId + rng() % (i + 1));
+            continue;
+        }
+        Side side = rng() % 2 ? Side::Buy : Side::Sell;
+        engine.submitLimit(symbol, id, side, 9990 + static_cast<Price>(rng() % 20), 1 + rng() % 50);
+    }
+}
+
+void testSnapshotRoundTrip() {
+    std::cout << "\n--- Test: Snapshot Round Trip ---\n";
+
+    std::string path = (std::filesystem::temp_directory_path() / "matching_engine_test.snapshot").string();
+    BookConfig config;
+    config.ladderLevels = 64;
+    MatchingEngine original(10'000, config, {}, Clock(), 3);
+    std::mt19937 rng(11);
+    randomFlow(original, rng, 1, 3000);
+
+    SnapshotInfo info;
+    info.journalSequence = 1234;
+    writeSnapshot(original, path, info);
+    check(!std::filesystem::exists(path + ".tmp"), "Snapshot is renamed into place");
+
+    LoadedSnapshot loaded = loadSnapshot(path);
+    check(loaded.info.journalSequence == 1234, "Snapshot records its journal position");
+    check(sameBooks(original, *loaded.engine), "Loaded books, pool usage and counters match");
+
+    OrderId someResting = 0;
+    for (OrderId id = 3000; id > 0 && !someResting; --id) {
+        if (loaded.engine->cancel(id)) someResting = id;
+    }
+    check(someResting != 0 && original.cancel(someResting), "Loaded index finds resting orders by ID");
+
+    // Sweeping both books must fill in exactly the same order — FIFO links survived
+    std::vector<Trade> a;
+    std::vector<Trade> b;
+    for (SymbolId s = 0; s < 3; ++s) {
+        for (Side side : {Side::Buy, Side::Sell}) {
+            auto ta = original.submitMarket(s, 900'000 + s * 2 + (side == Side::Buy), side, 1'000'000);
+            auto tb = loaded.engine->submitMarket(s, 900'000 + s * 2 + (side == Side::Buy), side, 1'000'000);
+            a.insert(a.end(), ta.begin(), ta.end());
+            b.insert(b.end(), tb.begin(), tb.end());
+        }
+    }
+    bool sameTrades = !a.empty() && a.size() == b.size();
+    for (size_t i = 0; sameTrades && i < a.size(); ++i) {
+        sameTrades = a[i].buyOrderId == b[i].buyOrderId && a[i].sellOrderId == b[i].sellOrderId
+                  && a[i].price == b[i].price && a[i].quantity == b[i].quantity;
+    }
+    check(sameTrades, "Loaded book matches in the same time priority");
+
+    // And they keep agreeing on new flow after that
+    std::mt19937 rngA(5);
+    std::mt19937 rngB(5);
+    randomFlow(original, rngA, 1'000'000, 1000);
+    randomFlow(*loaded.engine, rngB, 1'000'000, 1000);
+    check(sameBooks(original, *loaded.engine), "Engines stay identical after the snapshot");
+
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << "garbage";
+    bool threw = false;
+    try {
+        loadSnapshot(path);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    check(threw, "Corrupt snapshot is rejected");
+    std::filesystem::remove(path);
+}
+
+void testSnapshotRecovery() {
+    std::cout << "\n--- Test: Forked Snapshot + Journal Recovery ---\n";
+
+    auto dir = std::filesystem::temp_directory_path();
+    std::string snapshotPath = (dir / "matching_engine_recover.snapshot").string();
+    std::string journalPath = (dir / "matching_engine_recover.journal").string();
+    std::filesystem::remove(snapshotPath);
+
+    BookConfig config;
+    config.ladderLevels = 64;
+    MatchingEngine original(10'000, config, {}, Clock(), 2);
+    const int MESSAGES = 3000;
+    uint64_t written = 0;
+    {
+        JournalConfig journalConfig;
+        journalConfig.path = journalPath;
+        JournalWriter journal(journalConfig, original);
+
+        RunnerConfig runnerConfig;
+        runnerConfig.journal = &journal;
+        runnerConfig.snapshotPath = snapshotPath;
+        runnerConfig.snapshotEvery = 1000;
+        runnerConfig.batchSize = 16;
+        EngineRunner runner(original, runnerConfig);
+        runner.start();
+
+        std::mt19937 rng(3);
+        for (int i = 1; i <= MESSAGES; ++i) {
+            Side side = rng() % 2 ? Side::Buy : Side::Sell;
+            auto symbol = static_cast<SymbolId>(rng() % 2);
+            OrderMsg msg = rng() % 4 == 0 ? OrderMsg::cancel(rng() % i + 1, symbol)
+                         : OrderMsg::limit(static_cast<OrderId>(i), side, 9990 + static_cast<Price>(rng() % 20),
+                                           1 + rng() % 50, symbol);
+            while (!runner.submit(msg)) std::this_thread::yield();
+            // Let the matching thread catch up now and then so it gets to snapshot mid-flow
+            if (i % 500 == 0) {
+                while (runner.processed() < static_cast<uint64_t>(i)) std::this_thread::yield();
+            }
+        }
+        while (runner.processed() < MESSAGES) std::this_thread::yield();
+        runner.stop();
+        written = runner.snapshotsWritten();
+        check(written >= 1 && runner.snapshotsFailed() == 0, "Runner forked snapshots while matching");
+    }
+
+    Recovery recovered = recover(snapshotPath, journalPath);
+    check(recovered.fromSnapshot && recovered.snapshot.journalSequence > 0, "Recovery starts from the snapshot");
+    check(recovered.tail.matched && recovered.tail.messages < static_cast<uint64_t>(MESSAGES),
+          "Only the journal tail is replayed");
+    check(sameBooks(original, *recovered.engine), "Recovered engine matches the one that stopped");
+
+    // Restarted engine keeps appending to the same journal
+    {
+        JournalConfig journalConfig;
+        journalConfig.path = journalPath;
+        journalConfig.append = true;
+        JournalWriter journal(journalConfig, *recovered.engine);
+        uint64_t before = journal.appended();
+
+        RunnerConfig runnerConfig;
+        runnerConfig.journal = &journal;
+        EngineRunner runner(*recovered.engine, runnerConfig);
+        runner.start();
+        runner.submit(OrderMsg::limit(50'000, Side::Buy, 10'100, 10'000, 0));
+        while (runner.processed() < 1) std::this_thread::yield();
+        runner.stop();
+        check(journal.appended() == before + 1, "Reopened journal continues the sequence");
+    }
+    JournalReader reader(journalPath);
+    auto fresh = reader.header().shape.makeEngine();
+    EventListener ignore;
+    ReplayResult full = replayJournal(reader, *fresh, ignore);
+    check(full.matched && sameBooks(*fresh, *recovered.engine), "Full replay of the continued journal agrees");
+
+    // A journal written under self-trade prevention recovers only with the same limits attached
+    std::string riskPath = (dir / "matching_engine_recover_risk.journal").string();
+    RiskLimits stpLimits;
+    stpLimits.preventSelfTrade = true;
+    RiskTable liveRisk(3);
+    liveRisk.setLimits(1, stpLimits);
+    MatchingEngine guarded(1000);
+    guarded.enforceRisk(&liveRisk);
+    {
+        JournalConfig journalConfig;
+        journalConfig.path = riskPath;
+        JournalWriter journal(journalConfig, guarded);
+
+        RunnerConfig runnerConfig;
+        runnerConfig.journal = &journal;
+        EngineRunner runner(guarded, runnerConfig);
+        runner.start();
+        runner.submit(OrderMsg::limit(1, Side::Sell, 100, 10).from(1));
+        runner.submit(OrderMsg::limit(2, Side::Buy, 100, 10).from(1));    // cancels 1 instead of trading it
+        runner.submit(OrderMsg::limit(3, Side::Sell, 100, 4).from(2));
+        while (runner.processed() < 3) std::this_thread::yield();
+        runner.stop();
+    }
+    bool diverged = false;
+    try {
+        recover("", riskPath);
+    } catch (const std::runtime_error&) {
+        diverged = true;
+    }
+    check(diverged, "Recovering a self-trade-prevented journal without its risk table diverges");
+    RiskTable recoveredRisk(3);
+    recoveredRisk.setLimits(1, stpLimits);
+    Recovery withRisk = recover("", riskPath, Clock(), &recoveredRisk);
+    check(withRisk.tail.matched && withRisk.tail.messages == 3 && withRisk.tail.digest.count == 1
+              && sameBooks(guarded, *withRisk.engine) && recoveredRisk.openQuantity(1) == liveRisk.openQuantity(1),
+          "With the same limits attached, recovery reproduces the trades, books and exposure");
+
+    std::filesystem::remove(snapshotPath);
+    std::filesystem::remove(journalPath);
+    std::filesystem::remove(riskPath);
+}
+
+void testSubmitBatch() {
+    std::cout << "\n--- Test: Batch Submission ---\n";
+
+    // Same flow one message at a time and in batches of 64
+    std::mt19937 rng(21);
+    std::vector<OrderMsg> flow;
+    for (OrderId id = 1; id <= 2000; ++id) {
+        auto symbol = static_cast<SymbolId>(rng() % 2);
+        if (rng() % 4 == 0) {
+            flow.push_back(OrderMsg::cancel(1 + rng() % id, symbol));
+        } else if (rng() % 10 == 0) {
+            flow.push_back(OrderMsg::market(id, rng() % 2 ? Side::Buy : Side::Sell, 1 + rng() % 50, symbol));
+        } else {
+            flow.push_back(OrderMsg::limit(id, rng() % 2 ? Side::Buy : Side::Sell,
+                                           9990 + static_cast<Price>(rng() % 20), 1 + rng() % 50, symbol));
+        }
+    }
+
+    MatchingEngine single(10'000, {}, {}, Clock(), 2);
+    MatchingEngine batched(10'000, {}, {}, Clock(), 2);
+    std::vector<EngineEvent> singleEvents, batchEvents;
+    EventBuffer singleSink(single.clock(), singleEvents);
+    EventBuffer batchSink(batched.clock(), batchEvents);
+
+    size_t singleAccepted = 0;
+    for (const OrderMsg& msg : flow) {
+        if (single.submit(msg, singleSink)) {
+            singleAccepted++;
+        } else {
+            singleSink.onRejected(msg);
+        }
+    }
+    size_t batchAccepted = 0;
+    for (size_t i = 0; i < flow.size(); i += 64) {
+        size_t n = std::min<size_t>(64, flow.size() - i);
+        batchAccepted += batched.submitBatch(std::span<const OrderMsg>(flow.data() + i, n), batchSink);
+    }
+
+    bool sameEvents = singleEvents.size() == batchEvents.size();
+    for (size_t i = 0; sameEvents && i < singleEvents.size(); ++i) {
+        const EngineEvent& a = singleEvents[i];
+        const EngineEvent& b = batchEvents[i];
+        sameEvents = a.type == b.type && a.side == b.side && a.symbol == b.symbol && a.orderId == b.orderId
+                  && a.otherId == b.otherId && a.price == b.price && a.quantity == b.quantity;
+    }
+    check(batchAccepted == singleAccepted, "Batch accepts the same messages");
+    check(sameEvents, "Batch produces the same events in the same order");
+    check(sameBooks(single, batched), "Batch leaves the same books");
+
+    // A bad message is rejected in place and the rest of the batch still runs
+    MatchingEngine engine(100);
+    std::vector<EngineEvent> events;
+    EventBuffer sink(engine.clock(), events);
+    OrderMsg burst[] = {
+        OrderMsg::limit(1, Side::Sell, 100, 10),
+        OrderMsg::limit(2, Side::Buy, 100, 10, 7),      // no such symbol
+        OrderMsg::cancel(42),                           // no such order
+        OrderMsg::limit(3, Side::Buy, 100, 4),
+    };
+    size_t accepted = engine.submitBatch(std::span<const OrderMsg>(burst), sink);
+    check(accepted == 2, "Rejected messages aren't counted as accepted");
+    size_t rejected = std::count_if(events.begin(), events.end(),
+                                    [](const EngineEvent& e) { return e.type == EventType::Rejected; });
+    check(rejected == 2 && events[1].type == EventType::Rejected && events[1].orderId == 2,
+          "Rejections are reported in message order");
+    check(events.back().type == EventType::Filled && events.back().orderId == 3, "Messages after a rejection still match");
+
+    auto trade = std::find_if(events.begin(), events.end(), [](const EngineEvent& e) { return e.type == EventType::Trade; });
+    check(trade != events.end() && trade->orderId == 3 && trade->otherId == 1 && trade->side == Side::Buy,
+          "Trade events name the aggressor first");
+
+    bool oneStamp = std::all_of(events.begin(), events.end(),
+                                [&](const EngineEvent& e) { return e.timestamp == events.front().timestamp; });
+    check(oneStamp, "The whole batch shares one timestamp");
+}
+
+void testL2Publisher() {
+    std::cout << "\n--- Test: L2 Publisher ---\n";
+
+    MatchingEngine engine(1000, {}, {}, Clock(), 2);
+    L2Publisher feed(engine);
+    auto same = [](const LevelUpdate& u, SymbolId symbol, Side side, Price price, Quantity qty, uint32_t count) {
+        return u.symbol == symbol && u.side == side && u.price == price && u.totalQuantity == qty && u.orderCount == count;
+    };
+
+    engine.submitLimit(0, 1, Side::Sell, 100, 10);
+    engine.submitLimit(0, 2, Side::Sell, 101, 5);
+    auto updates = feed.publish();
+    check(updates.size() == 2 && same(updates[0], 0, Side::Sell, 100, 10, 1) && same(updates[1], 0, Side::Sell, 101, 5, 1),
+          "Resting orders publish their levels");
+    check(feed.publish().empty(), "Nothing changed, nothing published");
+
+    engine.submitMarket(0, 3, Side::Buy, 12);
+    updates = feed.publish();
+    check(updates.size() == 2 && same(updates[0], 0, Side::Sell, 100, 0, 0) && same(updates[1], 0, Side::Sell, 101, 3, 1),
+          "A sweep publishes the emptied and the partly filled level");
+
+    engine.cancel(2);
+    updates = feed.publish();
+    check(updates.size() == 1 && same(updates[0], 0, Side::Sell, 101, 0, 0), "Cancelling the last order removes the level");
+
+    // Many touches of one level in a batch collapse into one update
+    std::vector<EngineEvent> events;
+    EventBuffer sink(engine.clock(), events);
+    OrderMsg burst[] = {
+        OrderMsg::limit(10, Side::Buy, 99, 1, 1),
+        OrderMsg::limit(11, Side::Buy, 99, 2, 1),
+        OrderMsg::limit(12, Side::Buy, 99, 3, 1),
+        OrderMsg::cancel(11, 1),
+        OrderMsg::limit(13, Side::Sell, 105, 4, 1),
+    };
+    engine.submitBatch(std::span<const OrderMsg>(burst), sink);
+    check(feed.pending() == 5, "Every touch is logged");
+    updates = feed.publish();
+    check(updates.size() == 2 && same(updates[0], 1, Side::Buy, 99, 4, 2) && same(updates[1], 1, Side::Sell, 105, 4, 1),
+          "A batch publishes each changed level once");
+
+    // Top-N depth
+    for (Price p = 90; p < 95; ++p) {
+        engine.submitLimit(0, 100 + static_cast<OrderId>(p), Side::Buy, p, 10);
+    }
+    engine.submitLimit(0, 300, Side::Buy, 94, 5);
+    DepthLevel depth[3];
+    size_t n = engine.book(0).depth(Side::Buy, depth, 3);
+    check(n == 3 && depth[0].price == 94 && depth[0].totalQuantity == 15 && depth[0].orderCount == 2
+              && depth[1].price == 93 && depth[2].price == 92, "Depth copies the best levels first");
+    check(engine.book(0).depth(Side::Sell, depth, 3) == 0, "Depth of an empty side is empty");
+}
+
+void testTopOfBook() {
+    std::cout << "\n--- Test: Seqlock Top of Book ---\n";
+
+    MatchingEngine engine(50'000, {}, {}, Clock(), 2);
+    BboTable table(2);
+    engine.submitLimit(1, 1, Side::Buy, 99, 10);
+    engine.publishTopOfBook(&table);
+
+    TopOfBook top = table[1].read();
+    check(top.hasBid() && !top.hasAsk() && top.bidPrice == 99 && top.bidQuantity == 10 && top.sequence == 1,
+          "Attaching publishes the current BBO");
+    check(!table[0].read().hasBid() && table[0].sequence() == 0, "An empty book publishes nothing");
+
+    engine.submitLimit(1, 2, Side::Sell, 101, 5);
+    engine.submitLimit(1, 3, Side::Buy, 99, 7);
+    top = table[1].read();
+    check(top.bidQuantity == 17 && top.bidOrders == 2 && top.askPrice == 101 && top.askQuantity == 5 && top.sequence == 3,
+          "Each change bumps the sequence");
+
+    engine.submitLimit(1, 4, Side::Buy, 90, 1);   // behind the best bid
+    check(table[1].sequence() == 3, "A change away from the top publishes nothing");
+
+    engine.submitMarket(1, 5, Side::Buy, 5);
+    engine.cancel(1);
+    top = table[1].read();
+    check(!top.hasAsk() && top.bidQuantity == 7 && top.bidOrders == 1, "Trades and cancels update the BBO");
+
+    bool threw = false;
+    try {
+        BboTable small(1);
+        engine.publishTopOfBook(&small);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    check(threw, "A table smaller than the symbol count is refused");
+
+    // A reader on another thread never sees a torn quote: every order is
+    // 10 lots at one price on each side, so size is always 10x the count
+    std::atomic<bool> done{false};
+    std::atomic<bool> torn{false};
+    std::atomic<uint64_t> reads{0};
+    std::thread reader([&]() {
+        Waiter waiter(WaitStrategy::Backoff);
+        do {
+            TopOfBook quote = table[0].read();
+            if (quote.bidQuantity != quote.bidOrders * 10 || quote.askQuantity != quote.askOrders * 10
+                || (quote.hasBid() && quote.bidPrice != 50) || (quote.hasAsk() && quote.askPrice != 60)) {
+                torn.store(true);
+            }
+            reads.fetch_add(1, std::memory_order_relaxed);
+            waiter.idle();   // one core in CI: let the writer run
+        } while (!done.load(std::memory_order_acquire));
+    });
+    // Don't let the writer finish before the reader has even started
+    Waiter startWait(WaitStrategy::Backoff);
+    while (reads.load() == 0) startWait.idle();
+    for (OrderId id = 100; id < 20'100; ++id) {
+        Side side = id % 2 ? Side::Buy : Side::Sell;
+        engine.submitLimit(0, id, side, side == Side::Buy ? 50 : 60, 10);
+        if (id % 3 == 0) engine.cancel(id - 1);
+    }
+    done.store(true, std::memory_order_release);
+    reader.join();
+    check(!torn.load() && reads.load() > 0, "Concurrent reads are always consistent");
+}
+
+void testModify() {
+    std::cout << "\n--- Test: Modify / Cancel-Replace ---\n";
+
+    BookConfig config;
+    config.tickSize = 5;
+    MatchingEngine engine(100, config);
+    engine.submitLimit(1, Side::Buy, 100, 10);
+    engine.submitLimit(2, Side::Buy, 100, 10);
+    size_t inUse = engine.poolInUse();
+
+    check(engine.modify(1, 100, 4), "Amend down accepted");
+    check(engine.book().top().bidQuantity == 14 && engine.poolInUse() == inUse, "Amend down updates the level in place");
+    auto trades = engine.submitLimit(10, Side::Sell, 100, 5);
+    check(trades.size() == 2 && trades[0].buyOrderId == 1 && trades[0].quantity == 4 && trades[1].buyOrderId == 2,
+          "Amended-down order keeps its queue position");
+
+    // Order 2 has 9 left; raising it sends it behind order 3
+    engine.submitLimit(3, Side::Buy, 100, 10);
+    check(engine.modify(2, 100, 20), "Amend up accepted");
+    trades = engine.submitLimit(11, Side::Sell, 100, 10);
+    check(trades.size() == 1 && trades[0].buyOrderId == 3, "Amend up loses queue position");
+
+    // A new price that crosses trades, then the rest rests at the new price
+    engine.submitLimit(12, Side::Sell, 110, 5);
+    inUse = engine.poolInUse();
+    std::vector<EngineEvent> events;
+    EventBuffer sink(engine.clock(), events);
+    check(engine.submit(OrderMsg::modify(2, 110, 20), sink), "Price change accepted");
+    check(events.size() == 4 && events[0].type == EventType::Modified && events[1].type == EventType::Trade
+              && events[1].orderId == 2 && events[1].otherId == 12 && events[1].side == Side::Buy
+              && events[3].type == EventType::Rested && events[3].quantity == 15,
+          "Crossing modify reports the amend, the trade and the new resting quantity");
+    check(engine.book().bestBid() == 110 && engine.poolInUse() == inUse - 1, "Replaced order reuses its pool slot");
+
+    bool threw = false;
+    try {
+        engine.modify(2, 112, 20);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    check(threw && engine.book().bestBid() == 110 && engine.book().top().bidQuantity == 15,
+          "Off-tick modify throws and leaves the order alone");
+
+    check(!engine.modify(999, 100, 1), "Modify of an unknown order is refused");
+    check(engine.modify(2, 110, 0) && !engine.book().bestBid(), "Modify to zero cancels");
+    check(!engine.cancel(2), "Cancelled by modify means gone");
+}
+
+void testExtendedOrderTypes() {
+    std::cout << "\n--- Test: IOC / FOK / Post-Only / Iceberg ---\n";
+
+    MatchingEngine engine(1000);
+    std::vector<EngineEvent> events;
+    EventBuffer sink(engine.clock(), events);
+
+    // IOC trades what it can and cancels the rest
+    engine.submitLimit(1, Side::Sell, 100, 5);
+    check(engine.submitIoc(0, 2, Side::Buy, 101, 8, sink), "IOC accepted");
+    check(events.size() == 3 && events[0].type == EventType::Trade && events[0].quantity == 5
+              && events[2].type == EventType::Cancelled && events[2].quantity == 3,
+          "IOC fills what crosses and cancels the remainder");
+    check(!engine.book().bestBid() && engine.poolInUse() == 0, "IOC never rests");
+
+    // FOK either fills completely or touches nothing
+    engine.submitLimit(3, Side::Sell, 100, 5);
+    engine.submitLimit(4, Side::Sell, 101, 5);
+    engine.submitLimit(5, Side::Sell, 103, 50);
+    events.clear();
+    check(!engine.submitFok(0, 6, Side::Buy, 101, 12, sink), "FOK that can't fill is rejected");
+    check(events.empty() && engine.book().orderCount() == 3 && engine.book().top().askQuantity == 5,
+          "Rejected FOK leaves the book untouched");
+    check(engine.submitFok(0, 7, Side::Buy, 101, 10, sink) && events.back().type == EventType::Filled
+              && engine.book().bestAsk() == 103, "FOK that can fill sweeps both levels");
+    check(!engine.submit(OrderMsg::fok(8, Side::Buy, 102, 1), sink), "FOK by message is rejected the same way");
+
+    // Post-only rests or is rejected
+    check(!engine.submitPostOnly(0, 9, Side::Buy, 103, 5, sink), "Post-only that would cross is rejected");
+    check(engine.submitPostOnly(0, 10, Side::Buy, 102, 5, sink) && engine.book().bestBid() == 102,
+          "Post-only that doesn't cross rests");
+    check(!engine.modify(10, 103, 5) && engine.book().bestBid() == 102, "Post-only can't be modified into a cross");
+
+    // Iceberg shows one slice at a time and goes to the back when it refills
+    MatchingEngine ice(1000);
+    std::vector<Trade> trades;
+    TradeCollector collector(trades);
+    ice.submitIceberg(0, 50, Side::Sell, 110, 25, 10, collector);
+    ice.submitLimit(51, Side::Sell, 110, 5);
+    check(ice.book().top().askQuantity == 15 && ice.book().top().askOrders == 2, "Only the iceberg's slice is displayed");
+    size_t inUse = ice.poolInUse();
+
+    ice.submitLimit(0, 52, Side::Buy, 110, 12, collector);
+    check(trades.size() == 2 && trades[0].sellOrderId == 50 && trades[0].quantity == 10
+              && trades[1].sellOrderId == 51 && trades[1].quantity == 2,
+          "Refilled iceberg loses priority to the order behind it");
+    check(ice.book().top().askQuantity == 13 && ice.poolInUse() == inUse, "Refill reuses the slot and shows the next slice");
+
+    // Snapshot keeps the reserve
+    std::string path = (std::filesystem::temp_directory_path() / "matching_engine_iceberg.snapshot").string();
+    writeSnapshot(ice, path);
+    LoadedSnapshot loaded = loadSnapshot(path);
+    std::filesystem::remove(path);
+
+    check(ice.modify(50, 110, 12) && ice.book().top().askQuantity == 13, "Amend-down trims the reserve first");
+    trades = ice.submitMarket(53, Side::Buy, 100);
+    Quantity taken = 0;
+    for (const Trade& t : trades) taken += t.quantity;
+    check(taken == 15 && !ice.book().bestAsk(), "Iceberg fills slice by slice until its reserve is gone");
+
+    std::vector<Trade> fromSnapshot;
+    TradeCollector snapshotCollector(fromSnapshot);
+    loaded.engine->submitMarket(0, 53, Side::Buy, 100, snapshotCollector);
+    Quantity snapshotTaken = 0;
+    for (const Trade& t : fromSnapshot) snapshotTaken += t.quantity;
+    check(snapshotTaken == 18, "Snapshot restores the iceberg's hidden reserve");
+
+    bool threw = false;
+    try {
+        ice.submitIceberg(0, 60, Side::Buy, 100, 10, 0, collector);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    check(threw, "Iceberg without a peak is refused");
+}
+
+void testHistogram() {
+    std::cout << "\n--- Test: Latency Histogram ---\n";
+
+    Histogram h;
+    check(h.count() == 0 && h.percentile(99) == 0, "Empty histogram reports zeros");
+
+    // 1..100000 once each: the p-th percentile is p * 1000
+    for (uint64_t v = 1; v <= 100'000; ++v) h.record(v);
+    check(h.count() == 100'000, "Every value counted");
+    check(h.min() == 1 && h.max() == 100'000, "Min and max are exact");
+    bool accurate = true;
+    for (double p : {50.0, 90.0, 99.0, 99.9, 99.99}) {
+        double expected = p * 1000;
+        double got = static_cast<double>(h.percentile(p));
+        if (got < expected || got > expected * 1.001) accurate = false;
+    }
+    check(accurate, "Percentiles within 0.1% above the true value");
+    check(h.percentile(100) == 100'000, "100th percentile is the max");
+
+    Histogram other;
+    other.record(5'000'000);
+    h.merge(other);
+    check(h.count() == 100'001 && h.max() == 5'000'000, "Merge adds counts and extends the max");
+
+    h.reset();
+    check(h.count() == 0 && h.max() == 0, "Reset empties the histogram");
+}
+
+// Field by field — OrderMsg has a padding byte, so memcmp isn't reliable
+bool sameMessages(const std::vector<OrderMsg>& a, const std::vector<OrderMsg>& b, size_t n) {
+    if (a.size() < n || b.size() < n) return false;
+    for (size_t i = 0; i < n; ++i) {
+        const OrderMsg& x = a[i];
+        const OrderMsg& y = b[i];
+        if (x.type != y.type || x.side != y.side || x.orderType != y.orderType || x.symbol != y.symbol
+            || x.id != y.id || x.price != y.price || x.quantity != y.quantity || x.displayQty != y.displayQty) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void testWorkload() {
+    std::cout << "\n--- Test: Workload Generation ---\n";
+
+    WorkloadConfig config;
+    config.messages = 20'000;
+    config.initialDepth = 1000;
+    config.symbols = 2;
+    Workload a = generateWorkload(config);
+    Workload b = generateWorkload(config);
+    check(a.messages.size() == 21'000 && a.warmup == 1000, "Warmup depth precedes the measured flow");
+    check(a.arrivalNs.size() == a.messages.size(), "Every message has an arrival time");
+    check(sameMessages(a.messages, b.messages, a.messages.size()) && a.arrivalNs == b.arrivalNs,
+          "Same seed gives the same flow");
+    check(std::is_sorted(a.arrivalNs.begin(), a.arrivalNs.end()), "Arrival times never go backwards");
+
+    size_t counts[4] = {};
+    for (size_t i = a.warmup; i < a.messages.size(); ++i) {
+        counts[static_cast<size_t>(a.messages[i].type)]++;
+    }
+    double cancelShare = static_cast<double>(counts[static_cast<size_t>(MsgType::Cancel)]) / 20'000;
+    double modifyShare = static_cast<double>(counts[static_cast<size_t>(MsgType::Modify)]) / 20'000;
+    check(std::abs(cancelShare - 0.44) < 0.02 && std::abs(modifyShare - 0.05) < 0.01,
+          "Mix follows the configured weights");
+
+    // Every cancel and modify targets an order the flow sent earlier
+    std::vector<OrderId> sent;
+    bool targetsKnown = true;
+    for (const OrderMsg& msg : a.messages) {
+        if (msg.type == MsgType::NewLimit || msg.type == MsgType::NewMarket) {
+            sent.push_back(msg.id);
+        } else if (std::find(sent.end() - std::min<size_t>(sent.size(), 50'000), sent.end(), msg.id) == sent.end()) {
+            targetsKnown = false;
+        }
+    }
+    check(targetsKnown, "Cancels and modifies target earlier orders");
+
+    // The flow runs cleanly through an engine
+    MatchingEngine engine(50'000, {}, {}, Clock(), config.symbols);
+    EventListener ignore;
+    size_t accepted = 0;
+    for (const OrderMsg& msg : a.messages) accepted += engine.submit(msg, ignore);
+    check(accepted > a.messages.size() * 9 / 10, "Most of the generated flow is accepted");
+
+    std::string path = (std::filesystem::temp_directory_path() / "matching_engine_test.workload").string();
+    saveWorkload(a, path);
+    Workload loaded = loadWorkload(path);
+    check(loaded.messages.size() == a.messages.size() && loaded.warmup == a.warmup
+          && loaded.arrivalNs == a.arrivalNs
+          && sameMessages(loaded.messages, a.messages, a.messages.size()),
+          "Workload file round trip");
+    std::filesystem::remove(path);
+
+    // A journal loads as an untimed workload
+    std::string journalPath = (std::filesystem::temp_directory_path() / "matching_engine_test_wl.journal").string();
+    {
+        JournalConfig journalConfig;
+        journalConfig.path = journalPath;
+        JournalWriter journal(journalConfig, engine);
+        for (size_t i = 0; i < 100; ++i) journal.append(a.messages[i], {});
+        journal.flush();
+    }
+    Workload fromJournal = loadWorkload(journalPath);
+    check(fromJournal.messages.size() == 100 && fromJournal.arrivalNs.empty() && fromJournal.warmup == 0
+          && sameMessages(fromJournal.messages, a.messages, 100),
+          "Journal loads as an untimed workload");
+    std::filesystem::remove(journalPath);
+
+    bool threw = false;
+    try {
+        std::ofstream(path) << "not a workload";
+        loadWorkload(path);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    check(threw, "Unknown file format rejected");
+    std::filesystem::remove(path);
+}
+
+void testInstrumentation() {
+    std::cout << "\n--- Test: Instrumentation (" << (kInstrumented ? "compiled in" : "compiled out") << ") ---\n";
+
+    if constexpr (!kInstrumented) {
+        MatchingEngine engine(1000);
+        engine.submitLimit(1, Side::Sell, 100, 10);
+        engine.submitMarket(2, Side::Buy, 10);
+        CounterSnapshot counters = readCounters();
+        check(counters[Counter::Sweeps] == 0 && counters[Counter::LevelsCreated] == 0
+              && counters.phaseCalls[static_cast<size_t>(Phase::Match)] == 0,
+              "Nothing is recorded");
+        check(std::is_empty_v<PhaseTimer>, "Phase timers hold nothing");
+        return;
+    }
+
+    resetCounters();
+    MatchingEngine engine(50'000);
+    engine.submitLimit(1, Side::Sell, 100, 10);
+    engine.submitLimit(2, Side::Sell, 100, 10);
+    engine.submitLimit(3, Side::Sell, 101, 10);
+    engine.submitLimit(4, Side::Sell, 102, 10);
+    engine.submitMarket(5, Side::Buy, 35);   // fills 1, 2 and 3, leaves 5 of 4
+    engine.cancel(4);
+    engine.cancel(99);
+
+    CounterSnapshot counters = readCounters();
+    check(counters[Counter::LevelsCreated] == 3 && counters[Counter::LevelsErased] == 3,
+          "Levels created and erased");
+    check(counters[Counter::Sweeps] == 1 && counters[Counter::SweepFills] == 4
+          && counters[Counter::SweepLevels] == 3 && counters[Counter::SweepMaxLevels] == 3,
+          "Sweep fills and depth");
+    check(counters[Counter::Lookups] == 2 && counters[Counter::LookupProbes] >= 2
+          && counters[Counter::LookupMaxProbe] >= 1,
+          "Lookups and probe lengths");
+    check(counters[Counter::PoolHighWater] == 5, "Pool high-water mark");
+
+    auto calls = [&](Phase phase) { return counters.phaseCalls[static_cast<size_t>(phase)]; };
+    check(calls(Phase::Rest) == 4 && calls(Phase::Match) == 1 && calls(Phase::Lookup) == 2
+          && calls(Phase::Release) == 4,   // filled resting orders, the market order, the cancel's removal and slot
+          "Phase timers around rest, match, lookup and release");
+    check(counters.phaseNs(Phase::Match) > 0, "Phase time is measured");
+
+    // The exporter reads while this thread keeps matching
+    std::vector<CounterSnapshot> exported;
+    {
+        CounterExporter exporter(std::chrono::milliseconds(1),
+                                 [&](const CounterSnapshot& snapshot) { exported.push_back(snapshot); });
+        for (OrderId id = 100; id < 20'000; ++id) {
+            Side side = id % 2 ? Side::Buy : Side::Sell;
+            engine.submitLimit(id, side, side == Side::Buy ? 99 : 101, 10);
+            if (id % 4 == 0) engine.submitMarket(id + 1'000'000, side, 5);
+        }
+    }
+    CounterSnapshot final = readCounters();
+    check(!exported.empty() && exported.back()[Counter::Sweeps] == final[Counter::Sweeps]
+          && exported.back()[Counter::LevelsCreated] == final[Counter::LevelsCreated],
+          "Exporter delivers a final snapshot matching the counters");
+    bool monotonic = std::is_sorted(exported.begin(), exported.end(), [](const auto& a, const auto& b) {
+        return a[Counter::Sweeps] < b[Counter::Sweeps];
+    });
+    check(monotonic, "Exported counts never go backwards");
+}
+
+void testHandles() {
+    std::cout << "\n--- Test: Order Handles ---\n";
+    MatchingEngine engine(1000);
+    std::vector<EngineEvent> events;
+    EventBuffer sink(engine.clock(), events);
+
+    engine.submitLimit(1, Side::Buy, 10000, 10, sink);
+    OrderHandle first = events.back().handle;
+    check(events.back().type == EventType::Rested && engine.isLive(first), "Rested event carries a live handle");
+    check(engine.cancel(first), "Cancel by handle");
+    check(!engine.isLive(first) && !engine.cancel(first), "Cancelled handle is stale");
+
+    engine.submitLimit(2, Side::Buy, 10000, 10, sink);
+    OrderHandle filled = events.back().handle;
+    engine.submitLimit(3, Side::Sell, 10000, 10, sink);
+    check(!engine.cancel(filled), "Handle of a filled order is stale");
+
+    // The next order takes the slot a cancel just freed; the old handle must not reach it
+    engine.submitLimit(6, Side::Buy, 9980, 10, sink);
+    OrderHandle cancelled = events.back().handle;
+    engine.cancel(6);
+    engine.submitLimit(4, Side::Buy, 9990, 10, sink);
+    OrderHandle reused = events.back().handle;
+    check(reused.slot == cancelled.slot && reused.generation != cancelled.generation, "Reused slot has a new generation");
+    check(!engine.cancel(cancelled), "Stale handle doesn't cancel the slot's new order");
+    check(engine.isLive(reused) && engine.book().bestBid() == 9990, "New order still rests");
+    check(!engine.isLive(OrderHandle{}) && !engine.cancel(OrderHandle{999'999, 0}), "Empty and out-of-range handles are stale");
+
+    engine.submitLimit(5, Side::Sell, 10100, 10);
+    engine.submitLimit(5 + (1ull << 32), Side::Sell, 10200, 10);
+    check(engine.cancel(5 + (1ull << 32)) && engine.cancel(5), "IDs sharing their low 32 bits cancel separately");
+}
+
+void testLazyCancel() {
+    std::cout << "\n--- Test: Lazy Cancel ---\n";
+    BookConfig config;
+    config.cancelMode = CancelMode::Lazy;
+    MatchingEngine engine(1000, config);
+    std::vector<EngineEvent> events;
+    EventBuffer sink(engine.clock(), events);
+
+    for (OrderId id = 1; id <= 5; ++id) engine.submitLimit(id, Side::Sell, 10100, 10, sink);
+    OrderHandle second = events[1].handle;
+    events.clear();
+    engine.cancel(2, sink);
+    engine.cancel(4, sink);
+    const PriceLevel* level = engine.book().level(Side::Sell, 10100);
+    check(events.size() == 2 && events[0].quantity == 10, "Cancel reported with the quantity it had");
+    check(level->orderCount == 3 && level->deadCount == 2 && level->totalQuantity == 30,
+          "Dead orders leave the level's size but stay linked");
+    check(engine.poolInUse() == 5 && engine.book().orderCount() == 3, "Dead orders keep their slots until unlinked");
+    check(!engine.cancel(2) && !engine.isLive(second), "A dead order can't be cancelled again");
+
+    auto trades = engine.submitLimit(6, Side::Buy, 10100, 25);
+    check(trades.size() == 3 && trades[0].sellOrderId == 1 && trades[1].sellOrderId == 3 && trades[2].sellOrderId == 5,
+          "Match loop skips dead orders");
+    check(engine.poolInUse() == 1 && level->deadCount == 0, "Match loop unlinks dead orders and frees their slots");
+
+    // Cancelling the last live order of a level clears it straight away
+    engine.submitLimit(10, Side::Sell, 10200, 10);
+    engine.submitLimit(11, Side::Sell, 10200, 10);
+    engine.cancel(10);
+    engine.cancel(11);
+    check(engine.book().level(Side::Sell, 10200) == nullptr && engine.poolInUse() == 1, "All-dead level is removed");
+
+    // A mostly dead level is queued for compact()
+    for (OrderId id = 20; id < 30; ++id) engine.submitLimit(id, Side::Sell, 10300, 10);
+    for (OrderId id = 20; id < 25; ++id) engine.cancel(id);
+    check(engine.book().pendingCompactions() == 0, "Half dead is not over the ratio");
+    engine.cancel(25);
+    check(engine.book().pendingCompactions() == 1 && engine.poolInUse() == 11, "Level queued once over the ratio");
+    check(engine.compact() == 1 && engine.poolInUse() == 5, "compact() frees the dead slots");
+    check(engine.book().level(Side::Sell, 10300)->deadCount == 0 && engine.compact() == 0, "Nothing left to compact");
+
+    // Same trades as eager mode on a cancel-heavy flow, and through a snapshot
+    WorkloadConfig flow;
+    flow.messages = 30'000;
+    flow.initialDepth = 500;
+    flow.newWeight = 0.08;
+    flow.cancelWeight = 0.9;
+    flow.modifyWeight = 0.0;
+    flow.marketWeight = 0.02;
+    flow.maxDistance = 20;
+    Workload workload = generateWorkload(flow);
+    MatchingEngine eager(50'000);
+    MatchingEngine lazy(50'000, config);
+    EventListener ignore;
+    TradeDigest eagerDigest;
+    TradeDigest lazyDigest;
+    DigestListener<EventListener> eagerSink{ignore, eagerDigest};
+    DigestListener<EventListener> lazySink{ignore, lazyDigest};
+    size_t half = workload.messages.size() / 2;
+    for (size_t i = 0; i < half; ++i) {
+        eager.submit(workload.messages[i], eagerSink);
+        lazy.submit(workload.messages[i], lazySink);
+        if (i % 64 == 0) lazy.compact(4);
+    }
+    check(eagerDigest == lazyDigest && eagerDigest.count > 0, "Lazy mode trades the same as eager");
+    check(eager.book().orderCount() == lazy.book().orderCount(), "Same resting orders");
+
+    std::string path = (std::filesystem::temp_directory_path() / "matching_engine_lazy.snap").string();
+    writeSnapshot(lazy, path);
+    LoadedSnapshot restored = loadSnapshot(path);
+    check(restored.engine->poolInUse() == lazy.book().orderCount(), "Snapshot leaves dead orders out");
+    DigestListener<EventListener> restoredSink{ignore, lazyDigest};
+    for (size_t i = half; i < workload.messages.size(); ++i) {
+        eager.submit(workload.messages[i], eagerSink);
+        restored.engine->submit(workload.messages[i], restoredSink);
+    }
+    check(eagerDigest == lazyDigest, "Restored lazy engine carries on with the same trades");
+    std::filesystem::remove(path);
+}
+
+void testDepthQueries() {
+    std::cout << "\n--- Test: Depth Queries ---\n";
+
+    // Every kernel agrees with the scalar loop on random runs, both directions
+    std::mt19937_64 rng(23);
+    std::vector<PriceLevel> levels(1000);
+    for (PriceLevel& level : levels) {
+        level.totalQuantity = rng() % 4 == 0 ? static_cast<Quantity>(rng() % 1000) : 0;
+        level.orderCount = static_cast<uint32_t>(rng());   // neighbours of totalQuantity must not leak in
+        level.deadCount = static_cast<uint32_t>(rng());
+    }
+    bool agree = true;
+    for (int trial = 0; trial < 2000; ++trial) {
+        bool down = trial % 2;
+        size_t start = rng() % levels.size();
+        size_t room = down ? start + 1 : levels.size() - start;
+        size_t count = rng() % (room + 1);
+        uint64_t target = trial % 5 == 0 ? UINT64_MAX : rng() % 20'000;
+        SweepResult expected = sweepLevels(SimdLevel::Scalar, &levels[start], count, down, target);
+        for (SimdLevel simd : {SimdLevel::Avx2, SimdLevel::Avx512}) {
+            SweepResult got = sweepLevels(simd, &levels[start], count, down, target);
+            agree = agree && got.quantity == expected.quantity && got.weighted == expected.weighted
+                 && got.reachedAt == expected.reachedAt;
+        }
+    }
+    check(agree, std::string("Vector kernels match the scalar loop (this CPU: ") + simdName(supportedSimd()) + ")");
+
+    // Book queries against a hand-built book
+    BookConfig config;
+    config.tickSize = 5;
+    MatchingEngine engine(1000, config);
+    engine.submitLimit(1, Side::Sell, 10100, 10);
+    engine.submitLimit(2, Side::Sell, 10100, 5);
+    engine.submitLimit(3, Side::Sell, 10110, 20);
+    engine.submitLimit(4, Side::Sell, 10200, 30);
+    engine.submitLimit(5, Side::Buy, 10000, 7);
+    engine.submitLimit(6, Side::Buy, 9990, 8);
+    const OrderBook& book = engine.book();
+    check(book.depthWithin(Side::Sell, 0) == 15 && book.depthWithin(Side::Sell, 2) == 35
+          && book.depthWithin(Side::Sell, 100) == 65, "Ask depth within N ticks");
+    check(book.depthWithin(Side::Buy, 1) == 7 && book.depthWithin(Side::Buy, 2) == 15, "Bid depth within N ticks");
+
+    FillEstimate buy = book.estimateFill(Side::Buy, 25);
+    check(buy.complete && buy.quantity == 25 && buy.worstPrice == 10110
+          && std::abs(buy.averagePrice - (15.0 * 10100 + 10.0 * 10110) / 25) < 1e-9, "Buy fill estimate");
+    FillEstimate limited = book.estimateFill(Side::Buy, 100, 10150);
+    check(!limited.complete && limited.quantity == 35 && limited.worstPrice == 10110, "Limit stops the estimate");
+    FillEstimate sell = book.estimateFill(Side::Sell, 100);
+    check(!sell.complete && sell.quantity == 15 && sell.worstPrice == 9990
+          && std::abs(sell.averagePrice - (7.0 * 10000 + 8.0 * 9990) / 15) < 1e-9, "Sell fill estimate takes all bids");
+    check(book.estimateFill(Side::Sell, 5, 10005).quantity == 0, "Limit better than the best level fills nothing");
+
+    // After a random flow, level totals outside the live levels are still 0
+    MatchingEngine flowEngine(50'000);
+    WorkloadConfig flow;
+    flow.messages = 20'000;
+    flow.initialDepth = 2000;
+    Workload workload = generateWorkload(flow);
+    EventListener ignore;
+    for (const OrderMsg& msg : workload.messages) flowEngine.submit(msg, ignore);
+    const OrderBook& flowBook = flowEngine.book();
+    uint64_t walked = 0;
+    for (const PriceLevel* level = flowBook.asks().best(); level; level = flowBook.asks().next(*level)) {
+        walked += level->totalQuantity;
+    }
+    check(walked > 0 && flowBook.depthWithin(Side::Sell, 1'000'000) == walked, "Scan and level walk agree after a flow");
+}
+
+void testProtocol() {
+    std::cout << "\n--- Test: Wire Protocol ---\n";
+
+    char frame[kOrderFrameSize];
+    encodeOrderFrame(OrderMsg::iceberg(77, Side::Sell, 10050, 500, 100, 3), frame);
+    check(frame[0] == 1 && frame[1] == 1 && frame[2] == 5 && frame[8] == 77 && frame[16] == static_cast<char>(10050 & 0xFF),
+          "Order frame is little-endian at the documented offsets");
+
+    OrderMsg msg{};
+    check(decodeOrderFrame(frame, msg) && msg.type == MsgType::NewLimit && msg.orderType == OrderType::Iceberg
+              && msg.side == Side::Sell && msg.symbol == 3 && msg.id == 77 && msg.price == 10050
+              && msg.quantity == 500 && msg.displayQty == 100,
+          "Order frame decodes back to the message");
+
+    encodeOrderFrame(OrderMsg::market(78, Side::Buy, 20), frame);
+    check(decodeOrderFrame(frame, msg) && msg.type == MsgType::NewMarket, "Market order type gives a market message");
+    encodeOrderFrame(OrderMsg::cancel(79), frame);
+    check(decodeOrderFrame(frame, msg) && msg.type == MsgType::Cancel && msg.id == 79, "Cancel frame decodes");
+
+    frame[0] = 9;
+    check(!decodeOrderFrame(frame, msg) && msg.id == 79, "Unknown frame type is malformed, id still read");
+    encodeOrderFrame(OrderMsg::limit(kMaxClientOrderId + 1, Side::Buy, 100, 1), frame);
+    check(!decodeOrderFrame(frame, msg), "Client order id above 2^40 is malformed");
+
+    char report[kReportFrameSize];
+    encodeReport({EventType::Trade, Side::Buy, 2, 5, 6, -3, 40}, report);
+    Report r = decodeReport(report);
+    check(r.type == EventType::Trade && r.side == Side::Buy && r.symbol == 2 && r.orderId == 5 && r.otherId == 6
+              && r.price == -3 && r.quantity == 40,
+          "Report frame round-trips");
+}
+
+#if defined(__linux__)
+namespace {
+
+int connectTo(uint16_t port) {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    ::inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        ::close(fd);
+        return -1;
+    }
+    timeval timeout{5, 0};
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    return fd;
+}
+
+void sendFrames(int fd, const std::vector<OrderMsg>& msgs) {
+    std::vector<char> bytes(msgs.size() * kOrderFrameSize);
+    for (size_t i = 0; i < msgs.size(); ++i) encodeOrderFrame(msgs[i], bytes.data() + i * kOrderFrameSize);
+    ::send(fd, bytes.data(), bytes.size(), 0);
+}
+
+std::vector<Report> readReports(int fd, size_t count) {
+    std::vector<Report> reports;
+    char buffer[kReportFrameSize];
+    while (reports.size() < count) {
+        size_t got = 0;
+        while (got < kReportFrameSize) {
+            ssize_t n = ::recv(fd, buffer + got, kReportFrameSize - got, 0);
+            if (n <= 0) return reports;
+            got += static_cast<size_t>(n);
+        }
+        reports.push_back(decodeReport(buffer));
+    }
+    return reports;
+}
+
+} // namespace
+
+void testGateway() {
+    std::cout << "\n--- Test: io_uring Gateway ---\n";
+
+    MatchingEngine engine(1000);
+    EngineRunner runner(engine);
+    GatewayConfig config;
+    config.address = "127.0.0.1";
+    config.maxConnections = 4;
+    config.receiveBuffers = 8;
+    config.receiveBufferSize = 48;   // frames straddle receive buffers
+    std::unique_ptr<Gateway> gateway;
+    try {
+        gateway = std::make_unique<Gateway>(runner, config);
+    } catch (const std::system_error& e) {
+        std::cout << "  (skipped: " << e.what() << ")\n";
+        return;
+    }
+    runner.start();
+    gateway->start();
+
+    int a = connectTo(gateway->port());
+    int b = connectTo(gateway->port());
+    check(a >= 0 && b >= 0, "Clients connect");
+
+    // Both clients use order id 1 — ids are per connection
+    sendFrames(a, {OrderMsg::limit(1, Side::Sell, 10000, 10), OrderMsg::limit(2, Side::Sell, 10001, 5)});
+    auto rested = readReports(a, 2);
+    check(rested.size() == 2 && rested[0].type == EventType::Rested && rested[0].orderId == 1
+              && rested[1].orderId == 2 && rested[1].quantity == 5,
+          "Each new order is acked on its own connection");
+
+    // A frame written in two pieces is reassembled
+    char frame[kOrderFrameSize];
+    encodeOrderFrame(OrderMsg::limit(1, Side::Buy, 10000, 4), frame);
+    ::send(b, frame, 7, 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    ::send(b, frame + 7, kOrderFrameSize - 7, 0);
+
+    auto taker = readReports(b, 2);
+    check(taker.size() == 2 && taker[0].type == EventType::Trade && taker[0].orderId == 1 && taker[0].otherId == 0
+              && taker[0].side == Side::Buy && taker[0].quantity == 4 && taker[1].type == EventType::Filled,
+          "Aggressor gets its trade, then its fill");
+    auto maker = readReports(a, 1);
+    check(maker.size() == 1 && maker[0].type == EventType::Trade && maker[0].orderId == 1 && maker[0].side == Side::Sell
+              && maker[0].price == 10000 && maker[0].quantity == 4,
+          "Resting side gets the trade under its own id");
+
+    char bad[kOrderFrameSize] = {};
+    bad[0] = 42;
+    bad[8] = 9;
+    ::send(a, bad, sizeof(bad), 0);
+    sendFrames(a, {OrderMsg::cancel(1)});
+    auto tail = readReports(a, 2);
+    check(tail.size() == 2 && tail[0].type == EventType::Rejected && tail[0].orderId == 9,
+          "Malformed frame is rejected by the gateway");
+    check(tail.size() == 2 && tail[1].type == EventType::Cancelled && tail[1].orderId == 1 && tail[1].quantity == 6,
+          "Cancel by client id reaches the right order");
+
+    // A trade between two orders of the same connection names both
+    sendFrames(a, {OrderMsg::limit(3, Side::Buy, 10001, 5)});
+    auto self = readReports(a, 4);
+    check(self.size() == 4 && self[0].type == EventType::Trade && self[0].orderId == 3 && self[0].otherId == 2
+              && self[1].orderId == 2 && self[1].otherId == 3 && self[1].side == Side::Sell,
+          "Same-connection trade reports carry the other client id");
+
+    ::close(b);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (gateway->stats().open != 1 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+    GatewayStats stats = gateway->stats();
+    check(stats.accepted == 2 && stats.open == 1 && stats.frames == 5 && stats.badFrames == 1,
+          "Gateway counts connections and frames");
+
+    ::close(a);
+    gateway->stop();
+    runner.stop();
+    check(engine.book().orderCount() == 0, "Book is empty after the session");
+}
+#endif
+
+void testStopOrders() {
+    std::cout << "\n--- Test: Stop Orders ---\n";
+
+    MatchingEngine engine(1000);
+    std::vector<EngineEvent> events;
+    EventBuffer sink(engine.clock(), events);
+    const OrderBook& book = engine.book();
+
+    // With no trade yet nothing can trigger: stops park out of the book
+    engine.submitStop(0, 1, Side::Buy, 105, 5, sink);
+    engine.submitStop(0, 2, Side::Sell, 95, 3, sink);
+    engine.submitStop(0, 3, Side::Sell, 90, 3, sink);
+    check(events.size() == 3 && events[0].type == EventType::Rested && book.stopCount() == 3
+              && book.orderCount() == 0 && !book.bestBid() && !book.bestAsk(),
+          "Stops park without showing in the book");
+    check(!engine.modify(3, 91, 3), "A parked stop can't be modified");
+    check(engine.cancel(3) && book.stopCount() == 2 && engine.poolInUse() == 2, "A parked stop cancels by ID");
+
+    engine.submitLimit(10, Side::Sell, 100, 1);
+    engine.submitLimit(11, Side::Buy, 100, 1);
+    check(book.lastTradePrice() == 100 && book.stopCount() == 2, "A trade between the stops triggers neither");
+
+    // 30 lifts 101 and 105, which triggers stop 1; its market buy lifts 108
+    // and part of 112, which triggers stop-limit 4, which rests at 110
+    engine.submitLimit(20, Side::Sell, 101, 2);
+    engine.submitLimit(21, Side::Sell, 105, 2);
+    engine.submitLimit(22, Side::Sell, 108, 4);
+    engine.submitLimit(23, Side::Sell, 112, 20);
+    engine.submitStopLimit(0, 4, Side::Buy, 108, 110, 10, sink);
+    events.clear();
+    engine.submitLimit(0, 30, Side::Buy, 105, 4, sink);
+    std::vector<OrderId> aggressors;
+    std::vector<OrderId> triggered;
+    for (const EngineEvent& e : events) {
+        if (e.type == EventType::Trade) aggressors.push_back(e.orderId);
+        if (e.type == EventType::Triggered) triggered.push_back(e.orderId);
+    }
+    check(aggressors == std::vector<OrderId>{30, 30, 1, 1} && triggered == std::vector<OrderId>{1, 4},
+          "A cascade runs within the message, each stop after the trade that set it off");
+    check(book.bestBid() == 110 && book.top().bidQuantity == 10 && book.top().askQuantity == 19
+              && book.lastTradePrice() == 112 && book.stopCount() == 1,
+          "The triggered stop-limit rests at its limit");
+
+    // Stops the same trade reaches run nearest price first, FIFO at a price
+    MatchingEngine fifo(1000);
+    std::vector<EngineEvent> fifoEvents;
+    EventBuffer fifoSink(fifo.clock(), fifoEvents);
+    fifo.submitLimit(1, Side::Sell, 100, 1);
+    fifo.submitLimit(2, Side::Buy, 100, 1);
+    for (OrderId id : {7, 5, 6}) fifo.submitStop(0, id, Side::Buy, 102, 1, fifoSink);
+    fifo.submitStop(0, 8, Side::Buy, 101, 1, fifoSink);
+    fifo.submitLimit(3, Side::Sell, 101, 1);
+    fifo.submitLimit(4, Side::Sell, 103, 100);
+    fifoEvents.clear();
+    fifo.submitLimit(0, 9, Side::Buy, 101, 1, fifoSink);
+    triggered.clear();
+    for (const EngineEvent& e : fifoEvents) {
+        if (e.type == EventType::Triggered) triggered.push_back(e.orderId);
+    }
+    check(triggered == std::vector<OrderId>{8, 7, 5, 6} && fifo.book().top().askQuantity == 96,
+          "Triggered stops run in stop price then arrival order");
+
+    // Snapshot keeps the parked stop and the price it triggers against
+    std::string path = (std::filesystem::temp_directory_path() / "matching_engine_stops.snapshot").string();
+    writeSnapshot(engine, path);
+    LoadedSnapshot loaded = loadSnapshot(path);
+    std::filesystem::remove(path);
+    MatchingEngine& restored = *loaded.engine;
+    check(restored.book().stopCount() == 1 && restored.book().lastTradePrice() == 112, "Snapshot keeps parked stops");
+
+    // Selling through 95 triggers sell stop 2, alike in both engines
+    std::vector<std::vector<Trade>> runs;
+    for (MatchingEngine* e : {&engine, &restored}) {
+        e->submitLimit(40, Side::Buy, 95, 5);
+        std::vector<Trade> trades = e->submitMarket(41, Side::Sell, 12);
+        for (const Trade& t : e->submitLimit(42, Side::Buy, 80, 1)) trades.push_back(t);
+        runs.push_back(trades);
+        check(e->book().stopCount() == 0 && !e->book().level(Side::Buy, 95) && e->book().lastTradePrice() == 95,
+              "Sell stop triggers on a trade at its price");
+    }
+    check(runs[0].size() == 3 && runs[0][2].sellOrderId == 2 && runs[0][2].quantity == 3,
+          "The sell stop trades as a market order");
+    check(runs[0].size() == runs[1].size()
+              && std::equal(runs[0].begin(), runs[0].end(), runs[1].begin(), [](const Trade& a, const Trade& b) {
+                     return a.buyOrderId == b.buyOrderId && a.sellOrderId == b.sellOrderId && a.price == b.price
+                         && a.quantity == b.quantity;
+                 }),
+          "Restored stops trade like the originals");
+
+    // A stop the last trade has already reached triggers on arrival
+    events.clear();
+    engine.submitStop(0, 50, Side::Sell, 96, 1, sink);
+    check(events.size() == 4 && events[0].type == EventType::Triggered && events[1].type == EventType::Trade
+              && events[1].price == 80 && book.stopCount() == 0 && engine.poolInUse() == 1,
+          "An already reached stop trades at once");
+
+    // Stops by message, and on the wire
+    OrderMsg msg = OrderMsg::stopLimit(60, Side::Buy, 120, 117, 5);
+    check(msg.type == MsgType::NewStop && msg.limitPrice() == 117, "Stop-limit message carries its limit");
+    char frame[kOrderFrameSize];
+    encodeOrderFrame(msg, frame);
+    OrderMsg decoded{};
+    check(decodeOrderFrame(frame, decoded) && decoded.type == MsgType::NewStop
+              && decoded.orderType == OrderType::StopLimit && decoded.price == 120 && decoded.limitPrice() == 117,
+          "Stop-limit frame decodes to a stop message");
+    check(engine.submit(msg, sink) && book.stopCount() == 1 && engine.cancel(events.back().handle),
+          "Stop by message parks and cancels by handle");
+}
+
+void testAuction() {
+    std::cout << "\n--- Test: Call Auction ---\n";
+
+    MatchingEngine engine(1000);
+    std::vector<EngineEvent> events;
+    EventBuffer sink(engine.clock(), events);
+    const OrderBook& book = engine.book();
+
+    // In the call phase crossing orders rest
+    engine.startAuction();
+    engine.submitLimit(1, Side::Buy, 102, 10);
+    engine.submitLimit(2, Side::Buy, 101, 5);
+    engine.submitLimit(3, Side::Buy, 100, 10);
+    engine.submitLimit(4, Side::Sell, 99, 8);
+    engine.submitLimit(5, Side::Sell, 100, 7);
+    engine.submitLimit(6, Side::Sell, 103, 10);
+    check(engine.totalTrades() == 0 && book.bestBid() == 102 && book.bestAsk() == 99 && book.orderCount() == 6,
+          "Orders rest crossed during the auction");
+    bool refused = false;
+    try {
+        engine.submitMarket(7, Side::Buy, 5);
+    } catch (const std::invalid_argument&) {
+        refused = true;
+    }
+    check(refused && !engine.submitBatch(std::span<const OrderMsg>(std::vector<OrderMsg>{OrderMsg::ioc(8, Side::Buy, 103, 1)}), sink)
+              && events.back().type == EventType::Rejected,
+          "Market and IOC orders are refused during the auction");
+
+    // 100 and 101 both trade 15; 101 leaves no surplus
+    AuctionResult indicative = engine.indicativeUncross();
+    check(indicative.price == 101 && indicative.volume == 15 && indicative.surplus == 0,
+          "Equilibrium price maximizes volume, then minimizes surplus");
+
+    events.clear();
+    AuctionResult done = engine.uncross(0, sink);
+    std::vector<std::pair<OrderId, OrderId>> pairs;
+    bool onePrice = true;
+    for (const EngineEvent& e : events) {
+        if (e.type != EventType::Trade) continue;
+        pairs.push_back({e.orderId, e.otherId});
+        onePrice = onePrice && e.price == 101;
+    }
+    check(done.volume == 15 && onePrice && pairs == std::vector<std::pair<OrderId, OrderId>>{{1, 4}, {1, 5}, {2, 5}},
+          "Uncross trades best bids against best asks at one price");
+    check(!engine.inAuction() && book.bestBid() == 100 && book.bestAsk() == 103 && book.orderCount() == 2
+              && engine.poolInUse() == 2 && book.lastTradePrice() == 101,
+          "Uncross leaves the book uncrossed and continuous");
+    check(engine.submitLimit(9, Side::Sell, 100, 1).size() == 1, "Matching is continuous again");
+
+    // Equal volume and surplus: the price nearest the last trade wins, and
+    // stops the uncross price reaches run after it
+    MatchingEngine close(1000);
+    close.submitLimit(1, Side::Sell, 104, 1);
+    close.submitLimit(2, Side::Buy, 104, 1);
+    close.submit(OrderMsg::startAuction(), sink);
+    close.submitLimit(3, Side::Buy, 105, 5);
+    close.submitLimit(4, Side::Sell, 95, 5);
+    close.submitLimit(5, Side::Sell, 110, 3);
+    close.submitStop(0, 6, Side::Buy, 103, 1, sink);   // reached already, but parks in the call phase
+    check(close.book().stopCount() == 1 && close.indicativeUncross().price == 105, "Ties go to the price nearest the last trade");
+
+    std::string path = (std::filesystem::temp_directory_path() / "matching_engine_auction.snapshot").string();
+    writeSnapshot(close, path);
+    LoadedSnapshot loaded = loadSnapshot(path);
+    std::filesystem::remove(path);
+    check(loaded.engine->inAuction() && loaded.engine->indicativeUncross().volume == 5, "Snapshot keeps the call phase");
+
+    std::vector<Trade> trades;
+    TradeCollector collector(trades);
+    close.submit(OrderMsg::uncross(), collector);
+    check(trades.size() == 2 && trades[0].price == 105 && trades[0].quantity == 5 && trades[1].buyOrderId == 6
+              && trades[1].price == 110, "Stops reached by the uncross price trigger after it");
+
+    // Nothing crossed: nothing trades
+    MatchingEngine quiet(1000);
+    quiet.startAuction();
+    quiet.submitLimit(1, Side::Buy, 99, 5);
+    quiet.submitLimit(2, Side::Sell, 101, 5);
+    check(quiet.uncross(0, collector).volume == 0 && !quiet.inAuction() && quiet.book().orderCount() == 2,
+          "Uncrossing an uncrossed book only ends the auction");
+
+    // A stop parked in the call phase waits for the uncross, whatever arrives meanwhile
+    MatchingEngine parked(1000);
+    parked.submitLimit(1, Side::Sell, 100, 5);
+    parked.submitLimit(2, Side::Buy, 100, 5);
+    parked.submitLimit(3, Side::Sell, 100, 5);
+    parked.startAuction();
+    events.clear();
+    parked.submitStop(0, 4, Side::Buy, 100, 5, sink);
+    parked.submit(OrderMsg::limit(5, Side::Buy, 90, 1), sink);
+    check(parked.inAuction() && parked.totalTrades() == 1 && parked.book().stopCount() == 1
+              && std::none_of(events.begin(), events.end(), [](const EngineEvent& e) { return e.type == EventType::Triggered; }),
+          "An order in the call phase doesn't trigger a parked stop");
+    trades.clear();
+    parked.submit(OrderMsg::uncross(), collector);
+    check(trades.size() == 1 && trades[0].buyOrderId == 4 && trades[0].price == 100 && parked.book().stopCount() == 0,
+          "The stop triggers once the uncross ends the call phase");
+}
+
+void testBacktest() {
+    std::cout << "\n--- Test: Backtest ---\n";
+
+    // Reset empties the books and frees every slot, and the engine trades on afresh
+    BookConfig lazy;
+    lazy.cancelMode = CancelMode::Lazy;
+    MatchingEngine engine(64, lazy);
+    engine.submitLimit(1, Side::Buy, 100, 10);
+    engine.submitLimit(2, Side::Buy, 100, 10);
+    engine.submitLimit(3, Side::Sell, 105, 10);
+    engine.cancel(OrderId{1});    // lazily: still linked
+    EventListener ignore;
+    engine.submitStop(0, 4, Side::Sell, 95, 10, ignore);
+    engine.submitMarket(5, Side::Sell, 1);
+    engine.reset();
+    check(engine.poolInUse() == 0 && engine.book().orderCount() == 0 && engine.book().stopCount() == 0
+          && !engine.book().bestBid() && !engine.book().bestAsk() && !engine.book().lastTradePrice()
+          && engine.totalTrades() == 0,
+          "Reset empties the book and the pool");
+    check(engine.submitLimit(2, Side::Sell, 100, 5).empty() && engine.submitLimit(3, Side::Buy, 100, 5).size() == 1
+          && engine.poolInUse() == 0,
+          "The same IDs trade again after a reset");
+
+    // Two days of four symbols: same trades as a fresh multi-symbol engine per day
+    WorkloadConfig config;
+    config.symbols = 4;
+    config.messages = 20'000;
+    config.initialDepth = 2'000;
+    config.maxDistance = 20;
+    auto dir = std::filesystem::temp_directory_path();
+    std::vector<std::string> days = {(dir / "matching_engine_test_day1.workload").string(),
+                                     (dir / "matching_engine_test_day2.workload").string()};
+    TradeDigest expected;
+    for (size_t d = 0; d < days.size(); ++d) {
+        config.seed = 100 + d;
+        Workload day = generateWorkload(config);
+        saveWorkload(day, days[d]);
+        MatchingEngine fresh(50'000, {}, {}, Clock(), config.symbols);
+        DigestListener<EventListener> digest{ignore, expected};
+        for (const OrderMsg& msg : day.messages) fresh.submit(msg, digest);
+    }
+
+    BacktestConfig backtest;
+    backtest.threads = 1;
+    backtest.poolSize = 1024;    // grows, and is reused by every task
+    BacktestResult one = runBacktest(days, backtest);
+    backtest.threads = 3;
+    BacktestResult three = runBacktest(days, backtest);
+    check(one.tasks == 8 && one.messages == 2 * (config.messages + config.initialDepth), "Split into symbol-days");
+    check(expected.count > 0 && one.digest == expected, "Backtest trades like one engine per day");
+    bool ordered = std::is_sorted(one.trades.begin(), one.trades.end(), [](const BacktestTrade& a, const BacktestTrade& b) {
+        return std::tie(a.day, a.timeNs, a.sequence) < std::tie(b.day, b.timeNs, b.sequence);
+    });
+    check(ordered && one.trades.size() == expected.count, "Trades merged by day, time and sequence");
+    check(three.threads == 3 && three.digest == one.digest
+          && std::equal(one.trades.begin(), one.trades.end(), three.trades.begin(), three.trades.end(),
+                        [](const BacktestTrade& a, const BacktestTrade& b) {
+                            return a.sequence == b.sequence && a.day == b.day && a.trade.buyOrderId == b.trade.buyOrderId
+                                && a.trade.sellOrderId == b.trade.sellOrderId && a.trade.symbol == b.trade.symbol;
+                        }),
+          "Workers don't change the result");
+
+    // A journal replays to the digest it recorded
+    std::string journalPath = (dir / "matching_engine_test_bt.journal").string();
+    TradeDigest recorded;
+    {
+        MatchingEngine original(50'000, {}, {}, Clock(), config.symbols);
+        JournalConfig journalConfig;
+        journalConfig.path = journalPath;
+        journalConfig.sync = false;
+        JournalWriter journal(journalConfig, original);
+        DigestListener<EventListener> digest{ignore, recorded};
+        config.seed = 7;
+        for (const OrderMsg& msg : generateWorkload(config).messages) {
+            if (original.submit(msg, digest)) journal.append(msg, recorded);
+        }
+        journal.flush();
+    }
+    BacktestResult replayed = runBacktest({journalPath}, backtest);
+    check(replayed.digest == recorded && replayed.rejected == 0, "Journal backtest reproduces its digest");
+
+    bool threw = false;
+    try {
+        std::ofstream(days[0]) << "not a recording";
+        runBacktest(days, backtest);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    check(threw, "Unknown file format rejected");
+    for (const std::string& path : days) std::filesystem::remove(path);
+    std::filesystem::remove(journalPath);
+}
+
+void testReplication() {
+    std::cout << "\n--- Test: Replication ---\n";
+
+    auto waitFor = [](auto done) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (!done() && std::chrono::steady_clock::now() < deadline) std::this_thread::sleep_for(std::chrono::microseconds(100));
+        return done();
+    };
+    auto sameBooks = [](const MatchingEngine& a, const MatchingEngine& b) {
+        for (SymbolId s = 0; s < a.symbolCount(); ++s) {
+            const OrderBook& x = a.book(s);
+            const OrderBook& y = b.book(s);
+            if (x.orderCount() != y.orderCount()) return false;
+            for (Side side : {Side::Buy, Side::Sell}) {
+                DepthLevel dx[10];
+                DepthLevel dy[10];
+                size_t n = x.depth(side, dx, 10);
+                if (y.depth(side, dy, 10) != n) return false;
+                for (size_t i = 0; i < n; ++i) {
+                    if (dx[i].price != dy[i].price || dx[i].totalQuantity != dy[i].totalQuantity
+                        || dx[i].orderCount != dy[i].orderCount) {
+                        return false;
+                    }
+                }
+            }
+        }
+        return a.totalTrades() == b.totalTrades() && a.poolInUse() == b.poolInUse();
+    };
+
+    WorkloadConfig flowConfig;
+    flowConfig.symbols = 2;
+    flowConfig.messages = 6'000;
+    flowConfig.initialDepth = 500;
+    flowConfig.maxDistance = 10;
+    std::vector<OrderMsg> flow = generateWorkload(flowConfig).messages;
+
+    ReplicationConfig config;
+    config.address = "127.0.0.1";
+    config.historyRecords = 4096;
+    config.maxBatch = 64;
+    config.heartbeat = std::chrono::milliseconds(5);
+    config.reconnect = std::chrono::milliseconds(1);
+
+    MatchingEngine primaryEngine(20'000, {}, {}, Clock(), 2);
+    MatchingEngine hot(20'000, {}, {}, Clock(), 2);
+    MatchingEngine late(20'000, {}, {}, Clock(), 2);
+    MatchingEngine tooLate(20'000, {}, {}, Clock(), 2);
+    uint64_t promotedAt = 0;
+    uint64_t lateAt = 0;
+    TradeDigest promotedDigest;
+    TradeDigest lateDigest;
+    {
+        ReplicationPrimary primary(config, primaryEngine);
+        ReplicationConfig follow = config;
+        follow.port = primary.port();
+        ReplicationStandby standby(follow, hot);
+        standby.start();
+        check(waitFor([&]() { return primary.standbys() == 1; }), "Standby connects to the primary");
+
+        RunnerConfig runnerConfig;
+        runnerConfig.replication = &primary;
+        EngineRunner runner(primaryEngine, runnerConfig);
+        runner.start();
+        EngineEvent event;
+        auto send = [&](size_t from, size_t to) {
+            for (size_t i = from; i < to; ++i) {
+                while (!runner.submit(flow[i])) {
+                    while (runner.poll(event)) {}
+                }
+            }
+            waitFor([&]() { while (runner.poll(event)) {} return runner.processed() == to; });
+        };
+
+        // A standby that joins late is caught up from the history
+        send(0, 1'000);
+        ReplicationStandby joiner(follow, late);
+        joiner.start();
+        send(1'000, flow.size());
+        check(waitFor([&]() { return standby.applied() == primary.appended() && joiner.applied() == primary.appended(); })
+              && primary.appended() > 4096,
+              "Standbys apply every accepted message");
+        check(waitFor([&]() { return primary.acknowledged() == primary.appended(); }), "Primary counts the acks");
+        runner.stop();
+        check(!standby.diverged() && !joiner.diverged() && standby.gaps() == 0 && standby.lag() == 0,
+              "Trade digests match on the standbys");
+
+        // Past the history: refused, to be seeded some other way
+        ReplicationStandby stale(follow, tooLate);
+        stale.start();
+        check(waitFor([&]() { return stale.refused(); }) && primary.refused() == 1 && tooLate.totalOrders() == 0,
+              "A standby behind the history is refused");
+
+        lateAt = joiner.promote();
+        lateDigest = joiner.digest();
+        promotedAt = standby.promote();
+        promotedDigest = standby.digest();
+    }
+    check(promotedAt == lateAt && promotedDigest == lateDigest && sameBooks(primaryEngine, hot)
+          && sameBooks(primaryEngine, late),
+          "Standby books are identical to the primary's");
+
+    // Failover: the promoted standby becomes the primary and the other follows it
+    {
+        ReplicationPrimary primary(config, hot, promotedAt, promotedDigest);
+        ReplicationConfig follow = config;
+        follow.port = primary.port();
+        ReplicationStandby standby(follow, late, lateAt, lateDigest);
+        standby.start();
+
+        RunnerConfig runnerConfig;
+        runnerConfig.replication = &primary;
+        EngineRunner runner(hot, runnerConfig);
+        runner.start();
+        EngineEvent event;
+        OrderId id = 1'000'000;
+        for (int i = 0; i < 500; ++i) {
+            Side side = i % 2 ? Side::Buy : Side::Sell;
+            while (!runner.submit(OrderMsg::limit(++id, side, flowConfig.mid + (i % 3) - 1, 5, i % 2))) {}
+        }
+        waitFor([&]() { while (runner.poll(event)) {} return runner.processed() == 500; });
+        runner.stop();
+        check(waitFor([&]() { return standby.applied() == primary.appended(); }) && primary.appended() > promotedAt
+              && !standby.diverged(),
+              "After failover the new primary's stream continues the sequence and digest");
+        standby.promote();
+    }
+    check(sameBooks(hot, late), "Books still match after failover");
+}
+
+void testRiskChecks() {
+    std::cout << "\n--- Test: Inline Risk Checks ---\n";
+
+    MatchingEngine engine(1000);
+    RiskTable risk(4);
+    RiskLimits limits;
+    limits.maxOrderQty = 100;
+    limits.priceBand = 5;
+    limits.maxOpenQty = 150;
+    limits.maxOpenNotional = 150 * 100;
+    risk.setLimits(1, limits);
+    limits.preventSelfTrade = true;
+    risk.setLimits(2, limits);
+    engine.enforceRisk(&risk);
+
+    std::vector<EngineEvent> events;
+    EventBuffer sink(engine.clock(), events);
+    const OrderBook& book = engine.book();
+
+    check(engine.submit(OrderMsg::limit(1, Side::Sell, 100, 50).from(1), sink) && risk.openQuantity(1) == 50
+              && risk.openNotional(1) == 5000,
+          "A resting order counts toward its account's open quantity and notional");
+    check(!engine.submit(OrderMsg::limit(2, Side::Buy, 99, 101).from(1), sink) && risk.rejected(RiskCheck::OrderSize) == 1,
+          "An order over the size limit is refused");
+    check(!engine.submit(OrderMsg::ioc(4, Side::Buy, 106, 10).from(1), sink)
+              && risk.rejected(RiskCheck::PriceBand) == 1 && book.orderCount() == 1,
+          "A buy priced through the best ask by more than the band is refused");
+    check(!engine.submit(OrderMsg::limit(5, Side::Sell, 100, 40).from(9), sink)
+              && risk.rejected(RiskCheck::UnknownAccount) == 1,
+          "An account without a row is refused");
+    check(engine.submit(OrderMsg::limit(6, Side::Sell, 101, 90).from(1), sink)
+              && !engine.submit(OrderMsg::limit(7, Side::Sell, 101, 20).from(1), sink)
+              && risk.rejected(RiskCheck::OpenQuantity) == 1 && risk.openQuantity(1) == 140,
+          "An order that would take open quantity over the limit is refused");
+    check(engine.submit(OrderMsg::market(8, Side::Buy, 100).from(1), sink) && risk.rejected(RiskCheck::OpenQuantity) == 1,
+          "Market orders never rest, so open limits don't apply");
+    check(risk.openQuantity(1) == 40 && risk.openNotional(1) == 40 * 101, "Fills of resting orders release exposure");
+    check(engine.submit(OrderMsg::limit(9, Side::Buy, 10, 100).from(1), sink) && risk.openNotional(1) == 40 * 101 + 1000,
+          "Passive orders far from the market pass the band");
+    check(engine.modify(9, 10, 50) && risk.openQuantity(1) == 90 && engine.cancel(9) && risk.openQuantity(1) == 40,
+          "Amends and cancels release what they take away");
+    check(!engine.submit(OrderMsg::modify(6, 101, 200), sink) && book.level(Side::Sell, 101)->totalQuantity == 40,
+          "A cancel-replace is checked like a new order");
+
+    // Notional: 40 open at 101 and a limit of 15000 leave no room for 100 at 110
+    RiskLimits notional = risk.limits(1);
+    notional.maxOpenQty = UINT64_MAX;
+    risk.setLimits(1, notional);
+    check(!engine.submit(OrderMsg::limit(10, Side::Sell, 110, 100).from(1), sink)
+              && risk.rejected(RiskCheck::OpenNotional) == 1,
+          "An order that would take open notional over the limit is refused");
+
+    // Self-trade prevention cancels the resting order of the same account
+    MatchingEngine stp(1000);
+    RiskTable stpRisk(3, limits);
+    RiskLimits open;
+    stpRisk.setLimits(0, open);
+    stp.enforceRisk(&stpRisk);
+    std::vector<EngineEvent> stpEvents;
+    EventBuffer stpSink(stp.clock(), stpEvents);
+    stp.submit(OrderMsg::limit(1, Side::Sell, 100, 10).from(2), stpSink);
+    stp.submit(OrderMsg::limit(2, Side::Sell, 100, 10).from(1), stpSink);
+    stpEvents.clear();
+    check(stp.submit(OrderMsg::limit(3, Side::Buy, 100, 15).from(2), stpSink) && stpEvents.size() == 4
+              && stpEvents[0].type == EventType::Cancelled && stpEvents[0].orderId == 1
+              && stpEvents[1].type == EventType::Trade && stpEvents[1].otherId == 2 && stpEvents[1].quantity == 10,
+          "A resting order of the same account is cancelled, not traded");
+    check(stpRisk.openQuantity(2) == 5 && stpRisk.openQuantity(1) == 0 && stp.poolInUse() == 1
+              && stp.book().bestBid() == 100,
+          "The cancelled order's exposure and slot are released");
+    stp.submit(OrderMsg::limit(4, Side::Sell, 101, 5), stpSink);
+    stp.submit(OrderMsg::limit(5, Side::Buy, 101, 5), stpSink);
+    check(stp.totalTrades() == 2, "Accounts without prevention trade with themselves");
+
+    // A FOK can't count on its own account's orders where they'd be cancelled instead
+    MatchingEngine fok(1000);
+    RiskTable fokRisk(3, limits);
+    fok.enforceRisk(&fokRisk);
+    std::vector<EngineEvent> fokEvents;
+    EventBuffer fokSink(fok.clock(), fokEvents);
+    fok.submit(OrderMsg::limit(1, Side::Sell, 100, 10).from(2), fokSink);
+    fok.submit(OrderMsg::limit(2, Side::Sell, 100, 10).from(1), fokSink);
+    fokEvents.clear();
+    OrderMsg fokBuy = OrderMsg::fok(3, Side::Buy, 100, 20).from(2);
+    check(!fok.submit(fokBuy, fokSink) && fokEvents.empty() && fok.totalTrades() == 0 && fok.book().orderCount() == 2,
+          "A FOK that only fills with self trades is rejected, touching nothing");
+    fokBuy.quantity = 10;
+    check(fok.submit(fokBuy, fokSink) && fok.totalTrades() == 1 && fokEvents[0].type == EventType::Cancelled
+              && fokEvents[0].orderId == 1,
+          "A FOK the other accounts can fill still goes through");
+
+    // Attaching rebuilds exposure from the book; reset clears it
+    RiskTable fresh(3);
+    stp.enforceRisk(&fresh);
+    check(fresh.openQuantity(2) == 5 && fresh.openNotional(2) == 500, "Attaching a table rebuilds open exposure");
+    RiskTable small(1);
+    bool threw = false;
+    try {
+        stp.enforceRisk(&small);
+    } catch (const std::out_of_range&) {
+        threw = true;
+    }
+    check(threw && stp.riskTable() == &fresh, "A table missing a resting order's account is refused");
+    stp.reset();
+    check(fresh.openQuantity(2) == 0 && fresh.limits(2).maxOrderQty == UINT32_MAX, "reset() clears exposure, not limits");
+    stp.enforceRisk(nullptr);
+    check(stp.submit(OrderMsg::limit(6, Side::Buy, 100, 5000).from(7), stpSink), "Detached, nothing is checked");
+
+    // A stop is held to the band and open limits when it triggers
+    MatchingEngine stops(1000);
+    RiskLimits openCap;
+    openCap.maxOrderQty = 1000;
+    openCap.maxOpenQty = 100;
+    RiskTable stopRisk(2);
+    stopRisk.setLimits(1, openCap);
+    stops.enforceRisk(&stopRisk);
+    std::vector<EngineEvent> stopEvents;
+    EventBuffer stopSink(stops.clock(), stopEvents);
+    check(!stops.submit(OrderMsg::stop(6, Side::Sell, 90, 1001).from(1), stopSink)
+              && stopEvents.empty() && stops.book().stopCount() == 0 && stopRisk.rejected(RiskCheck::OrderSize) == 1,
+          "A sell stop over the size limit is refused on entry with no events");
+    check(!stops.submit(OrderMsg::limit(1, Side::Buy, 99, 500).from(1), stopSink)
+              && stops.submit(OrderMsg::stopLimit(2, Side::Buy, 100, 99, 500).from(1), stopSink)
+              && stops.submit(OrderMsg::stopLimit(3, Side::Buy, 100, 98, 50).from(1), stopSink),
+          "Stops over the open limit park, since only their size is checked on entry");
+    stopEvents.clear();
+    stops.submit(OrderMsg::limit(4, Side::Sell, 100, 5), stopSink);
+    stops.submit(OrderMsg::limit(5, Side::Buy, 100, 5), stopSink);
+    auto cancelled = std::find_if(stopEvents.begin(), stopEvents.end(),
+                                  [](const EngineEvent& e) { return e.type == EventType::Cancelled; });
+    check(cancelled != stopEvents.end() && cancelled->orderId == 2 && stopRisk.rejected(RiskCheck::OpenQuantity) == 2
+              && stopRisk.openQuantity(1) == 50 && stops.book().stopCount() == 0 && stops.poolInUse() == 1,
+          "A triggered stop the open limit refuses is cancelled; one within it rests");
+
+    // Accounts survive a snapshot
+    std::string path = (std::filesystem::temp_directory_path() / "matching_engine_risk.snapshot").string();
+    writeSnapshot(engine, path);
+    LoadedSnapshot loaded = loadSnapshot(path);
+    std::filesystem::remove(path);
+    RiskTable restoredRisk(4);
+    loaded.engine->enforceRisk(&restoredRisk);
+    check(restoredRisk.openQuantity(1) == risk.openQuantity(1) && restoredRisk.openNotional(1) == risk.openNotional(1),
+          "Snapshot keeps each order's account");
+}
+
+void testDropCopy() {
+    std::cout << "\n--- Test: Drop Copy ---\n";
+
+    std::string path = (std::filesystem::temp_directory_path() / "matching_engine_test.dropcopy").string();
+    MatchingEngine engine(1000);
+    {
+        DropCopyConfig config;
+        config.path = path;
+        DropCopyWriter writer(config, engine.clock());
+        auto send = [&](const OrderMsg& msg) {
+            engine.submit(msg, writer);
+            writer.commit();
+        };
+        send(OrderMsg::limit(1, Side::Sell, 100, 10));
+        send(OrderMsg::limit(2, Side::Sell, 101, 10));
+        send(OrderMsg::limit(3, Side::Buy, 101, 15));
+        send(OrderMsg::cancel(2));
+        send(OrderMsg::market(4, Side::Buy, 20));
+        writer.flush();
+        check(writer.written() == 7 && writer.bytesWritten() == writer.writes() * sizeof(DropCopyFrame) + 7 * sizeof(ExecReport),
+              "Every committed report is written, framed");
+    }
+
+    std::vector<DecodedReport> reports = readDropCopy(path);
+    bool sequenced = reports.size() == 7;
+    for (size_t i = 0; sequenced && i < reports.size(); ++i) {
+        sequenced = reports[i].sequence == i + 1 && (i == 0 || reports[i].timeNs >= reports[i - 1].timeNs);
+    }
+    check(sequenced && reports[0].report.type == ExecType::Clock && reports[1].timeNs == reports[0].report.price,
+          "Sequences follow on and times are rebuilt from a Clock anchor");
+    const ExecReport& first = reports[3].report;
+    const ExecReport& second = reports[4].report;
+    check(reports[1].report.type == ExecType::Rested && reports[1].report.orderId == 1 && reports[1].report.quantity == 10,
+          "A resting order is reported");
+    check(first.type == ExecType::Trade && first.orderId == 3 && first.otherId == 1 && first.quantity == 10
+              && first.flags == kRestingFilled,
+          "A trade that completes the resting order is flagged as its full fill");
+    check(second.type == ExecType::Trade && second.otherId == 2 && second.quantity == 5 && second.flags == kAggressorFilled,
+          "A trade that completes the aggressor and leaves the resting order is a partial fill of it");
+    check(reports[5].report.type == ExecType::Cancelled && reports[5].report.orderId == 2 && reports[5].report.quantity == 5
+              && reports[6].report.type == ExecType::Cancelled && reports[6].report.quantity == 20,
+          "Cancel acks and an unfilled market order are reported with what was left");
+
+    // One message with more reports than the ring holds, and frames wrapping it
+    MatchingEngine sweep(1000);
+    {
+        DropCopyConfig config;
+        config.path = path;
+        config.ringCapacity = 8;
+        config.maxBatch = 3;
+        DropCopyWriter writer(config, sweep.clock());
+        for (OrderId id = 1; id <= 20; ++id) {
+            sweep.submit(OrderMsg::limit(id, Side::Sell, 100, 1), writer);
+        }
+        writer.commit();
+        sweep.submit(OrderMsg::limit(21, Side::Buy, 100, 20), writer);
+        writer.commit();
+        writer.flush();
+        check(writer.written() == 41 && writer.writes() >= 41 / 3, "A sweep longer than the ring still goes out in full");
+    }
+    reports = readDropCopy(path);
+    size_t trades = 0;
+    bool flagged = true;
+    for (const DecodedReport& r : reports) {
+        if (r.report.type != ExecType::Trade) continue;
+        trades++;
+        flagged = flagged && (r.report.flags & kRestingFilled);
+    }
+    check(trades == 20 && flagged && reports.back().report.flags == (kAggressorFilled | kRestingFilled),
+          "Fills are still flagged on trades handed over before the message ended");
+
+    // Through the runner: every trade event is reported
+    MatchingEngine ran(1000);
+    size_t tradeEvents = 0;
+    {
+        DropCopyConfig config;
+        config.path = path;
+        DropCopyWriter writer(config, ran.clock());
+        RunnerConfig runnerConfig;
+        runnerConfig.dropCopy = &writer;
+        EngineRunner runner(ran, runnerConfig);
+        runner.start();
+        std::mt19937 rng(11);
+        const int MESSAGES = 500;
+        for (int i = 1; i <= MESSAGES; ++i) {
+            Side side = rng() % 2 ? Side::Buy : Side::Sell;
+            OrderMsg msg = OrderMsg::limit(static_cast<OrderId>(i), side, 95 + static_cast<Price>(rng() % 10), 1 + rng() % 20);
+            while (!runner.submit(msg)) std::this_thread::yield();
+        }
+        while (runner.processed() < MESSAGES) std::this_thread::yield();
+        runner.stop();
+        check(writer.written() == writer.committed(), "Stopping the runner writes out the drop copy");
+        EngineEvent e;
+        while (runner.poll(e)) {
+            if (e.type == EventType::Trade) tradeEvents++;
+        }
+    }
+    reports = readDropCopy(path);
+    check(static_cast<size_t>(std::count_if(reports.begin(), reports.end(), [](const DecodedReport& r) {
+              return r.report.type == ExecType::Trade;
+          })) == tradeEvents && tradeEvents > 0,
+          "The runner's drop copy carries every trade");
+    std::filesystem::remove(path);
+}
+
 int main() {
     std::cout << "=== Matching Engine Tests ===\n";
 
@@ -152,6 +2504,46 @@ int main() {
     testMarketOrder();
     testCancel();
     testMultipleFillsAtSameLevel();
+    testBestPriceAfterLevelEmpties();
+    testLadderRecenter();
+    testTickSize();
+    testCancelFromMiddleOfLevel();
+    testOrderIndex();
+    testDirectIndexMode();
+    testListenerEvents();
+    testCancelReleasesPoolSlot();
+    testGrowablePool();
+    testPoolBackingOptions();
+    testOrderMeta();
+    testClockSources();
+    testSpscRing();
+    testEngineRunner();
+    testMultiSymbolEngine();
+    testShardedRunner();
+    testJournalReplay();
+    testSnapshotRoundTrip();
+    testSnapshotRecovery();
+    testSubmitBatch();
+    testL2Publisher();
+    testTopOfBook();
+    testModify();
+    testExtendedOrderTypes();
+    testHistogram();
+    testWorkload();
+    testInstrumentation();
+    testHandles();
+    testLazyCancel();
+    testDepthQueries();
+    testProtocol();
+    testStopOrders();
+    testAuction();
+    testBacktest();
+    testReplication();
+    testRiskChecks();
+    testDropCopy();
+#if defined(__linux__)
+    testGateway();
+#endif
 
     std::cout << "\n=== Results: " << testsPassed << " passed, "
               << testsFailed << " failed ===\n";